@@ -0,0 +1,264 @@
+#include "harness.h"
+#include "castor/bulk.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// Size of the table of the lookup cases, about what a co-running service
+// keeps hot in the cache
+#define BULK_TABLE_BYTES ((usize)4 << 20)
+
+// Lookups per repetition of the lookup cases
+#define BULK_LOOKUPS ((usize)1 << 20)
+
+// A threshold never reached
+#define BULK_NEVER UINT64_MAX
+
+// Split size of the parallel policies
+#define BULK_PARALLEL ((usize)2 << 20)
+
+
+// Member:
+// - objects:
+//    The count objects appended by each operation.
+// - vector:
+//    The Vector they are appended to, its pages already touched.
+// - table:
+//    The table of the lookup cases, or nullptr.
+// - options:
+//    The bulk options before the case, restored by cleanup.
+typedef struct BulkBench {
+  u8*               objects;
+  Vector*           vector;
+  u64*              table;
+  VectorBulkOptions options;
+} BulkBench;
+
+
+static bool bulk_bench_prepare(
+  BenchState*             state,
+  const VectorBulkOptions options,
+  const bool              lookup
+) {
+  BulkBench* bench = calloc(1, sizeof(BulkBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+  vector_bulk_options(&bench->options);
+  vector_bulk_configure(options);
+
+  const usize bytes = state->count * state->object_size;
+  bench->objects = malloc(bytes);
+  if (bench->objects == nullptr) {
+    return false;
+  }
+  for (usize i = 0; i < state->count; i++) {
+    memcpy(
+      bench->objects + i * state->object_size,
+      state->object,
+      state->object_size
+    );
+  }
+
+  // Touch the pages of the Vector once, so that the copies are timed
+  // rather than the page faults
+  bench->vector = vector_construct(
+    state->object_size,
+    (VectorOptions){ .capacity = state->count }
+  );
+  if (
+    bench->vector == nullptr ||
+    !vector_append(bench->vector, bench->objects, state->count)
+  ) {
+    return false;
+  }
+  vector_reset(bench->vector);
+
+  if (lookup) {
+    bench->table = malloc(BULK_TABLE_BYTES);
+    if (bench->table == nullptr) {
+      return false;
+    }
+    for (usize i = 0; i < BULK_TABLE_BYTES / sizeof(u64); i++) {
+      bench->table[i] = i * 0x9e3779b97f4a7c15;
+    }
+    state->operations = BULK_LOOKUPS;
+    state->bytes = BULK_LOOKUPS * sizeof(u64);
+  } else {
+    state->operations = bench_linear_operations(state, bytes);
+    state->bytes = state->operations * bytes;
+  }
+
+  return true;
+}
+
+static void bulk_bench_cleanup(BenchState* state) {
+  BulkBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  vector_bulk_configure(bench->options);
+  vector_destruct(bench->vector);
+  free(bench->objects);
+  free(bench->table);
+  free(bench);
+}
+
+// The policies: a plain memcpy, non-temporal stores, split across the
+// threads, both, and the defaults of the machine
+static const VectorBulkOptions bulk_memcpy = {
+  .threads   = 1,
+  .parallel  = BULK_NEVER,
+  .streaming = BULK_NEVER,
+};
+
+static const VectorBulkOptions bulk_streaming = {
+  .threads   = 1,
+  .parallel  = BULK_NEVER,
+  .streaming = 1,
+};
+
+static const VectorBulkOptions bulk_parallel = {
+  .parallel  = BULK_PARALLEL,
+  .streaming = BULK_NEVER,
+};
+
+static const VectorBulkOptions bulk_streaming_parallel = {
+  .parallel  = BULK_PARALLEL,
+  .streaming = 1,
+};
+
+static bool prepare_memcpy(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_memcpy, false);
+}
+
+static bool prepare_streaming(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_streaming, false);
+}
+
+static bool prepare_parallel(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_parallel, false);
+}
+
+static bool prepare_streaming_parallel(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_streaming_parallel, false);
+}
+
+static bool prepare_default(BenchState* state) {
+  return bulk_bench_prepare(state, (VectorBulkOptions){}, false);
+}
+
+static bool prepare_lookup_memcpy(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_memcpy, true);
+}
+
+static bool prepare_lookup_streaming(BenchState* state) {
+  return bulk_bench_prepare(state, bulk_streaming, true);
+}
+
+static void run_append(BenchState* state) {
+  BulkBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_reset(bench->vector);
+    vector_append(bench->vector, bench->objects, state->count);
+  }
+  state->sink += *(u8*)vector_get_back(bench->vector);
+}
+
+// The cost of a copy to the other work of the machine: the table is warmed,
+// a copy is made as a co-running thread would, then the lookups are timed.
+// The copy is made before rather than alongside them, so that the case also
+// holds on a single CPU.
+static bool setup_lookup(BenchState* state) {
+  BulkBench* bench = state->context;
+  for (usize i = 0; i < BULK_TABLE_BYTES / sizeof(u64); i++) {
+    state->sink += bench->table[i];
+  }
+  vector_reset(bench->vector);
+  return vector_append(bench->vector, bench->objects, state->count);
+}
+
+static void run_lookup(BenchState* state) {
+  BulkBench* bench = state->context;
+  const usize mask = BULK_TABLE_BYTES / sizeof(u64) - 1;
+  u64 x = 0x2545f4914f6cdd1d;
+  u64 sum = 0;
+  for (usize i = 0; i < BULK_LOOKUPS; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    sum += bench->table[x & mask];
+  }
+  state->sink += sum;
+}
+
+static const BenchCase bulk_cases[] = {
+  {
+    .group     = "bulk",
+    .operation = "append",
+    .policy    = "memcpy",
+    .prepare   = prepare_memcpy,
+    .cleanup   = bulk_bench_cleanup,
+    .run       = run_append,
+  },
+  {
+    .group     = "bulk",
+    .operation = "append",
+    .policy    = "streaming",
+    .prepare   = prepare_streaming,
+    .cleanup   = bulk_bench_cleanup,
+    .run       = run_append,
+  },
+  {
+    .group     = "bulk",
+    .operation = "append",
+    .policy    = "parallel",
+    .prepare   = prepare_parallel,
+    .cleanup   = bulk_bench_cleanup,
+    .run       = run_append,
+  },
+  {
+    .group     = "bulk",
+    .operation = "append",
+    .policy    = "streaming_parallel",
+    .prepare   = prepare_streaming_parallel,
+    .cleanup   = bulk_bench_cleanup,
+    .run       = run_append,
+  },
+  {
+    .group     = "bulk",
+    .operation = "append",
+    .policy    = "default",
+    .prepare   = prepare_default,
+    .cleanup   = bulk_bench_cleanup,
+    .run       = run_append,
+  },
+  {
+    .group     = "bulk",
+    .operation = "lookup",
+    .policy    = "memcpy",
+    .prepare   = prepare_lookup_memcpy,
+    .cleanup   = bulk_bench_cleanup,
+    .setup     = setup_lookup,
+    .run       = run_lookup,
+  },
+  {
+    .group     = "bulk",
+    .operation = "lookup",
+    .policy    = "streaming",
+    .prepare   = prepare_lookup_streaming,
+    .cleanup   = bulk_bench_cleanup,
+    .setup     = setup_lookup,
+    .run       = run_lookup,
+  },
+};
+
+void bench_bulk_register(void) {
+  for (usize i = 0; i < sizeof(bulk_cases) / sizeof(*bulk_cases); i++) {
+    bench_register(&bulk_cases[i]);
+  }
+}
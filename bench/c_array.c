@@ -0,0 +1,339 @@
+#include "harness.h"
+#include "castor/types.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// The baseline: the same operations written by hand on a plain C array,
+// growing by doubling as Vector does.
+
+// Member:
+// - data:
+//    The objects.
+// - count:
+//    Number of objects.
+// - capacity:
+//    Number of objects data has room for.
+// - dest:
+//    Receives the popped objects.
+// - copies:
+//    The copies made by the copy case.
+typedef struct ArrayBench {
+  u8*   data;
+  usize count;
+  usize capacity;
+  u8*   dest;
+  u8**  copies;
+} ArrayBench;
+
+
+static bool array_reserve(ArrayBench* array, const usize size, const usize n) {
+  if (array->count + n <= array->capacity) {
+    return true;
+  }
+
+  usize capacity = array->capacity ? array->capacity * 2 : 16;
+  while (capacity < array->count + n) {
+    capacity *= 2;
+  }
+  u8* data = realloc(array->data, capacity * size);
+  if (data == nullptr) {
+    return false;
+  }
+  array->data = data;
+  array->capacity = capacity;
+  return true;
+}
+
+static void array_push_back(ArrayBench* array, const usize size, void* o) {
+  if (array_reserve(array, size, 1)) {
+    memcpy(array->data + array->count++ * size, o, size);
+  }
+}
+
+static bool array_prepare(BenchState* state, const bool filled) {
+  ArrayBench* array = calloc(1, sizeof(ArrayBench));
+  if (array == nullptr) {
+    return false;
+  }
+  state->context = array;
+
+  array->dest = malloc(state->object_size);
+  if (array->dest == nullptr) {
+    return false;
+  }
+
+  if (filled) {
+    if (!array_reserve(array, state->object_size, state->count)) {
+      return false;
+    }
+    for (usize i = 0; i < state->count; i++) {
+      array_push_back(array, state->object_size, state->object);
+    }
+  }
+
+  return true;
+}
+
+static void array_cleanup(BenchState* state) {
+  ArrayBench* array = state->context;
+  if (array == nullptr) {
+    return;
+  }
+
+  if (array->copies != nullptr) {
+    for (usize i = 0; i < state->operations; i++) {
+      free(array->copies[i]);
+    }
+  }
+  free(array->copies);
+  free(array->data);
+  free(array->dest);
+  free(array);
+}
+
+static bool prepare_empty(BenchState* state) {
+  return array_prepare(state, false);
+}
+
+static bool prepare_filled(BenchState* state) {
+  return array_prepare(state, true);
+}
+
+static bool prepare_linear(BenchState* state) {
+  if (!array_prepare(state, true)) {
+    return false;
+  }
+  const usize bytes = state->count * state->object_size;
+  state->operations = bench_linear_operations(state, bytes);
+  state->bytes = state->operations * bytes;
+  return true;
+}
+
+static bool prepare_linear_middle(BenchState* state) {
+  if (!array_prepare(state, true)) {
+    return false;
+  }
+  const usize bytes = state->count / 2 * state->object_size;
+  state->operations = bench_linear_operations(state, bytes);
+  state->bytes = state->operations * bytes;
+  return true;
+}
+
+static bool prepare_copy(BenchState* state) {
+  if (!prepare_linear(state)) {
+    return false;
+  }
+  ArrayBench* array = state->context;
+  array->copies = calloc(state->operations, sizeof(u8*));
+  return array->copies != nullptr;
+}
+
+static void teardown_clear(BenchState* state) {
+  ArrayBench* array = state->context;
+  free(array->data);
+  array->data = nullptr;
+  array->count = 0;
+  array->capacity = 0;
+}
+
+static void teardown_shrink(BenchState* state) {
+  ArrayBench* array = state->context;
+  array->count -= state->operations;
+}
+
+static void teardown_refill(BenchState* state) {
+  ArrayBench* array = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    array_push_back(array, state->object_size, state->object);
+  }
+}
+
+static void teardown_refill_all(BenchState* state) {
+  ArrayBench* array = state->context;
+  array->count = 0;
+  for (usize i = 0; i < state->count; i++) {
+    array_push_back(array, state->object_size, state->object);
+  }
+}
+
+static void teardown_copy(BenchState* state) {
+  ArrayBench* array = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    free(array->copies[i]);
+    array->copies[i] = nullptr;
+  }
+}
+
+static void run_push_back(BenchState* state) {
+  ArrayBench* array = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    array_push_back(array, state->object_size, state->object);
+  }
+}
+
+static void step_push_back(BenchState* state, const usize) {
+  array_push_back(state->context, state->object_size, state->object);
+}
+
+static void run_push_front(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->operations; i++) {
+    if (array_reserve(array, size, 1)) {
+      memmove(array->data + size, array->data, array->count * size);
+      memcpy(array->data, state->object, size);
+      array->count++;
+    }
+  }
+}
+
+static void run_pop_back(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->count; i++) {
+    memcpy(array->dest, array->data + --array->count * size, size);
+    state->sink += array->dest[0];
+  }
+}
+
+static void run_pop_front(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->operations; i++) {
+    memcpy(array->dest, array->data, size);
+    array->count--;
+    memmove(array->data, array->data + size, array->count * size);
+    state->sink += array->dest[0];
+  }
+}
+
+static void run_get(BenchState* state) {
+  ArrayBench* array = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += array->data[i * state->object_size];
+  }
+}
+
+static void run_set(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->count; i++) {
+    memcpy(array->data + i * size, state->object, size);
+  }
+}
+
+static void run_insert(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->operations; i++) {
+    if (array_reserve(array, size, 1)) {
+      u8* at = array->data + array->count / 2 * size;
+      memmove(at + size, at, (array->count - array->count / 2) * size);
+      memcpy(at, state->object, size);
+      array->count++;
+    }
+  }
+}
+
+static void run_discard(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize size = state->object_size;
+  for (usize i = 0; i < state->operations; i++) {
+    const usize index = array->count / 2;
+    u8* at = array->data + index * size;
+    memmove(at, at + size, (array->count - index - 1) * size);
+    array->count--;
+  }
+}
+
+static void run_copy(BenchState* state) {
+  ArrayBench* array = state->context;
+  const usize bytes = array->count * state->object_size;
+  for (usize i = 0; i < state->operations; i++) {
+    array->copies[i] = malloc(bytes);
+    if (array->copies[i] != nullptr) {
+      memcpy(array->copies[i], array->data, bytes);
+    }
+  }
+}
+
+static const BenchCase c_array_cases[] = {
+  {
+    .group     = "c_array",
+    .operation = "push_back",
+    .prepare   = prepare_empty,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_clear,
+    .run       = run_push_back,
+    .step      = step_push_back,
+  },
+  {
+    .group     = "c_array",
+    .operation = "push_front",
+    .prepare   = prepare_linear,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_shrink,
+    .run       = run_push_front,
+  },
+  {
+    .group     = "c_array",
+    .operation = "pop_back",
+    .prepare   = prepare_filled,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_refill_all,
+    .run       = run_pop_back,
+  },
+  {
+    .group     = "c_array",
+    .operation = "pop_front",
+    .prepare   = prepare_linear,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_pop_front,
+  },
+  {
+    .group     = "c_array",
+    .operation = "get",
+    .prepare   = prepare_filled,
+    .cleanup   = array_cleanup,
+    .run       = run_get,
+  },
+  {
+    .group     = "c_array",
+    .operation = "set",
+    .prepare   = prepare_filled,
+    .cleanup   = array_cleanup,
+    .run       = run_set,
+  },
+  {
+    .group     = "c_array",
+    .operation = "insert",
+    .prepare   = prepare_linear_middle,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_shrink,
+    .run       = run_insert,
+  },
+  {
+    .group     = "c_array",
+    .operation = "discard",
+    .prepare   = prepare_linear_middle,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_discard,
+  },
+  {
+    .group     = "c_array",
+    .operation = "copy",
+    .prepare   = prepare_copy,
+    .cleanup   = array_cleanup,
+    .teardown  = teardown_copy,
+    .run       = run_copy,
+  },
+};
+
+void bench_c_array_register(void) {
+  for (usize i = 0; i < sizeof(c_array_cases) / sizeof(*c_array_cases); i++) {
+    bench_register(&c_array_cases[i]);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,519 @@
+#define _GNU_SOURCE
+#include "compare.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Longest case name, as in the harness
+#define BENCH_NAME_MAX 128
+
+// Deepest nesting of the values skipped by the parser
+#define BENCH_PARSE_DEPTH 32
+
+
+// Member:
+// - name:
+//    Name of the case.
+// - object_size, count:
+//    The combination.
+// - samples:
+//    The ns per operation of each repetition.
+// - n:
+//    Number of samples.
+// - median:
+//    Median of the samples.
+typedef struct BenchResult {
+  char  name[BENCH_NAME_MAX];
+  usize object_size;
+  usize count;
+  f64*  samples;
+  usize n;
+  f64   median;
+} BenchResult;
+
+// Member:
+// - results:
+//    Vector of BenchResult.
+struct BenchResults {
+  Vector* results;
+};
+
+// The parser only keeps what the comparison needs and skips the rest.
+// Member:
+// - at:
+//    Next character to read.
+// - end:
+//    End of the text, which is followed by a null character.
+typedef struct BenchParser {
+  const char* at;
+  const char* end;
+} BenchParser;
+
+// A sample and the run it comes from, ranked by the test
+typedef struct BenchRanked {
+  f64  value;
+  bool current;
+} BenchRanked;
+
+
+static void parse_space(BenchParser* parser) {
+  while (
+    parser->at < parser->end &&
+    (*parser->at == ' ' || *parser->at == '\n' ||
+     *parser->at == '\r' || *parser->at == '\t')
+  ) {
+    parser->at++;
+  }
+}
+
+// Consumes the character if it comes next
+static bool parse_char(BenchParser* parser, const char c) {
+  parse_space(parser);
+  if (parser->at < parser->end && *parser->at == c) {
+    parser->at++;
+    return true;
+  }
+  return false;
+}
+
+// Reads a string into dest, truncated to size. Escapes other than the
+// simple ones are replaced by '?'.
+static bool parse_string(BenchParser* parser, char* dest, const usize size) {
+  if (!parse_char(parser, '"')) {
+    return false;
+  }
+
+  usize length = 0;
+  while (parser->at < parser->end && *parser->at != '"') {
+    char c = *parser->at++;
+    if (c == '\\') {
+      if (parser->at == parser->end) {
+        return false;
+      }
+      c = *parser->at++;
+      if (c == 'u') {
+        parser->at += parser->end - parser->at < 4 ? 0 : 4;
+        c = '?';
+      } else if (c == 'n') {
+        c = '\n';
+      } else if (c == 't') {
+        c = '\t';
+      } else if (c != '"' && c != '\\' && c != '/') {
+        c = '?';
+      }
+    }
+    if (dest != nullptr && length + 1 < size) {
+      dest[length++] = c;
+    }
+  }
+  if (dest != nullptr && size > 0) {
+    dest[length] = '\0';
+  }
+  return parse_char(parser, '"');
+}
+
+static bool parse_number(BenchParser* parser, f64* value) {
+  parse_space(parser);
+  char* end;
+  *value = strtod(parser->at, &end);
+  if (end == parser->at) {
+    return false;
+  }
+  parser->at = end;
+  return true;
+}
+
+static bool parse_literal(BenchParser* parser, const char* literal) {
+  const usize length = strlen(literal);
+  parse_space(parser);
+  if (
+    (usize)(parser->end - parser->at) < length ||
+    memcmp(parser->at, literal, length) != 0
+  ) {
+    return false;
+  }
+  parser->at += length;
+  return true;
+}
+
+static bool parse_skip(BenchParser* parser, const usize depth) {
+  if (depth == BENCH_PARSE_DEPTH) {
+    return false;
+  }
+
+  parse_space(parser);
+  if (parser->at == parser->end) {
+    return false;
+  }
+
+  switch (*parser->at) {
+    case '"':
+      return parse_string(parser, nullptr, 0);
+    case '{':
+      parser->at++;
+      if (parse_char(parser, '}')) {
+        return true;
+      }
+      do {
+        if (
+          !parse_string(parser, nullptr, 0) || !parse_char(parser, ':') ||
+          !parse_skip(parser, depth + 1)
+        ) {
+          return false;
+        }
+      } while (parse_char(parser, ','));
+      return parse_char(parser, '}');
+    case '[':
+      parser->at++;
+      if (parse_char(parser, ']')) {
+        return true;
+      }
+      do {
+        if (!parse_skip(parser, depth + 1)) {
+          return false;
+        }
+      } while (parse_char(parser, ','));
+      return parse_char(parser, ']');
+    case 't':
+      return parse_literal(parser, "true");
+    case 'f':
+      return parse_literal(parser, "false");
+    case 'n':
+      return parse_literal(parser, "null");
+    default: {
+      f64 value;
+      return parse_number(parser, &value);
+    }
+  }
+}
+
+static bool parse_samples(BenchParser* parser, BenchResult* result) {
+  if (!parse_char(parser, '[')) {
+    return false;
+  }
+  if (parse_char(parser, ']')) {
+    return true;
+  }
+
+  usize capacity = 0;
+  do {
+    if (result->n == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      f64* samples = realloc(result->samples, capacity * sizeof(f64));
+      if (samples == nullptr) {
+        return false;
+      }
+      result->samples = samples;
+    }
+    if (!parse_number(parser, &result->samples[result->n])) {
+      return false;
+    }
+    result->n++;
+  } while (parse_char(parser, ','));
+  return parse_char(parser, ']');
+}
+
+static int bench_compare_f64(const void* a, const void* b) {
+  const f64 x = *(const f64*)a;
+  const f64 y = *(const f64*)b;
+  return (x > y) - (x < y);
+}
+
+static bool bench_result_median(BenchResult* result) {
+  f64* sorted = malloc(result->n * sizeof(f64));
+  if (sorted == nullptr) {
+    return false;
+  }
+  memcpy(sorted, result->samples, result->n * sizeof(f64));
+  qsort(sorted, result->n, sizeof(f64), bench_compare_f64);
+
+  const usize half = result->n / 2;
+  result->median = result->n % 2
+    ? sorted[half]
+    : (sorted[half - 1] + sorted[half]) / 2;
+  free(sorted);
+  return true;
+}
+
+static bool parse_result(BenchParser* parser, BenchResult* result) {
+  if (!parse_char(parser, '{')) {
+    return false;
+  }
+
+  do {
+    char key[BENCH_NAME_MAX];
+    f64 value;
+    if (!parse_string(parser, key, sizeof(key)) || !parse_char(parser, ':')) {
+      return false;
+    }
+
+    bool ok;
+    if (strcmp(key, "name") == 0) {
+      ok = parse_string(parser, result->name, sizeof(result->name));
+    } else if (strcmp(key, "object_size") == 0) {
+      ok = parse_number(parser, &value);
+      result->object_size = (usize)value;
+    } else if (strcmp(key, "count") == 0) {
+      ok = parse_number(parser, &value);
+      result->count = (usize)value;
+    } else if (strcmp(key, "samples") == 0) {
+      ok = parse_samples(parser, result);
+    } else {
+      ok = parse_skip(parser, 0);
+    }
+    if (!ok) {
+      return false;
+    }
+  } while (parse_char(parser, ','));
+
+  return parse_char(parser, '}') && result->n > 0 &&
+    bench_result_median(result);
+}
+
+static bool parse_results(BenchParser* parser, BenchResults* results) {
+  if (!parse_char(parser, '[')) {
+    return false;
+  }
+  if (parse_char(parser, ']')) {
+    return true;
+  }
+
+  do {
+    BenchResult result = {};
+    if (
+      !parse_result(parser, &result) ||
+      !vector_push_back(results->results, &result)
+    ) {
+      free(result.samples);
+      return false;
+    }
+  } while (parse_char(parser, ','));
+  return parse_char(parser, ']');
+}
+
+// Reads the rest of the file, followed by a null character
+static char* bench_read_file(FILE* file, usize* length) {
+  usize capacity = 64 * 1024;
+  usize size = 0;
+  char* text = malloc(capacity);
+  while (text != nullptr) {
+    size += fread(text + size, 1, capacity - size - 1, file);
+    if (size + 1 < capacity) {
+      break;
+    }
+    capacity *= 2;
+    char* grown = realloc(text, capacity);
+    if (grown == nullptr) {
+      free(text);
+    }
+    text = grown;
+  }
+
+  if (text == nullptr || ferror(file)) {
+    free(text);
+    return nullptr;
+  }
+  text[size] = '\0';
+  *length = size;
+  return text;
+}
+
+BenchResults* bench_results_read(FILE* file) {
+  usize length;
+  char* text = bench_read_file(file, &length);
+  if (text == nullptr) {
+    return nullptr;
+  }
+
+  BenchResults* results = malloc(sizeof(BenchResults));
+  if (results == nullptr) {
+    free(text);
+    return nullptr;
+  }
+  results->results = vector_construct(sizeof(BenchResult), (VectorOptions){});
+  if (results->results == nullptr) {
+    free(results);
+    free(text);
+    return nullptr;
+  }
+
+  BenchParser parser = { .at = text, .end = text + length };
+  bool ok = parse_char(&parser, '{');
+  bool found = false;
+  while (ok && !parse_char(&parser, '}')) {
+    char key[BENCH_NAME_MAX];
+    ok = parse_string(&parser, key, sizeof(key)) && parse_char(&parser, ':');
+    if (ok && strcmp(key, "results") == 0) {
+      ok = parse_results(&parser, results);
+      found = true;
+    } else if (ok) {
+      ok = parse_skip(&parser, 0);
+    }
+    if (ok) {
+      parse_char(&parser, ',');
+    }
+  }
+  free(text);
+
+  if (!ok || !found) {
+    bench_results_destruct(results);
+    return nullptr;
+  }
+  return results;
+}
+
+void bench_results_destruct(BenchResults* results) {
+  if (results == nullptr) {
+    return;
+  }
+
+  Vector* vector = results->results;
+  for (usize i = 0; vector_get(vector, i) != nullptr; i++) {
+    free(((BenchResult*)vector_get(vector, i))->samples);
+  }
+  vector_destruct(vector);
+  free(results);
+}
+
+static const BenchResult* bench_results_find(
+  const BenchResults* results,
+  const BenchResult*  key
+) {
+  const BenchResult* result;
+  for (usize i = 0; (result = vector_get(results->results, i)); i++) {
+    if (
+      result->object_size == key->object_size &&
+      result->count == key->count && strcmp(result->name, key->name) == 0
+    ) {
+      return result;
+    }
+  }
+  return nullptr;
+}
+
+static int bench_compare_ranked(const void* a, const void* b) {
+  return bench_compare_f64(
+    &((const BenchRanked*)a)->value, &((const BenchRanked*)b)->value
+  );
+}
+
+// One-sided Mann-Whitney U test with the normal approximation, corrected
+// for ties and continuity. Returns the p-value of the current samples being
+// larger than the baseline, or smaller if slower is false; 1 if the test
+// cannot be computed.
+static f64 bench_mann_whitney(
+  const BenchResult* baseline,
+  const BenchResult* current,
+  const bool         slower
+) {
+  const usize n1 = current->n;
+  const usize n2 = baseline->n;
+  const usize n = n1 + n2;
+  BenchRanked* ranked = malloc(n * sizeof(BenchRanked));
+  if (ranked == nullptr) {
+    return 1;
+  }
+  for (usize i = 0; i < n1; i++) {
+    ranked[i] = (BenchRanked){ current->samples[i], true };
+  }
+  for (usize i = 0; i < n2; i++) {
+    ranked[n1 + i] = (BenchRanked){ baseline->samples[i], false };
+  }
+  qsort(ranked, n, sizeof(BenchRanked), bench_compare_ranked);
+
+  // Tied samples share the mean of their ranks
+  f64 ranks = 0;
+  f64 ties = 0;
+  for (usize i = 0; i < n;) {
+    usize j = i + 1;
+    while (j < n && ranked[j].value == ranked[i].value) {
+      j++;
+    }
+    const f64 rank = (f64)(i + j + 1) / 2;
+    for (usize k = i; k < j; k++) {
+      ranks += ranked[k].current ? rank : 0;
+    }
+    const f64 t = (f64)(j - i);
+    ties += t * t * t - t;
+    i = j;
+  }
+  free(ranked);
+
+  const f64 u = ranks - (f64)n1 * (f64)(n1 + 1) / 2;
+  const f64 mean = (f64)n1 * (f64)n2 / 2;
+  const f64 variance = (f64)n1 * (f64)n2 / 12 *
+    ((f64)(n + 1) - ties / ((f64)n * (f64)(n - 1)));
+  if (variance <= 0) {
+    return 1;
+  }
+
+  const f64 shift = slower ? u - mean : mean - u;
+  const f64 z = (shift - 0.5) / sqrt(variance);
+  return 0.5 * erfc(z / sqrt(2));
+}
+
+usize bench_results_compare(
+  const BenchResults*       baseline,
+  const BenchResults*       current,
+  const BenchCompareOptions options,
+  FILE*                     out
+) {
+  const f64 alpha = options.alpha > 0 ? options.alpha : 0.01;
+  const f64 threshold = options.threshold > 0 ? options.threshold : 0.1;
+  usize compared = 0;
+  usize regressions = 0;
+  usize improvements = 0;
+  usize missing = 0;
+
+  fprintf(
+    out, "%-40s %5s %10s %12s %12s %8s %8s  %s\n",
+    "case", "size", "count", "baseline", "current", "change", "p", "verdict"
+  );
+
+  const BenchResult* result;
+  for (usize i = 0; (result = vector_get(current->results, i)); i++) {
+    const BenchResult* base = bench_results_find(baseline, result);
+    if (base == nullptr) {
+      fprintf(
+        out, "%-40s %5zu %10zu %12s %10.2fns %8s %8s  new\n",
+        result->name, (size_t)result->object_size, (size_t)result->count,
+        "-", result->median, "-", "-"
+      );
+      missing++;
+      continue;
+    }
+
+    compared++;
+    const f64 change = base->median > 0
+      ? result->median / base->median - 1
+      : 0;
+    const bool slower = change > 0;
+    const f64 p = bench_mann_whitney(base, result, slower);
+
+    const char* verdict = "";
+    if (p < alpha && fabs(change) > threshold) {
+      verdict = slower ? "REGRESSION" : "improvement";
+      regressions += slower;
+      improvements += !slower;
+    }
+
+    fprintf(
+      out, "%-40s %5zu %10zu %10.2fns %10.2fns %+7.1f%% %8.4f  %s\n",
+      result->name, (size_t)result->object_size, (size_t)result->count,
+      base->median, result->median, change * 100, p, verdict
+    );
+  }
+
+  fprintf(
+    out,
+    "\n%zu compared, %zu regressions, %zu improvements, "
+    "%zu not in the baseline (alpha %.3g, threshold %.3g%%)\n",
+    (size_t)compared, (size_t)regressions, (size_t)improvements,
+    (size_t)missing, alpha, threshold * 100
+  );
+  return regressions;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "castor/types.h"
+#include <stdio.h>
+
+
+// The regression gate compares the results of a run of the harness to a
+// baseline, another run of the harness saved as JSON. Each combination of
+// case, object size and count present in both is compared on its samples
+// with a one-sided Mann-Whitney U test, which makes no assumption on their
+// distribution. A combination has regressed when the test is significant
+// and its median got slower by more than the threshold; both conditions
+// are needed, so that noise does not fail the gate and tiny but consistent
+// shifts do not either.
+typedef struct BenchResults BenchResults;
+
+// BenchCompareOptions holds the parameters of a comparison.
+typedef struct BenchCompareOptions BenchCompareOptions;
+
+
+// Member:
+// - alpha:
+//    Significance level of the test, 0.01 if 0.
+// - threshold:
+//    Smallest relative change of the median that counts, 0.1 if 0.
+struct BenchCompareOptions {
+  f64 alpha;
+  f64 threshold;
+};
+
+
+// Reads the results written by bench_run from the current position of the
+// file to its end. Returns nullptr if they cannot be read or parsed.
+BenchResults* bench_results_read(FILE*);
+
+void bench_results_destruct(BenchResults*);
+
+// Compares the current results to the baseline and writes a table of the
+// combinations to out, one row per case, object size and count, followed
+// by a summary line. Returns the number of regressions.
+usize bench_results_compare(
+  const BenchResults*       baseline,
+  const BenchResults*       current,
+  const BenchCompareOptions options,
+  FILE*                     out
+);
@@ -0,0 +1,296 @@
+#include "harness.h"
+#include "castor/dict.h"
+#include "castor/packed.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// The cases of PackedSequence and DictVector. Both hold u64-sized entries,
+// so the cases only run with an object size of 8; the bytes per operation
+// of decode are those of the decoded integers, which gives its GB/s.
+
+// Number of distinct values of the DictVector
+#define CONTAINERS_CARDINALITY 1000
+
+// Number of values looked up by dict_vector_in
+#define CONTAINERS_IN_KEYS 16
+
+// Longest value of the DictVector
+#define CONTAINERS_VALUE_MAX 32
+
+
+// Member:
+// - sequence:
+//    A PackedSequence of count increasing integers.
+// - dict:
+//    A DictVector of count values out of CONTAINERS_CARDINALITY.
+// - dest:
+//    Receives the decoded integers or the bitmaps.
+// - values:
+//    The strings of the DictVector.
+typedef struct ContainersBench {
+  PackedSequence* sequence;
+  DictVector*     dict;
+  Vector*         dest;
+  char            values[CONTAINERS_CARDINALITY][CONTAINERS_VALUE_MAX];
+} ContainersBench;
+
+
+static bool containers_supports(const usize object_size, const usize count) {
+  return object_size == sizeof(u64) && count >= 10;
+}
+
+// Increasing by small, irregular steps, as the ids of a posting list
+static u64 containers_value(const usize index) {
+  return index * 7 + (index * 2654435761u >> 7) % 13;
+}
+
+static bool containers_prepare(
+  BenchState* state,
+  const bool  packed,
+  const bool  dict
+) {
+  ContainersBench* bench = calloc(1, sizeof(ContainersBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  bench->dest = vector_construct(sizeof(u64), (VectorOptions){});
+  if (bench->dest == nullptr) {
+    return false;
+  }
+
+  if (packed) {
+    bench->sequence = packed_sequence_construct();
+    if (bench->sequence == nullptr) {
+      return false;
+    }
+    for (usize i = 0; i < state->count; i++) {
+      if (!packed_sequence_push_back(bench->sequence, containers_value(i))) {
+        return false;
+      }
+    }
+  }
+
+  for (usize i = 0; i < CONTAINERS_CARDINALITY; i++) {
+    snprintf(
+      bench->values[i], CONTAINERS_VALUE_MAX, "value-%zu", (size_t)i
+    );
+  }
+
+  if (dict) {
+    bench->dict = dict_vector_construct(
+      (DictVectorOptions){ .capacity = state->count }
+    );
+    if (bench->dict == nullptr) {
+      return false;
+    }
+    for (usize i = 0; i < state->count; i++) {
+      const char* value = bench->values[i % CONTAINERS_CARDINALITY];
+      if (!dict_vector_push_back(bench->dict, value, strlen(value))) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static void containers_cleanup(BenchState* state) {
+  ContainersBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  packed_sequence_destruct(bench->sequence);
+  dict_vector_destruct(bench->dict);
+  vector_destruct(bench->dest);
+  free(bench);
+}
+
+static bool prepare_empty(BenchState* state) {
+  return containers_prepare(state, false, false);
+}
+
+static bool prepare_packed(BenchState* state) {
+  return containers_prepare(state, true, false);
+}
+
+static bool prepare_dict(BenchState* state) {
+  return containers_prepare(state, false, true);
+}
+
+static bool setup_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  bench->sequence = packed_sequence_construct();
+  return bench->sequence != nullptr;
+}
+
+static void teardown_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  packed_sequence_destruct(bench->sequence);
+  bench->sequence = nullptr;
+}
+
+static void run_packed_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    packed_sequence_push_back(bench->sequence, containers_value(i));
+  }
+}
+
+static void step_packed_push_back(BenchState* state, const usize index) {
+  ContainersBench* bench = state->context;
+  packed_sequence_push_back(bench->sequence, containers_value(index));
+}
+
+static void teardown_decode(BenchState* state) {
+  ContainersBench* bench = state->context;
+  vector_reset(bench->dest);
+}
+
+static void run_packed_decode(BenchState* state) {
+  ContainersBench* bench = state->context;
+  packed_sequence_decode(bench->sequence, 0, state->count, bench->dest);
+}
+
+static void run_packed_get(BenchState* state) {
+  ContainersBench* bench = state->context;
+  u64 value;
+  for (usize i = 0; i < state->count; i++) {
+    packed_sequence_get(bench->sequence, i, &value);
+    state->sink += value;
+  }
+}
+
+static void run_packed_lower_bound(BenchState* state) {
+  ContainersBench* bench = state->context;
+  const u64 last = containers_value(state->count - 1);
+  for (usize i = 0; i < state->count; i++) {
+    const u64 value = (i * 2654435761u) % (last + 1);
+    state->sink += packed_sequence_lower_bound(bench->sequence, value);
+  }
+}
+
+static void run_dict_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    const char* value = bench->values[i % CONTAINERS_CARDINALITY];
+    dict_vector_push_back(bench->dict, value, strlen(value));
+  }
+}
+
+static void step_dict_push_back(BenchState* state, const usize index) {
+  ContainersBench* bench = state->context;
+  const char* value = bench->values[index % CONTAINERS_CARDINALITY];
+  dict_vector_push_back(bench->dict, value, strlen(value));
+}
+
+static bool setup_dict_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  bench->dict = dict_vector_construct((DictVectorOptions){});
+  return bench->dict != nullptr;
+}
+
+static void teardown_dict_push_back(BenchState* state) {
+  ContainersBench* bench = state->context;
+  dict_vector_destruct(bench->dict);
+  bench->dict = nullptr;
+}
+
+static void run_dict_equals(BenchState* state) {
+  ContainersBench* bench = state->context;
+  const char* value = bench->values[CONTAINERS_CARDINALITY / 2];
+  state->sink += dict_vector_equals(
+    bench->dict, value, strlen(value), bench->dest
+  );
+}
+
+static void run_dict_in(BenchState* state) {
+  ContainersBench* bench = state->context;
+  DictKey keys[CONTAINERS_IN_KEYS];
+  for (usize i = 0; i < CONTAINERS_IN_KEYS; i++) {
+    const char* value = bench->values[i * 61 % CONTAINERS_CARDINALITY];
+    keys[i] = (DictKey){ .data = value, .length = strlen(value) };
+  }
+  state->sink += dict_vector_in(
+    bench->dict, keys, CONTAINERS_IN_KEYS, bench->dest
+  );
+}
+
+static const BenchCase containers_cases[] = {
+  {
+    .group     = "packed_sequence",
+    .operation = "push_back",
+    .supports  = containers_supports,
+    .prepare   = prepare_empty,
+    .cleanup   = containers_cleanup,
+    .setup     = setup_push_back,
+    .teardown  = teardown_push_back,
+    .run       = run_packed_push_back,
+    .step      = step_packed_push_back,
+  },
+  {
+    .group     = "packed_sequence",
+    .operation = "decode",
+    .supports  = containers_supports,
+    .prepare   = prepare_packed,
+    .cleanup   = containers_cleanup,
+    .teardown  = teardown_decode,
+    .run       = run_packed_decode,
+  },
+  {
+    .group     = "packed_sequence",
+    .operation = "get",
+    .supports  = containers_supports,
+    .prepare   = prepare_packed,
+    .cleanup   = containers_cleanup,
+    .run       = run_packed_get,
+  },
+  {
+    .group     = "packed_sequence",
+    .operation = "lower_bound",
+    .supports  = containers_supports,
+    .prepare   = prepare_packed,
+    .cleanup   = containers_cleanup,
+    .run       = run_packed_lower_bound,
+  },
+  {
+    .group     = "dict_vector",
+    .operation = "push_back",
+    .supports  = containers_supports,
+    .prepare   = prepare_empty,
+    .cleanup   = containers_cleanup,
+    .setup     = setup_dict_push_back,
+    .teardown  = teardown_dict_push_back,
+    .run       = run_dict_push_back,
+    .step      = step_dict_push_back,
+  },
+  {
+    .group     = "dict_vector",
+    .operation = "equals",
+    .supports  = containers_supports,
+    .prepare   = prepare_dict,
+    .cleanup   = containers_cleanup,
+    .run       = run_dict_equals,
+  },
+  {
+    .group     = "dict_vector",
+    .operation = "in",
+    .supports  = containers_supports,
+    .prepare   = prepare_dict,
+    .cleanup   = containers_cleanup,
+    .run       = run_dict_in,
+  },
+};
+
+void bench_containers_register(void) {
+  const usize count = sizeof(containers_cases) / sizeof(*containers_cases);
+  for (usize i = 0; i < count; i++) {
+    bench_register(&containers_cases[i]);
+  }
+}
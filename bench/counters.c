@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+#include "counters.h"
+#include "castor/types.h"
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Member:
+// - fds:
+//    The events, -1 for those that could not be opened.
+// - start:
+//    Count, enabled and running times read by bench_counters_start.
+// - totals:
+//    Scaled counts accumulated by bench_counters_stop.
+// - scheduled:
+//    Whether each event has been counted at all since the last reset.
+struct BenchCounters {
+  int  fds[BENCH_EVENTS];
+  u64  start[BENCH_EVENTS][3];
+  f64  totals[BENCH_EVENTS];
+  bool scheduled[BENCH_EVENTS];
+};
+
+
+static const char* bench_event_names[BENCH_EVENTS] = {
+  [BENCH_CYCLES]        = "cycles",
+  [BENCH_INSTRUCTIONS]  = "instructions",
+  [BENCH_L1D_MISSES]    = "l1d_misses",
+  [BENCH_LLC_MISSES]    = "llc_misses",
+  [BENCH_BRANCH_MISSES] = "branch_misses",
+  [BENCH_DTLB_MISSES]   = "dtlb_misses",
+};
+
+// Type and config of a read miss in the given cache
+#define BENCH_CACHE_MISS(cache)                                              \
+  PERF_TYPE_HW_CACHE,                                                        \
+  (cache) | PERF_COUNT_HW_CACHE_OP_READ << 8 |                               \
+    PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+
+static const struct {
+  u32 type;
+  u64 config;
+} bench_events[BENCH_EVENTS] = {
+  [BENCH_CYCLES] = {
+    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES
+  },
+  [BENCH_INSTRUCTIONS] = {
+    PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS
+  },
+  [BENCH_L1D_MISSES] = {
+    BENCH_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)
+  },
+  [BENCH_LLC_MISSES] = {
+    BENCH_CACHE_MISS(PERF_COUNT_HW_CACHE_LL)
+  },
+  [BENCH_BRANCH_MISSES] = {
+    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES
+  },
+  [BENCH_DTLB_MISSES] = {
+    BENCH_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB)
+  },
+};
+
+
+BenchCounters* bench_counters_construct(void) {
+  BenchCounters* counters = calloc(1, sizeof(BenchCounters));
+  if (counters == nullptr) {
+    return nullptr;
+  }
+
+  bool any = false;
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    struct perf_event_attr attr = {
+      .type           = bench_events[i].type,
+      .size           = sizeof(attr),
+      .config         = bench_events[i].config,
+      .disabled       = 1,
+      .inherit        = 1,
+      .exclude_kernel = 1,
+      .exclude_hv     = 1,
+      .read_format    =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING,
+    };
+    counters->fds[i] = (int)syscall(
+      SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC
+    );
+    any |= counters->fds[i] >= 0;
+  }
+
+  if (!any) {
+    free(counters);
+    return nullptr;
+  }
+  return counters;
+}
+
+void bench_counters_destruct(BenchCounters* counters) {
+  if (counters == nullptr) {
+    return;
+  }
+
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    if (counters->fds[i] >= 0) {
+      close(counters->fds[i]);
+    }
+  }
+  free(counters);
+}
+
+// Reads the count, enabled and running times of an event
+static bool bench_counters_read(const int fd, u64 values[3]) {
+  return read(fd, values, 3 * sizeof(u64)) == 3 * sizeof(u64);
+}
+
+void bench_counters_start(BenchCounters* counters) {
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    const int fd = counters->fds[i];
+    if (fd >= 0) {
+      bench_counters_read(fd, counters->start[i]);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+void bench_counters_stop(BenchCounters* counters) {
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    const int fd = counters->fds[i];
+    if (fd < 0) {
+      continue;
+    }
+
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    u64 end[3];
+    if (!bench_counters_read(fd, end)) {
+      continue;
+    }
+
+    const u64 count = end[0] - counters->start[i][0];
+    const u64 enabled = end[1] - counters->start[i][1];
+    const u64 running = end[2] - counters->start[i][2];
+    if (running == 0) {
+      continue;
+    }
+    counters->totals[i] += (f64)count * ((f64)enabled / (f64)running);
+    counters->scheduled[i] = true;
+  }
+}
+
+void bench_counters_reset(BenchCounters* counters) {
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    counters->totals[i] = 0;
+    counters->scheduled[i] = false;
+  }
+}
+
+bool bench_counters_total(
+  const BenchCounters* counters,
+  const BenchEvent     event,
+  f64*                 value
+) {
+  if (counters->fds[event] < 0 || !counters->scheduled[event]) {
+    return false;
+  }
+  *value = counters->totals[event];
+  return true;
+}
+
+const char* bench_event_name(const BenchEvent event) {
+  return bench_event_names[event];
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "castor/types.h"
+
+
+// BenchCounters reads hardware performance counters of the calling thread
+// and the threads it creates, through perf_event_open. Only user-space
+// events are counted, which most perf_event_paranoid settings allow.
+// Each event is opened on its own, so the ones the CPU or the kernel do not
+// provide (in containers and virtual machines, usually all of them) are
+// simply reported as unavailable. When the kernel multiplexes the events,
+// the counts are scaled by the share of time each one was counted.
+typedef struct BenchCounters BenchCounters;
+
+typedef enum BenchEvent {
+  BENCH_CYCLES,
+  BENCH_INSTRUCTIONS,
+  BENCH_L1D_MISSES,
+  BENCH_LLC_MISSES,
+  BENCH_BRANCH_MISSES,
+  BENCH_DTLB_MISSES,
+  BENCH_EVENTS,
+} BenchEvent;
+
+
+// Opens the events. Returns nullptr if none of them can be opened.
+BenchCounters* bench_counters_construct(void);
+
+void bench_counters_destruct(BenchCounters*);
+
+// Starts counting.
+void bench_counters_start(BenchCounters*);
+
+// Stops counting and adds the counts since the start to the totals.
+void bench_counters_stop(BenchCounters*);
+
+// Sets the totals to zero.
+void bench_counters_reset(BenchCounters*);
+
+// Reads the total of an event into value. Returns false if the event is not
+// available or was never scheduled.
+bool bench_counters_total(const BenchCounters*, const BenchEvent, f64* value);
+
+// Returns the name of the event, as used in the results.
+const char* bench_event_name(const BenchEvent);
@@ -0,0 +1,614 @@
+#define _GNU_SOURCE
+#include "harness.h"
+#include "counters.h"
+#include "histogram.h"
+#include "castor/dispatch.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TSC
+#endif
+
+
+// Bytes moved by a repetition of an O(n) operation
+#define BENCH_LINEAR_BUDGET (64 * 1024 * 1024)
+
+// Longest case name
+#define BENCH_NAME_MAX 128
+
+// Most cases in the registry
+#define BENCH_CASES_MAX 256
+
+// Duration of the calibration of the TSC, in nanoseconds
+#define BENCH_CALIBRATION (20 * 1000 * 1000)
+
+// Longest latency kept exactly by the histogram, in nanoseconds
+#define BENCH_LATENCY_MAX (60ull * 1000 * 1000 * 1000)
+
+// Significant digits of the latencies
+#define BENCH_LATENCY_DIGITS 3
+
+
+// The state shared by the combinations of a run.
+// Member:
+// - config, out:
+//    As given to bench_run.
+// - first:
+//    Whether no result was written yet.
+// - overhead:
+//    Cost of reading the timer twice, in nanoseconds.
+// - counters:
+//    The hardware counters, nullptr without them.
+// - samples:
+//    Room for max_repetitions samples, in the throughput mode.
+// - histogram:
+//    The latencies in ticks, in the latency mode.
+// - tsc:
+//    Whether the latency mode reads the TSC rather than the clock.
+// - ns_per_tick:
+//    Duration of a tick of the timer.
+typedef struct BenchRun {
+  const BenchConfig* config;
+  FILE*              out;
+  bool               first;
+  f64                overhead;
+  BenchCounters*     counters;
+  f64*               samples;
+  BenchHistogram*    histogram;
+  bool               tsc;
+  f64                ns_per_tick;
+} BenchRun;
+
+
+static const BenchCase* bench_cases[BENCH_CASES_MAX];
+static usize bench_case_count;
+
+
+void bench_register(const BenchCase* bench) {
+  if (bench_case_count < BENCH_CASES_MAX) {
+    bench_cases[bench_case_count++] = bench;
+  }
+}
+
+u64 bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+usize bench_linear_operations(const BenchState* state, const usize bytes) {
+  usize operations = bytes ? BENCH_LINEAR_BUDGET / bytes : state->count;
+  if (operations > state->count) {
+    operations = state->count;
+  }
+  return operations ? operations : 1;
+}
+
+bool bench_fill(Vector* vector, const usize count, void* object) {
+  for (usize i = 0; i < count; i++) {
+    if (!vector_push_back(vector, object)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void bench_name(const BenchCase* bench, char* name) {
+  if (bench->policy != nullptr) {
+    snprintf(
+      name, BENCH_NAME_MAX, "%s_%s_%s",
+      bench->group, bench->operation, bench->policy
+    );
+  } else {
+    snprintf(name, BENCH_NAME_MAX, "%s_%s", bench->group, bench->operation);
+  }
+}
+
+// Reads the timer of the latency mode
+static inline u64 bench_ticks(const bool tsc) {
+#ifdef BENCH_TSC
+  if (tsc) {
+    _mm_lfence();
+    const u64 ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+  }
+#else
+  (void)tsc;
+#endif
+  return bench_now();
+}
+
+void bench_list(FILE* out) {
+  char name[BENCH_NAME_MAX];
+  for (usize i = 0; i < bench_case_count; i++) {
+    bench_name(bench_cases[i], name);
+    fprintf(out, "%s\n", name);
+  }
+}
+
+static int bench_compare(const void* a, const void* b) {
+  const f64 x = *(const f64*)a;
+  const f64 y = *(const f64*)b;
+  return (x > y) - (x < y);
+}
+
+// Returns the value at the given quantile of the sorted samples
+static f64 bench_quantile(const f64* sorted, const usize n, const f64 q) {
+  const f64 position = q * (f64)(n - 1);
+  const usize low = (usize)position;
+  if (low + 1 >= n) {
+    return sorted[n - 1];
+  }
+  const f64 weight = position - (f64)low;
+  return sorted[low] * (1 - weight) + sorted[low + 1] * weight;
+}
+
+// Measures the cost of reading the clock twice, subtracted from each sample
+static f64 bench_timer_overhead(void) {
+  f64 samples[1001];
+  for (usize i = 0; i < 1001; i++) {
+    const u64 start = bench_now();
+    samples[i] = (f64)(bench_now() - start);
+  }
+  qsort(samples, 1001, sizeof(f64), bench_compare);
+  return samples[500];
+}
+
+// Writes the hardware events per operation, null for those unavailable
+static void bench_report_counters(
+  FILE*                out,
+  const BenchCounters* counters,
+  const f64            operations
+) {
+  f64 totals[BENCH_EVENTS];
+  bool available[BENCH_EVENTS];
+
+  fprintf(out, "      \"counters\": {");
+  for (usize i = 0; i < BENCH_EVENTS; i++) {
+    available[i] = bench_counters_total(counters, i, &totals[i]);
+    fprintf(out, "%s\"%s_per_op\": ", i ? ", " : "", bench_event_name(i));
+    if (available[i]) {
+      fprintf(out, "%.4f", totals[i] / operations);
+    } else {
+      fprintf(out, "null");
+    }
+  }
+
+  fprintf(out, ", \"ipc\": ");
+  if (
+    available[BENCH_CYCLES] && available[BENCH_INSTRUCTIONS] &&
+    totals[BENCH_CYCLES] > 0
+  ) {
+    fprintf(out, "%.4f", totals[BENCH_INSTRUCTIONS] / totals[BENCH_CYCLES]);
+  } else {
+    fprintf(out, "null");
+  }
+  fprintf(out, "},\n");
+}
+
+static void bench_report(
+  FILE*                out,
+  const BenchState*    state,
+  const BenchCounters* counters,
+  const f64*           samples,
+  const usize          n,
+  bool*                first
+) {
+  char name[BENCH_NAME_MAX];
+  bench_name(state->bench, name);
+
+  f64* sorted = malloc(n * sizeof(f64));
+  if (sorted == nullptr) {
+    return;
+  }
+  memcpy(sorted, samples, n * sizeof(f64));
+  qsort(sorted, n, sizeof(f64), bench_compare);
+
+  f64 mean = 0;
+  for (usize i = 0; i < n; i++) {
+    mean += sorted[i];
+  }
+  mean /= (f64)n;
+  const f64 median = bench_quantile(sorted, n, 0.5);
+
+  fprintf(out, "%s\n    {\n", *first ? "" : ",");
+  fprintf(out, "      \"name\": \"%s\",\n", name);
+  fprintf(out, "      \"group\": \"%s\",\n", state->bench->group);
+  fprintf(out, "      \"operation\": \"%s\",\n", state->bench->operation);
+  fprintf(out, "      \"object_size\": %zu,\n", (size_t)state->object_size);
+  fprintf(out, "      \"count\": %zu,\n", (size_t)state->count);
+  fprintf(out, "      \"operations\": %zu,\n", (size_t)state->operations);
+  fprintf(out, "      \"repetitions\": %zu,\n", (size_t)n);
+  fprintf(out, "      \"median_ns_per_op\": %.4f,\n", median);
+  fprintf(
+    out, "      \"p99_ns_per_op\": %.4f,\n",
+    bench_quantile(sorted, n, 0.99)
+  );
+  fprintf(out, "      \"mean_ns_per_op\": %.4f,\n", mean);
+  fprintf(out, "      \"min_ns_per_op\": %.4f,\n", sorted[0]);
+  fprintf(
+    out, "      \"bytes_per_op\": %.2f,\n",
+    (f64)state->bytes / (f64)state->operations
+  );
+  // Bytes per nanosecond are gigabytes per second. A median clamped to 0
+  // by the overhead subtraction has no rate, and JSON has no infinity.
+  if (state->bytes != 0 && median > 0) {
+    fprintf(
+      out, "      \"gb_per_s\": %.3f,\n",
+      (f64)state->bytes / (f64)state->operations / median
+    );
+  }
+  if (counters != nullptr) {
+    bench_report_counters(out, counters, (f64)n * (f64)state->operations);
+  }
+
+  // The raw samples, in the order they were taken
+  fprintf(out, "      \"samples\": [");
+  for (usize i = 0; i < n; i++) {
+    fprintf(out, "%s%.4f", i ? ", " : "", samples[i]);
+  }
+  fprintf(out, "]\n    }");
+
+  *first = false;
+  free(sorted);
+}
+
+// Runs the repetitions of one combination, storing up to max_repetitions
+// samples and counting the events of the timed ones. Returns the number of
+// samples, or 0 if a setup failed.
+static usize bench_measure(
+  const BenchConfig* config,
+  BenchState*        state,
+  const f64          overhead,
+  BenchCounters*     counters,
+  f64*               samples
+) {
+  const BenchCase* bench = state->bench;
+  const u64 started = bench_now();
+  u64 timed = 0;
+  usize done = 0;
+
+  if (counters != nullptr) {
+    bench_counters_reset(counters);
+  }
+
+  for (usize repetition = 0;; repetition++) {
+    const bool warmup = repetition < config->warmup;
+    const f64 elapsed = (f64)(bench_now() - started) / 1e9;
+
+    if (!warmup && done >= config->min_repetitions) {
+      if (
+        done >= config->max_repetitions ||
+        (f64)timed / 1e9 >= config->min_time ||
+        elapsed >= config->max_time
+      ) {
+        return done;
+      }
+    }
+
+    if (bench->setup != nullptr && !bench->setup(state)) {
+      return 0;
+    }
+
+    const bool counted = !warmup && counters != nullptr;
+    if (counted) {
+      bench_counters_start(counters);
+    }
+
+    const u64 start = bench_now();
+    bench->run(state);
+    const u64 duration = bench_now() - start;
+
+    if (counted) {
+      bench_counters_stop(counters);
+    }
+
+    if (bench->teardown != nullptr) {
+      bench->teardown(state);
+    }
+
+    if (!warmup) {
+      timed += duration;
+      f64 ns = (f64)duration - overhead;
+      ns = ns > 0 ? ns : 0;
+      samples[done++] = ns / (f64)state->operations;
+    }
+  }
+}
+
+// Calls measure for each combination of the matching cases of the mode
+static bool bench_each(
+  BenchRun* run,
+  bool    (*measure)(BenchRun*, BenchState*)
+) {
+  const BenchConfig* config = run->config;
+  bool ok = true;
+
+  for (usize c = 0; c < bench_case_count; c++) {
+    const BenchCase* bench = bench_cases[c];
+    char name[BENCH_NAME_MAX];
+    bench_name(bench, name);
+    if (
+      (config->latency ? bench->step == nullptr : bench->run == nullptr) ||
+      (config->filter != nullptr && strstr(name, config->filter) == nullptr)
+    ) {
+      continue;
+    }
+
+    for (usize s = 0; s < config->size_count; s++) {
+      for (usize n = 0; n < config->count_count; n++) {
+        const usize object_size = config->sizes[s];
+        const usize count = config->counts[n];
+        if (
+          object_size == 0 || count > config->max_bytes / object_size ||
+          (bench->supports != nullptr && !bench->supports(object_size, count))
+        ) {
+          continue;
+        }
+
+        BenchState state = {
+          .bench       = bench,
+          .object_size = object_size,
+          .count       = count,
+          .operations  = count,
+          .bytes       = count * object_size,
+          .object      = malloc(object_size),
+        };
+        if (state.object == nullptr) {
+          ok = false;
+          continue;
+        }
+        for (usize i = 0; i < object_size; i++) {
+          state.object[i] = (u8)(i * 31 + 7);
+        }
+
+        fprintf(
+          stderr, "%s object_size=%zu count=%zu\n",
+          name, (size_t)object_size, (size_t)count
+        );
+
+        if (bench->prepare != nullptr && !bench->prepare(&state)) {
+          fprintf(stderr, "  skipped: prepare failed\n");
+        } else if (!measure(run, &state)) {
+          fprintf(stderr, "  failed\n");
+          ok = false;
+        }
+
+        if (bench->cleanup != nullptr) {
+          bench->cleanup(&state);
+        }
+        free(state.object);
+      }
+    }
+  }
+
+  return ok;
+}
+
+static bool bench_measure_throughput(BenchRun* run, BenchState* state) {
+  const usize taken = bench_measure(
+    run->config, state, run->overhead, run->counters, run->samples
+  );
+  if (taken == 0) {
+    return false;
+  }
+  bench_report(
+    run->out, state, run->counters, run->samples, taken, &run->first
+  );
+  return true;
+}
+
+static bool bench_run_throughput(BenchRun* run) {
+  const BenchConfig* config = run->config;
+  run->samples = malloc(config->max_repetitions * sizeof(f64));
+  if (run->samples == nullptr) {
+    return false;
+  }
+
+  // Without counters the cases still run, with the timings only
+  if (config->counters) {
+    run->counters = bench_counters_construct();
+    if (run->counters == nullptr) {
+      fprintf(stderr, "hardware counters unavailable\n");
+    }
+  }
+
+  run->overhead = bench_timer_overhead();
+  fprintf(run->out, "{\n  \"isa\": \"%s\",\n", castor_isa_name(castor_isa()));
+  fprintf(run->out, "  \"timer_overhead_ns\": %.2f,\n", run->overhead);
+  fprintf(
+    run->out, "  \"counters\": %s,\n",
+    run->counters != nullptr ? "true" : "false"
+  );
+  fprintf(run->out, "  \"results\": [");
+
+  const bool ok = bench_each(run, bench_measure_throughput);
+
+  fprintf(run->out, "\n  ]\n}\n");
+  bench_counters_destruct(run->counters);
+  free(run->samples);
+  return ok;
+}
+
+// Returns the duration of a tick of the TSC, or 0 if it does not tick
+static f64 bench_tsc_calibrate(void) {
+  const u64 start = bench_now();
+  const u64 ticks = bench_ticks(true);
+  while (bench_now() - start < BENCH_CALIBRATION) {
+  }
+  const u64 elapsed = bench_ticks(true) - ticks;
+  return elapsed ? (f64)(bench_now() - start) / (f64)elapsed : 0;
+}
+
+// Measures the cost of reading the latency timer twice, in ticks
+static u64 bench_ticks_overhead(const bool tsc) {
+  u64 smallest = UINT64_MAX;
+  for (usize i = 0; i < 1001; i++) {
+    const u64 start = bench_ticks(tsc);
+    const u64 ticks = bench_ticks(tsc) - start;
+    smallest = ticks < smallest ? ticks : smallest;
+  }
+  return smallest;
+}
+
+static void bench_latency_report(
+  BenchRun*         run,
+  const BenchState* state,
+  const usize       repetitions
+) {
+  static const f64 percentiles[] = { 50, 90, 99, 99.9, 99.99, 99.999 };
+  const BenchHistogram* histogram = run->histogram;
+  const f64 scale = run->ns_per_tick;
+  FILE* out = run->out;
+  char name[BENCH_NAME_MAX];
+  bench_name(state->bench, name);
+
+  fprintf(out, "%s\n    {\n", run->first ? "" : ",");
+  fprintf(out, "      \"name\": \"%s\",\n", name);
+  fprintf(out, "      \"group\": \"%s\",\n", state->bench->group);
+  fprintf(out, "      \"operation\": \"%s\",\n", state->bench->operation);
+  fprintf(
+    out, "      \"policy\": \"%s\",\n",
+    state->bench->policy != nullptr ? state->bench->policy : "default"
+  );
+  fprintf(out, "      \"object_size\": %zu,\n", (size_t)state->object_size);
+  fprintf(out, "      \"count\": %zu,\n", (size_t)state->count);
+  fprintf(out, "      \"operations\": %zu,\n", (size_t)state->operations);
+  fprintf(out, "      \"repetitions\": %zu,\n", (size_t)repetitions);
+  fprintf(
+    out, "      \"values\": %llu,\n",
+    (unsigned long long)bench_histogram_count(histogram)
+  );
+  fprintf(
+    out, "      \"min_ns\": %.1f,\n",
+    (f64)bench_histogram_min(histogram) * scale
+  );
+  fprintf(
+    out, "      \"mean_ns\": %.1f,\n", bench_histogram_mean(histogram) * scale
+  );
+  fprintf(
+    out, "      \"max_ns\": %.1f,\n",
+    (f64)bench_histogram_max(histogram) * scale
+  );
+
+  fprintf(out, "      \"percentiles_ns\": {");
+  for (usize i = 0; i < sizeof(percentiles) / sizeof(*percentiles); i++) {
+    fprintf(
+      out, "%s\"%g\": %.1f", i ? ", " : "", percentiles[i],
+      (f64)bench_histogram_percentile(histogram, percentiles[i]) * scale
+    );
+  }
+  fprintf(out, "},\n");
+
+  // Each bucket holding values, as [highest latency, percentile up to it]
+  const f64 total = (f64)bench_histogram_count(histogram);
+  usize cursor = 0;
+  u64 value;
+  u64 count;
+  fprintf(out, "      \"distribution\": [");
+  for (bool first = true; bench_histogram_next(
+    histogram, &cursor, &value, &count
+  ); first = false) {
+    fprintf(
+      out, "%s[%.1f, %.6f]", first ? "" : ", ",
+      (f64)value * scale, (f64)count / total * 100
+    );
+  }
+  fprintf(out, "]\n    }");
+
+  run->first = false;
+}
+
+static bool bench_measure_latency(BenchRun* run, BenchState* state) {
+  const BenchConfig* config = run->config;
+  const BenchCase* bench = state->bench;
+  const usize total = config->warmup + config->min_repetitions;
+  const u64 started = bench_now();
+  usize repetitions = 0;
+
+  bench_histogram_reset(run->histogram);
+  for (usize repetition = 0; repetition < total; repetition++) {
+    const bool warmup = repetition < config->warmup;
+    const f64 elapsed = (f64)(bench_now() - started) / 1e9;
+    if (repetitions > 0 && elapsed >= config->max_time) {
+      break;
+    }
+
+    if (bench->setup != nullptr && !bench->setup(state)) {
+      return false;
+    }
+
+    for (usize i = 0; i < state->operations; i++) {
+      const u64 start = bench_ticks(run->tsc);
+      bench->step(state, i);
+      const u64 ticks = bench_ticks(run->tsc) - start;
+      if (!warmup) {
+        bench_histogram_record(run->histogram, ticks);
+      }
+    }
+
+    if (bench->teardown != nullptr) {
+      bench->teardown(state);
+    }
+    repetitions += !warmup;
+  }
+
+  bench_latency_report(run, state, repetitions);
+  return true;
+}
+
+static bool bench_run_latency(BenchRun* run) {
+  const BenchConfig* config = run->config;
+
+  run->ns_per_tick = 1;
+#ifdef BENCH_TSC
+  if (config->timer != BENCH_TIMER_CLOCK) {
+    run->ns_per_tick = bench_tsc_calibrate();
+    run->tsc = run->ns_per_tick > 0;
+    run->ns_per_tick = run->tsc ? run->ns_per_tick : 1;
+  }
+#endif
+  if (config->timer == BENCH_TIMER_TSC && !run->tsc) {
+    fprintf(stderr, "no TSC, timing with clock_gettime\n");
+  }
+
+  run->histogram = bench_histogram_construct(
+    (u64)((f64)BENCH_LATENCY_MAX / run->ns_per_tick), BENCH_LATENCY_DIGITS
+  );
+  if (run->histogram == nullptr) {
+    return false;
+  }
+
+  run->overhead = (f64)bench_ticks_overhead(run->tsc) * run->ns_per_tick;
+  fprintf(run->out, "{\n  \"isa\": \"%s\",\n", castor_isa_name(castor_isa()));
+  fprintf(
+    run->out, "  \"timer\": \"%s\",\n",
+    run->tsc ? "tsc" : "clock_gettime"
+  );
+  fprintf(run->out, "  \"ns_per_tick\": %.6f,\n", run->ns_per_tick);
+  fprintf(run->out, "  \"timer_overhead_ns\": %.2f,\n", run->overhead);
+  fprintf(run->out, "  \"latency\": [");
+
+  const bool ok = bench_each(run, bench_measure_latency);
+
+  fprintf(run->out, "\n  ]\n}\n");
+  bench_histogram_destruct(run->histogram);
+  return ok;
+}
+
+bool bench_run(const BenchConfig* config, FILE* out) {
+  BenchRun run = {
+    .config = config,
+    .out    = out,
+    .first  = true,
+  };
+  return config->latency
+    ? bench_run_latency(&run)
+    : bench_run_throughput(&run);
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "castor/types.h"
+#include "castor/vector.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// The benchmark harness runs each registered BenchCase for every object size
+// and count of the configuration.
+// For each combination, prepare builds the state shared by the repetitions,
+// then each repetition calls setup, times run, and calls teardown, which
+// must bring the state back to what the next repetition expects. Warmup
+// repetitions are run first and discarded.
+// The repetitions go on until both a minimum number and a minimum timed
+// duration are reached, or the wall-clock budget of the case is spent.
+typedef struct BenchCase BenchCase;
+
+// BenchState is the state of one case at one object size and count.
+typedef struct BenchState BenchState;
+
+// BenchConfig holds the parameters of a run of the harness.
+typedef struct BenchConfig BenchConfig;
+
+// BenchTimer selects the clock of the latency mode.
+// - BENCH_TIMER_AUTO:
+//    The TSC where there is one, clock_gettime otherwise.
+// - BENCH_TIMER_TSC:
+//    The TSC, calibrated against CLOCK_MONOTONIC.
+// - BENCH_TIMER_CLOCK:
+//    clock_gettime(CLOCK_MONOTONIC).
+typedef enum BenchTimer {
+  BENCH_TIMER_AUTO,
+  BENCH_TIMER_TSC,
+  BENCH_TIMER_CLOCK,
+} BenchTimer;
+
+
+// Member:
+// - bench:
+//    The case being run.
+// - object_size:
+//    Size of each object in bytes.
+// - count:
+//    Number of objects the case works on.
+// - operations:
+//    Number of operations made by run, set by prepare or setup.
+// - bytes:
+//    Number of bytes moved by run, set by prepare or setup.
+// - context:
+//    Built by prepare and released by cleanup.
+// - data:
+//    Built by setup and released by teardown.
+// - object:
+//    An object of object_size bytes filled with a pattern.
+// - sink:
+//    Results accumulated by run so the compiler keeps the work.
+struct BenchState {
+  const BenchCase* bench;
+  usize            object_size;
+  usize            count;
+  usize            operations;
+  usize            bytes;
+  void*            context;
+  void*            data;
+  u8*              object;
+  u64              sink;
+};
+
+// Member:
+// - group:
+//    The family of the case: "vector", "stack", "c_array", "std_vector"...
+// - operation:
+//    The operation measured. The case is reported as group_operation, or
+//    group_operation_policy when it has a policy.
+// - policy:
+//    The growth policy of the container, such as "doubling" or "reserved",
+//    may be nullptr.
+// - supports:
+//    Returns whether the case runs at the given object size and count, may
+//    be nullptr.
+// - prepare, cleanup:
+//    Called once per object size and count, may be nullptr. prepare returns
+//    false to skip the combination, cleanup is called in any case.
+// - setup, teardown:
+//    Called around each repetition, untimed, may be nullptr.
+// - run:
+//    The timed part, may be nullptr for a latency-only case.
+// - step:
+//    Makes the operation of the given index, one of the operations of run,
+//    for the latency mode which times each call. May be nullptr; any
+//    container can take part in the latency mode by providing it.
+struct BenchCase {
+  const char* group;
+  const char* operation;
+  const char* policy;
+  bool (*supports)(const usize object_size, const usize count);
+  bool (*prepare)(BenchState*);
+  void (*cleanup)(BenchState*);
+  bool (*setup)(BenchState*);
+  void (*teardown)(BenchState*);
+  void (*run)(BenchState*);
+  void (*step)(BenchState*, const usize index);
+};
+
+// Member:
+// - filter:
+//    Only the cases whose name contains it are run, nullptr for all.
+// - sizes, size_count:
+//    The object sizes.
+// - counts, count_count:
+//    The counts.
+// - max_bytes:
+//    Combinations whose objects take more memory are skipped.
+// - warmup:
+//    Number of discarded repetitions.
+// - min_repetitions, max_repetitions:
+//    Bounds on the number of timed repetitions.
+// - min_time:
+//    Minimum timed duration of a case in seconds.
+// - max_time:
+//    Wall-clock budget of a case in seconds, setup and teardown included.
+//    It only stops a case once min_repetitions are done.
+// - counters:
+//    Whether to count hardware events around each timed repetition.
+// - latency:
+//    Whether to run the latency mode instead: the cases having a step are
+//    run for warmup and then min_repetitions repetitions (max_time
+//    permitting), each of their operations timed and recorded in a
+//    histogram, whose percentiles are reported.
+// - timer:
+//    The clock of the latency mode.
+struct BenchConfig {
+  const char*  filter;
+  const usize* sizes;
+  usize        size_count;
+  const usize* counts;
+  usize        count_count;
+  usize        max_bytes;
+  usize        warmup;
+  usize        min_repetitions;
+  usize        max_repetitions;
+  f64          min_time;
+  f64          max_time;
+  bool         counters;
+  bool         latency;
+  BenchTimer   timer;
+};
+
+
+// Adds a case to the registry. The case must outlive the harness.
+void bench_register(const BenchCase*);
+
+// Runs the matching cases, in the mode of the configuration, and writes the
+// results to out as JSON.
+// Progress is reported on stderr.
+// Returns false if a case failed.
+bool bench_run(const BenchConfig*, FILE* out);
+
+// Lists the names of the registered cases on out.
+void bench_list(FILE* out);
+
+// Returns the number of O(n) operations a repetition should make when each
+// of them moves the given number of bytes, so that a repetition moves about
+// 64 MiB. The result is between 1 and the count.
+usize bench_linear_operations(const BenchState*, const usize bytes);
+
+// Appends count copies of the object to the Vector.
+bool bench_fill(Vector*, const usize count, void* object);
+
+// Returns a monotonic timestamp in nanoseconds.
+u64 bench_now(void);
+
+// Registration functions of each family of cases.
+void bench_vector_register(void);
+void bench_stack_register(void);
+void bench_c_array_register(void);
+void bench_std_vector_register(void);
+void bench_persistence_register(void);
+void bench_containers_register(void);
+void bench_bulk_register(void);
+void bench_numeric_register(void);
+void bench_scan_register(void);
+
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
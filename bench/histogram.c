@@ -0,0 +1,198 @@
+#include "histogram.h"
+#include "castor/types.h"
+#include <stdlib.h>
+
+
+// The values are split in buckets of sub_bucket_count sub-buckets, each
+// bucket covering twice the range of the previous one with sub-buckets
+// twice as wide. As the lower half of a bucket overlaps the previous one,
+// only the first bucket has its lower half; counts holds the sub-buckets
+// of that first bucket followed by the upper halves of the others.
+// Member:
+// - counts:
+//    Number of values in each sub-bucket.
+// - length:
+//    Number of sub-buckets.
+// - half_magnitude:
+//    Log2 of half the number of sub-buckets of a bucket.
+// - sub_bucket_mask:
+//    Mask of the values of the first bucket.
+// - highest:
+//    Highest value counted exactly.
+// - total:
+//    Number of values.
+// - min, max, sum:
+//    Of the values, as recorded.
+struct BenchHistogram {
+  u64*  counts;
+  usize length;
+  u32   half_magnitude;
+  u64   sub_bucket_mask;
+  u64   highest;
+  u64   total;
+  u64   min;
+  u64   max;
+  f64   sum;
+};
+
+
+BenchHistogram* bench_histogram_construct(const u64 highest, const u32 digits) {
+  if (highest < 2 || digits < 1 || digits > 5) {
+    return nullptr;
+  }
+
+  BenchHistogram* this = calloc(1, sizeof(BenchHistogram));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  // Enough sub-buckets to tell apart two values differing in the last
+  // significant digit
+  u64 largest_single_unit = 2;
+  for (u32 i = 0; i < digits; i++) {
+    largest_single_unit *= 10;
+  }
+  u32 magnitude = 0;
+  while ((1ull << magnitude) < largest_single_unit) {
+    magnitude++;
+  }
+  const u64 sub_bucket_count = 1ull << magnitude;
+  this->half_magnitude = magnitude - 1;
+  this->sub_bucket_mask = sub_bucket_count - 1;
+
+  usize buckets = 1;
+  for (
+    u64 smallest_untrackable = sub_bucket_count;
+    smallest_untrackable <= highest && buckets < 64 - magnitude;
+    smallest_untrackable <<= 1
+  ) {
+    buckets++;
+  }
+  this->length = (buckets + 1) << this->half_magnitude;
+  this->highest = highest;
+
+  this->counts = calloc(this->length, sizeof(u64));
+  if (this->counts == nullptr) {
+    free(this);
+    return nullptr;
+  }
+
+  return this;
+}
+
+void bench_histogram_destruct(BenchHistogram* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  free(this->counts);
+  free(this);
+}
+
+static usize bench_histogram_index(const BenchHistogram* this, const u64 v) {
+  const u32 ceiling = 64 - (u32)__builtin_clzll(v | this->sub_bucket_mask);
+  const u32 bucket = ceiling - (this->half_magnitude + 1);
+  const u64 sub_bucket = v >> bucket;
+  return ((usize)(bucket + 1) << this->half_magnitude) +
+    (usize)(sub_bucket - (1ull << this->half_magnitude));
+}
+
+// Returns the highest value counted in the sub-bucket of the index
+static u64 bench_histogram_value(const BenchHistogram* this, const usize i) {
+  i64 bucket = (i64)(i >> this->half_magnitude) - 1;
+  u64 sub_bucket = (i & ((1ull << this->half_magnitude) - 1)) +
+    (1ull << this->half_magnitude);
+  if (bucket < 0) {
+    sub_bucket -= 1ull << this->half_magnitude;
+    bucket = 0;
+  }
+  return ((sub_bucket + 1) << bucket) - 1;
+}
+
+void bench_histogram_record(BenchHistogram* this, const u64 value) {
+  const u64 clamped = value < this->highest ? value : this->highest;
+  this->counts[bench_histogram_index(this, clamped)]++;
+
+  if (this->total == 0 || value < this->min) {
+    this->min = value;
+  }
+  if (value > this->max) {
+    this->max = value;
+  }
+  this->sum += (f64)value;
+  this->total++;
+}
+
+void bench_histogram_reset(BenchHistogram* this) {
+  for (usize i = 0; i < this->length; i++) {
+    this->counts[i] = 0;
+  }
+  this->total = 0;
+  this->min = 0;
+  this->max = 0;
+  this->sum = 0;
+}
+
+u64 bench_histogram_count(const BenchHistogram* this) {
+  return this->total;
+}
+
+u64 bench_histogram_min(const BenchHistogram* this) {
+  return this->min;
+}
+
+u64 bench_histogram_max(const BenchHistogram* this) {
+  return this->max;
+}
+
+f64 bench_histogram_mean(const BenchHistogram* this) {
+  return this->total ? this->sum / (f64)this->total : 0;
+}
+
+u64 bench_histogram_percentile(
+  const BenchHistogram* this,
+  const f64             percentile
+) {
+  if (this->total == 0) {
+    return 0;
+  }
+
+  const f64 p = percentile < 0 ? 0 : percentile > 100 ? 100 : percentile;
+  u64 wanted = (u64)(p / 100 * (f64)this->total + 0.5);
+  wanted = wanted ? wanted : 1;
+
+  u64 seen = 0;
+  for (usize i = 0; i < this->length; i++) {
+    seen += this->counts[i];
+    if (seen >= wanted) {
+      const u64 value = bench_histogram_value(this, i);
+      return value < this->max ? value : this->max;
+    }
+  }
+  return this->max;
+}
+
+bool bench_histogram_next(
+  const BenchHistogram* this,
+  usize*                cursor,
+  u64*                  value,
+  u64*                  count
+) {
+  // The cursor is the index of the next sub-bucket, and the running count
+  // is rebuilt from the values before it
+  if (*cursor == 0) {
+    *count = 0;
+  }
+  for (usize i = *cursor; i < this->length; i++) {
+    if (this->counts[i] == 0) {
+      continue;
+    }
+    *count += this->counts[i];
+    const u64 highest = bench_histogram_value(this, i);
+    *value = highest < this->max ? highest : this->max;
+    *cursor = i + 1;
+    return true;
+  }
+  *cursor = this->length;
+  return false;
+}
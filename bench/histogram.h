@@ -0,0 +1,51 @@
+#pragma once
+#include "castor/types.h"
+
+
+// BenchHistogram records values in the manner of an HDR histogram: the
+// values are counted in buckets whose width grows with their magnitude, so
+// that any value up to the highest one is kept with a fixed number of
+// significant decimal digits, in a fixed amount of memory and in constant
+// time per value. Values above the highest one are counted as the highest
+// one; the exact minimum and maximum are kept aside.
+typedef struct BenchHistogram BenchHistogram;
+
+
+// Constructs a histogram for the values from 1 to highest, with the given
+// number of significant digits, from 1 to 5.
+[[nodiscard, gnu::malloc]]
+BenchHistogram* bench_histogram_construct(const u64 highest, const u32 digits);
+
+void bench_histogram_destruct(BenchHistogram*);
+
+// Counts a value.
+void bench_histogram_record(BenchHistogram*, const u64 value);
+
+// Forgets every value.
+void bench_histogram_reset(BenchHistogram*);
+
+// Returns the number of values.
+u64 bench_histogram_count(const BenchHistogram*);
+
+// Returns the smallest and largest values, 0 if there are none.
+u64 bench_histogram_min(const BenchHistogram*);
+u64 bench_histogram_max(const BenchHistogram*);
+
+// Returns the mean of the values, 0 if there are none.
+f64 bench_histogram_mean(const BenchHistogram*);
+
+// Returns the value below or at which the given percentage of the values
+// are, from 0 to 100. The value is the highest of its bucket, and at most
+// the maximum.
+u64 bench_histogram_percentile(const BenchHistogram*, const f64 percentile);
+
+// Iterates the buckets holding values in increasing order. cursor must be
+// 0 on the first call. Sets value to the highest value of the bucket and
+// count to the number of values up to it included. Returns false once
+// every bucket was visited.
+bool bench_histogram_next(
+  const BenchHistogram* histogram,
+  usize*                cursor,
+  u64*                  value,
+  u64*                  count
+);
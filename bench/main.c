@@ -0,0 +1,296 @@
+#define _GNU_SOURCE
+#include "harness.h"
+#include "compare.h"
+#include "replay.h"
+#include "castor/types.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Most sizes or counts accepted on the command line
+#define BENCH_LIST_MAX 64
+
+
+static const char* bench_usage =
+  "usage: castor_bench [options]\n"
+  "  --filter TEXT          run the cases whose name contains TEXT\n"
+  "  --sizes N,...          object sizes in bytes (1,8,64,512)\n"
+  "  --counts N,...         object counts (10,1000,100000,1000000,"
+  "10000000,100000000)\n"
+  "  --max-bytes N          skip the combinations above N bytes (1 GiB)\n"
+  "  --warmup N             discarded repetitions (1)\n"
+  "  --min-repetitions N    (5)\n"
+  "  --max-repetitions N    (1000)\n"
+  "  --min-time SECONDS     timed duration to reach (0.05)\n"
+  "  --max-time SECONDS     wall-clock budget of a combination (2)\n"
+  "  --output FILE          write the JSON to FILE instead of stdout\n"
+  "  --counters             count hardware events with perf_event_open\n"
+  "  --latency              time each operation, report the percentiles\n"
+  "  --timer auto|tsc|clock clock of --latency (auto)\n"
+  "  --replay FILE          replay the Vector trace in FILE against each\n"
+  "                         target instead of running the cases\n"
+  "  --quick                small counts and budgets, for a smoke test\n"
+  "  --baseline FILE        compare to the results in FILE, print a table\n"
+  "                         and fail on regressions\n"
+  "  --alpha P              significance level of the comparison (0.01)\n"
+  "  --threshold R          smallest median change that counts (0.1)\n"
+  "  --list                 list the cases and exit\n";
+
+// Parses a comma-separated list of sizes. Returns the number of them, or 0
+// if the list is invalid.
+static usize bench_parse_list(const char* text, usize* list) {
+  usize n = 0;
+  while (*text != '\0') {
+    char* end;
+    const unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || value == 0 || n == BENCH_LIST_MAX) {
+      return 0;
+    }
+    list[n++] = (usize)value;
+    text = *end == ',' ? end + 1 : end;
+    if (*end != ',' && *end != '\0') {
+      return 0;
+    }
+  }
+  return n;
+}
+
+int main(int argc, char** argv) {
+  static usize sizes[BENCH_LIST_MAX] = { 1, 8, 64, 512 };
+  static usize counts[BENCH_LIST_MAX] = {
+    10, 1000, 100000, 1000000, 10000000, 100000000
+  };
+
+  BenchConfig config = {
+    .sizes           = sizes,
+    .size_count      = 4,
+    .counts          = counts,
+    .count_count     = 6,
+    .max_bytes       = (usize)1 << 30,
+    .warmup          = 1,
+    .min_repetitions = 5,
+    .max_repetitions = 1000,
+    .min_time        = 0.05,
+    .max_time        = 2,
+  };
+  const char* output = nullptr;
+  const char* baseline_path = nullptr;
+  const char* replay = nullptr;
+  BenchCompareOptions compare = {};
+  bool list = false;
+
+  enum {
+    OPTION_FILTER = 1,
+    OPTION_SIZES,
+    OPTION_COUNTS,
+    OPTION_MAX_BYTES,
+    OPTION_WARMUP,
+    OPTION_MIN_REPETITIONS,
+    OPTION_MAX_REPETITIONS,
+    OPTION_MIN_TIME,
+    OPTION_MAX_TIME,
+    OPTION_OUTPUT,
+    OPTION_COUNTERS,
+    OPTION_LATENCY,
+    OPTION_TIMER,
+    OPTION_REPLAY,
+    OPTION_QUICK,
+    OPTION_BASELINE,
+    OPTION_ALPHA,
+    OPTION_THRESHOLD,
+    OPTION_LIST,
+  };
+  static const struct option options[] = {
+    { "filter",          required_argument, nullptr, OPTION_FILTER },
+    { "sizes",           required_argument, nullptr, OPTION_SIZES },
+    { "counts",          required_argument, nullptr, OPTION_COUNTS },
+    { "max-bytes",       required_argument, nullptr, OPTION_MAX_BYTES },
+    { "warmup",          required_argument, nullptr, OPTION_WARMUP },
+    { "min-repetitions", required_argument, nullptr, OPTION_MIN_REPETITIONS },
+    { "max-repetitions", required_argument, nullptr, OPTION_MAX_REPETITIONS },
+    { "min-time",        required_argument, nullptr, OPTION_MIN_TIME },
+    { "max-time",        required_argument, nullptr, OPTION_MAX_TIME },
+    { "output",          required_argument, nullptr, OPTION_OUTPUT },
+    { "counters",        no_argument,       nullptr, OPTION_COUNTERS },
+    { "latency",         no_argument,       nullptr, OPTION_LATENCY },
+    { "timer",           required_argument, nullptr, OPTION_TIMER },
+    { "replay",          required_argument, nullptr, OPTION_REPLAY },
+    { "quick",           no_argument,       nullptr, OPTION_QUICK },
+    { "baseline",        required_argument, nullptr, OPTION_BASELINE },
+    { "alpha",           required_argument, nullptr, OPTION_ALPHA },
+    { "threshold",       required_argument, nullptr, OPTION_THRESHOLD },
+    { "list",            no_argument,       nullptr, OPTION_LIST },
+    { "help",            no_argument,       nullptr, 'h' },
+    {},
+  };
+
+  // --quick only changes the defaults, so the options override it wherever
+  // it appears
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      counts[0] = 10;
+      counts[1] = 1000;
+      counts[2] = 100000;
+      config.count_count = 3;
+      config.min_repetitions = 3;
+      config.min_time = 0.01;
+      config.max_time = 0.2;
+    }
+  }
+
+  int option;
+  while ((option = getopt_long(argc, argv, "h", options, nullptr)) != -1) {
+    switch (option) {
+      case OPTION_FILTER:
+        config.filter = optarg;
+        break;
+      case OPTION_SIZES:
+        config.size_count = bench_parse_list(optarg, sizes);
+        break;
+      case OPTION_COUNTS:
+        config.count_count = bench_parse_list(optarg, counts);
+        break;
+      case OPTION_MAX_BYTES:
+        config.max_bytes = strtoull(optarg, nullptr, 10);
+        break;
+      case OPTION_WARMUP:
+        config.warmup = strtoull(optarg, nullptr, 10);
+        break;
+      case OPTION_MIN_REPETITIONS:
+        config.min_repetitions = strtoull(optarg, nullptr, 10);
+        break;
+      case OPTION_MAX_REPETITIONS:
+        config.max_repetitions = strtoull(optarg, nullptr, 10);
+        break;
+      case OPTION_MIN_TIME:
+        config.min_time = strtod(optarg, nullptr);
+        break;
+      case OPTION_MAX_TIME:
+        config.max_time = strtod(optarg, nullptr);
+        break;
+      case OPTION_OUTPUT:
+        output = optarg;
+        break;
+      case OPTION_COUNTERS:
+        config.counters = true;
+        break;
+      case OPTION_LATENCY:
+        config.latency = true;
+        break;
+      case OPTION_TIMER:
+        if (strcmp(optarg, "auto") == 0) {
+          config.timer = BENCH_TIMER_AUTO;
+        } else if (strcmp(optarg, "tsc") == 0) {
+          config.timer = BENCH_TIMER_TSC;
+        } else if (strcmp(optarg, "clock") == 0) {
+          config.timer = BENCH_TIMER_CLOCK;
+        } else {
+          fputs(bench_usage, stderr);
+          return EXIT_FAILURE;
+        }
+        break;
+      case OPTION_REPLAY:
+        replay = optarg;
+        break;
+      case OPTION_QUICK:
+        break;
+      case OPTION_BASELINE:
+        baseline_path = optarg;
+        break;
+      case OPTION_ALPHA:
+        compare.alpha = strtod(optarg, nullptr);
+        break;
+      case OPTION_THRESHOLD:
+        compare.threshold = strtod(optarg, nullptr);
+        break;
+      case OPTION_LIST:
+        list = true;
+        break;
+      case 'h':
+        fputs(bench_usage, stdout);
+        return EXIT_SUCCESS;
+      default:
+        fputs(bench_usage, stderr);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (
+    optind != argc || config.size_count == 0 || config.count_count == 0 ||
+    config.min_repetitions == 0 ||
+    config.max_repetitions < config.min_repetitions ||
+    (config.latency && baseline_path != nullptr) ||
+    (replay != nullptr && (config.latency || baseline_path != nullptr))
+  ) {
+    fputs(bench_usage, stderr);
+    return EXIT_FAILURE;
+  }
+
+  bench_vector_register();
+  bench_stack_register();
+  bench_c_array_register();
+  bench_std_vector_register();
+  bench_persistence_register();
+  bench_containers_register();
+  bench_bulk_register();
+  bench_numeric_register();
+  bench_scan_register();
+
+  if (list) {
+    bench_list(stdout);
+    return EXIT_SUCCESS;
+  }
+
+  // Read the baseline first, not to run the whole suite for nothing
+  BenchResults* baseline = nullptr;
+  if (baseline_path != nullptr) {
+    FILE* file = fopen(baseline_path, "r");
+    baseline = file != nullptr ? bench_results_read(file) : nullptr;
+    if (file != nullptr) {
+      fclose(file);
+    }
+    if (baseline == nullptr) {
+      fprintf(stderr, "%s: cannot read the baseline\n", baseline_path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // When comparing, the results are read back from the output, and go to a
+  // temporary file unless one is given, leaving stdout to the table
+  FILE* out = stdout;
+  if (output != nullptr) {
+    out = fopen(output, baseline != nullptr ? "w+" : "w");
+  } else if (baseline != nullptr) {
+    out = tmpfile();
+  }
+  if (out == nullptr) {
+    perror(output != nullptr ? output : "tmpfile");
+    bench_results_destruct(baseline);
+    return EXIT_FAILURE;
+  }
+
+  bool ok = replay != nullptr
+    ? bench_replay(&config, replay, out)
+    : bench_run(&config, out);
+
+  if (baseline != nullptr) {
+    rewind(out);
+    BenchResults* current = bench_results_read(out);
+    if (current == nullptr) {
+      fprintf(stderr, "cannot read back the results\n");
+      ok = false;
+    } else {
+      ok &= bench_results_compare(baseline, current, compare, stdout) == 0;
+    }
+    bench_results_destruct(current);
+    bench_results_destruct(baseline);
+  }
+
+  if (out != stdout && fclose(out) != 0) {
+    perror(output);
+    return EXIT_FAILURE;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,169 @@
+#include "harness.h"
+#include "castor/numeric.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+
+
+// Bins of the histogram cases
+#define NUMERIC_BINS 64
+
+
+// Member:
+// - x, y:
+//    Vectors of count f64 samples.
+// - bins:
+//    The bins of the histogram cases.
+typedef struct NumericBench {
+  Vector* x;
+  Vector* y;
+  usize   bins[NUMERIC_BINS];
+} NumericBench;
+
+
+// The cases work on f64 samples
+static bool numeric_supports(const usize object_size, const usize) {
+  return object_size == sizeof(f64);
+}
+
+static bool numeric_bench_prepare(BenchState* state) {
+  NumericBench* bench = calloc(1, sizeof(NumericBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  const VectorOptions options = { .capacity = state->count };
+  bench->x = vector_construct(sizeof(f64), options);
+  bench->y = vector_construct(sizeof(f64), options);
+  if (bench->x == nullptr || bench->y == nullptr) {
+    return false;
+  }
+
+  // Samples spread over [-500, 500)
+  u64 seed = 0x9e3779b97f4a7c15;
+  for (usize i = 0; i < state->count; i++) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    f64 sample = (f64)(seed >> 11) / (f64)(1ull << 53) * 1000 - 500;
+    if (!vector_push_back(bench->x, &sample)) {
+      return false;
+    }
+    sample = 1 / (sample + 1000);
+    if (!vector_push_back(bench->y, &sample)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void numeric_bench_cleanup(BenchState* state) {
+  NumericBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  vector_destruct(bench->x);
+  vector_destruct(bench->y);
+  free(bench);
+}
+
+// The baseline: a sum through the walk callback
+static f64 walked;
+
+static void walk_callback(void* object) {
+  walked += *(f64*)object;
+}
+
+static void run_sum_walk(BenchState* state) {
+  NumericBench* bench = state->context;
+  walked = 0;
+  vector_walk(bench->x, walk_callback);
+  state->sink += (u64)walked;
+}
+
+static void numeric_sum(BenchState* state, const VectorSummation method) {
+  NumericBench* bench = state->context;
+  f64 sum;
+  vector_sum(bench->x, VECTOR_NUMBER_F64, method, &sum);
+  state->sink += (u64)sum;
+}
+
+static void run_sum_plain(BenchState* state) {
+  numeric_sum(state, VECTOR_SUMMATION_PLAIN);
+}
+
+static void run_sum_pairwise(BenchState* state) {
+  numeric_sum(state, VECTOR_SUMMATION_PAIRWISE);
+}
+
+static void run_sum_kahan(BenchState* state) {
+  numeric_sum(state, VECTOR_SUMMATION_KAHAN);
+}
+
+static void run_min(BenchState* state) {
+  NumericBench* bench = state->context;
+  f64 min;
+  usize index;
+  vector_min(bench->x, VECTOR_NUMBER_F64, &min, &index);
+  state->sink += index;
+}
+
+static void run_variance(BenchState* state) {
+  NumericBench* bench = state->context;
+  f64 variance;
+  vector_variance(bench->x, VECTOR_NUMBER_F64, nullptr, &variance);
+  state->sink += (u64)variance;
+}
+
+static void run_dot(BenchState* state) {
+  NumericBench* bench = state->context;
+  f64 dot;
+  vector_dot(bench->x, bench->y, VECTOR_NUMBER_F64, &dot);
+  state->sink += (u64)dot;
+}
+
+// y stays bounded: a alternates in sign
+static void run_axpy(BenchState* state) {
+  NumericBench* bench = state->context;
+  vector_axpy(
+    bench->y, bench->x, VECTOR_NUMBER_F64, state->sink & 1 ? 1e-9 : -1e-9
+  );
+  state->sink++;
+}
+
+static void run_histogram(BenchState* state) {
+  NumericBench* bench = state->context;
+  vector_histogram(
+    bench->x, VECTOR_NUMBER_F64, -500, 500, bench->bins, NUMERIC_BINS
+  );
+  state->sink += bench->bins[0];
+}
+
+#define NUMERIC_CASE(name, case_policy, function)                             \
+  {                                                                           \
+    .group     = "numeric",                                                   \
+    .operation = name,                                                        \
+    .policy    = case_policy,                                                 \
+    .supports  = numeric_supports,                                            \
+    .prepare   = numeric_bench_prepare,                                       \
+    .cleanup   = numeric_bench_cleanup,                                       \
+    .run       = function,                                                    \
+  }
+
+static const BenchCase numeric_cases[] = {
+  NUMERIC_CASE("sum", "walk", run_sum_walk),
+  NUMERIC_CASE("sum", "plain", run_sum_plain),
+  NUMERIC_CASE("sum", "pairwise", run_sum_pairwise),
+  NUMERIC_CASE("sum", "kahan", run_sum_kahan),
+  NUMERIC_CASE("min", nullptr, run_min),
+  NUMERIC_CASE("variance", nullptr, run_variance),
+  NUMERIC_CASE("dot", nullptr, run_dot),
+  NUMERIC_CASE("axpy", nullptr, run_axpy),
+  NUMERIC_CASE("histogram", nullptr, run_histogram),
+};
+
+void bench_numeric_register(void) {
+  for (usize i = 0; i < sizeof(numeric_cases) / sizeof(*numeric_cases); i++) {
+    bench_register(&numeric_cases[i]);
+  }
+}
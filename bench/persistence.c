@@ -0,0 +1,418 @@
+#define _GNU_SOURCE
+#include "harness.h"
+#include "castor/async.h"
+#include "castor/snapshot.h"
+#include "castor/vector.h"
+#include "castor/wal.h"
+#include "castor/types.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+
+// The persistence cases compare the ways of getting a Vector of u64 to and
+// from a file: snapshot save and load (mapped or copied) against reading
+// the objects one by one, async_io against a plain writev, and the WAL
+// under several commit windows.
+
+// Number of threads appending to the WAL
+#define PERSISTENCE_WAL_THREADS 4
+
+// Size of the reads of the element-wise load
+#define PERSISTENCE_READ_SIZE (64 * 1024)
+
+
+// Member:
+// - directory:
+//    Temporary directory holding the files.
+// - path:
+//    The snapshot file.
+// - vector:
+//    The saved Vector.
+// - io:
+//    The AsyncIo of the async_io cases.
+// - wal:
+//    The log of the wal cases, opened for each repetition.
+typedef struct PersistenceBench {
+  char    directory[PATH_MAX];
+  char    path[PATH_MAX + 16];
+  Vector* vector;
+  AsyncIo* io;
+  Wal*    wal;
+} PersistenceBench;
+
+
+static bool persistence_supports(const usize object_size, const usize count) {
+  return object_size == sizeof(u64) && count >= 1000;
+}
+
+// Each record of the WAL is synced, so keep the counts small
+static bool wal_supports(const usize object_size, const usize count) {
+  return persistence_supports(object_size, count) && count <= 10000;
+}
+
+// Removes the files of the directory
+static void persistence_clear(const char* directory) {
+  DIR* dir = opendir(directory);
+  if (dir == nullptr) {
+    return;
+  }
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+    unlink(path);
+  }
+  closedir(dir);
+}
+
+static bool persistence_prepare_with(
+  BenchState*          state,
+  const AsyncIoBackend backend
+) {
+  PersistenceBench* bench = calloc(1, sizeof(PersistenceBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  const char* tmp = getenv("TMPDIR");
+  snprintf(
+    bench->directory, sizeof(bench->directory), "%s/castor_bench.XXXXXX",
+    tmp != nullptr ? tmp : "/tmp"
+  );
+  if (mkdtemp(bench->directory) == nullptr) {
+    bench->directory[0] = '\0';
+    return false;
+  }
+  snprintf(
+    bench->path, sizeof(bench->path), "%s/snapshot", bench->directory
+  );
+
+  bench->vector = vector_construct(
+    sizeof(u64),
+    (VectorOptions){ .capacity = state->count }
+  );
+  if (bench->vector == nullptr) {
+    return false;
+  }
+  for (u64 i = 0; i < state->count; i++) {
+    if (!vector_push_back(bench->vector, &i)) {
+      return false;
+    }
+  }
+
+  if (backend != ASYNC_IO_AUTO) {
+    bench->io = async_io_construct((AsyncIoOptions){ .backend = backend });
+    if (bench->io == nullptr) {
+      return false;
+    }
+  }
+
+  return snapshot_save(bench->vector, bench->path);
+}
+
+static bool persistence_prepare(BenchState* state) {
+  return persistence_prepare_with(state, ASYNC_IO_AUTO);
+}
+
+static bool persistence_prepare_uring(BenchState* state) {
+  return persistence_prepare_with(state, ASYNC_IO_URING);
+}
+
+static bool persistence_prepare_threads(BenchState* state) {
+  return persistence_prepare_with(state, ASYNC_IO_THREADS);
+}
+
+static void persistence_cleanup(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  async_io_destruct(bench->io);
+  vector_destruct(bench->vector);
+  if (bench->directory[0] != '\0') {
+    persistence_clear(bench->directory);
+    rmdir(bench->directory);
+  }
+  free(bench);
+}
+
+// Reads every object of a loaded Vector, as the first pass over it would
+static void persistence_touch(BenchState* state, Vector* vector) {
+  if (vector == nullptr) {
+    return;
+  }
+  const u64* values = vector_get(vector, 0);
+  for (usize i = 0; values != nullptr && i < state->count; i++) {
+    state->sink += values[i];
+  }
+}
+
+static void run_snapshot_save(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  snapshot_save(bench->vector, bench->path);
+}
+
+static void run_async_io_save(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  AsyncIoRequest* request = async_io_save(
+    bench->io, bench->vector, bench->path, nullptr, nullptr
+  );
+  if (request != nullptr) {
+    async_io_wait(bench->io, request);
+    async_io_release(request);
+  }
+}
+
+static void run_snapshot_load(BenchState* state, const SnapshotMode mode) {
+  PersistenceBench* bench = state->context;
+  Vector* vector = snapshot_load(
+    bench->path,
+    (SnapshotOptions){ .mode = mode }
+  );
+  persistence_touch(state, vector);
+  vector_destruct(vector);
+}
+
+static void run_snapshot_load_readonly(BenchState* state) {
+  run_snapshot_load(state, SNAPSHOT_READONLY);
+}
+
+static void run_snapshot_load_copy_on_write(BenchState* state) {
+  run_snapshot_load(state, SNAPSHOT_COPY_ON_WRITE);
+}
+
+// Loads the snapshot the way it would be without it: read the file and push
+// the objects one by one
+static void run_elementwise_load(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  int fd = open(bench->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  SnapshotHeader header;
+  if (
+    pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+    lseek(fd, (off_t)header.payload_offset, SEEK_SET) < 0
+  ) {
+    close(fd);
+    return;
+  }
+
+  Vector* vector = vector_construct(sizeof(u64), (VectorOptions){});
+  static u64 buffer[PERSISTENCE_READ_SIZE / sizeof(u64)];
+  usize remaining = header.count;
+  while (vector != nullptr && remaining > 0) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+    const usize objects = (usize)n / sizeof(u64);
+    for (usize i = 0; i < objects && remaining > 0; i++, remaining--) {
+      vector_push_back(vector, &buffer[i]);
+    }
+  }
+  close(fd);
+
+  persistence_touch(state, vector);
+  vector_destruct(vector);
+}
+
+static void run_async_io_load(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  AsyncIoRequest* request = async_io_load(
+    bench->io, bench->path, false, nullptr, nullptr
+  );
+  if (request == nullptr) {
+    return;
+  }
+
+  async_io_wait(bench->io, request);
+  Vector* vector = async_io_take(request);
+  async_io_release(request);
+  persistence_touch(state, vector);
+  vector_destruct(vector);
+}
+
+static bool setup_wal(BenchState* state, const usize commit_window) {
+  PersistenceBench* bench = state->context;
+  bench->wal = wal_open(
+    bench->directory, sizeof(u64),
+    (WalOptions){ .commit_window = commit_window }
+  );
+  return bench->wal != nullptr;
+}
+
+static bool setup_wal_window_0(BenchState* state) {
+  return setup_wal(state, 0);
+}
+
+static bool setup_wal_window_100(BenchState* state) {
+  return setup_wal(state, 100);
+}
+
+static bool setup_wal_window_1000(BenchState* state) {
+  return setup_wal(state, 1000);
+}
+
+static void teardown_wal(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  wal_close(bench->wal);
+  bench->wal = nullptr;
+
+  // Start the next repetition from an empty log
+  persistence_clear(bench->directory);
+}
+
+typedef struct WalWriter {
+  Wal*  wal;
+  usize count;
+} WalWriter;
+
+static int wal_writer(void* argument) {
+  WalWriter* writer = argument;
+  for (u64 i = 0; i < writer->count; i++) {
+    wal_push_back(writer->wal, &i);
+  }
+  return 0;
+}
+
+// Several threads append at once, so the commits can be grouped
+static void run_wal_push_back(BenchState* state) {
+  PersistenceBench* bench = state->context;
+  thrd_t threads[PERSISTENCE_WAL_THREADS];
+  WalWriter writers[PERSISTENCE_WAL_THREADS];
+  usize started = 0;
+
+  for (; started < PERSISTENCE_WAL_THREADS; started++) {
+    writers[started] = (WalWriter){
+      .wal   = bench->wal,
+      .count = state->count / PERSISTENCE_WAL_THREADS,
+    };
+    if (thrd_create(
+      &threads[started], wal_writer, &writers[started]
+    ) != thrd_success) {
+      break;
+    }
+  }
+
+  for (usize i = 0; i < started; i++) {
+    thrd_join(threads[i], nullptr);
+  }
+}
+
+static const BenchCase persistence_cases[] = {
+  {
+    .group     = "persistence",
+    .operation = "snapshot_save",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .run       = run_snapshot_save,
+  },
+  {
+    .group     = "persistence",
+    .operation = "async_io_save_uring",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare_uring,
+    .cleanup   = persistence_cleanup,
+    .run       = run_async_io_save,
+  },
+  {
+    .group     = "persistence",
+    .operation = "async_io_save_threads",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare_threads,
+    .cleanup   = persistence_cleanup,
+    .run       = run_async_io_save,
+  },
+  {
+    .group     = "persistence",
+    .operation = "snapshot_load_readonly",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .run       = run_snapshot_load_readonly,
+  },
+  {
+    .group     = "persistence",
+    .operation = "snapshot_load_copy_on_write",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .run       = run_snapshot_load_copy_on_write,
+  },
+  {
+    .group     = "persistence",
+    .operation = "elementwise_load",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .run       = run_elementwise_load,
+  },
+  {
+    .group     = "persistence",
+    .operation = "async_io_load_uring",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare_uring,
+    .cleanup   = persistence_cleanup,
+    .run       = run_async_io_load,
+  },
+  {
+    .group     = "persistence",
+    .operation = "async_io_load_threads",
+    .supports  = persistence_supports,
+    .prepare   = persistence_prepare_threads,
+    .cleanup   = persistence_cleanup,
+    .run       = run_async_io_load,
+  },
+  {
+    .group     = "persistence",
+    .operation = "wal_push_back_window_0",
+    .supports  = wal_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .setup     = setup_wal_window_0,
+    .teardown  = teardown_wal,
+    .run       = run_wal_push_back,
+  },
+  {
+    .group     = "persistence",
+    .operation = "wal_push_back_window_100",
+    .supports  = wal_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .setup     = setup_wal_window_100,
+    .teardown  = teardown_wal,
+    .run       = run_wal_push_back,
+  },
+  {
+    .group     = "persistence",
+    .operation = "wal_push_back_window_1000",
+    .supports  = wal_supports,
+    .prepare   = persistence_prepare,
+    .cleanup   = persistence_cleanup,
+    .setup     = setup_wal_window_1000,
+    .teardown  = teardown_wal,
+    .run       = run_wal_push_back,
+  },
+};
+
+void bench_persistence_register(void) {
+  const usize count = sizeof(persistence_cases) / sizeof(*persistence_cases);
+  for (usize i = 0; i < count; i++) {
+    bench_register(&persistence_cases[i]);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,570 @@
+#define _GNU_SOURCE
+#include "replay.h"
+#include "harness.h"
+#include "castor/trace.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// Receives the objects read by the replay, so that reading is not optimized
+// away
+static u64 replay_sink;
+
+static void replay_walk(void* object) {
+  replay_sink += *(u8*)object;
+}
+
+
+// The Castor target
+
+static void* vector_replay_construct(
+  const usize object_size,
+  const usize capacity
+) {
+  return vector_construct(object_size, (VectorOptions){ .capacity = capacity });
+}
+
+static void vector_replay_destruct(void* container) {
+  vector_destruct(container);
+}
+
+static void* vector_replay_copy(void* container, const bool shrink) {
+  return vector_copy(container, shrink);
+}
+
+static bool vector_replay_read(const void* object) {
+  if (object == nullptr) {
+    return false;
+  }
+  replay_sink += *(const u8*)object;
+  return true;
+}
+
+static bool vector_replay_apply(
+  void*                    container,
+  const VectorTraceRecord* record,
+  u8*                      object
+) {
+  Vector* vector = container;
+  const usize index = (usize)record->index;
+
+  switch (record->event) {
+    case VECTOR_TRACE_GROW:
+      return vector_grow(vector, index);
+    case VECTOR_TRACE_PUSH_BACK:
+      return vector_push_back(vector, object);
+    case VECTOR_TRACE_PUSH_FRONT:
+      return vector_push_front(vector, object);
+    case VECTOR_TRACE_DISCARD_BACK:
+      return vector_discard_back(vector);
+    case VECTOR_TRACE_DISCARD_FRONT:
+      return vector_discard_front(vector);
+    case VECTOR_TRACE_DISCARD:
+      return vector_discard(vector, index);
+    case VECTOR_TRACE_POP_BACK:
+      return vector_pop_back(vector, object);
+    case VECTOR_TRACE_POP_FRONT:
+      return vector_pop_front(vector, object);
+    case VECTOR_TRACE_POP:
+      return vector_pop(vector, object, index);
+    case VECTOR_TRACE_SET:
+      return vector_set(vector, index, object);
+    case VECTOR_TRACE_INSERT:
+      return vector_insert(vector, index, object);
+    case VECTOR_TRACE_RESET:
+      vector_reset(vector);
+      return true;
+    case VECTOR_TRACE_RELEASE:
+      vector_release(vector);
+      return true;
+    case VECTOR_TRACE_GET:
+      return vector_replay_read(vector_get(vector, index));
+    case VECTOR_TRACE_GET_BACK:
+      return vector_replay_read(vector_get_back(vector));
+    case VECTOR_TRACE_GET_FRONT:
+      return vector_replay_read(vector_get_front(vector));
+    case VECTOR_TRACE_WALK:
+      vector_walk(vector, replay_walk);
+      return true;
+    case VECTOR_TRACE_APPEND:
+      // The trace holds neither the objects nor their size: push the
+      // object as many times
+      for (usize i = 0; i < index; i++) {
+        if (!vector_push_back(vector, object)) {
+          return false;
+        }
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// The baseline: a plain C array growing by the given factor, to compare the
+// growth policies on the same trace.
+
+// Member:
+// - data:
+//    The objects.
+// - object_size:
+//    Size of an object in bytes.
+// - count:
+//    Number of objects.
+// - capacity:
+//    Number of objects data has room for.
+// - factor:
+//    Growth factor of the capacity when full.
+typedef struct ArrayReplay {
+  u8*   data;
+  usize object_size;
+  usize count;
+  usize capacity;
+  f64   factor;
+} ArrayReplay;
+
+
+static bool array_replay_resize(ArrayReplay* array, const usize capacity) {
+  u8* data = realloc(array->data, capacity * array->object_size);
+  if (data == nullptr) {
+    return false;
+  }
+  array->data = data;
+  array->capacity = capacity;
+  return true;
+}
+
+// Makes room for one more object
+static bool array_replay_reserve(ArrayReplay* array) {
+  if (array->count < array->capacity) {
+    return true;
+  }
+  const usize capacity = (usize)((f64)array->capacity * array->factor);
+  return array_replay_resize(
+    array, capacity > array->capacity ? capacity : array->capacity + 16
+  );
+}
+
+static ArrayReplay* array_replay_construct(
+  const usize object_size,
+  const usize capacity,
+  const f64   factor
+) {
+  ArrayReplay* array = calloc(1, sizeof(ArrayReplay));
+  if (array == nullptr) {
+    return nullptr;
+  }
+  array->object_size = object_size;
+  array->factor = factor;
+  if (capacity > 0 && !array_replay_resize(array, capacity)) {
+    free(array);
+    return nullptr;
+  }
+  return array;
+}
+
+static void* array_replay_construct_doubling(
+  const usize object_size,
+  const usize capacity
+) {
+  return array_replay_construct(object_size, capacity, 2);
+}
+
+static void* array_replay_construct_factor_1_5(
+  const usize object_size,
+  const usize capacity
+) {
+  return array_replay_construct(object_size, capacity, 1.5);
+}
+
+static void array_replay_destruct(void* container) {
+  ArrayReplay* array = container;
+  if (array != nullptr) {
+    free(array->data);
+    free(array);
+  }
+}
+
+static void* array_replay_copy(void* container, const bool shrink) {
+  const ArrayReplay* array = container;
+  ArrayReplay* copy = array_replay_construct(
+    array->object_size,
+    shrink ? array->count : array->capacity,
+    array->factor
+  );
+  if (copy == nullptr) {
+    return nullptr;
+  }
+  if (array->count > 0) {
+    memcpy(copy->data, array->data, array->count * array->object_size);
+  }
+  copy->count = array->count;
+  return copy;
+}
+
+// Returns the object at the index
+static u8* array_replay_at(const ArrayReplay* array, const usize index) {
+  return array->data + index * array->object_size;
+}
+
+// Inserts the object before the index, which may be the count
+static bool array_replay_insert(
+  ArrayReplay* array,
+  const usize  index,
+  const u8*    object
+) {
+  if (!array_replay_reserve(array)) {
+    return false;
+  }
+  memmove(
+    array_replay_at(array, index + 1), array_replay_at(array, index),
+    (array->count - index) * array->object_size
+  );
+  memcpy(array_replay_at(array, index), object, array->object_size);
+  array->count++;
+  return true;
+}
+
+// Removes the object at the index, copying it to object unless nullptr
+static bool array_replay_remove(
+  ArrayReplay* array,
+  const usize  index,
+  u8*          object
+) {
+  if (index >= array->count) {
+    return false;
+  }
+  if (object != nullptr) {
+    memcpy(object, array_replay_at(array, index), array->object_size);
+  }
+  memmove(
+    array_replay_at(array, index), array_replay_at(array, index + 1),
+    (array->count - index - 1) * array->object_size
+  );
+  array->count--;
+  return true;
+}
+
+static bool array_replay_read(const ArrayReplay* array, const usize index) {
+  if (index >= array->count) {
+    return false;
+  }
+  replay_sink += *array_replay_at(array, index);
+  return true;
+}
+
+static bool array_replay_apply(
+  void*                    container,
+  const VectorTraceRecord* record,
+  u8*                      object
+) {
+  ArrayReplay* array = container;
+  const usize index = (usize)record->index;
+  const usize last = array->count - 1;
+
+  // The same preconditions as the Vector functions
+  switch (record->event) {
+    case VECTOR_TRACE_GROW: {
+      const usize capacity = array->capacity + index;
+      return array_replay_resize(array, capacity ? capacity : 16);
+    }
+    case VECTOR_TRACE_PUSH_BACK:
+      return array_replay_insert(array, array->count, object);
+    case VECTOR_TRACE_PUSH_FRONT:
+      return array_replay_insert(array, 0, object);
+    case VECTOR_TRACE_DISCARD_BACK:
+      return array_replay_remove(array, last, nullptr);
+    case VECTOR_TRACE_DISCARD_FRONT:
+      return array_replay_remove(array, 0, nullptr);
+    case VECTOR_TRACE_DISCARD:
+      return array_replay_remove(array, index, nullptr);
+    case VECTOR_TRACE_POP_BACK:
+      return array_replay_remove(array, last, object);
+    case VECTOR_TRACE_POP_FRONT:
+      return array_replay_remove(array, 0, object);
+    case VECTOR_TRACE_POP:
+      return array_replay_remove(array, index, object);
+    case VECTOR_TRACE_SET:
+      if (index >= array->count) {
+        return false;
+      }
+      memcpy(array_replay_at(array, index), object, array->object_size);
+      return true;
+    case VECTOR_TRACE_INSERT:
+      return index < array->count && array_replay_insert(array, index, object);
+    case VECTOR_TRACE_RESET:
+      array->count = 0;
+      return true;
+    case VECTOR_TRACE_RELEASE:
+      free(array->data);
+      array->data = nullptr;
+      array->count = 0;
+      array->capacity = 0;
+      return true;
+    case VECTOR_TRACE_GET:
+      return array_replay_read(array, index);
+    case VECTOR_TRACE_GET_BACK:
+      return array_replay_read(array, last);
+    case VECTOR_TRACE_GET_FRONT:
+      return array_replay_read(array, 0);
+    case VECTOR_TRACE_WALK:
+      for (usize i = 0; i < array->count; i++) {
+        replay_walk(array_replay_at(array, i));
+      }
+      return true;
+    case VECTOR_TRACE_APPEND:
+      for (usize i = 0; i < index; i++) {
+        if (!array_replay_insert(array, array->count, object)) {
+          return false;
+        }
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+static const BenchReplayTarget replay_targets[] = {
+  {
+    .name      = "vector",
+    .construct = vector_replay_construct,
+    .destruct  = vector_replay_destruct,
+    .copy      = vector_replay_copy,
+    .apply     = vector_replay_apply,
+  },
+  {
+    .name      = "c_array_doubling",
+    .construct = array_replay_construct_doubling,
+    .destruct  = array_replay_destruct,
+    .copy      = array_replay_copy,
+    .apply     = array_replay_apply,
+  },
+  {
+    .name      = "c_array_factor_1.5",
+    .construct = array_replay_construct_factor_1_5,
+    .destruct  = array_replay_destruct,
+    .copy      = array_replay_copy,
+    .apply     = array_replay_apply,
+  },
+};
+
+
+// A trace loaded in memory.
+// Member:
+// - records:
+//    The records in order.
+// - count:
+//    Number of records.
+// - vectors:
+//    Highest number of a Vector.
+// - object_size:
+//    Largest object size.
+typedef struct ReplayTrace {
+  VectorTraceRecord* records;
+  usize              count;
+  usize              vectors;
+  usize              object_size;
+} ReplayTrace;
+
+
+static bool replay_load(FILE* in, ReplayTrace* trace) {
+  if (!vector_trace_read_header(in)) {
+    return false;
+  }
+
+  usize capacity = 0;
+  VectorTraceRecord record;
+  while (vector_trace_read(in, &record)) {
+    if (trace->count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      VectorTraceRecord* records = realloc(
+        trace->records, capacity * sizeof(VectorTraceRecord)
+      );
+      if (records == nullptr) {
+        return false;
+      }
+      trace->records = records;
+    }
+    trace->records[trace->count++] = record;
+
+    const u64 vector = record.vector > record.copy
+      ? record.vector
+      : record.copy;
+    trace->vectors = vector > trace->vectors ? (usize)vector : trace->vectors;
+    if (record.object_size > trace->object_size) {
+      trace->object_size = (usize)record.object_size;
+    }
+  }
+
+  // A malformed record ends the trace early
+  return feof(in) && !ferror(in);
+}
+
+// Replays the trace once. Returns the number of calls that failed.
+static usize replay_once(
+  const BenchReplayTarget* target,
+  const ReplayTrace*       trace,
+  void**                   containers,
+  u8*                      object
+) {
+  usize failures = 0;
+
+  for (usize i = 0; i < trace->count; i++) {
+    const VectorTraceRecord* record = &trace->records[i];
+    void** container = &containers[record->vector];
+
+    switch (record->event) {
+      case VECTOR_TRACE_CONSTRUCT:
+      case VECTOR_TRACE_ATTACH:
+        target->destruct(*container);
+        *container = target->construct(
+          (usize)record->object_size, (usize)record->capacity
+        );
+        failures += *container == nullptr;
+        // An attached Vector starts with its objects
+        for (u64 n = 0; *container != nullptr && n < record->count; n++) {
+          const VectorTraceRecord push = { .event = VECTOR_TRACE_PUSH_BACK };
+          target->apply(*container, &push, object);
+        }
+        break;
+      case VECTOR_TRACE_DESTRUCT:
+        target->destruct(*container);
+        *container = nullptr;
+        break;
+      case VECTOR_TRACE_COPY:
+        // The copy was constructed just before, replace it
+        target->destruct(containers[record->copy]);
+        containers[record->copy] = *container != nullptr
+          ? target->copy(*container, record->index != 0)
+          : nullptr;
+        failures += containers[record->copy] == nullptr;
+        break;
+      default:
+        failures += *container == nullptr ||
+          !target->apply(*container, record, object);
+        break;
+    }
+  }
+
+  return failures;
+}
+
+static int replay_compare(const void* a, const void* b) {
+  const f64 x = *(const f64*)a;
+  const f64 y = *(const f64*)b;
+  return (x > y) - (x < y);
+}
+
+// Replays the trace with the target and writes its result
+static bool replay_target(
+  const BenchConfig*       config,
+  const BenchReplayTarget* target,
+  const ReplayTrace*       trace,
+  FILE*                    out,
+  const bool               first
+) {
+  void** containers = calloc(trace->vectors + 1, sizeof(void*));
+  u8* object = malloc(trace->object_size ? trace->object_size : 1);
+  f64* samples = malloc(config->min_repetitions * sizeof(f64));
+  if (containers == nullptr || object == nullptr || samples == nullptr) {
+    free(containers);
+    free(object);
+    free(samples);
+    return false;
+  }
+  memset(object, 0x5a, trace->object_size ? trace->object_size : 1);
+
+  const usize total = config->warmup + config->min_repetitions;
+  const u64 started = bench_now();
+  usize repetitions = 0;
+  usize failures = 0;
+  for (usize repetition = 0; repetition < total; repetition++) {
+    const f64 elapsed = (f64)(bench_now() - started) / 1e9;
+    if (repetitions > 0 && elapsed >= config->max_time) {
+      break;
+    }
+
+    const u64 start = bench_now();
+    failures = replay_once(target, trace, containers, object);
+    const u64 duration = bench_now() - start;
+    if (repetition >= config->warmup) {
+      samples[repetitions++] = (f64)duration;
+    }
+
+    // The Vectors left alive by the trace are not part of the timing
+    for (usize i = 0; i <= trace->vectors; i++) {
+      target->destruct(containers[i]);
+      containers[i] = nullptr;
+    }
+  }
+
+  qsort(samples, repetitions, sizeof(f64), replay_compare);
+  const f64 median = repetitions % 2
+    ? samples[repetitions / 2]
+    : (samples[repetitions / 2 - 1] + samples[repetitions / 2]) / 2;
+
+  fprintf(out, "%s\n    {\n", first ? "" : ",");
+  fprintf(out, "      \"target\": \"%s\",\n", target->name);
+  fprintf(out, "      \"repetitions\": %zu,\n", (size_t)repetitions);
+  fprintf(out, "      \"median_ns\": %.1f,\n", median);
+  fprintf(out, "      \"min_ns\": %.1f,\n", samples[0]);
+  fprintf(
+    out, "      \"ns_per_record\": %.3f,\n",
+    trace->count ? median / (f64)trace->count : 0
+  );
+  fprintf(out, "      \"failures\": %zu\n    }", (size_t)failures);
+
+  free(containers);
+  free(object);
+  free(samples);
+  return true;
+}
+
+bool bench_replay(const BenchConfig* config, const char* path, FILE* out) {
+  FILE* in = fopen(path, "rb");
+  if (in == nullptr) {
+    perror(path);
+    return false;
+  }
+
+  ReplayTrace trace = {};
+  const bool loaded = replay_load(in, &trace);
+  fclose(in);
+  if (!loaded) {
+    fprintf(stderr, "%s: cannot read the trace\n", path);
+    free(trace.records);
+    return false;
+  }
+
+  fprintf(out, "{\n  \"trace\": \"%s\",\n", path);
+  fprintf(out, "  \"records\": %zu,\n", (size_t)trace.count);
+  fprintf(out, "  \"vectors\": %zu,\n", (size_t)trace.vectors);
+  fprintf(out, "  \"results\": [");
+
+  bool ok = true;
+  bool first = true;
+  const usize count = sizeof(replay_targets) / sizeof(*replay_targets);
+  for (usize i = 0; i < count; i++) {
+    const BenchReplayTarget* target = &replay_targets[i];
+    if (
+      config->filter != nullptr &&
+      strstr(target->name, config->filter) == nullptr
+    ) {
+      continue;
+    }
+    fprintf(stderr, "replay %s\n", target->name);
+    if (!replay_target(config, target, &trace, out, first)) {
+      fprintf(stderr, "  failed\n");
+      ok = false;
+      continue;
+    }
+    first = false;
+  }
+
+  fprintf(out, "\n  ]\n}\n");
+  free(trace.records);
+  return ok;
+}
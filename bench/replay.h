@@ -0,0 +1,43 @@
+#pragma once
+#include "harness.h"
+#include "castor/trace.h"
+#include "castor/types.h"
+#include <stdio.h>
+
+
+// The replay runs a Vector trace (see castor/trace.h) recorded from a real
+// workload against each replay target: Castor's Vector and the containers
+// and growth policies it is compared to. Each target replays the whole
+// trace for warmup and then min_repetitions repetitions, max_time
+// permitting, and the durations are reported as JSON.
+typedef struct BenchReplayTarget BenchReplayTarget;
+
+
+// Member:
+// - name:
+//    Name of the target, matched by the filter of the configuration.
+// - construct:
+//    Makes a container of objects of object_size bytes with room for
+//    capacity of them. Returns nullptr if allocation fails.
+// - destruct:
+//    Destroys a container, may be given nullptr.
+// - copy:
+//    Returns a copy of the container, shrunk to fit if shrink is true.
+// - apply:
+//    Makes on the container the call of the record, any but construct,
+//    attach, destruct and copy. object holds object_size bytes to add, and
+//    receives the objects removed. Returns false if the call failed, which
+//    the trace may hold as well.
+struct BenchReplayTarget {
+  const char* name;
+  void*     (*construct)(const usize object_size, const usize capacity);
+  void      (*destruct)(void*);
+  void*     (*copy)(void*, const bool shrink);
+  bool      (*apply)(void*, const VectorTraceRecord*, u8* object);
+};
+
+
+// Replays the trace of the file at path against the matching targets, and
+// writes the results to out as JSON. Returns false if the trace cannot be
+// read or a target failed.
+bool bench_replay(const BenchConfig*, const char* path, FILE* out);
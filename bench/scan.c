@@ -0,0 +1,193 @@
+#include "harness.h"
+#include "castor/bulk.h"
+#include "castor/numeric.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+
+
+// Member:
+// - counts:
+//    The count i64 counts of the scan cases, between 0 and 15.
+// - sums:
+//    The destination of the scans.
+// - mask:
+//    A byte per count, set for about half of them.
+// - indexes:
+//    A permutation of the count indexes, the destinations of the scatters.
+// - out:
+//    The destination of the scatters.
+// - array, array_out:
+//    Copies of counts and out as plain arrays, for the serial loops.
+// - array_indexes:
+//    A copy of indexes, for the serial loops.
+typedef struct ScanBench {
+  Vector* counts;
+  Vector* sums;
+  Vector* mask;
+  Vector* indexes;
+  Vector* out;
+  i64*    array;
+  i64*    array_out;
+  u64*    array_indexes;
+} ScanBench;
+
+
+// The cases work on i64 counts
+static bool scan_supports(const usize object_size, const usize) {
+  return object_size == sizeof(i64);
+}
+
+static bool scan_bench_prepare(BenchState* state) {
+  ScanBench* bench = calloc(1, sizeof(ScanBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  const usize count = state->count;
+  const VectorOptions options = { .capacity = count };
+  bench->counts = vector_construct(sizeof(i64), options);
+  bench->sums = vector_construct(sizeof(i64), options);
+  bench->mask = vector_construct(1, options);
+  bench->indexes = vector_construct(sizeof(u64), options);
+  bench->out = vector_construct(sizeof(i64), options);
+  bench->array = malloc(count * sizeof(i64));
+  bench->array_out = malloc(count * sizeof(i64));
+  bench->array_indexes = malloc(count * sizeof(u64));
+  if (
+    bench->counts == nullptr || bench->sums == nullptr ||
+    bench->mask == nullptr || bench->indexes == nullptr ||
+    bench->out == nullptr || bench->array == nullptr ||
+    bench->array_out == nullptr || bench->array_indexes == nullptr
+  ) {
+    return false;
+  }
+
+  u64 seed = 0x9e3779b97f4a7c15;
+  for (usize i = 0; i < count; i++) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    i64 value = (i64)(seed >> 60);
+    u8 flag = (seed >> 32) & 1;
+    bench->array[i] = value;
+    bench->array_indexes[i] = i;
+    if (
+      !vector_push_back(bench->counts, &value) ||
+      !vector_push_back(bench->mask, &flag) ||
+      !vector_push_back(bench->out, &value)
+    ) {
+      return false;
+    }
+  }
+
+  // A random permutation, so that the scatters miss the cache as the
+  // offsets of a pipeline stage would
+  for (usize i = count; i > 1; i--) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    const usize j = (seed >> 33) % i;
+    const u64 swap = bench->array_indexes[i - 1];
+    bench->array_indexes[i - 1] = bench->array_indexes[j];
+    bench->array_indexes[j] = swap;
+  }
+  if (!vector_append(bench->indexes, bench->array_indexes, count)) {
+    return false;
+  }
+
+  state->bytes = count * sizeof(i64);
+  return true;
+}
+
+static void scan_bench_cleanup(BenchState* state) {
+  ScanBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  vector_destruct(bench->counts);
+  vector_destruct(bench->sums);
+  vector_destruct(bench->mask);
+  vector_destruct(bench->indexes);
+  vector_destruct(bench->out);
+  free(bench->array);
+  free(bench->array_out);
+  free(bench->array_indexes);
+  free(bench);
+}
+
+// The baselines: serial loops over plain arrays
+static void run_scan_loop(BenchState* state) {
+  ScanBench* bench = state->context;
+  i64 sum = 0;
+  for (usize i = 0; i < state->count; i++) {
+    const i64 value = bench->array[i];
+    bench->array_out[i] = sum;
+    sum += value;
+  }
+  state->sink += (u64)sum;
+}
+
+static void run_scan(BenchState* state) {
+  ScanBench* bench = state->context;
+  i64 total;
+  vector_scan(bench->sums, bench->counts, VECTOR_NUMBER_I64, &total);
+  state->sink += (u64)total;
+}
+
+static void run_filter_loop(BenchState* state) {
+  ScanBench* bench = state->context;
+  const u8* mask = vector_get(bench->mask, 0);
+  usize kept = 0;
+  for (usize i = 0; i < state->count; i++) {
+    if (mask[i]) {
+      bench->array_out[kept++] = bench->array[i];
+    }
+  }
+  state->sink += kept;
+}
+
+static void run_filter(BenchState* state) {
+  ScanBench* bench = state->context;
+  Vector* kept = vector_filter_mask(bench->counts, bench->mask);
+  state->sink += kept != nullptr && !vector_empty(kept);
+  vector_destruct(kept);
+}
+
+static void run_scatter_loop(BenchState* state) {
+  ScanBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    bench->array_out[bench->array_indexes[i]] = bench->array[i];
+  }
+  state->sink += (u64)bench->array_out[0];
+}
+
+static void run_scatter(BenchState* state) {
+  ScanBench* bench = state->context;
+  vector_scatter(bench->out, bench->counts, bench->indexes);
+  state->sink += *(u64*)vector_get(bench->out, 0);
+}
+
+#define SCAN_CASE(name, case_policy, function)                                \
+  {                                                                           \
+    .group     = "scan",                                                      \
+    .operation = name,                                                        \
+    .policy    = case_policy,                                                 \
+    .supports  = scan_supports,                                               \
+    .prepare   = scan_bench_prepare,                                          \
+    .cleanup   = scan_bench_cleanup,                                          \
+    .run       = function,                                                    \
+  }
+
+static const BenchCase scan_cases[] = {
+  SCAN_CASE("scan", "loop", run_scan_loop),
+  SCAN_CASE("scan", "vector", run_scan),
+  SCAN_CASE("filter", "loop", run_filter_loop),
+  SCAN_CASE("filter", "vector", run_filter),
+  SCAN_CASE("scatter", "loop", run_scatter_loop),
+  SCAN_CASE("scatter", "vector", run_scatter),
+};
+
+void bench_scan_register(void) {
+  for (usize i = 0; i < sizeof(scan_cases) / sizeof(*scan_cases); i++) {
+    bench_register(&scan_cases[i]);
+  }
+}
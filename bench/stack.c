@@ -0,0 +1,282 @@
+#include "harness.h"
+#include "castor/stack.h"
+#include "castor/types.h"
+#include <stdlib.h>
+
+
+// Member:
+// - stack:
+//    A Stack of count objects, or nullptr.
+// - stacks:
+//    The Stacks of the cases that construct or copy many of them.
+// - dest:
+//    Receives the popped objects.
+typedef struct StackBench {
+  Stack*  stack;
+  Stack** stacks;
+  u8*     dest;
+} StackBench;
+
+
+static bool stack_bench_fill(Stack* stack, const usize count, void* object) {
+  for (usize i = 0; i < count; i++) {
+    if (!stack_push(stack, object)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool stack_bench_prepare(
+  BenchState* state,
+  const bool  filled,
+  const bool  many
+) {
+  StackBench* bench = calloc(1, sizeof(StackBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  bench->dest = malloc(state->object_size);
+  if (bench->dest == nullptr) {
+    return false;
+  }
+
+  if (filled) {
+    bench->stack = stack_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+    if (
+      bench->stack == nullptr ||
+      !stack_bench_fill(bench->stack, state->count, state->object)
+    ) {
+      return false;
+    }
+  }
+
+  // Each of the Stacks holds count objects
+  if (many) {
+    const usize bytes = state->count * state->object_size;
+    state->operations = bench_linear_operations(state, bytes);
+    state->bytes = state->operations * bytes;
+    bench->stacks = calloc(state->operations, sizeof(Stack*));
+    if (bench->stacks == nullptr) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void stack_bench_cleanup(BenchState* state) {
+  StackBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  if (bench->stacks != nullptr) {
+    for (usize i = 0; i < state->operations; i++) {
+      stack_destruct(bench->stacks[i]);
+    }
+  }
+  stack_destruct(bench->stack);
+  free(bench->stacks);
+  free(bench->dest);
+  free(bench);
+}
+
+static bool prepare_filled(BenchState* state) {
+  return stack_bench_prepare(state, true, false);
+}
+
+static bool prepare_empty(BenchState* state) {
+  return stack_bench_prepare(state, false, false);
+}
+
+static bool prepare_many(BenchState* state) {
+  return stack_bench_prepare(state, false, true);
+}
+
+static bool prepare_filled_many(BenchState* state) {
+  return stack_bench_prepare(state, true, true);
+}
+
+static void teardown_many(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    stack_destruct(bench->stacks[i]);
+    bench->stacks[i] = nullptr;
+  }
+}
+
+static bool setup_many(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->stacks[i] = stack_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+    if (bench->stacks[i] == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void run_construct(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->stacks[i] = stack_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+  }
+}
+
+static void run_destruct(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    stack_destruct(bench->stacks[i]);
+    bench->stacks[i] = nullptr;
+  }
+}
+
+static bool setup_push(BenchState* state) {
+  StackBench* bench = state->context;
+  bench->stack = stack_construct(state->object_size, (VectorOptions){});
+  return bench->stack != nullptr;
+}
+
+static void teardown_push(BenchState* state) {
+  StackBench* bench = state->context;
+  stack_destruct(bench->stack);
+  bench->stack = nullptr;
+}
+
+static void run_push(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    stack_push(bench->stack, state->object);
+  }
+}
+
+static void step_push(BenchState* state, const usize) {
+  StackBench* bench = state->context;
+  stack_push(bench->stack, state->object);
+}
+
+static void teardown_refill(BenchState* state) {
+  StackBench* bench = state->context;
+  stack_bench_fill(bench->stack, state->count, state->object);
+}
+
+static void run_pop(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    stack_pop(bench->stack, bench->dest);
+    state->sink += bench->dest[0];
+  }
+}
+
+static void run_empty(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += stack_empty(bench->stack);
+  }
+}
+
+static void run_peek(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += *(u8*)stack_peek(bench->stack);
+  }
+}
+
+static void run_copy(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->stacks[i] = stack_copy(bench->stack, false);
+  }
+}
+
+static void run_copy_shrink(BenchState* state) {
+  StackBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->stacks[i] = stack_copy(bench->stack, true);
+  }
+}
+
+static const BenchCase stack_cases[] = {
+  {
+    .group     = "stack",
+    .operation = "construct",
+    .prepare   = prepare_many,
+    .cleanup   = stack_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_construct,
+  },
+  {
+    .group     = "stack",
+    .operation = "destruct",
+    .prepare   = prepare_many,
+    .cleanup   = stack_bench_cleanup,
+    .setup     = setup_many,
+    .run       = run_destruct,
+  },
+  {
+    .group     = "stack",
+    .operation = "push",
+    .prepare   = prepare_empty,
+    .cleanup   = stack_bench_cleanup,
+    .setup     = setup_push,
+    .teardown  = teardown_push,
+    .run       = run_push,
+    .step      = step_push,
+  },
+  {
+    .group     = "stack",
+    .operation = "pop",
+    .prepare   = prepare_filled,
+    .cleanup   = stack_bench_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_pop,
+  },
+  {
+    .group     = "stack",
+    .operation = "empty",
+    .prepare   = prepare_filled,
+    .cleanup   = stack_bench_cleanup,
+    .run       = run_empty,
+  },
+  {
+    .group     = "stack",
+    .operation = "peek",
+    .prepare   = prepare_filled,
+    .cleanup   = stack_bench_cleanup,
+    .run       = run_peek,
+  },
+  {
+    .group     = "stack",
+    .operation = "copy",
+    .prepare   = prepare_filled_many,
+    .cleanup   = stack_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_copy,
+  },
+  {
+    .group     = "stack",
+    .operation = "copy_shrink",
+    .prepare   = prepare_filled_many,
+    .cleanup   = stack_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_copy_shrink,
+  },
+};
+
+void bench_stack_register(void) {
+  for (usize i = 0; i < sizeof(stack_cases) / sizeof(*stack_cases); i++) {
+    bench_register(&stack_cases[i]);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "harness.h"
+#include "castor/types.h"
+#include <cstring>
+#include <new>
+#include <vector>
+
+
+// The baseline: the same operations on std::vector. The object size must be
+// known at compile time, so the cases only run at the sizes instantiated
+// below.
+
+namespace {
+
+template <usize N>
+struct Object {
+  u8 bytes[N];
+};
+
+// Member:
+// - vector:
+//    The objects.
+// - copies:
+//    The copies made by the copy case.
+// - object:
+//    The object pushed by the cases.
+template <usize N>
+struct StdVectorBench {
+  std::vector<Object<N>>              vector;
+  std::vector<std::vector<Object<N>>> copies;
+  Object<N>                           object;
+};
+
+enum Fill {
+  EMPTY,
+  FILLED,
+  LINEAR,
+  LINEAR_MIDDLE,
+};
+
+template <usize N>
+bool prepare(BenchState* state, const Fill fill) {
+  auto* bench = new (std::nothrow) StdVectorBench<N>();
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+  std::memcpy(bench->object.bytes, state->object, N);
+
+  if (fill != EMPTY) {
+    bench->vector.assign(state->count, bench->object);
+  }
+
+  if (fill == LINEAR || fill == LINEAR_MIDDLE) {
+    const usize objects = fill == LINEAR ? state->count : state->count / 2;
+    state->operations = bench_linear_operations(state, objects * N);
+    state->bytes = state->operations * objects * N;
+  }
+
+  return true;
+}
+
+template <usize N>
+void cleanup(BenchState* state) {
+  delete static_cast<StdVectorBench<N>*>(state->context);
+}
+
+template <usize N>
+StdVectorBench<N>* context(BenchState* state) {
+  return static_cast<StdVectorBench<N>*>(state->context);
+}
+
+template <usize N>
+bool prepare_empty(BenchState* state) {
+  return prepare<N>(state, EMPTY);
+}
+
+template <usize N>
+bool prepare_filled(BenchState* state) {
+  return prepare<N>(state, FILLED);
+}
+
+template <usize N>
+bool prepare_linear(BenchState* state) {
+  return prepare<N>(state, LINEAR);
+}
+
+template <usize N>
+bool prepare_linear_middle(BenchState* state) {
+  return prepare<N>(state, LINEAR_MIDDLE);
+}
+
+template <usize N>
+void teardown_clear(BenchState* state) {
+  std::vector<Object<N>>().swap(context<N>(state)->vector);
+}
+
+// With room for count objects, the vector never grows
+template <usize N>
+bool setup_reserve(BenchState* state) {
+  context<N>(state)->vector.reserve(state->count);
+  return true;
+}
+
+template <usize N>
+void teardown_shrink(BenchState* state) {
+  auto& vector = context<N>(state)->vector;
+  vector.resize(vector.size() - state->operations);
+}
+
+template <usize N>
+void teardown_refill(BenchState* state) {
+  auto* bench = context<N>(state);
+  bench->vector.resize(state->count, bench->object);
+}
+
+template <usize N>
+void teardown_copy(BenchState* state) {
+  context<N>(state)->copies.clear();
+}
+
+template <usize N>
+void run_push_back(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->count; i++) {
+    bench->vector.push_back(bench->object);
+  }
+}
+
+template <usize N>
+void step_push_back(BenchState* state, const usize) {
+  auto* bench = context<N>(state);
+  bench->vector.push_back(bench->object);
+}
+
+template <usize N>
+void run_push_front(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vector.insert(bench->vector.begin(), bench->object);
+  }
+}
+
+template <usize N>
+void run_pop_back(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->count; i++) {
+    Object<N> object = bench->vector.back();
+    bench->vector.pop_back();
+    state->sink += object.bytes[0];
+  }
+}
+
+template <usize N>
+void run_pop_front(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->operations; i++) {
+    Object<N> object = bench->vector.front();
+    bench->vector.erase(bench->vector.begin());
+    state->sink += object.bytes[0];
+  }
+}
+
+template <usize N>
+void run_get(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += bench->vector[i].bytes[0];
+  }
+}
+
+template <usize N>
+void run_set(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->count; i++) {
+    bench->vector[i] = bench->object;
+  }
+}
+
+template <usize N>
+void run_insert(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->operations; i++) {
+    auto middle = bench->vector.begin() + bench->vector.size() / 2;
+    bench->vector.insert(middle, bench->object);
+  }
+}
+
+template <usize N>
+void run_discard(BenchState* state) {
+  auto* bench = context<N>(state);
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vector.erase(bench->vector.begin() + bench->vector.size() / 2);
+  }
+}
+
+template <usize N>
+void run_copy(BenchState* state) {
+  auto* bench = context<N>(state);
+  bench->copies.reserve(state->operations);
+  for (usize i = 0; i < state->operations; i++) {
+    bench->copies.push_back(bench->vector);
+  }
+}
+
+bool supports(const usize object_size, const usize) {
+  switch (object_size) {
+    case 1: case 2: case 4: case 8: case 16:
+    case 32: case 64: case 128: case 256: case 512:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls the instance of the template matching the object size
+#define STD_VECTOR_DISPATCH(type, function)                                   \
+  type function##_dispatch(BenchState* state) {                               \
+    switch (state->object_size) {                                             \
+      case 1:   return function<1>(state);                                    \
+      case 2:   return function<2>(state);                                    \
+      case 4:   return function<4>(state);                                    \
+      case 8:   return function<8>(state);                                    \
+      case 16:  return function<16>(state);                                   \
+      case 32:  return function<32>(state);                                   \
+      case 64:  return function<64>(state);                                   \
+      case 128: return function<128>(state);                                  \
+      case 256: return function<256>(state);                                  \
+      default:  return function<512>(state);                                  \
+    }                                                                         \
+  }
+
+// Calls the instance of the step matching the object size
+#define STD_VECTOR_DISPATCH_STEP(function)                                    \
+  void function##_dispatch(BenchState* state, const usize index) {           \
+    switch (state->object_size) {                                             \
+      case 1:   return function<1>(state, index);                             \
+      case 2:   return function<2>(state, index);                             \
+      case 4:   return function<4>(state, index);                             \
+      case 8:   return function<8>(state, index);                             \
+      case 16:  return function<16>(state, index);                            \
+      case 32:  return function<32>(state, index);                            \
+      case 64:  return function<64>(state, index);                            \
+      case 128: return function<128>(state, index);                           \
+      case 256: return function<256>(state, index);                           \
+      default:  return function<512>(state, index);                           \
+    }                                                                         \
+  }
+
+STD_VECTOR_DISPATCH(bool, prepare_empty)
+STD_VECTOR_DISPATCH(bool, prepare_filled)
+STD_VECTOR_DISPATCH(bool, prepare_linear)
+STD_VECTOR_DISPATCH(bool, prepare_linear_middle)
+STD_VECTOR_DISPATCH(void, cleanup)
+STD_VECTOR_DISPATCH(bool, setup_reserve)
+STD_VECTOR_DISPATCH(void, teardown_clear)
+STD_VECTOR_DISPATCH(void, teardown_shrink)
+STD_VECTOR_DISPATCH(void, teardown_refill)
+STD_VECTOR_DISPATCH(void, teardown_copy)
+STD_VECTOR_DISPATCH(void, run_push_back)
+STD_VECTOR_DISPATCH(void, run_push_front)
+STD_VECTOR_DISPATCH(void, run_pop_back)
+STD_VECTOR_DISPATCH(void, run_pop_front)
+STD_VECTOR_DISPATCH(void, run_get)
+STD_VECTOR_DISPATCH(void, run_set)
+STD_VECTOR_DISPATCH(void, run_insert)
+STD_VECTOR_DISPATCH(void, run_discard)
+STD_VECTOR_DISPATCH(void, run_copy)
+STD_VECTOR_DISPATCH_STEP(step_push_back)
+
+BenchCase std_vector_case(
+  const char* operation,
+  bool (*prepare)(BenchState*),
+  void (*teardown)(BenchState*),
+  void (*run)(BenchState*)
+) {
+  BenchCase bench = {};
+  bench.group = "std_vector";
+  bench.operation = operation;
+  bench.supports = supports;
+  bench.prepare = prepare;
+  bench.cleanup = cleanup_dispatch;
+  bench.teardown = teardown;
+  bench.run = run;
+  return bench;
+}
+
+// Makes the case also run in the latency mode, under the growth policy
+BenchCase std_vector_latency(
+  BenchCase   bench,
+  const char* policy,
+  bool      (*setup)(BenchState*),
+  void      (*step)(BenchState*, const usize)
+) {
+  bench.policy = policy;
+  bench.setup = setup;
+  bench.step = step;
+  return bench;
+}
+
+const BenchCase std_vector_cases[] = {
+  std_vector_latency(
+    std_vector_case(
+      "push_back", prepare_empty_dispatch, teardown_clear_dispatch,
+      run_push_back_dispatch
+    ),
+    nullptr, nullptr, step_push_back_dispatch
+  ),
+  std_vector_latency(
+    std_vector_case(
+      "push_back", prepare_empty_dispatch, teardown_clear_dispatch,
+      run_push_back_dispatch
+    ),
+    "reserved", setup_reserve_dispatch, step_push_back_dispatch
+  ),
+  std_vector_case(
+    "push_front", prepare_linear_dispatch, teardown_shrink_dispatch,
+    run_push_front_dispatch
+  ),
+  std_vector_case(
+    "pop_back", prepare_filled_dispatch, teardown_refill_dispatch,
+    run_pop_back_dispatch
+  ),
+  std_vector_case(
+    "pop_front", prepare_linear_dispatch, teardown_refill_dispatch,
+    run_pop_front_dispatch
+  ),
+  std_vector_case(
+    "get", prepare_filled_dispatch, nullptr, run_get_dispatch
+  ),
+  std_vector_case(
+    "set", prepare_filled_dispatch, nullptr, run_set_dispatch
+  ),
+  std_vector_case(
+    "insert", prepare_linear_middle_dispatch, teardown_shrink_dispatch,
+    run_insert_dispatch
+  ),
+  std_vector_case(
+    "discard", prepare_linear_middle_dispatch, teardown_refill_dispatch,
+    run_discard_dispatch
+  ),
+  std_vector_case(
+    "copy", prepare_linear_dispatch, teardown_copy_dispatch,
+    run_copy_dispatch
+  ),
+};
+
+}
+
+extern "C" void bench_std_vector_register(void) {
+  for (const BenchCase& bench : std_vector_cases) {
+    bench_register(&bench);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,691 @@
+#include "harness.h"
+#include "castor/cache.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// Member:
+// - vector:
+//    A Vector of count objects, or nullptr.
+// - vectors:
+//    The Vectors of the cases that construct or release many of them.
+// - dest:
+//    Receives the popped objects.
+typedef struct VectorBench {
+  Vector*  vector;
+  Vector** vectors;
+  u8*      dest;
+} VectorBench;
+
+
+static bool vector_bench_prepare(
+  BenchState* state,
+  const bool  filled,
+  const bool  many
+) {
+  VectorBench* bench = calloc(1, sizeof(VectorBench));
+  if (bench == nullptr) {
+    return false;
+  }
+  state->context = bench;
+
+  bench->dest = malloc(state->object_size);
+  if (bench->dest == nullptr) {
+    return false;
+  }
+
+  if (filled) {
+    bench->vector = vector_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+    if (
+      bench->vector == nullptr ||
+      !bench_fill(bench->vector, state->count, state->object)
+    ) {
+      return false;
+    }
+  }
+
+  // Each of the Vectors holds count objects
+  if (many) {
+    const usize bytes = state->count * state->object_size;
+    state->operations = bench_linear_operations(state, bytes);
+    state->bytes = state->operations * bytes;
+    bench->vectors = calloc(state->operations, sizeof(Vector*));
+    if (bench->vectors == nullptr) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void vector_bench_cleanup(BenchState* state) {
+  VectorBench* bench = state->context;
+  if (bench == nullptr) {
+    return;
+  }
+
+  if (bench->vectors != nullptr) {
+    for (usize i = 0; i < state->operations; i++) {
+      vector_destruct(bench->vectors[i]);
+    }
+  }
+  vector_destruct(bench->vector);
+  free(bench->vectors);
+  free(bench->dest);
+  free(bench);
+}
+
+static bool prepare_filled(BenchState* state) {
+  return vector_bench_prepare(state, true, false);
+}
+
+static bool prepare_empty(BenchState* state) {
+  return vector_bench_prepare(state, false, false);
+}
+
+static bool prepare_many(BenchState* state) {
+  return vector_bench_prepare(state, false, true);
+}
+
+static bool prepare_filled_many(BenchState* state) {
+  return vector_bench_prepare(state, true, true);
+}
+
+// For O(n) operations on the front of the Vector
+static bool prepare_linear(BenchState* state) {
+  if (!vector_bench_prepare(state, true, false)) {
+    return false;
+  }
+  const usize bytes = state->count * state->object_size;
+  state->operations = bench_linear_operations(state, bytes);
+  state->bytes = state->operations * bytes;
+  return true;
+}
+
+// For O(n) operations in the middle of the Vector
+static bool prepare_linear_middle(BenchState* state) {
+  if (!vector_bench_prepare(state, true, false)) {
+    return false;
+  }
+  const usize bytes = state->count / 2 * state->object_size;
+  state->operations = bench_linear_operations(state, bytes);
+  state->bytes = state->operations * bytes;
+  return true;
+}
+
+// For the searches of an object the Vector does not hold, in dest
+static bool prepare_find(BenchState* state) {
+  if (!prepare_linear(state)) {
+    return false;
+  }
+  VectorBench* bench = state->context;
+  memcpy(bench->dest, state->object, state->object_size);
+  bench->dest[state->object_size - 1] ^= 0xff;
+  return true;
+}
+
+// Destroys the Vectors made by the repetition
+static void teardown_many(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_destruct(bench->vectors[i]);
+    bench->vectors[i] = nullptr;
+  }
+}
+
+// Makes the Vectors consumed by the repetition
+static bool setup_many(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vectors[i] = vector_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+    if (bench->vectors[i] == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool setup_many_filled(BenchState* state) {
+  VectorBench* bench = state->context;
+  if (!setup_many(state)) {
+    return false;
+  }
+  for (usize i = 0; i < state->operations; i++) {
+    if (!bench_fill(bench->vectors[i], state->count, state->object)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Removes the objects added by the repetition
+static void teardown_shrink(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_discard_back(bench->vector);
+  }
+}
+
+// Adds back the objects removed by the repetition
+static void teardown_refill(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_push_back(bench->vector, state->object);
+  }
+}
+
+static void teardown_refill_all(BenchState* state) {
+  VectorBench* bench = state->context;
+  vector_reset(bench->vector);
+  bench_fill(bench->vector, state->count, state->object);
+}
+
+static void run_construct(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vectors[i] = vector_construct(
+      state->object_size,
+      (VectorOptions){ .capacity = state->count }
+    );
+  }
+}
+
+static void run_destruct(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_destruct(bench->vectors[i]);
+    bench->vectors[i] = nullptr;
+  }
+}
+
+// The cache of the thread is enabled for the churn case only
+static bool prepare_churn(BenchState* state) {
+  vector_cache_configure((VectorCacheOptions){ .buffers = 16 });
+  return vector_bench_prepare(state, false, true);
+}
+
+// The Vectors take their memory from malloc every time
+static bool prepare_churn_uncached(BenchState* state) {
+  vector_cache_configure((VectorCacheOptions){});
+  return vector_bench_prepare(state, false, true);
+}
+
+static void cleanup_churn(BenchState* state) {
+  vector_bench_cleanup(state);
+  vector_cache_configure((VectorCacheOptions){});
+}
+
+// Constructs, fills and destructs a Vector per operation, as a request
+// handler would
+static void run_churn(BenchState* state) {
+  for (usize i = 0; i < state->operations; i++) {
+    Vector* vector = vector_construct(state->object_size, (VectorOptions){});
+    bench_fill(vector, state->count, state->object);
+    vector_destruct(vector);
+  }
+}
+
+// The Vectors start with the capacity learned for their call site
+static void run_churn_site(BenchState* state) {
+  for (usize i = 0; i < state->operations; i++) {
+    Vector* vector = vector_construct(
+      state->object_size,
+      (VectorOptions){ .site = "bench_churn" }
+    );
+    bench_fill(vector, state->count, state->object);
+    vector_destruct(vector);
+  }
+}
+
+static void run_get(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += *(u8*)vector_get(bench->vector, i);
+  }
+}
+
+static void run_empty(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += vector_empty(bench->vector);
+  }
+}
+
+static u64 walked;
+
+static void walk_callback(void* object) {
+  walked += *(u8*)object;
+}
+
+static void run_walk(BenchState* state) {
+  VectorBench* bench = state->context;
+  vector_walk(bench->vector, walk_callback);
+  state->sink += walked;
+}
+
+// A reset is a single operation whatever the count
+static bool prepare_reset(BenchState* state) {
+  state->operations = 1;
+  return vector_bench_prepare(state, true, false);
+}
+
+static void run_reset(BenchState* state) {
+  VectorBench* bench = state->context;
+  vector_reset(bench->vector);
+}
+
+static void run_release(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_release(bench->vectors[i]);
+  }
+}
+
+static void run_grow(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_grow(bench->vectors[i], state->count);
+  }
+}
+
+static bool setup_push_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  bench->vector = vector_construct(state->object_size, (VectorOptions){});
+  return bench->vector != nullptr;
+}
+
+// With room for count objects, the Vector never grows
+static bool setup_push_back_reserved(BenchState* state) {
+  VectorBench* bench = state->context;
+  bench->vector = vector_construct(
+    state->object_size,
+    (VectorOptions){ .capacity = state->count }
+  );
+  return bench->vector != nullptr;
+}
+
+// The Vector grows by moving its objects a few at a time
+static bool setup_push_back_incremental(BenchState* state) {
+  VectorBench* bench = state->context;
+  bench->vector = vector_construct(
+    state->object_size,
+    (VectorOptions){ .incremental = true }
+  );
+  return bench->vector != nullptr;
+}
+
+static void teardown_push_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  vector_destruct(bench->vector);
+  bench->vector = nullptr;
+}
+
+static void run_push_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    vector_push_back(bench->vector, state->object);
+  }
+}
+
+static void step_push_back(BenchState* state, const usize) {
+  VectorBench* bench = state->context;
+  vector_push_back(bench->vector, state->object);
+}
+
+static void run_push_front(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_push_front(bench->vector, state->object);
+  }
+}
+
+static void step_push_front(BenchState* state, const usize) {
+  VectorBench* bench = state->context;
+  vector_push_front(bench->vector, state->object);
+}
+
+static void run_discard_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    vector_discard_back(bench->vector);
+  }
+}
+
+static void run_discard_front(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_discard_front(bench->vector);
+  }
+}
+
+static void run_discard(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_discard(bench->vector, (state->count - i) / 2);
+  }
+}
+
+static void run_pop_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    vector_pop_back(bench->vector, bench->dest);
+    state->sink += bench->dest[0];
+  }
+}
+
+static void run_pop_front(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_pop_front(bench->vector, bench->dest);
+    state->sink += bench->dest[0];
+  }
+}
+
+static void run_pop(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_pop(bench->vector, bench->dest, (state->count - i) / 2);
+    state->sink += bench->dest[0];
+  }
+}
+
+static void run_set(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    vector_set(bench->vector, i, state->object);
+  }
+}
+
+static void run_insert(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    vector_insert(bench->vector, (state->count + i) / 2, state->object);
+  }
+}
+
+static void step_insert(BenchState* state, const usize index) {
+  VectorBench* bench = state->context;
+  vector_insert(bench->vector, (state->count + index) / 2, state->object);
+}
+
+static void run_copy(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vectors[i] = vector_copy(bench->vector, false);
+  }
+}
+
+static void run_copy_shrink(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    bench->vectors[i] = vector_copy(bench->vector, true);
+  }
+}
+
+static void run_find(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->operations; i++) {
+    usize index = 0;
+    vector_find(bench->vector, bench->dest, &index);
+    state->sink += index;
+  }
+}
+
+static void run_get_back(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += *(u8*)vector_get_back(bench->vector);
+  }
+}
+
+static void run_get_front(BenchState* state) {
+  VectorBench* bench = state->context;
+  for (usize i = 0; i < state->count; i++) {
+    state->sink += *(u8*)vector_get_front(bench->vector);
+  }
+}
+
+static const BenchCase vector_cases[] = {
+  {
+    .group     = "vector",
+    .operation = "construct",
+    .prepare   = prepare_many,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_construct,
+  },
+  {
+    .group     = "vector",
+    .operation = "destruct",
+    .prepare   = prepare_many,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_many,
+    .run       = run_destruct,
+  },
+  {
+    .group     = "vector",
+    .operation = "churn",
+    .prepare   = prepare_churn,
+    .cleanup   = cleanup_churn,
+    .run       = run_churn,
+  },
+  {
+    .group     = "vector",
+    .operation = "churn",
+    .policy    = "uncached",
+    .prepare   = prepare_churn_uncached,
+    .cleanup   = cleanup_churn,
+    .run       = run_churn,
+  },
+  {
+    .group     = "vector",
+    .operation = "churn",
+    .policy    = "site",
+    .prepare   = prepare_churn,
+    .cleanup   = cleanup_churn,
+    .run       = run_churn_site,
+  },
+  {
+    .group     = "vector",
+    .operation = "get",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_get,
+  },
+  {
+    .group     = "vector",
+    .operation = "empty",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_empty,
+  },
+  {
+    .group     = "vector",
+    .operation = "walk",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_walk,
+  },
+  {
+    .group     = "vector",
+    .operation = "reset",
+    .prepare   = prepare_reset,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill_all,
+    .run       = run_reset,
+  },
+  {
+    .group     = "vector",
+    .operation = "release",
+    .prepare   = prepare_many,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_many,
+    .teardown  = teardown_many,
+    .run       = run_release,
+  },
+  {
+    .group     = "vector",
+    .operation = "grow",
+    .prepare   = prepare_many,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_many_filled,
+    .teardown  = teardown_many,
+    .run       = run_grow,
+  },
+  {
+    .group     = "vector",
+    .operation = "push_back",
+    .prepare   = prepare_empty,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_push_back,
+    .teardown  = teardown_push_back,
+    .run       = run_push_back,
+    .step      = step_push_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "push_back",
+    .policy    = "reserved",
+    .prepare   = prepare_empty,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_push_back_reserved,
+    .teardown  = teardown_push_back,
+    .run       = run_push_back,
+    .step      = step_push_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "push_back",
+    .policy    = "incremental",
+    .prepare   = prepare_empty,
+    .cleanup   = vector_bench_cleanup,
+    .setup     = setup_push_back_incremental,
+    .teardown  = teardown_push_back,
+    .run       = run_push_back,
+    .step      = step_push_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "push_front",
+    .prepare   = prepare_linear,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_shrink,
+    .run       = run_push_front,
+    .step      = step_push_front,
+  },
+  {
+    .group     = "vector",
+    .operation = "discard_back",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill_all,
+    .run       = run_discard_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "discard_front",
+    .prepare   = prepare_linear,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_discard_front,
+  },
+  {
+    .group     = "vector",
+    .operation = "discard",
+    .prepare   = prepare_linear_middle,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_discard,
+  },
+  {
+    .group     = "vector",
+    .operation = "pop_back",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill_all,
+    .run       = run_pop_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "pop_front",
+    .prepare   = prepare_linear,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_pop_front,
+  },
+  {
+    .group     = "vector",
+    .operation = "pop",
+    .prepare   = prepare_linear_middle,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_refill,
+    .run       = run_pop,
+  },
+  {
+    .group     = "vector",
+    .operation = "set",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_set,
+  },
+  {
+    .group     = "vector",
+    .operation = "insert",
+    .prepare   = prepare_linear_middle,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_shrink,
+    .run       = run_insert,
+    .step      = step_insert,
+  },
+  {
+    .group     = "vector",
+    .operation = "copy",
+    .prepare   = prepare_filled_many,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_copy,
+  },
+  {
+    .group     = "vector",
+    .operation = "copy_shrink",
+    .prepare   = prepare_filled_many,
+    .cleanup   = vector_bench_cleanup,
+    .teardown  = teardown_many,
+    .run       = run_copy_shrink,
+  },
+  {
+    .group     = "vector",
+    .operation = "find",
+    .prepare   = prepare_find,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_find,
+  },
+  {
+    .group     = "vector",
+    .operation = "get_back",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_get_back,
+  },
+  {
+    .group     = "vector",
+    .operation = "get_front",
+    .prepare   = prepare_filled,
+    .cleanup   = vector_bench_cleanup,
+    .run       = run_get_front,
+  },
+};
+
+void bench_vector_register(void) {
+  for (usize i = 0; i < sizeof(vector_cases) / sizeof(*vector_cases); i++) {
+    bench_register(&vector_cases[i]);
+  }
+}
\ No newline at end of file
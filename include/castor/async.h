@@ -0,0 +1,129 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// AsyncIo saves and loads Vectors of plain objects in the snapshot format
+// (see snapshot.h) without blocking the calling thread.
+// The payload is split into chunks and several of them are kept in flight.
+// On Linux, the transfers go through io_uring. When io_uring is unavailable
+// (old kernels, seccomp filters), a pool of threads issues the transfers
+// with pwrite/pread instead.
+//
+// AsyncIo is meant to be driven by an event loop: async_io_fd becomes
+// readable when transfers complete, and async_io_process then submits the
+// next chunks and runs the callbacks of the finished requests.
+// An AsyncIo and its requests must be used by a single thread.
+typedef struct AsyncIo AsyncIo;
+
+// AsyncIoRequest is a save or load in progress.
+typedef struct AsyncIoRequest AsyncIoRequest;
+
+// AsyncIoOptions is used to configure an AsyncIo.
+typedef struct AsyncIoOptions AsyncIoOptions;
+
+// AsyncIoBackend selects how the transfers are issued.
+typedef enum AsyncIoBackend {
+  ASYNC_IO_AUTO,
+  ASYNC_IO_URING,
+  ASYNC_IO_THREADS,
+} AsyncIoBackend;
+
+// Called from async_io_process (or async_io_wait) when a request finishes.
+typedef void (*AsyncIoCallback)(AsyncIoRequest*, void* context);
+
+
+// Member:
+// - backend:
+//    ASYNC_IO_AUTO uses io_uring when available and threads otherwise.
+// - chunk_size:
+//    Size of each transfer in bytes, rounded up to 4 KiB. 0 for 1 MiB.
+// - queue_depth:
+//    Maximum number of transfers in flight, 0 for 8.
+// - threads:
+//    Number of threads of the fallback backend, 0 for 4.
+// - direct:
+//    If true, files are opened with O_DIRECT, bypassing the page cache. The
+//    chunks go through aligned bounce buffers, which are registered with
+//    io_uring.
+struct AsyncIoOptions {
+  AsyncIoBackend backend;
+  usize          chunk_size;
+  usize          queue_depth;
+  usize          threads;
+  bool           direct;
+};
+
+
+// Constructs a new AsyncIo.
+// Returns:
+// - A pointer to the newly created AsyncIo, or nullptr if the requested
+//   backend is unavailable or allocation fails.
+[[nodiscard, gnu::malloc]]
+AsyncIo* async_io_construct(const AsyncIoOptions options);
+
+// Waits for every request in flight, then releases the AsyncIo. The
+// requests themselves must still be released with async_io_release.
+void async_io_destruct(AsyncIo*);
+
+// Returns the backend in use (never ASYNC_IO_AUTO).
+AsyncIoBackend async_io_backend(const AsyncIo*);
+
+// Returns a descriptor that becomes readable when transfers complete.
+int async_io_fd(const AsyncIo*);
+
+// Submits pending chunks and completes the finished requests.
+// Returns:
+// - The number of requests that finished.
+usize async_io_process(AsyncIo*);
+
+// Starts saving the objects of the Vector to the file at the given path.
+// The Vector must not be modified until the request finishes. As with
+// snapshot_save, the file is written to path.tmp, synced and renamed over
+// the target, so an interrupted save leaves the previous snapshot in place.
+// Returns:
+// - The request, or nullptr if the Vector has an interface or the file can
+//   not be opened.
+[[nodiscard]]
+AsyncIoRequest* async_io_save(
+  AsyncIo*        io,
+  const Vector*   vector,
+  const char*     path,
+  AsyncIoCallback callback,
+  void*           context
+);
+
+// Starts loading the snapshot at the given path into a new Vector. The load
+// fails if the header does not describe a payload that fits in the file.
+// Parameters:
+// - verify:
+//    If true, the payload checksum is verified once every chunk is read,
+//    as SnapshotOptions.verify does for snapshot_load.
+// Returns:
+// - The request, or nullptr if the file can not be opened.
+[[nodiscard]]
+AsyncIoRequest* async_io_load(
+  AsyncIo*        io,
+  const char*     path,
+  const bool      verify,
+  AsyncIoCallback callback,
+  void*           context
+);
+
+// Processes completions until the request finishes.
+// Returns the result of the request.
+bool async_io_wait(AsyncIo*, AsyncIoRequest*);
+
+// Returns whether the request finished.
+bool async_io_done(const AsyncIoRequest*);
+
+// Returns whether the request finished successfully.
+bool async_io_ok(const AsyncIoRequest*);
+
+// Returns the Vector loaded by a successful load request, and transfers its
+// ownership to the caller. Returns nullptr otherwise.
+[[nodiscard]]
+Vector* async_io_take(AsyncIoRequest*);
+
+// Releases a finished request.
+void async_io_release(AsyncIoRequest*);
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// Bulk copies move the content of whole Vectors: vector_copy, stack_copy
+// and vector_append. A large copy is split across worker threads, each
+// copying a contiguous part, and above a size the stores are non-temporal:
+// they stream to memory rather than through the cache, so that a copy of
+// gigabytes does not evict the working set of the other threads. Smaller
+// copies are a plain memcpy. The filters and the scatter below, and the
+// numeric functions (see numeric.h), split their large calls across the
+// same threads.
+//
+// The options are shared by every thread of the process.
+typedef struct VectorBulkOptions VectorBulkOptions;
+
+
+// Member:
+// - threads:
+//    Most threads a copy is split across, the calling one included, up to
+//    64. Defaults to the number of CPUs online, up to 8.
+// - parallel:
+//    Size in bytes from which a copy or a numeric call is split. Each
+//    thread takes at least half of it. Defaults to 64 MiB.
+// - streaming:
+//    Size in bytes from which the stores are non-temporal. Defaults to the
+//    size of the last level cache, or 32 MiB if it is unknown.
+struct VectorBulkOptions {
+  usize threads;
+  usize parallel;
+  usize streaming;
+};
+
+
+// Sets the options of the bulk copies. A member set to 0 keeps its default.
+void vector_bulk_configure(const VectorBulkOptions options);
+
+// Reads the options of the bulk copies.
+void vector_bulk_options(VectorBulkOptions*);
+
+// Returns a new Vector of the objects for which keep returns true, in
+// their order, or nullptr on failure. keep is called once per object, from
+// several threads at once when the Vector is large. The objects are copied
+// as memory, and the new Vector has no interface.
+[[nodiscard, gnu::malloc]]
+Vector* vector_filter(const Vector*, bool (*keep)(const void*));
+
+// Returns a new Vector of the objects whose flag is not 0, as vector_filter.
+// mask is a Vector of 1-byte flags of the same count. A large Vector is
+// filtered in two passes split across threads: each part counts the
+// objects it keeps, then copies them from the sum of the counts before.
+[[nodiscard, gnu::malloc]]
+Vector* vector_filter_mask(const Vector*, const Vector* mask);
+
+// Copies each object of the Vector to dest at the index given by the u64
+// of the same index of indexes, e.g. offsets made by vector_scan. Fails
+// without writing if an index is out of dest, or if dest is the Vector.
+// When indexes repeat, which of their objects is written is unspecified.
+bool vector_scatter(Vector* dest, const Vector*, const Vector* indexes);
@@ -0,0 +1,86 @@
+#pragma once
+#include "types.h"
+
+
+// The Vector cache keeps, for each thread, the content buffers and the
+// Vector headers that are freed, to hand them to the next Vectors
+// constructed by the same thread instead of calling malloc. It pays off for
+// code that constructs and destructs many Vectors of similar capacities,
+// such as a request handler. The cache is disabled until
+// vector_cache_configure enables it for the thread, as it changes the
+// capacities Vectors get.
+//
+// The buffers are sorted by size in power-of-two buckets. While a content
+// size is cached, a Vector allocates its content rounded up to the power of
+// two and uses the whole of it as capacity, so that a buffer it frees fits
+// the next Vector asking for the same size. vector_release gives the
+// content to the cache, and the first allocation of a content takes a
+// buffer back from its bucket or a slightly larger one, so that a Vector
+// often starts with the capacity a previous one grew to. Growing a content
+// uses realloc, which often extends it in place.
+//
+// The retention is bounded by the options of the thread, and a thread frees
+// its cache when it exits. A buffer freed by another thread than the one
+// that allocated it goes to the cache of the thread freeing it. Vectors
+// with a storage of their own (persistent, snapshot or pool Vectors) do not
+// use the cache.
+typedef struct VectorCacheOptions VectorCacheOptions;
+
+// VectorCacheStats holds the counters of the cache of a thread.
+typedef struct VectorCacheStats VectorCacheStats;
+
+
+// Member:
+// - buffers:
+//    Most buffers kept in each bucket, and most headers kept. 0 disables
+//    the cache, as it is by default; 16 suits most uses.
+// - largest:
+//    Largest content size kept, in bytes. Larger contents are allocated as
+//    usual. 0 for 64 KiB.
+// - bytes:
+//    Most bytes kept by the cache of the thread, 0 for 1 MiB.
+struct VectorCacheOptions {
+  usize buffers;
+  usize largest;
+  usize bytes;
+};
+
+// Member:
+// - requests:
+//    Content allocations of a cached size.
+// - hits:
+//    Those served from the cache.
+// - header_requests, header_hits:
+//    The same for the Vector headers.
+// - hit_rate:
+//    Share of the requests of both kinds that were hits, 0 without any.
+// - returns:
+//    Buffers and headers given to the cache.
+// - drops:
+//    Those freed instead because the cache was full.
+// - buffers:
+//    Buffers and headers kept now.
+// - bytes:
+//    Bytes kept now, counting each buffer at the size of its bucket.
+struct VectorCacheStats {
+  u64   requests;
+  u64   hits;
+  u64   header_requests;
+  u64   header_hits;
+  f64   hit_rate;
+  u64   returns;
+  u64   drops;
+  usize buffers;
+  usize bytes;
+};
+
+
+// Sets the options of the cache of the calling thread, freeing the buffers
+// it kept so far. Options with buffers set to 0 disable the cache.
+void vector_cache_configure(const VectorCacheOptions options);
+
+// Frees the buffers kept by the cache of the calling thread.
+void vector_cache_trim(void);
+
+// Reads the counters of the cache of the calling thread.
+void vector_cache_stats(VectorCacheStats*);
@@ -0,0 +1,88 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// Checkpoint writes incremental checkpoints of a Vector of plain objects
+// (the Vector must not have an interface) into a directory.
+// While a Checkpoint exists, the Vector tracks which chunks of its content
+// are modified by vector_set, vector_push_back, vector_push_front,
+// vector_insert and the discard/pop functions. Each checkpoint only writes
+// the dirty chunks to a new delta file, and the first one writes everything.
+// Objects modified through the pointers returned by vector_get are not
+// tracked; use vector_set instead.
+//
+// Files in the directory:
+// - manifest:
+//    The list of delta files to apply, in order, to rebuild the full image.
+//    It is replaced atomically after each delta is written.
+// - delta.<sequence>:
+//    The object count at the time of the checkpoint followed by the dirty
+//    byte ranges and their content. A new delta is always numbered after
+//    those the manifest lists, so a crash before the manifest is replaced
+//    leaves the previous checkpoints intact.
+typedef struct Checkpoint Checkpoint;
+
+// CheckpointOptions is used to configure the dirty tracking granularity.
+typedef struct CheckpointOptions CheckpointOptions;
+
+// CheckpointStats describes a written checkpoint.
+typedef struct CheckpointStats CheckpointStats;
+
+
+// Member:
+// - chunk_size:
+//    Size of a dirty tracking chunk in bytes, 0 for 4 KiB.
+struct CheckpointOptions {
+  usize chunk_size;
+};
+
+// Member:
+// - sequence:
+//    Sequence number of the delta file. The first Checkpoint in a directory
+//    starts at 0, the next ones after the deltas of the manifest.
+// - count:
+//    Number of objects in the Vector at the time of the checkpoint.
+// - ranges:
+//    Number of contiguous dirty byte ranges written.
+// - bytes_written:
+//    Total number of bytes written, including the delta and manifest
+//    headers.
+struct CheckpointStats {
+  u64 sequence;
+  u64 count;
+  u64 ranges;
+  u64 bytes_written;
+};
+
+
+// Starts tracking the modifications of the Vector for checkpoints in the
+// given directory, which must exist. Existing checkpoints in the directory
+// are replaced by the next checkpoint_write, which removes their deltas.
+// Returns:
+// - A pointer to the newly created Checkpoint, or nullptr if the Vector has
+//   an interface, is already tracked, or allocation fails.
+[[nodiscard, gnu::malloc]]
+Checkpoint* checkpoint_construct(
+  Vector*                 vector,
+  const char*             directory,
+  const CheckpointOptions options
+);
+
+// Stops tracking the modifications of the Vector and releases the
+// Checkpoint. The Vector must still be alive.
+void checkpoint_destruct(Checkpoint*);
+
+// Writes the chunks modified since the previous checkpoint to a new delta
+// file, then records it in the manifest.
+// Parameters:
+// - stats:
+//    Optional, receives the description of the checkpoint.
+bool checkpoint_write(Checkpoint*, CheckpointStats* stats);
+
+// Rebuilds the Vector from the manifest and delta files in the directory.
+// Returns:
+// - A pointer to the newly created Vector, or nullptr if the checkpoints can
+//   not be read.
+[[nodiscard, gnu::malloc]]
+Vector* checkpoint_restore(const char* directory);
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// DictVector is a dictionary-encoded column for data with few distinct
+// values, such as strings or wide keys repeated over many rows.
+// Each distinct value is stored once in a dictionary and gets a code, and
+// the rows only hold codes. The codes are as narrow as the dictionary
+// allows: u8 up to 256 values, then u16 up to 65536 values, then u32. The
+// rows are re-encoded at the wider width when the dictionary overflows.
+//
+// Values are byte strings of any length, compared byte for byte.
+// Predicates are evaluated on the codes, 16 rows at a time with SSE2, and
+// produce a bitmap of the matching rows.
+typedef struct DictVector DictVector;
+
+// DictVectorOptions is used to configure a DictVector.
+typedef struct DictVectorOptions DictVectorOptions;
+
+// DictKey is a value passed to dict_vector_in.
+typedef struct DictKey DictKey;
+
+
+// Returned by dict_vector_code for an index out of range. No value is
+// given this code.
+#define DICT_VECTOR_NO_CODE UINT32_MAX
+
+
+// Member:
+// - capacity:
+//    Initial number of rows.
+// - cardinality:
+//    Initial number of distinct values.
+struct DictVectorOptions {
+  usize capacity;
+  usize cardinality;
+};
+
+// Member:
+// - data:
+//    The bytes of the value.
+// - length:
+//    Length of the value in bytes.
+struct DictKey {
+  const void* data;
+  usize       length;
+};
+
+
+// Constructs an empty DictVector.
+// Returns:
+// - A pointer to the newly created DictVector, or nullptr if allocation
+//   fails.
+[[nodiscard, gnu::malloc]]
+DictVector* dict_vector_construct(const DictVectorOptions options);
+
+// Destroys the DictVector and frees its memory.
+void dict_vector_destruct(DictVector*);
+
+// Appends a row holding the given value.
+// Returns false if allocation fails.
+bool dict_vector_push_back(DictVector*, const void* value, const usize length);
+
+// Replaces the value of the row at the specified index. The previous value
+// stays in the dictionary.
+// Returns false if the index is out of range or allocation fails.
+bool dict_vector_set(
+  DictVector* vector,
+  const usize index,
+  const void* value,
+  const usize length
+);
+
+// Returns the number of rows.
+usize dict_vector_count(const DictVector*);
+
+// Returns the number of distinct values in the dictionary.
+usize dict_vector_cardinality(const DictVector*);
+
+// Returns the size of a code in bytes: 1, 2 or 4.
+usize dict_vector_code_size(const DictVector*);
+
+// Returns the value of the row at the specified index, and its length in
+// `length`. The pointer is valid until the next value is added.
+// Returns nullptr if the index is out of range.
+const void* dict_vector_get(const DictVector*, const usize, usize* length);
+
+// Returns the code of the row at the specified index, or
+// DICT_VECTOR_NO_CODE if the index is out of range.
+u32 dict_vector_code(const DictVector*, const usize);
+
+// Returns the value of the given code, and its length in `length`.
+// Returns nullptr if the code is not in the dictionary.
+const void* dict_vector_value(const DictVector*, const u32, usize* length);
+
+// Looks up the code of a value.
+// Returns false if the value is not in the dictionary.
+bool dict_vector_find(
+  const DictVector* vector,
+  const void*       value,
+  const usize       length,
+  u32*              code
+);
+
+// Evaluates `row == value` on every row.
+// Parameters:
+// - bitmap:
+//    Vector of u64 that receives one bit per row, bit i % 64 of word i / 64
+//    being set when row i matches. Its previous objects are replaced.
+// Returns:
+// - The number of matching rows, or (usize)-1 if allocation fails.
+usize dict_vector_equals(
+  const DictVector* vector,
+  const void*       value,
+  const usize       length,
+  Vector*           bitmap
+);
+
+// Evaluates `row IN (values...)` on every row, with a bitmap as for
+// dict_vector_equals.
+usize dict_vector_in(
+  const DictVector* vector,
+  const DictKey*    values,
+  const usize       count,
+  Vector*           bitmap
+);
\ No newline at end of file
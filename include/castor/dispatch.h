@@ -0,0 +1,32 @@
+#pragma once
+#include "types.h"
+
+
+// Castor is compiled for the baseline instruction set, and picks at load
+// time the implementation of each of its kernels for the CPU it runs on:
+// the features are read once with cpuid, and the level chosen sets the
+// function pointers every Vector calls through. A level can be forced with
+// the CASTOR_ISA environment variable, e.g. CASTOR_ISA=sse4.2, to test the
+// other implementations on a recent host; it is lowered to the level the
+// CPU supports if it asks for more.
+//
+// Only x86-64 has levels above CASTOR_ISA_SCALAR.
+typedef enum CastorIsa {
+  CASTOR_ISA_SCALAR,
+  CASTOR_ISA_SSE42,
+  CASTOR_ISA_AVX2,
+  // AVX-512 F and BW
+  CASTOR_ISA_AVX512,
+  CASTOR_ISAS,
+} CastorIsa;
+
+
+// Returns the highest level the CPU supports.
+CastorIsa castor_isa_detected(void);
+
+// Returns the level the kernels use.
+CastorIsa castor_isa(void);
+
+// Returns the name of the level, as accepted by CASTOR_ISA: "scalar",
+// "sse4.2", "avx2" or "avx512".
+const char* castor_isa_name(const CastorIsa);
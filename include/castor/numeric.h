@@ -0,0 +1,124 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// The numeric functions compute over the content of a Vector of numbers,
+// in place of a vector_walk callback: the loops run over the objects in
+// memory, several lanes at a time, with the kernels of the instruction set
+// level chosen at load time (see dispatch.h).
+//
+// The type of the objects is given at each call, and a call fails if the
+// object size of the Vector is not that of the type. Sums, dot products
+// and the elementwise functions compute in the type of the objects, and
+// wrap around for the integer types. Means and variances are computed in
+// f64 whatever the type.
+//
+// A call over at least the parallel threshold of the bulk options (see
+// bulk.h) is split across their threads. The floating point results then
+// depend on the number of threads, as the objects are summed in another
+// order, but not on their scheduling.
+typedef enum VectorNumber {
+  VECTOR_NUMBER_F32,
+  VECTOR_NUMBER_F64,
+  VECTOR_NUMBER_I32,
+  VECTOR_NUMBER_I64,
+  VECTOR_NUMBERS,
+} VectorNumber;
+
+// VectorSummation selects how vector_sum adds floating point objects. The
+// integer types are always summed exactly, modulo their width.
+// - VECTOR_SUMMATION_PLAIN:
+//    In independent lanes. The error grows linearly with the count.
+// - VECTOR_SUMMATION_PAIRWISE:
+//    By blocks, summed pairwise. The error grows with the logarithm of the
+//    count, at about the speed of the plain sum.
+// - VECTOR_SUMMATION_KAHAN:
+//    With a compensation of the rounding error, which does not grow with
+//    the count. Up to 4 times slower than the plain sum on data in cache,
+//    about as fast on data in memory.
+typedef enum VectorSummation {
+  VECTOR_SUMMATION_PLAIN,
+  VECTOR_SUMMATION_PAIRWISE,
+  VECTOR_SUMMATION_KAHAN,
+} VectorSummation;
+
+
+// Returns the size in bytes of the type, 0 if it is unknown.
+usize vector_number_size(const VectorNumber);
+
+// Sums the objects into sum, an object of the type. The sum of an empty
+// Vector is 0.
+bool vector_sum(
+  const Vector*,
+  const VectorNumber,
+  const VectorSummation,
+  void* sum
+);
+
+// Stores the smallest object in min, and its index in index if it is not
+// nullptr. The first of equal objects is taken. Fails if the Vector is
+// empty. NaNs are skipped, and the first object is taken if they all are.
+bool vector_min(const Vector*, const VectorNumber, void* min, usize* index);
+
+// Stores the largest object in max, as vector_min.
+bool vector_max(const Vector*, const VectorNumber, void* max, usize* index);
+
+// Stores the mean of the objects. Fails if the Vector is empty.
+bool vector_mean(const Vector*, const VectorNumber, f64* mean);
+
+// Stores the population variance of the objects, divided by their count,
+// and their mean if mean is not nullptr. The deviations from the mean are
+// summed in a second pass, which does not lose the precision of a single
+// pass of sums of squares. Fails if the Vector is empty.
+bool vector_variance(
+  const Vector*,
+  const VectorNumber,
+  f64* mean,
+  f64* variance
+);
+
+// Stores the dot product of two Vectors of the same count in dot, an
+// object of the type.
+bool vector_dot(const Vector*, const Vector*, const VectorNumber, void* dot);
+
+// Adds a times each object of x to the object of y at the same index:
+// y = a * x + y. a is converted to the type. The Vectors must have the same
+// count.
+bool vector_axpy(Vector* y, const Vector* x, const VectorNumber, const f64 a);
+
+// Multiplies each object by a, converted to the type.
+bool vector_scale(Vector*, const VectorNumber, const f64 a);
+
+// Adds each object of x to the object of y at the same index: y = x + y.
+// The Vectors must have the same count.
+bool vector_add(Vector* y, const Vector* x, const VectorNumber);
+
+// Stores in dest the exclusive prefix sums of the objects: the object i
+// of dest is the sum of the objects before i, and dest takes the count of
+// the Vector, which may be dest itself. Stores the sum of every object in
+// total if it is not nullptr, e.g. the size of the output of a scatter
+// whose offsets are the sums.
+// The sums are made several objects at a time in vector registers, and a
+// large Vector is split across threads, which sum their parts before
+// scanning them from the sum of the parts before. The floating point sums
+// may then differ from those of a loop in the last bits.
+bool vector_scan(
+  Vector*            dest,
+  const Vector*,
+  const VectorNumber,
+  void*              total
+);
+
+// Counts the objects in bin_count bins of equal width between low and
+// high, overwriting bins. The objects below low are counted in the first
+// bin and those from high on in the last one; NaNs are not counted. Fails
+// if there is no bin or high is not above low.
+bool vector_histogram(
+  const Vector*,
+  const VectorNumber,
+  const f64   low,
+  const f64   high,
+  usize*      bins,
+  const usize bin_count
+);
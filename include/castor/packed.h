@@ -0,0 +1,92 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// PackedSequence is an append-only sequence of non-decreasing u64, such as a
+// sorted list of IDs, stored compressed.
+// The values are grouped in blocks of PACKED_BLOCK_SIZE. Each block stores
+// the differences between consecutive values bit-packed at the width that
+// fits most of them (frame of reference), and the few larger differences as
+// exceptions patched in after unpacking (patched frame of reference).
+// A skip index holding the first value and the offset of each block gives
+// random access and lower_bound without decoding the blocks in between.
+// Blocks are unpacked with SSE2 on x86-64 and with portable code elsewhere.
+//
+// The last, incomplete block is kept uncompressed until it fills up.
+typedef struct PackedSequence PackedSequence;
+
+// PackedSequenceStats describes the compression of a PackedSequence.
+typedef struct PackedSequenceStats PackedSequenceStats;
+
+// Number of values per block
+#define PACKED_BLOCK_SIZE 128
+
+
+// Member:
+// - count:
+//    Number of values.
+// - blocks:
+//    Number of compressed blocks.
+// - exceptions:
+//    Number of differences stored as exceptions.
+// - bytes:
+//    Memory used by the values, the skip index and the incomplete block.
+// - bits_per_integer:
+//    bytes * 8 / count.
+// - decoded_bytes:
+//    Number of bytes of u64 produced by packed_sequence_decode.
+// - decode_seconds:
+//    Time spent in packed_sequence_decode, decoded_bytes / decode_seconds
+//    is the decoding throughput.
+struct PackedSequenceStats {
+  usize count;
+  usize blocks;
+  usize exceptions;
+  usize bytes;
+  f64   bits_per_integer;
+  u64   decoded_bytes;
+  f64   decode_seconds;
+};
+
+
+// Constructs an empty PackedSequence.
+// Returns:
+// - A pointer to the newly created PackedSequence, or nullptr if allocation
+//   fails.
+[[nodiscard, gnu::malloc]]
+PackedSequence* packed_sequence_construct(void);
+
+// Destroys the PackedSequence and frees its memory.
+void packed_sequence_destruct(PackedSequence*);
+
+// Appends a value.
+// Returns false if the value is lower than the last one or allocation fails.
+bool packed_sequence_push_back(PackedSequence*, const u64 value);
+
+// Returns the number of values.
+usize packed_sequence_count(const PackedSequence*);
+
+// Copies the value at the specified index into dest.
+// The last decoded block is cached, so sequential accesses decode each
+// block once.
+// Returns false if the index is out of range.
+bool packed_sequence_get(PackedSequence*, const usize, u64* dest);
+
+// Returns the index of the first value that is not lower than the given
+// value, or the count if there is none.
+usize packed_sequence_lower_bound(PackedSequence*, const u64 value);
+
+// Decodes the values in [first, first + count) and appends them to dest, a
+// Vector of u64, one block at a time.
+// Returns false if the range is out of bounds, dest does not hold u64 or
+// allocation fails.
+bool packed_sequence_decode(
+  PackedSequence* sequence,
+  const usize     first,
+  const usize     count,
+  Vector*         dest
+);
+
+// Fills stats with the current figures of the PackedSequence.
+void packed_sequence_stats(const PackedSequence*, PackedSequenceStats*);
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include "types.h"
+
+
+// PagedVector is an out-of-core vector. Its objects are stored in fixed-size
+// pages in a local file, and only a bounded number of pages are kept in
+// memory at once. Pages are evicted with the CLOCK algorithm, and dirty
+// pages are written back to the file on eviction and on flush.
+// Objects never span two pages, so a page holds page_size / object_size
+// objects.
+// Sequential scans are detected and the following pages are prefetched
+// asynchronously by the kernel.
+typedef struct PagedVector PagedVector;
+
+// PagedVectorOptions is used to configure a PagedVector.
+typedef struct PagedVectorOptions PagedVectorOptions;
+
+// PagedVectorStats holds the counters of the page cache.
+typedef struct PagedVectorStats PagedVectorStats;
+
+
+// Member:
+// - page_size:
+//    Size of a page in bytes, 0 for 64 KiB. Must be able to hold at least one
+//    object.
+// - cache_pages:
+//    Number of pages kept in memory, 0 for 256.
+// - prefetch_pages:
+//    Number of pages read ahead on sequential scans, 0 to disable.
+struct PagedVectorOptions {
+  usize page_size;
+  usize cache_pages;
+  usize prefetch_pages;
+};
+
+// Member:
+// - hits:
+//    Number of page accesses served from memory.
+// - misses:
+//    Number of page accesses that read the file.
+// - evictions:
+//    Number of pages evicted from memory.
+// - writebacks:
+//    Number of dirty pages written to the file.
+// - prefetches:
+//    Number of pages prefetched on sequential scans.
+struct PagedVectorStats {
+  u64 hits;
+  u64 misses;
+  u64 evictions;
+  u64 writebacks;
+  u64 prefetches;
+};
+
+
+// Opens the PagedVector stored in the file at the given path, creating it
+// if it does not exist. An empty file is initialized, and the objects of
+// any other file are kept.
+// Returns:
+// - A pointer to the newly created PagedVector, or nullptr if the file can
+//   not be opened, its header can not be read or does not match the object
+//   and page sizes, or allocation fails.
+[[nodiscard, gnu::malloc]]
+PagedVector* paged_vector_construct(
+  const char*              path,
+  const usize              object_size,
+  const PagedVectorOptions options
+);
+
+// Writes back the dirty pages and releases the PagedVector.
+void paged_vector_destruct(PagedVector*);
+
+// Returns the number of objects in the PagedVector.
+usize paged_vector_count(const PagedVector*);
+
+// Returns the object at the specified index.
+// The pointer is only valid until the next call on the PagedVector, as its
+// page may be evicted. Use paged_vector_pin for longer accesses.
+// Returns nullptr if the index is out of range or every page is pinned.
+void* paged_vector_get(PagedVector*, const usize);
+
+// Sets the value of the object at the specified index.
+bool paged_vector_set(PagedVector*, const usize, void*);
+
+// Appends an object to the end of the PagedVector.
+bool paged_vector_push_back(PagedVector*, void*);
+
+// Pins the page holding the object at the specified index in memory.
+// Parameters:
+// - count:
+//    Receives the number of objects that can be accessed from the returned
+//    pointer (up to the end of the page or of the PagedVector).
+// Returns:
+// - A pointer to the object, or nullptr if the index is out of range or
+//   every page is pinned.
+// Details:
+// - Every successful pin must be matched by a call to paged_vector_unpin.
+void* paged_vector_pin(PagedVector*, const usize, usize* count);
+
+// Unpins the page holding the object at the specified index.
+// Parameters:
+// - dirty:
+//    If true, the objects of the page were modified and must be written back.
+void paged_vector_unpin(PagedVector*, const usize, const bool dirty);
+
+// Writes back every dirty page and the object count to the file.
+bool paged_vector_flush(PagedVector*);
+
+// Returns the counters of the page cache.
+PagedVectorStats paged_vector_stats(const PagedVector*);
\ No newline at end of file
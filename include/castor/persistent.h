@@ -0,0 +1,79 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// A persistent Vector keeps its content in a shared mapping of a file, so
+// the objects survive process restarts without an explicit save step.
+// It is a regular Vector: every vector_* function works on it at the usual
+// speed, and vector_destruct closes the file without discarding its objects.
+// Only plain objects are supported (the Vector must not have an interface).
+//
+// File layout:
+//   [PersistentHeader][padding up to payload_offset][capacity * object_size]
+// The count stored in the header is only updated by persistent_sync and
+// vector_destruct/vector_release. After a crash, the file reopens with the
+// count of the last durability point.
+//
+// Only a Vector used purely append-only (push_back, append and grow, with
+// no removal at all) then reopens as a consistent prefix. The mapping is
+// shared, so the kernel may write modified pages to the file at any time,
+// and any write to an object below the synced count may reach the file
+// before the header: the objects changed in place by vector_set, shifted
+// by push_front, insert, discard and pop, and the objects pushed after a
+// pop_back or discard_back, which overwrite synced ones. After a crash,
+// the file then reopens with the synced count over the newer objects.
+typedef struct PersistentHeader PersistentHeader;
+
+
+#define PERSISTENT_MAGIC   "CASTORPV"
+#define PERSISTENT_VERSION 1
+
+
+// Member:
+// - magic:
+//    PERSISTENT_MAGIC without the terminating null byte.
+// - version:
+//    Format version, PERSISTENT_VERSION when written by this library.
+// - header_size:
+//    sizeof(PersistentHeader) when the file was created.
+// - object_size:
+//    Size of each object in bytes.
+// - count:
+//    Number of objects as of the last durability point.
+// - capacity:
+//    Number of objects the file has room for.
+// - payload_offset:
+//    Offset of the first object from the start of the file.
+struct PersistentHeader {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 object_size;
+  u64 count;
+  u64 capacity;
+  u64 payload_offset;
+};
+
+
+// Opens the persistent Vector stored in the file at the given path, creating
+// the file if it does not exist.
+// Parameters:
+// - object_size:
+//    Size of each object in bytes. Must match the file if it exists.
+// - options:
+//    The capacity is used for new files only. The interface must be nullptr.
+// Returns:
+// - A pointer to the Vector, or nullptr if the file can not be opened or
+//   does not match.
+[[nodiscard, gnu::malloc]]
+Vector* persistent_open(
+  const char*         path,
+  const usize         object_size,
+  const VectorOptions options
+);
+
+// Durability point: flushes the objects to the file, then records the count
+// in the header. Only the appends are staged until then (see above).
+// Returns false if the Vector is not persistent or if flushing fails.
+bool persistent_sync(Vector*);
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+#include "stack.h"
+
+
+// Pool is a fixed block of memory reserved once, from which Vectors and
+// Stacks take their content and themselves, so that a latency-critical path
+// never calls the system allocator after startup. The memory can be locked
+// and its pages faulted in up front, so that no page fault happens either.
+//
+// The blocks are managed by a buddy allocator: each allocation is a power
+// of two bytes (64 at least), found and split or merged back in a bounded
+// number of steps. A Vector growing in a pool doubles as usual, and uses
+// the whole of its block before it needs a larger one. When the pool has no
+// block large enough, the operation fails and returns false, as for a
+// failed malloc; pool_headroom tells how close the pool is to that point.
+//
+// A Pool is not synchronized, as Vector is not: use one per thread, or
+// guard it with the Vectors that use it. The Vectors of a pool ignore
+// VectorOptions.incremental, and vector_copy makes heap Vectors.
+typedef struct Pool Pool;
+
+// PoolOptions is used to configure a Pool.
+typedef struct PoolOptions PoolOptions;
+
+// PoolHeadroom holds the state of the memory of a Pool.
+typedef struct PoolHeadroom PoolHeadroom;
+
+
+// Member:
+// - size:
+//    Bytes reserved for the blocks.
+// - lock:
+//    Locks the memory with mlock, so that it is never paged out. Needs the
+//    RLIMIT_MEMLOCK limit to allow it.
+// - prefault:
+//    Touches every page at construction, so that using the memory never
+//    faults. Implied by lock.
+struct PoolOptions {
+  usize size;
+  bool  lock;
+  bool  prefault;
+};
+
+// Member:
+// - size:
+//    Bytes of the pool.
+// - used:
+//    Bytes of the blocks allocated.
+// - available:
+//    Bytes free, size - used.
+// - largest:
+//    Size of the largest block that can be allocated. A Vector whose
+//    content needs more fails to grow.
+// - allocations:
+//    Number of blocks allocated.
+// - failures:
+//    Number of allocations that failed since the pool was constructed.
+struct PoolHeadroom {
+  usize size;
+  usize used;
+  usize available;
+  usize largest;
+  usize allocations;
+  u64   failures;
+};
+
+
+// Reserves the memory of a pool.
+// Returns:
+// - A pointer to the Pool, or nullptr if the memory cannot be mapped or
+//   locked.
+[[nodiscard, gnu::malloc]]
+Pool* pool_construct(const PoolOptions options);
+
+// Unmaps the pool. Every Vector and Stack constructed in it must have been
+// destructed.
+void pool_destruct(Pool*);
+
+// Constructs a Vector in the pool. It is used and destructed as any other
+// Vector, and keeps taking its content from the pool after
+// vector_release.
+// Returns:
+// - A pointer to the Vector, or nullptr if the pool has no room for it or
+//   its initial capacity.
+[[nodiscard]]
+Vector* pool_vector_construct(
+  Pool*               pool,
+  const usize         object_size,
+  const VectorOptions options
+);
+
+// Constructs a Stack in the pool, as pool_vector_construct.
+[[nodiscard]]
+Stack* pool_stack_construct(
+  Pool*               pool,
+  const usize         object_size,
+  const VectorOptions options
+);
+
+// Reads the state of the memory of the pool.
+void pool_headroom(const Pool*, PoolHeadroom*);
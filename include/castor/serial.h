@@ -0,0 +1,111 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// VectorEncoder streams objects to a file descriptor (a file, a pipe or a
+// socket) and VectorDecoder reads them back, in bounded memory: the objects
+// go through a buffer of fixed size and each object is encoded on its own,
+// so a Vector is never copied as a whole.
+//
+// The stream starts with a header holding the object size. Each object is
+// then written as a varint length followed by its payload, which is either
+// the raw bytes of the object or, when the VectorInterface has a serialize
+// function, the bytes it produced. The stream ends with a zero length and
+// the number of objects.
+typedef struct VectorEncoder VectorEncoder;
+
+// VectorDecoder reads a stream written by a VectorEncoder.
+typedef struct VectorDecoder VectorDecoder;
+
+// SerialOptions is used to configure encoders and decoders.
+typedef struct SerialOptions SerialOptions;
+
+#define SERIAL_MAGIC   "CASTORSE"
+#define SERIAL_VERSION 1
+
+
+// Member:
+// - buffer_size:
+//    Size of the I/O buffer in bytes, 0 for 64 KiB. Payloads larger than
+//    the buffer bypass it.
+struct SerialOptions {
+  usize buffer_size;
+};
+
+
+// Constructs an encoder and writes the stream header.
+// Parameters:
+// - fd:
+//    The descriptor to write to. It is not closed by the encoder.
+// - object_size:
+//    Size of each object in bytes.
+// - interface:
+//    Interface whose serialize function encodes the objects, can be nullptr
+//    to write the raw bytes.
+// Returns:
+// - A pointer to the newly created VectorEncoder, or nullptr if allocation
+//   or the header write fails.
+[[nodiscard, gnu::malloc]]
+VectorEncoder* vector_encoder_construct(
+  int                    fd,
+  const usize            object_size,
+  const VectorInterface* interface,
+  const SerialOptions    options
+);
+
+// Releases the encoder without finishing the stream.
+void vector_encoder_destruct(VectorEncoder*);
+
+// Encodes one object.
+// Returns false if the object can not be serialized or written, after which
+// the encoder only fails.
+bool vector_encoder_push(VectorEncoder*, const void* object);
+
+// Writes the end of the stream and flushes the buffer.
+bool vector_encoder_finish(VectorEncoder*);
+
+// Constructs a decoder and reads the stream header.
+// Parameters:
+// - fd:
+//    The descriptor to read from. It is not closed by the decoder.
+// - interface:
+//    Interface whose deserialize function decodes the objects, can be
+//    nullptr for raw objects.
+// Returns:
+// - A pointer to the newly created VectorDecoder, or nullptr if allocation
+//   fails or the header is invalid.
+[[nodiscard, gnu::malloc]]
+VectorDecoder* vector_decoder_construct(
+  int                    fd,
+  const VectorInterface* interface,
+  const SerialOptions    options
+);
+
+// Releases the decoder.
+void vector_decoder_destruct(VectorDecoder*);
+
+// Returns the object size written in the stream header.
+usize vector_decoder_object_size(const VectorDecoder*);
+
+// Decodes the next object into dest, which must be object_size bytes long.
+// Returns false at the end of the stream or on error, use vector_decoder_ok
+// to tell them apart.
+bool vector_decoder_next(VectorDecoder*, void* dest);
+
+// Returns true if the decoder reached a valid end of stream.
+bool vector_decoder_ok(const VectorDecoder*);
+
+// Encodes all the objects of the Vector with its interface.
+bool vector_serialize(Vector*, int fd, const SerialOptions options);
+
+// Decodes a whole stream into a new Vector using the given interface, which
+// is also set as the interface of the Vector.
+// Returns:
+// - The Vector, or nullptr if the stream is invalid or allocation fails.
+[[nodiscard]]
+Vector* vector_deserialize(
+  int                 fd,
+  VectorInterface*    interface,
+  const SerialOptions options
+);
\ No newline at end of file
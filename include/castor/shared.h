@@ -0,0 +1,98 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// SharedVector is a vector of plain objects stored in shared memory, so
+// several processes can map the same objects instead of building their own
+// copies.
+// The shared segment only stores offsets (never raw pointers), so each
+// process may map it at a different address.
+//
+// There is a single writer (the process that created the segment) and any
+// number of readers. Mutations are published with a sequence lock: the
+// writer makes the sequence odd while it modifies the segment, and readers
+// retry when the sequence was odd or changed during their read. Readers
+// never take a lock and never block the writer.
+//
+// A SharedVector handle must not be used by several threads at once.
+typedef struct SharedVector SharedVector;
+
+
+// Creates a shared segment and returns its writer handle.
+// Parameters:
+// - name:
+//    POSIX shared memory name (e.g. "/tables") to open it with
+//    shared_vector_open, or nullptr for an anonymous memfd that is shared
+//    by passing the descriptor (see shared_vector_fd).
+// - object_size:
+//    Size of each object in bytes.
+// - options:
+//    Initial capacity. The interface must be nullptr.
+// Returns:
+// - A pointer to the newly created SharedVector, or nullptr if the segment
+//   already exists or can not be created.
+[[nodiscard, gnu::malloc]]
+SharedVector* shared_vector_create(
+  const char*         name,
+  const usize         object_size,
+  const VectorOptions options
+);
+
+// Opens a reader handle on the named segment.
+[[nodiscard, gnu::malloc]]
+SharedVector* shared_vector_open(const char* name);
+
+// Opens a reader handle on the segment referred to by the descriptor, which
+// is duplicated.
+[[nodiscard, gnu::malloc]]
+SharedVector* shared_vector_adopt(int fd);
+
+// Unmaps the segment and releases the handle. The segment itself lives
+// until every handle is closed and, if named, shared_vector_unlink is called.
+void shared_vector_destruct(SharedVector*);
+
+// Removes the name of a segment created with shared_vector_create.
+bool shared_vector_unlink(const char* name);
+
+// Returns the descriptor of the segment, to share an anonymous segment with
+// another process.
+int shared_vector_fd(const SharedVector*);
+
+// Writer functions. Each mutation is published on its own unless it is made
+// between shared_vector_begin and shared_vector_end, in which case readers
+// see all of them at once when shared_vector_end returns.
+// They return false on a reader handle.
+bool shared_vector_begin(SharedVector*);
+bool shared_vector_end(SharedVector*);
+bool shared_vector_push_back(SharedVector*, void*);
+bool shared_vector_set(SharedVector*, const usize, void*);
+bool shared_vector_discard_back(SharedVector*);
+bool shared_vector_reset(SharedVector*);
+
+// Copies the object at the specified index into dest, retrying until the
+// copy is consistent.
+// Returns false if the index is out of range.
+bool shared_vector_read(SharedVector*, const usize, void* dest);
+
+// Returns the number of objects as of a consistent view.
+usize shared_vector_count(SharedVector*);
+
+// Starts an optimistic zero-copy read. Objects may be read from
+// shared_vector_data up to the count returned in `count`, then
+// shared_vector_read_retry tells whether the view was consistent.
+// Returns:
+// - The sequence to pass to shared_vector_read_retry.
+// Details:
+// - Pointers into the segment must not be dereferenced beyond count, and
+//   values read before a successful shared_vector_read_retry must not be
+//   trusted.
+u64 shared_vector_read_begin(SharedVector*, usize* count);
+
+// Returns a pointer to the first object of the segment.
+const void* shared_vector_data(const SharedVector*);
+
+// Returns true if the writer published a mutation since
+// shared_vector_read_begin returned the given sequence, in which case the
+// read must be restarted.
+bool shared_vector_read_retry(const SharedVector*, const u64 sequence);
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include "types.h"
+#include <stdio.h>
+
+
+// Call sites let Vectors learn their initial capacity. A Vector constructed
+// with VectorOptions.site set records its count when it is destructed, and
+// the Vectors constructed later with the same site and no capacity start
+// with the capacity that held 90% of the recent ones, rather than growing
+// through 16, 32, 64... on every construction.
+//
+// Each site keeps a histogram of the final counts in power-of-two buckets,
+// decayed at each record so that the estimate follows a change of workload
+// within a hundred Vectors or so. Sites are identified by their tag, compared
+// as strings, and shared by every thread. At most VECTOR_SITES sites are
+// tracked; the Vectors of the sites beyond are constructed as usual.
+//
+// The learned capacities can be exported, e.g. at shutdown, and imported
+// into a new process so that it starts with them.
+typedef struct VectorSite VectorSite;
+
+// Most call sites tracked
+#define VECTOR_SITES 256
+
+
+// Member:
+// - tag:
+//    Tag of the site.
+// - capacity:
+//    Initial capacity learned, in objects.
+// - samples:
+//    Number of Vectors recorded or imported.
+struct VectorSite {
+  const char* tag;
+  usize       capacity;
+  u64         samples;
+};
+
+
+// Reads the state of the site with the given tag. Returns false if it is not
+// tracked.
+bool vector_site_read(const char* tag, VectorSite*);
+
+// Writes one line per site to out: its capacity, samples and tag.
+// Returns false if out failed.
+bool vector_sites_export(FILE* out);
+
+// Reads the lines written by vector_sites_export, and sets the capacity of
+// each site to the one read, as if the site had recorded it. Returns false
+// if in holds a malformed line or failed.
+bool vector_sites_import(FILE* in);
@@ -0,0 +1,94 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// Snapshots persist the content of a Vector of plain objects (objects that
+// do not own memory, so the Vector must not have an interface) in a
+// versioned binary file.
+// Saving writes the whole file with a single writev, and loading maps the
+// file into memory instead of rebuilding the Vector object by object.
+//
+// File layout:
+//   [SnapshotHeader][padding up to payload_offset][count * object_size bytes]
+// The payload starts on a page boundary so the mapped content is aligned for
+// any object type.
+typedef struct SnapshotHeader SnapshotHeader;
+
+// SnapshotOptions is used to configure how a snapshot is loaded.
+typedef struct SnapshotOptions SnapshotOptions;
+
+// SnapshotMode selects how the payload of a snapshot is mapped.
+// - SNAPSHOT_READONLY:
+//    The Vector reads straight from the page cache and is read-only.
+// - SNAPSHOT_COPY_ON_WRITE:
+//    The Vector is mutable. Modified pages are privately copied and never
+//    written back to the file. The first growth moves the content to the
+//    heap.
+typedef enum SnapshotMode {
+  SNAPSHOT_READONLY,
+  SNAPSHOT_COPY_ON_WRITE,
+} SnapshotMode;
+
+
+#define SNAPSHOT_MAGIC   "CASTORSV"
+#define SNAPSHOT_VERSION 1
+
+
+// Member:
+// - magic:
+//    SNAPSHOT_MAGIC without the terminating null byte.
+// - version:
+//    Format version, SNAPSHOT_VERSION when written by this library.
+// - header_size:
+//    sizeof(SnapshotHeader) when the file was written.
+// - object_size:
+//    Size of each object in bytes.
+// - count:
+//    Number of objects in the payload.
+// - alignment:
+//    Alignment of the payload inside the file (in bytes).
+// - payload_offset:
+//    Offset of the first object from the start of the file.
+// - checksum:
+//    Checksum of the payload bytes.
+struct SnapshotHeader {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 object_size;
+  u64 count;
+  u64 alignment;
+  u64 payload_offset;
+  u64 checksum;
+};
+
+// Member:
+// - mode:
+//    How the payload is mapped.
+// - verify:
+//    If true, the payload checksum is verified before returning. This reads
+//    the whole file, so it defeats the purpose of a lazy mapping for large
+//    snapshots.
+struct SnapshotOptions {
+  SnapshotMode mode;
+  bool         verify;
+};
+
+
+// Saves the objects of the Vector to the file at the given path, replacing
+// it if it exists. The snapshot is written and synced to path.tmp, then
+// renamed over path, so a Vector loaded from the previous file keeps its
+// objects, and a crash leaves either the previous snapshot or the new one.
+// Returns false if the Vector has an interface or if writing fails.
+bool snapshot_save(const Vector*, const char* path);
+
+// Loads the snapshot at the given path without copying its payload.
+// Returns:
+// - A pointer to the newly created Vector, or nullptr if the file can not be
+//   mapped or is not a valid snapshot.
+[[nodiscard, gnu::malloc]]
+Vector* snapshot_load(const char* path, const SnapshotOptions options);
+
+// Computes the checksum stored in SnapshotHeader.checksum.
+u64 snapshot_checksum(const void* data, const usize length);
\ No newline at end of file
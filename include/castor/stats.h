@@ -0,0 +1,98 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+#include "stack.h"
+#include <stdio.h>
+
+
+// Vector statistics count what each Vector does: its operations by type,
+// the reallocations of its content, the bytes shifted or copied by its
+// operations, and its peak and unused capacity.
+// They are only collected when Castor is built with CASTOR_STATS defined
+// (the `stats` option of xmake). Otherwise the counting compiles to nothing,
+// and the functions below report nothing and return false.
+//
+// The global statistics sum those of every Vector, alive or destructed. The
+// Vectors alive are tracked, so that a running service can dump them and
+// find the ones that are misused: a Vector that reallocates on every other
+// push, shifts its whole content at each operation, or keeps a large
+// capacity it no longer uses.
+typedef struct VectorStats VectorStats;
+
+// VectorOperation identifies the counted operations.
+typedef enum VectorOperation {
+  VECTOR_OPERATION_GROW,
+  VECTOR_OPERATION_PUSH_BACK,
+  VECTOR_OPERATION_PUSH_FRONT,
+  VECTOR_OPERATION_DISCARD_BACK,
+  VECTOR_OPERATION_DISCARD_FRONT,
+  VECTOR_OPERATION_DISCARD,
+  VECTOR_OPERATION_POP_BACK,
+  VECTOR_OPERATION_POP_FRONT,
+  VECTOR_OPERATION_POP,
+  VECTOR_OPERATION_SET,
+  VECTOR_OPERATION_INSERT,
+  VECTOR_OPERATION_COPY,
+  VECTOR_OPERATION_RESET,
+  VECTOR_OPERATION_RELEASE,
+  VECTOR_OPERATION_APPEND,
+  VECTOR_OPERATIONS,
+} VectorOperation;
+
+
+// Member:
+// - operations:
+//    Number of calls of each operation, failed ones included.
+// - reallocs:
+//    Number of allocations and reallocations of the content.
+// - bytes_moved:
+//    Bytes shifted by inserts and removals and copied by vector_copy.
+// - vectors:
+//    Number of Vectors summed: 1 for a Vector, those alive for the global
+//    statistics.
+// - count:
+//    Bytes of the objects held.
+// - capacity:
+//    Bytes of capacity.
+// - peak_capacity:
+//    Largest capacity reached, in bytes. For the global statistics, the
+//    largest reached by any Vector.
+// - wasted_capacity:
+//    Bytes of capacity holding no object.
+struct VectorStats {
+  u64   operations[VECTOR_OPERATIONS];
+  u64   reallocs;
+  u64   bytes_moved;
+  usize vectors;
+  usize count;
+  usize capacity;
+  usize peak_capacity;
+  usize wasted_capacity;
+};
+
+
+// Reads the statistics of the Vector. Returns false if they are not
+// collected.
+bool vector_stats(const Vector*, VectorStats*);
+
+// Reads the statistics of the Stack. Returns false if they are not
+// collected.
+bool stack_stats(const Stack*, VectorStats*);
+
+// Reads the sum of the statistics of every Vector. The operations,
+// reallocations and bytes moved include the destructed Vectors, the
+// capacities only those alive. Returns false if they are not collected.
+bool vector_stats_global(VectorStats*);
+
+// Sets the counters of the Vector to zero, and its peak capacity to its
+// capacity. The global statistics are not changed.
+void vector_stats_reset(Vector*);
+
+// Writes the global statistics to out, followed by one line per Vector
+// alive, those wasting the most capacity first. At most limit Vectors are
+// listed, all of them if limit is 0.
+// Returns false if the statistics are not collected or out failed.
+bool vector_stats_dump(FILE* out, const usize limit);
+
+// Returns the name of the operation, e.g. "push_back".
+const char* vector_operation_name(const VectorOperation);
@@ -0,0 +1,104 @@
+#pragma once
+#include "types.h"
+#include <stdio.h>
+
+
+// A Vector trace is the sequence of the vector_* calls made by a program,
+// recorded to a compact binary file, so that a production workload can be
+// replayed offline against other containers and growth policies (see
+// `castor_bench --replay`). The Stacks are traced through their Vector:
+// stack_push is recorded as a push_back, stack_pop as a pop_back, and so on.
+// Tracing is only compiled in when Castor is built with CASTOR_TRACE defined
+// (the `trace` option of xmake). Otherwise the hooks compile to nothing and
+// vector_trace_start returns false.
+//
+// Each thread records into its own buffer, written to the file when it is
+// full, when the thread exits and when the trace stops. The calls of a
+// thread keep their order, those of different threads are only ordered by
+// buffer. The Vectors alive when the trace starts are numbered from 1 and
+// introduced by attach records holding their size, capacity and count,
+// written before any other record; the Vectors constructed afterwards are
+// numbered as they are constructed. A call that only reads a Vector never
+// writes to it, so threads may still share a Vector they only read.
+//
+// File layout: the 8 bytes of VECTOR_TRACE_MAGIC and a u32 version, then
+// the records. A record is the event byte, the varint of the Vector and the
+// varints of the arguments of the event (see VectorTraceRecord).
+typedef struct VectorTraceRecord VectorTraceRecord;
+
+// VectorTraceEvent identifies the recorded calls.
+typedef enum VectorTraceEvent {
+  VECTOR_TRACE_CONSTRUCT,
+  VECTOR_TRACE_ATTACH,
+  VECTOR_TRACE_DESTRUCT,
+  VECTOR_TRACE_GROW,
+  VECTOR_TRACE_PUSH_BACK,
+  VECTOR_TRACE_PUSH_FRONT,
+  VECTOR_TRACE_DISCARD_BACK,
+  VECTOR_TRACE_DISCARD_FRONT,
+  VECTOR_TRACE_DISCARD,
+  VECTOR_TRACE_POP_BACK,
+  VECTOR_TRACE_POP_FRONT,
+  VECTOR_TRACE_POP,
+  VECTOR_TRACE_SET,
+  VECTOR_TRACE_INSERT,
+  VECTOR_TRACE_COPY,
+  VECTOR_TRACE_RESET,
+  VECTOR_TRACE_RELEASE,
+  VECTOR_TRACE_GET,
+  VECTOR_TRACE_GET_BACK,
+  VECTOR_TRACE_GET_FRONT,
+  VECTOR_TRACE_WALK,
+  VECTOR_TRACE_APPEND,
+  VECTOR_TRACE_EVENTS,
+} VectorTraceEvent;
+
+#define VECTOR_TRACE_MAGIC   "CASTORTR"
+#define VECTOR_TRACE_VERSION 1
+
+
+// Member:
+// - event:
+//    The call.
+// - vector:
+//    Number of the Vector.
+// - index:
+//    The index of get, set, insert, discard and pop, the n of grow, the
+//    count of append, and 1 for a copy shrunk to fit.
+// - object_size, capacity, count:
+//    The Vector constructed or attached; count for an attach only.
+// - copy:
+//    Number of the Vector made by a copy.
+struct VectorTraceRecord {
+  VectorTraceEvent event;
+  u64              vector;
+  u64              index;
+  u64              object_size;
+  u64              capacity;
+  u64              count;
+  u64              copy;
+};
+
+
+// Writes the header of a trace to out and starts recording the calls of
+// every thread to it. out must stay open until vector_trace_stop.
+// Returns false if tracing is not compiled in, a trace is already running,
+// or out failed.
+bool vector_trace_start(FILE* out);
+
+// Stops the trace and writes the records still buffered, without closing
+// the file. The other threads must not be using Vectors meanwhile, or their
+// last calls may be lost.
+// Returns false if no trace was running or writing failed at any point.
+bool vector_trace_stop(void);
+
+// Reads the header of a trace. Returns false if in does not hold a trace of
+// this version.
+bool vector_trace_read_header(FILE* in);
+
+// Reads the next record of a trace. Returns false at the end of the trace
+// or on a malformed record.
+bool vector_trace_read(FILE* in, VectorTraceRecord*);
+
+// Returns the name of the event, e.g. "push_back".
+const char* vector_trace_event_name(const VectorTraceEvent);
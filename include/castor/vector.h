@@ -8,6 +8,8 @@
 // size of the object (in bytes).
 // You may also provide a VectorInterface to perform deep operations on the 
 // object, such as deep copying and memory release.
+// A Vector may be read-only (e.g. a snapshot loaded with SNAPSHOT_READONLY),
+// in which case every function that modifies it returns false.
 typedef struct Vector Vector;
 
 // VectorInterface is used to perform deep operations on the objects of the
@@ -32,9 +34,23 @@ typedef struct VectorOptions VectorOptions;
 //    release the memory of the object itself.
 //    For example, if the object type is char*, you only need to free the
 //    memory of the string.
+// - serialize:
+//    This function appends the encoded form of an object to `dst`, a Vector
+//    of u8 (see serial.h). It is needed by objects that own memory, whose raw
+//    bytes are meaningless outside of the process.
+//    For example, if the object type is char*, you push the characters of
+//    the string.
+//    If any errors or failures occur, this function should return false.
+// - deserialize:
+//    This function rebuilds an object from the `length` bytes written by
+//    serialize, and sets the value of `dst` as copy does.
+//    If any errors or failures occur, this function should return false and
+//    leave nothing to release.
 struct VectorInterface {
   bool (*copy)(void* dst, void* src);
   void (*release)(void* src);
+  bool (*serialize)(Vector* dst, const void* src);
+  bool (*deserialize)(void* dst, const void* data, const usize length);
 };
 
 // Member:
@@ -42,9 +58,23 @@ struct VectorInterface {
 //    Initial capacity of the Vector (in terms of the number of objects).
 // - interface:
 //    Optional interface for the Vector, can be set to nullptr.
+// - incremental:
+//    Grows without pauses: when the Vector is full, a buffer of the new
+//    capacity is allocated and the objects are moved to it a few at a time
+//    by the following push_back, set, pop_back and discard_back, rather
+//    than all at once by a realloc. A push then costs O(1) in the worst
+//    case, at the price of holding both buffers until the move completes.
+//    The other modifications complete the move first. Ignored by the
+//    Vectors with a custom storage, such as the persistent ones.
+// - site:
+//    Optional tag of the call site, e.g. "parse_headers" (see site.h). The
+//    count of the Vector is recorded for the site when it is destructed,
+//    and a capacity of 0 is replaced by the one learned for the site.
 struct VectorOptions {
   usize            capacity;
   VectorInterface* interface;
+  bool             incremental;
+  const char*      site;
 };
 
 
@@ -84,6 +114,13 @@ bool vector_grow(Vector*, const usize);
 // Appends an object to the end of the Vector.
 bool vector_push_back(Vector*, void*);
 
+// Appends count objects, contiguous in memory, to the end of the Vector,
+// growing it at most once. The objects may be those of the Vector itself.
+// Large appends are copied as set by vector_bulk_configure (see bulk.h).
+// Returns false if the Vector can not grow, or if its size in bytes would
+// overflow.
+bool vector_append(Vector*, const void* objects, const usize count);
+
 // Inserts an object at the beginning of the Vector.
 bool vector_push_front(Vector*, void*);
 
@@ -131,4 +168,10 @@ void* vector_get_back(const Vector*);
 
 // Returns a pointer to the first object in the vector.
 // If the vector is empty, returns nullptr.
-void* vector_get_front(const Vector*);
\ No newline at end of file
+void* vector_get_front(const Vector*);
+
+// Searches the Vector for an object whose bytes are equal to those of the
+// given one, padding included, using the SIMD kernels of the CPU for
+// objects of 1, 2, 4 or 8 bytes (see dispatch.h).
+// Returns false if none is, else sets index to the first.
+bool vector_find(const Vector*, const void* object, usize* index);
@@ -0,0 +1,98 @@
+#pragma once
+#include "types.h"
+#include "vector.h"
+
+
+// Wal makes every mutation of a Vector of plain objects durable by appending
+// it to a write-ahead log before the mutating call returns.
+// Concurrent writers are group-committed: records appended while a flush is
+// in progress are written and synced together by the next fdatasync.
+//
+// Files in the directory:
+// - snapshot.<generation>:
+//    A snapshot (see snapshot.h) of the Vector before the first record of
+//    wal.<generation>.
+// - wal.<generation>:
+//    The records appended since the snapshot of the same generation.
+// wal_open replays the log onto the latest snapshot, and wal_compact writes
+// a new snapshot in the background and starts a new generation of the log.
+typedef struct Wal Wal;
+
+// WalOptions is used to configure the group commit.
+typedef struct WalOptions WalOptions;
+
+// WalStats holds the counters of a Wal.
+typedef struct WalStats WalStats;
+
+
+// Member:
+// - commit_window:
+//    Time (in microseconds) a flush waits for more records before syncing.
+//    0 syncs as soon as possible, which still groups the records appended
+//    while the previous sync was running.
+struct WalOptions {
+  usize commit_window;
+};
+
+// Member:
+// - records:
+//    Number of records appended since the Wal was opened.
+// - replayed:
+//    Number of records replayed by wal_open.
+// - commits:
+//    Number of fdatasync calls on the log.
+// - bytes_written:
+//    Number of bytes written to the log.
+// - compactions:
+//    Number of completed compactions.
+struct WalStats {
+  u64 records;
+  u64 replayed;
+  u64 commits;
+  u64 bytes_written;
+  u64 compactions;
+};
+
+
+// Opens the log in the given directory, which must exist, and recovers the
+// Vector from the latest snapshot and the records logged after it.
+// Returns:
+// - A pointer to the newly created Wal, or nullptr if the directory holds
+//   objects of another size or allocation fails.
+[[nodiscard, gnu::malloc]]
+Wal* wal_open(
+  const char*      directory,
+  const usize      object_size,
+  const WalOptions options
+);
+
+// Waits for a running compaction, then closes the log and destroys the
+// Vector.
+void wal_close(Wal*);
+
+// Returns the Vector recovered by wal_open.
+// It may be read directly while no mutation is in progress, but must only be
+// modified through the wal_* functions.
+Vector* wal_vector(Wal*);
+
+// Logged counterparts of the vector_* functions. Each of them returns once
+// its record is durable, or false if the operation or the log failed.
+// After a log failure the Vector may hold mutations that are not durable,
+// and every further mutation fails.
+bool wal_push_back(Wal*, void*);
+bool wal_push_front(Wal*, void*);
+bool wal_set(Wal*, const usize, void*);
+bool wal_insert(Wal*, const usize, void*);
+bool wal_discard_back(Wal*);
+bool wal_discard_front(Wal*);
+bool wal_discard(Wal*, const usize);
+
+// Starts a background compaction: the log moves to a new generation, whose
+// snapshot is then rebuilt from the previous snapshot and logs by a thread,
+// so that the writers are not stalled by a copy of the Vector. The files of
+// the previous generations are removed once the snapshot is durable.
+// Returns false if a compaction is already running or cannot start.
+bool wal_compact(Wal*);
+
+// Returns the counters of the Wal.
+WalStats wal_stats(Wal*);
\ No newline at end of file
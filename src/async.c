@@ -0,0 +1,1152 @@
+#define _GNU_SOURCE
+#include "castor/async.h"
+#include "castor/snapshot.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "snapshot_internal.h"
+#include "vector_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <threads.h>
+#include <unistd.h>
+
+
+// Phases of a request. A save syncs its payload before its header, and its
+// header before the file is renamed over the target.
+enum {
+  ASYNC_IO_HEADER_READ,
+  ASYNC_IO_PAYLOAD,
+  ASYNC_IO_PAYLOAD_SYNC,
+  ASYNC_IO_HEADER_WRITE,
+  ASYNC_IO_HEADER_SYNC,
+  ASYNC_IO_DIRECTORY_SYNC,
+};
+
+// Operations of a transfer
+enum {
+  ASYNC_IO_READ,
+  ASYNC_IO_WRITE,
+  ASYNC_IO_DATASYNC,
+  ASYNC_IO_SYNC,
+};
+
+
+// Member:
+// - request:
+//    The request the transfer belongs to.
+// - data:
+//    Source or destination of the transfer in the Vector or the header.
+// - length:
+//    Number of bytes transferred, padded to the alignment for O_DIRECT.
+// - copy:
+//    Number of meaningful bytes at data.
+// - offset:
+//    Offset of the transfer in the file.
+// - buffer:
+//    Index of the bounce buffer the transfer goes through, -1 for none.
+// - operation:
+//    What the transfer does, a read, a write or a sync of the file.
+// - result:
+//    Number of bytes transferred, or a negative errno.
+// - next:
+//    Link in the free list or in the queues of the thread backend.
+typedef struct AsyncIoJob AsyncIoJob;
+struct AsyncIoJob {
+  AsyncIoRequest* request;
+  u8*             data;
+  usize           length;
+  usize           copy;
+  off_t           offset;
+  i32             buffer;
+  u8              operation;
+  i64             result;
+  AsyncIoJob*     next;
+};
+
+// The rings shared with the kernel.
+typedef struct AsyncIoRing {
+  int                  fd;
+  u8*                  sq_ring;
+  usize                sq_ring_size;
+  u8*                  cq_ring;
+  usize                cq_ring_size;
+  struct io_uring_sqe* sqes;
+  usize                sqes_size;
+  _Atomic u32*         sq_head;
+  _Atomic u32*         sq_tail;
+  u32*                 sq_mask;
+  u32*                 sq_array;
+  _Atomic u32*         cq_head;
+  _Atomic u32*         cq_tail;
+  u32*                 cq_mask;
+  struct io_uring_cqe* cqes;
+  u32                  pending;
+} AsyncIoRing;
+
+// Member:
+// - io:
+//    The AsyncIo running the request.
+// - callback:
+//    Called when the request finishes, may be nullptr.
+// - context:
+//    Passed to the callback.
+// - fd:
+//    The file being transferred, then its directory once a save renamed it.
+// - path:
+//    The target of a save, which is written to path.tmp until it is
+//    renamed over the target.
+// - save:
+//    Whether the request is a save.
+// - phase:
+//    Current phase of the request.
+// - issued:
+//    Whether the single transfer of a header phase was issued.
+// - vector:
+//    The saved Vector, or the Vector being loaded.
+// - header:
+//    Aligned block holding the snapshot header and its padding.
+// - payload:
+//    Size of the payload in bytes.
+// - submitted:
+//    Number of payload bytes submitted.
+// - inflight:
+//    Number of transfers in flight.
+// - checksum:
+//    Running checksum of the saved payload.
+// - size:
+//    Size of the loaded file in bytes.
+// - verify:
+//    Whether the checksum of the loaded payload is verified.
+// - failed:
+//    Whether a transfer failed.
+// - done:
+//    Whether the request finished.
+// - ok:
+//    Whether the request finished successfully.
+struct AsyncIoRequest {
+  AsyncIo*        io;
+  AsyncIoCallback callback;
+  void*           context;
+  int             fd;
+  char*           path;
+  bool            save;
+  u8              phase;
+  bool            issued;
+  Vector*         vector;
+  u8*             header;
+  usize           payload;
+  usize           submitted;
+  usize           inflight;
+  u64             checksum;
+  usize           size;
+  bool            verify;
+  bool            failed;
+  bool            done;
+  bool            ok;
+};
+
+// Member:
+// - backend:
+//    The backend in use.
+// - chunk_size:
+//    Size of each transfer in bytes.
+// - queue_depth:
+//    Maximum number of transfers in flight.
+// - direct:
+//    Whether files are opened with O_DIRECT.
+// - event_fd:
+//    Signaled when transfers complete.
+// - jobs:
+//    The transfers, queue_depth of them.
+// - free_jobs:
+//    The transfers that are not in flight.
+// - buffers:
+//    The bounce buffers for O_DIRECT, chunk_size bytes each.
+// - free_buffers:
+//    Vector of i32, the indices of the bounce buffers that are not in use.
+// - requests:
+//    Vector of AsyncIoRequest*, the requests in progress.
+// - ring:
+//    The io_uring rings.
+// - threads:
+//    The workers of the thread backend.
+// - thread_count:
+//    Number of workers.
+// - lock:
+//    Protects the queues of the thread backend.
+// - available:
+//    Signaled when a transfer is queued or the workers must stop.
+// - queued:
+//    Transfers waiting for a worker.
+// - completed:
+//    Transfers completed by the workers.
+// - stopping:
+//    Set to stop the workers.
+struct AsyncIo {
+  AsyncIoBackend backend;
+  usize          chunk_size;
+  usize          queue_depth;
+  bool           direct;
+  int            event_fd;
+  AsyncIoJob*    jobs;
+  AsyncIoJob*    free_jobs;
+  u8*            buffers;
+  Vector*        free_buffers;
+  Vector*        requests;
+  AsyncIoRing    ring;
+  thrd_t*        threads;
+  usize          thread_count;
+  mtx_t          lock;
+  cnd_t          available;
+  AsyncIoJob*    queued;
+  AsyncIoJob*    completed;
+  bool           stopping;
+};
+
+
+static usize async_io_align(const usize n) {
+  return (n + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+static bool async_io_ring_setup(AsyncIo* this) {
+  AsyncIoRing* ring = &this->ring;
+  struct io_uring_params params = {};
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, this->queue_depth, &params);
+  if (ring->fd < 0) {
+    return false;
+  }
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+  ring->cq_ring_size = params.cq_off.cqes
+    + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  // Both rings share one mapping on kernels with IORING_FEAT_SINGLE_MMAP
+  const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single) {
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+      ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap(
+    nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING
+  );
+  // The mappings that failed are released here, and the descriptor is
+  // cleared so that the caller does not release them again
+  if (ring->sq_ring == MAP_FAILED) {
+    close(ring->fd);
+    ring->fd = -1;
+    return false;
+  }
+
+  ring->cq_ring = single ? ring->sq_ring : mmap(
+    nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING
+  );
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = ring->cq_ring == MAP_FAILED ? MAP_FAILED : mmap(
+    nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES
+  );
+  if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    if (!single && ring->cq_ring != MAP_FAILED) {
+      munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    ring->fd = -1;
+    return false;
+  }
+
+  ring->sq_head = (_Atomic u32*)(ring->sq_ring + params.sq_off.head);
+  ring->sq_tail = (_Atomic u32*)(ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask = (u32*)(ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_array = (u32*)(ring->sq_ring + params.sq_off.array);
+  ring->cq_head = (_Atomic u32*)(ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (_Atomic u32*)(ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = (u32*)(ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*)(ring->cq_ring + params.cq_off.cqes);
+
+  // Completions signal the event descriptor
+  if (syscall(
+    __NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD,
+    &this->event_fd, 1
+  ) < 0) {
+    return false;
+  }
+
+  // Register the bounce buffers, so the kernel does not map them per transfer
+  if (this->buffers != nullptr) {
+    struct iovec* iov = calloc(this->queue_depth, sizeof(struct iovec));
+    if (iov == nullptr) {
+      return false;
+    }
+    for (usize i = 0; i < this->queue_depth; i++) {
+      iov[i].iov_base = this->buffers + i * this->chunk_size;
+      iov[i].iov_len = this->chunk_size;
+    }
+    long registered = syscall(
+      __NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS,
+      iov, (unsigned)this->queue_depth
+    );
+    free(iov);
+    if (registered < 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void async_io_ring_release(AsyncIo* this) {
+  AsyncIoRing* ring = &this->ring;
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->fd);
+}
+
+static void async_io_ring_queue(AsyncIo* this, AsyncIoJob* job) {
+  AsyncIoRing* ring = &this->ring;
+  const u32 tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+  const u32 index = tail & *ring->sq_mask;
+
+  struct io_uring_sqe* sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = job->request->fd;
+  sqe->off = (u64)job->offset;
+  sqe->len = (u32)job->length;
+  sqe->user_data = (u64)(usize)job;
+
+  const bool writing = job->operation == ASYNC_IO_WRITE;
+  if (job->operation == ASYNC_IO_DATASYNC || job->operation == ASYNC_IO_SYNC) {
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fsync_flags = job->operation == ASYNC_IO_DATASYNC
+      ? IORING_FSYNC_DATASYNC
+      : 0;
+  } else if (job->buffer >= 0) {
+    sqe->opcode = writing ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->addr = (u64)(usize)(this->buffers + job->buffer * this->chunk_size);
+    sqe->buf_index = (u16)job->buffer;
+  } else {
+    sqe->opcode = writing ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->addr = (u64)(usize)job->data;
+  }
+
+  ring->sq_array[index] = index;
+  atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+  ring->pending++;
+}
+
+static int async_io_worker(void* argument) {
+  AsyncIo* this = argument;
+
+  mtx_lock(&this->lock);
+  for (;;) {
+    while (!this->stopping && this->queued == nullptr) {
+      cnd_wait(&this->available, &this->lock);
+    }
+    if (this->queued == nullptr) {
+      break;
+    }
+
+    AsyncIoJob* job = this->queued;
+    this->queued = job->next;
+    mtx_unlock(&this->lock);
+
+    u8* data = job->buffer >= 0
+      ? this->buffers + job->buffer * this->chunk_size
+      : job->data;
+
+    // A sync transfers nothing
+    job->result = 0;
+    if (job->operation == ASYNC_IO_DATASYNC) {
+      job->result = fdatasync(job->request->fd) == 0 ? 0 : -errno;
+    } else if (job->operation == ASYNC_IO_SYNC) {
+      job->result = fsync(job->request->fd) == 0 ? 0 : -errno;
+    }
+
+    // Transfer the whole chunk, a read stops early at the end of the file
+    const bool writing = job->operation == ASYNC_IO_WRITE;
+    usize done = 0;
+    while (done < job->length) {
+      ssize_t n = writing
+        ? pwrite(job->request->fd, data + done, job->length - done,
+                 job->offset + (off_t)done)
+        : pread(job->request->fd, data + done, job->length - done,
+                job->offset + (off_t)done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        job->result = n < 0 ? -errno : (i64)done;
+        break;
+      }
+      done += (usize)n;
+      job->result = (i64)done;
+    }
+
+    mtx_lock(&this->lock);
+    job->next = this->completed;
+    this->completed = job;
+
+    u64 one = 1;
+    if (write(this->event_fd, &one, sizeof(one)) < 0) {
+      // The counter can only overflow, the completion is signaled anyway
+    }
+  }
+  mtx_unlock(&this->lock);
+
+  return 0;
+}
+
+static bool async_io_threads_setup(AsyncIo* this, const usize count) {
+  if (mtx_init(&this->lock, mtx_plain) != thrd_success) {
+    return false;
+  }
+  if (cnd_init(&this->available) != thrd_success) {
+    mtx_destroy(&this->lock);
+    return false;
+  }
+
+  this->threads = calloc(count, sizeof(thrd_t));
+  if (this->threads == nullptr) {
+    cnd_destroy(&this->available);
+    mtx_destroy(&this->lock);
+    return false;
+  }
+
+  for (; this->thread_count < count; this->thread_count++) {
+    if (thrd_create(
+      &this->threads[this->thread_count], async_io_worker, this
+    ) != thrd_success) {
+      break;
+    }
+  }
+
+  return this->thread_count > 0;
+}
+
+static void async_io_threads_release(AsyncIo* this) {
+  mtx_lock(&this->lock);
+  this->stopping = true;
+  cnd_broadcast(&this->available);
+  mtx_unlock(&this->lock);
+
+  for (usize i = 0; i < this->thread_count; i++) {
+    thrd_join(this->threads[i], nullptr);
+  }
+
+  free(this->threads);
+  cnd_destroy(&this->available);
+  mtx_destroy(&this->lock);
+}
+
+AsyncIo* async_io_construct(const AsyncIoOptions options) {
+  AsyncIo* this = calloc(1, sizeof(AsyncIo));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->chunk_size = async_io_align(
+    options.chunk_size ? options.chunk_size : 1024 * 1024
+  );
+  this->queue_depth = options.queue_depth ? options.queue_depth : 8;
+  this->direct = options.direct;
+  this->ring.fd = -1;
+  this->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  this->jobs = calloc(this->queue_depth, sizeof(AsyncIoJob));
+  this->requests = vector_construct(sizeof(AsyncIoRequest*), (VectorOptions){});
+  this->free_buffers = vector_construct(
+    sizeof(i32),
+    (VectorOptions){ .capacity = this->queue_depth }
+  );
+  if (
+    this->event_fd < 0 || this->jobs == nullptr ||
+    this->requests == nullptr || this->free_buffers == nullptr
+  ) {
+    goto fail;
+  }
+
+  for (usize i = 0; i < this->queue_depth; i++) {
+    this->jobs[i].next = this->free_jobs;
+    this->free_jobs = &this->jobs[i];
+  }
+
+  if (this->direct) {
+    this->buffers = aligned_alloc(
+      SNAPSHOT_ALIGNMENT, this->queue_depth * this->chunk_size
+    );
+    if (this->buffers == nullptr) {
+      goto fail;
+    }
+    for (i32 i = 0; i < (i32)this->queue_depth; i++) {
+      vector_push_back(this->free_buffers, &i);
+    }
+  }
+
+  // Fall back to threads when io_uring is unavailable
+  if (options.backend != ASYNC_IO_THREADS) {
+    if (async_io_ring_setup(this)) {
+      this->backend = ASYNC_IO_URING;
+      return this;
+    }
+    if (this->ring.fd >= 0) {
+      async_io_ring_release(this);
+    }
+    this->ring.fd = -1;
+    if (options.backend == ASYNC_IO_URING) {
+      goto fail;
+    }
+  }
+
+  if (async_io_threads_setup(this, options.threads ? options.threads : 4)) {
+    this->backend = ASYNC_IO_THREADS;
+    return this;
+  }
+  if (this->threads != nullptr) {
+    async_io_threads_release(this);
+  }
+
+fail:
+  if (this->event_fd >= 0) {
+    close(this->event_fd);
+  }
+  free(this->jobs);
+  free(this->buffers);
+  vector_destruct(this->requests);
+  vector_destruct(this->free_buffers);
+  free(this);
+  return nullptr;
+}
+
+AsyncIoBackend async_io_backend(const AsyncIo* this) {
+  return this->backend;
+}
+
+int async_io_fd(const AsyncIo* this) {
+  return this->event_fd;
+}
+
+// Queues one transfer, returns false if none can be in flight right now
+static bool async_io_issue(
+  AsyncIo*        this,
+  AsyncIoRequest* request,
+  u8*             data,
+  const usize     copy,
+  const off_t     offset,
+  const u8        operation,
+  const bool      bounce
+) {
+  if (
+    this->free_jobs == nullptr ||
+    (bounce && vector_empty(this->free_buffers))
+  ) {
+    return false;
+  }
+
+  AsyncIoJob* job = this->free_jobs;
+  this->free_jobs = job->next;
+
+  *job = (AsyncIoJob){
+    .request   = request,
+    .data      = data,
+    .length    = copy,
+    .copy      = copy,
+    .offset    = offset,
+    .buffer    = -1,
+    .operation = operation,
+  };
+
+  if (bounce) {
+    vector_pop_back(this->free_buffers, &job->buffer);
+    u8* buffer = this->buffers + job->buffer * this->chunk_size;
+
+    // O_DIRECT transfers whole aligned blocks
+    job->length = async_io_align(copy);
+    if (operation == ASYNC_IO_WRITE) {
+      memcpy(buffer, data, copy);
+      memset(buffer + copy, 0, job->length - copy);
+    }
+  }
+
+  request->inflight++;
+
+  if (this->backend == ASYNC_IO_URING) {
+    async_io_ring_queue(this, job);
+  } else {
+    mtx_lock(&this->lock);
+    job->next = this->queued;
+    this->queued = job;
+    cnd_signal(&this->available);
+    mtx_unlock(&this->lock);
+  }
+
+  return true;
+}
+
+// Issues the transfers of the current phase of the request
+static void async_io_pump(AsyncIo* this, AsyncIoRequest* request) {
+  if (request->failed || request->done) {
+    return;
+  }
+
+  switch (request->phase) {
+    case ASYNC_IO_HEADER_READ:
+    case ASYNC_IO_HEADER_WRITE:
+      if (!request->issued && async_io_issue(
+        this, request, request->header, SNAPSHOT_ALIGNMENT, 0,
+        request->phase == ASYNC_IO_HEADER_WRITE
+          ? ASYNC_IO_WRITE
+          : ASYNC_IO_READ,
+        false
+      )) {
+        request->issued = true;
+      }
+      break;
+
+    case ASYNC_IO_PAYLOAD_SYNC:
+    case ASYNC_IO_HEADER_SYNC:
+    case ASYNC_IO_DIRECTORY_SYNC:
+      if (!request->issued && async_io_issue(
+        this, request, nullptr, 0, 0,
+        request->phase == ASYNC_IO_DIRECTORY_SYNC
+          ? ASYNC_IO_SYNC
+          : ASYNC_IO_DATASYNC,
+        false
+      )) {
+        request->issued = true;
+      }
+      break;
+
+    case ASYNC_IO_PAYLOAD:
+      while (request->submitted < request->payload) {
+        const usize remaining = request->payload - request->submitted;
+        const usize copy = remaining < this->chunk_size
+          ? remaining
+          : this->chunk_size;
+        u8* data = request->vector->content + request->submitted;
+
+        if (!async_io_issue(
+          this, request, data, copy,
+          (off_t)(SNAPSHOT_ALIGNMENT + request->submitted),
+          request->save ? ASYNC_IO_WRITE : ASYNC_IO_READ, this->direct
+        )) {
+          break;
+        }
+
+        // Chunks are submitted in order, so the checksum follows them
+        if (request->save) {
+          request->checksum = snapshot_checksum_update(
+            request->checksum, data, copy
+          );
+        }
+        request->submitted += copy;
+      }
+      break;
+  }
+}
+
+static void async_io_complete(AsyncIo* this, AsyncIoJob* job) {
+  AsyncIoRequest* request = job->request;
+  request->inflight--;
+
+  const bool writing = job->operation == ASYNC_IO_WRITE;
+  const bool ok = writing
+    ? job->result == (i64)job->length
+    : job->result >= (i64)job->copy;
+  // As for snapshot_save, a save succeeds even if its directory can not be
+  // synced after the rename
+  if (!ok && job->operation != ASYNC_IO_SYNC) {
+    request->failed = true;
+  }
+
+  if (job->buffer >= 0) {
+    if (ok && !writing) {
+      const u8* buffer = this->buffers + job->buffer * this->chunk_size;
+      memcpy(job->data, buffer, job->copy);
+    }
+    vector_push_back(this->free_buffers, &job->buffer);
+  }
+
+  job->next = this->free_jobs;
+  this->free_jobs = job;
+}
+
+// Returns the number of transfers completed
+static usize async_io_reap(AsyncIo* this) {
+  usize reaped = 0;
+  u64 counter;
+  if (read(this->event_fd, &counter, sizeof(counter)) < 0) {
+    // Nothing was signaled
+  }
+
+  if (this->backend == ASYNC_IO_URING) {
+    AsyncIoRing* ring = &this->ring;
+    u32 head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    const u32 tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+
+    for (; head != tail; head++) {
+      struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+      AsyncIoJob* job = (AsyncIoJob*)(usize)cqe->user_data;
+      job->result = cqe->res;
+      async_io_complete(this, job);
+      reaped++;
+    }
+    atomic_store_explicit(ring->cq_head, head, memory_order_release);
+    return reaped;
+  }
+
+  mtx_lock(&this->lock);
+  AsyncIoJob* job = this->completed;
+  this->completed = nullptr;
+  mtx_unlock(&this->lock);
+
+  while (job != nullptr) {
+    AsyncIoJob* next = job->next;
+    async_io_complete(this, job);
+    job = next;
+    reaped++;
+  }
+  return reaped;
+}
+
+// Submits the queued entries in one system call
+static bool async_io_ring_submit(AsyncIo* this) {
+  AsyncIoRing* ring = &this->ring;
+  while (ring->pending > 0) {
+    long submitted = syscall(
+      __NR_io_uring_enter, ring->fd, ring->pending, 0, 0, nullptr, 0
+    );
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // A full completion queue refuses new entries until it is drained,
+      // so the entries are retried only once completions were reaped
+      if ((errno == EBUSY || errno == EAGAIN) && async_io_reap(this) > 0) {
+        continue;
+      }
+      return false;
+    }
+    ring->pending -= (u32)submitted;
+  }
+  return true;
+}
+
+// Takes the entries that could not be submitted back from the submission
+// queue, and completes their transfers as failed
+static void async_io_ring_cancel(AsyncIo* this) {
+  AsyncIoRing* ring = &this->ring;
+  u32 tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+
+  for (; ring->pending > 0; ring->pending--) {
+    tail--;
+    const u32 index = ring->sq_array[tail & *ring->sq_mask];
+    AsyncIoJob* job = (AsyncIoJob*)(usize)ring->sqes[index].user_data;
+    job->result = -ECANCELED;
+    async_io_complete(this, job);
+  }
+  atomic_store_explicit(ring->sq_tail, tail, memory_order_release);
+
+  // The failed requests may have nothing left in flight, signal them so
+  // that the next call to async_io_process finishes them
+  u64 one = 1;
+  if (write(this->event_fd, &one, sizeof(one)) < 0) {
+    // The counter can only overflow, the completion is signaled anyway
+  }
+}
+
+// Moves the request to its next phase once its transfers completed.
+// Returns true if the request finished.
+static bool async_io_advance(AsyncIoRequest* request) {
+  if (request->inflight > 0) {
+    return false;
+  }
+  if (request->failed) {
+    return true;
+  }
+
+  switch (request->phase) {
+    case ASYNC_IO_HEADER_READ: {
+      if (!request->issued) {
+        return false;
+      }
+
+      // The payload is read from a fixed offset, and must fit in the file
+      const SnapshotHeader* header = (SnapshotHeader*)request->header;
+      if (
+        !snapshot_valid(header, request->size) ||
+        header->payload_offset != SNAPSHOT_ALIGNMENT
+      ) {
+        request->failed = true;
+        return true;
+      }
+
+      request->vector = vector_construct(
+        header->object_size,
+        (VectorOptions){ .capacity = header->count }
+      );
+      if (request->vector == nullptr) {
+        request->failed = true;
+        return true;
+      }
+      request->payload = header->count * header->object_size;
+      request->phase = ASYNC_IO_PAYLOAD;
+      return request->payload == 0;
+    }
+
+    case ASYNC_IO_PAYLOAD:
+      if (request->submitted < request->payload) {
+        return false;
+      }
+      if (!request->save) {
+        // Every chunk arrived, the payload is checked at once
+        const SnapshotHeader* header = (SnapshotHeader*)request->header;
+        request->failed = request->verify && snapshot_checksum(
+          request->vector->content, request->payload
+        ) != header->checksum;
+        return true;
+      }
+
+      // O_DIRECT writes padded the last chunk
+      if (request->io->direct && ftruncate(
+        request->fd, (off_t)(SNAPSHOT_ALIGNMENT + request->payload)
+      ) != 0) {
+        request->failed = true;
+        return true;
+      }
+      request->phase = ASYNC_IO_PAYLOAD_SYNC;
+      request->issued = false;
+      return false;
+
+    case ASYNC_IO_PAYLOAD_SYNC: {
+      if (!request->issued) {
+        return false;
+      }
+
+      // Every chunk is on the device, publish the header
+      SnapshotHeader* header = (SnapshotHeader*)request->header;
+      header->checksum = snapshot_checksum_end(request->checksum);
+      request->phase = ASYNC_IO_HEADER_WRITE;
+      request->issued = false;
+      return false;
+    }
+
+    case ASYNC_IO_HEADER_WRITE:
+      if (request->issued) {
+        request->phase = ASYNC_IO_HEADER_SYNC;
+        request->issued = false;
+      }
+      return false;
+
+    case ASYNC_IO_HEADER_SYNC: {
+      if (!request->issued) {
+        return false;
+      }
+
+      // Replace the target atomically, then persist the rename
+      char temporary[PATH_MAX];
+      char directory[PATH_MAX];
+      snprintf(temporary, sizeof(temporary), "%s.tmp", request->path);
+      snprintf(directory, sizeof(directory), "%s", request->path);
+
+      const bool closed = close(request->fd) == 0;
+      request->fd = -1;
+      if (!closed || rename(temporary, request->path) != 0) {
+        request->failed = true;
+        return true;
+      }
+
+      request->fd = open(
+        dirname(directory), O_RDONLY | O_DIRECTORY | O_CLOEXEC
+      );
+      request->phase = ASYNC_IO_DIRECTORY_SYNC;
+      request->issued = false;
+      return request->fd < 0;
+    }
+
+    case ASYNC_IO_DIRECTORY_SYNC:
+      return request->issued;
+  }
+
+  return false;
+}
+
+static void async_io_finish(AsyncIoRequest* request) {
+  request->ok = !request->failed;
+
+  if (request->ok && !request->save) {
+    const SnapshotHeader* header = (SnapshotHeader*)request->header;
+    request->vector->count = header->count;
+  }
+
+  // A failed save leaves the target as it was
+  if (!request->ok && request->save) {
+    char temporary[PATH_MAX];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", request->path);
+    unlink(temporary);
+  }
+
+  if (request->fd >= 0) {
+    close(request->fd);
+  }
+  request->fd = -1;
+  request->done = true;
+}
+
+usize async_io_process(AsyncIo* this) {
+  async_io_reap(this);
+
+  usize finished = 0;
+  for (usize i = 0; i < this->requests->count;) {
+    AsyncIoRequest* request = *(AsyncIoRequest**)vector_get(this->requests, i);
+
+    if (!async_io_advance(request)) {
+      async_io_pump(this, request);
+      i++;
+      continue;
+    }
+
+    vector_discard(this->requests, i);
+    async_io_finish(request);
+    finished++;
+
+    // The callback may release the request or start new ones
+    if (request->callback != nullptr) {
+      request->callback(request, request->context);
+    }
+  }
+
+  // Give the freed transfers to the requests that were waiting for one
+  for (usize i = 0; i < this->requests->count; i++) {
+    async_io_pump(this, *(AsyncIoRequest**)vector_get(this->requests, i));
+  }
+
+  // The requests whose transfers could not be submitted fail, and finish
+  // once their submitted transfers complete
+  if (this->backend == ASYNC_IO_URING && !async_io_ring_submit(this)) {
+    async_io_ring_cancel(this);
+  }
+
+  return finished;
+}
+
+static AsyncIoRequest* async_io_start(
+  AsyncIo*        this,
+  const char*     path,
+  const int       flags,
+  AsyncIoCallback callback,
+  void*           context
+) {
+  AsyncIoRequest* request = calloc(1, sizeof(AsyncIoRequest));
+  u8* header = aligned_alloc(SNAPSHOT_ALIGNMENT, SNAPSHOT_ALIGNMENT);
+  if (request == nullptr || header == nullptr) {
+    free(request);
+    free(header);
+    return nullptr;
+  }
+
+  const int direct = this->direct ? O_DIRECT : 0;
+  request->fd = open(path, flags | direct | O_CLOEXEC, 0644);
+  if (request->fd < 0) {
+    free(request);
+    free(header);
+    return nullptr;
+  }
+
+  memset(header, 0, SNAPSHOT_ALIGNMENT);
+  request->io = this;
+  request->header = header;
+  request->callback = callback;
+  request->context = context;
+
+  if (!vector_push_back(this->requests, &request)) {
+    close(request->fd);
+    free(request);
+    free(header);
+    return nullptr;
+  }
+
+  return request;
+}
+
+AsyncIoRequest* async_io_save(
+  AsyncIo*        this,
+  const Vector*   vector,
+  const char*     path,
+  AsyncIoCallback callback,
+  void*           context
+) {
+  if (vector->interface != nullptr) {
+    return nullptr;
+  }
+
+  // The file is written beside the target and renamed over it once synced:
+  // a mapping of the previous snapshot keeps its content, and a crash
+  // leaves either the previous snapshot or the new one
+  char temporary[PATH_MAX];
+  char directory[PATH_MAX];
+  if (
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path)
+      >= (int)sizeof(temporary) ||
+    snprintf(directory, sizeof(directory), "%s", path)
+      >= (int)sizeof(directory)
+  ) {
+    return nullptr;
+  }
+
+  char* target = strdup(path);
+  if (target == nullptr) {
+    return nullptr;
+  }
+  AsyncIoRequest* request = async_io_start(
+    this, temporary, O_WRONLY | O_CREAT | O_TRUNC, callback, context
+  );
+  if (request == nullptr) {
+    free(target);
+    return nullptr;
+  }
+
+  const usize payload = vector->count * vector->object_size;
+  SnapshotHeader* header = (SnapshotHeader*)request->header;
+  memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+  header->version = SNAPSHOT_VERSION;
+  header->header_size = sizeof(SnapshotHeader);
+  header->object_size = vector->object_size;
+  header->count = vector->count;
+  header->alignment = SNAPSHOT_ALIGNMENT;
+  header->payload_offset = SNAPSHOT_ALIGNMENT;
+
+  request->path = target;
+  request->save = true;
+  request->vector = (Vector*)vector;
+  // The payload is written from the content, and settling does not change
+  // the objects
+  vector_settle(request->vector);
+  request->payload = payload;
+  request->phase = ASYNC_IO_PAYLOAD;
+  request->checksum = snapshot_checksum_begin(payload);
+
+  async_io_pump(this, request);
+  async_io_process(this);
+  return request;
+}
+
+AsyncIoRequest* async_io_load(
+  AsyncIo*        this,
+  const char*     path,
+  const bool      verify,
+  AsyncIoCallback callback,
+  void*           context
+) {
+  AsyncIoRequest* request = async_io_start(
+    this, path, O_RDONLY, callback, context
+  );
+  if (request == nullptr) {
+    return nullptr;
+  }
+
+  // The header is checked against the size of the file once read
+  struct stat st;
+  request->failed = fstat(request->fd, &st) != 0;
+  request->size = request->failed ? 0 : (usize)st.st_size;
+  request->verify = verify;
+  request->phase = ASYNC_IO_HEADER_READ;
+
+  async_io_pump(this, request);
+  async_io_process(this);
+  return request;
+}
+
+bool async_io_wait(AsyncIo* this, AsyncIoRequest* request) {
+  while (!request->done) {
+    async_io_process(this);
+    if (request->done) {
+      break;
+    }
+
+    struct pollfd fd = { .fd = this->event_fd, .events = POLLIN };
+    poll(&fd, 1, -1);
+  }
+
+  return request->ok;
+}
+
+bool async_io_done(const AsyncIoRequest* request) {
+  return request->done;
+}
+
+bool async_io_ok(const AsyncIoRequest* request) {
+  return request->done && request->ok;
+}
+
+Vector* async_io_take(AsyncIoRequest* request) {
+  if (!async_io_ok(request) || request->save) {
+    return nullptr;
+  }
+
+  Vector* vector = request->vector;
+  request->vector = nullptr;
+  return vector;
+}
+
+void async_io_release(AsyncIoRequest* request) {
+  if (request == nullptr) {
+    return;
+  }
+
+  if (!request->save) {
+    vector_destruct(request->vector);
+  }
+  free(request->path);
+  free(request->header);
+  free(request);
+}
+
+void async_io_destruct(AsyncIo* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  // Let the requests in flight finish
+  while (!vector_empty(this->requests)) {
+    async_io_process(this);
+    if (vector_empty(this->requests)) {
+      break;
+    }
+
+    struct pollfd fd = { .fd = this->event_fd, .events = POLLIN };
+    poll(&fd, 1, -1);
+  }
+
+  if (this->backend == ASYNC_IO_URING) {
+    async_io_ring_release(this);
+  } else {
+    async_io_threads_release(this);
+  }
+
+  close(this->event_fd);
+  free(this->jobs);
+  free(this->buffers);
+  vector_destruct(this->requests);
+  vector_destruct(this->free_buffers);
+  free(this);
+}
\ No newline at end of file
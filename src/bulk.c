@@ -0,0 +1,519 @@
+#define _GNU_SOURCE
+#include "castor/bulk.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "bulk_internal.h"
+#include "dispatch_internal.h"
+#include "vector_internal.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unistd.h>
+
+
+// Most threads of a copy by default: more rarely add bandwidth
+#define BULK_THREADS 8
+
+// Defaults of the thresholds
+#define BULK_PARALLEL  ((usize)64 << 20)
+#define BULK_STREAMING ((usize)32 << 20)
+
+// Alignment in bytes of the parts of a split operation, so that the threads
+// do not share pages
+#define BULK_ALIGNMENT 4096
+
+
+// A part of a split operation.
+// Member:
+// - task, context:
+//    As given to vector_bulk_run.
+// - part, first, last:
+//    The arguments of the task.
+// - thread:
+//    The worker running it.
+typedef struct BulkPart {
+  VectorBulkTask task;
+  void*          context;
+  usize          part;
+  usize          first;
+  usize          last;
+  thrd_t         thread;
+} BulkPart;
+
+// A filter or a scatter split across threads.
+// Member:
+// - source:
+//    The Vector read.
+// - mask:
+//    The Vector of the kept flags of a filter, 1 byte each, or nullptr.
+// - keep:
+//    The predicate of a filter without mask.
+// - flags:
+//    The results of keep, when the filter is split.
+// - dest:
+//    The Vector written.
+// - indexes:
+//    The indexes of a scatter.
+// - counts, offsets:
+//    The objects each part of a filter keeps, and the index in dest of the
+//    first of them.
+// - failed:
+//    Whether each part of a scatter holds an index out of dest.
+typedef struct BulkSelect {
+  const Vector* source;
+  const Vector* mask;
+  bool          (*keep)(const void*);
+  u8*           flags;
+  Vector*       dest;
+  const Vector* indexes;
+  usize         counts[VECTOR_BULK_PARTS];
+  usize         offsets[VECTOR_BULK_PARTS];
+  bool          failed[VECTOR_BULK_PARTS];
+} BulkSelect;
+
+// A copy.
+// Member:
+// - dst, src:
+//    As for memcpy.
+// - stream:
+//    Uses non-temporal stores.
+typedef struct BulkCopy {
+  u8*       dst;
+  const u8* src;
+  bool      stream;
+} BulkCopy;
+
+
+static once_flag bulk_once = ONCE_FLAG_INIT;
+
+static _Atomic usize bulk_threads;
+static _Atomic usize bulk_parallel;
+static _Atomic usize bulk_streaming;
+
+// The defaults, from the machine
+static usize bulk_default_threads;
+static usize bulk_default_streaming;
+
+
+static void bulk_init(void) {
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  bulk_default_threads = cpus < 1 ? 1
+    : (usize)cpus < BULK_THREADS ? (usize)cpus
+    : BULK_THREADS;
+
+  // The largest cache sysconf knows of
+  long cache = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+  cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  if (cache <= 0) {
+    cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  }
+#endif
+  bulk_default_streaming = cache > 0 ? (usize)cache : BULK_STREAMING;
+
+  atomic_store(&bulk_threads, bulk_default_threads);
+  atomic_store(&bulk_parallel, BULK_PARALLEL);
+  atomic_store(&bulk_streaming, bulk_default_streaming);
+}
+
+void vector_bulk_configure(const VectorBulkOptions options) {
+  call_once(&bulk_once, bulk_init);
+  atomic_store(
+    &bulk_threads, options.threads ? options.threads : bulk_default_threads
+  );
+  atomic_store(
+    &bulk_parallel, options.parallel ? options.parallel : BULK_PARALLEL
+  );
+  atomic_store(
+    &bulk_streaming,
+    options.streaming ? options.streaming : bulk_default_streaming
+  );
+}
+
+void vector_bulk_options(VectorBulkOptions* options) {
+  call_once(&bulk_once, bulk_init);
+  *options = (VectorBulkOptions){
+    .threads   = atomic_load(&bulk_threads),
+    .parallel  = atomic_load(&bulk_parallel),
+    .streaming = atomic_load(&bulk_streaming),
+  };
+}
+
+usize vector_bulk_parts(const usize bytes) {
+  VectorBulkOptions options;
+  vector_bulk_options(&options);
+  if (bytes < options.parallel) {
+    return 1;
+  }
+
+  // Each thread takes at least half of the parallel threshold
+  const usize half = options.parallel / 2 ? options.parallel / 2 : 1;
+  usize parts = bytes / half < options.threads
+    ? bytes / half
+    : options.threads;
+  return parts < VECTOR_BULK_PARTS ? parts : VECTOR_BULK_PARTS;
+}
+
+static int bulk_worker(void* data) {
+  const BulkPart* part = data;
+  part->task(part->context, part->part, part->first, part->last);
+  return 0;
+}
+
+usize vector_bulk_run(
+  const usize          count,
+  const usize          size,
+  const usize          parts,
+  const VectorBulkTask task,
+  void*                context
+) {
+  if (parts <= 1 || count == 0) {
+    task(context, 0, 0, count);
+    return 1;
+  }
+
+  // The length of the parts, a whole number of pages when the items fit
+  const usize alignment = size < BULK_ALIGNMENT ? BULK_ALIGNMENT / size : 1;
+  const usize length = (count + parts - 1) / parts;
+  const usize stride = (length + alignment - 1) / alignment * alignment;
+  BulkPart list[VECTOR_BULK_PARTS];
+  usize n = 0;
+  for (usize first = 0; first < count && n < VECTOR_BULK_PARTS; n++) {
+    const usize last = count - first < stride ? count : first + stride;
+    list[n] = (BulkPart){
+      .task    = task,
+      .context = context,
+      .part    = n,
+      .first   = first,
+      .last    = last,
+    };
+    first = last;
+  }
+  list[n - 1].last = count;
+
+  // The calling thread runs the first part, and any part whose worker
+  // could not be started
+  bool started[VECTOR_BULK_PARTS] = {};
+  for (usize i = 1; i < n; i++) {
+    started[i] =
+      thrd_create(&list[i].thread, bulk_worker, &list[i]) == thrd_success;
+  }
+  for (usize i = 0; i < n; i++) {
+    if (!started[i]) {
+      bulk_worker(&list[i]);
+    }
+  }
+  for (usize i = 1; i < n; i++) {
+    if (started[i]) {
+      thrd_join(list[i].thread, nullptr);
+    }
+  }
+  return n;
+}
+
+static void bulk_copy_part(
+  void*       context,
+  const usize,
+  const usize first,
+  const usize last
+) {
+  const BulkCopy* copy = context;
+  if (copy->stream) {
+    castor_kernels->stream(copy->dst + first, copy->src + first, last - first);
+  } else {
+    memcpy(copy->dst + first, copy->src + first, last - first);
+  }
+}
+
+void vector_bulk_copy(void* dst, const void* src, const usize bytes) {
+  // The content of an empty Vector may be nullptr
+  if (bytes == 0) {
+    return;
+  }
+
+  VectorBulkOptions options;
+  vector_bulk_options(&options);
+  if (bytes < options.parallel && bytes < options.streaming) {
+    memcpy(dst, src, bytes);
+    return;
+  }
+
+  BulkCopy copy = {
+    .dst    = dst,
+    .src    = src,
+    .stream = bytes >= options.streaming,
+  };
+  vector_bulk_run(bytes, 1, vector_bulk_parts(bytes), bulk_copy_part, &copy);
+}
+
+// Runs the loop over the objects [first, last) of the source of select,
+// run by run: objects is the address of the object at, flags those of its
+// kept flags, and n the number of objects of the run
+#define BULK_FILTER_RUNS(select, first, last, at, objects, flags, n, loop)    \
+  do {                                                                        \
+    const Vector* mask_ = (select)->mask;                                     \
+    for (usize at = first, end_, mask_end_; at < last; at = end_) {           \
+      const u8* objects = vector_run((select)->source, at, &end_);            \
+      const u8* flags;                                                        \
+      if (mask_ != nullptr) {                                                 \
+        flags = vector_run(mask_, at, &mask_end_);                            \
+        end_ = end_ < mask_end_ ? end_ : mask_end_;                           \
+      } else {                                                                \
+        flags = (select)->flags + at;                                         \
+      }                                                                       \
+      end_ = end_ < last ? end_ : last;                                       \
+      const usize n = end_ - at;                                              \
+      loop                                                                    \
+    }                                                                         \
+  } while (0)
+
+// Counts the objects a part of a filter keeps, storing the results of the
+// predicate in the flags
+static void bulk_count_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  BulkSelect* select = context;
+  const usize size = select->source->object_size;
+  usize kept = 0;
+  BULK_FILTER_RUNS(select, first, last, at, objects, flags, n, {
+    if (select->mask == nullptr) {
+      for (usize i = 0; i < n; i++) {
+        select->flags[at + i] = select->keep(objects + i * size);
+      }
+    }
+    for (usize i = 0; i < n; i++) {
+      kept += flags[i] != 0;
+    }
+  });
+  select->counts[part] = kept;
+}
+
+// Copies the kept objects of a run to the content of dest from next,
+// without a branch for the common sizes: every object is written, and the
+// next index moves on only if it is kept. The writes past the last kept
+// object of the part go to a local, as the next part owns that memory.
+#define BULK_COMPACT(type)                                                    \
+  do {                                                                        \
+    type* to = (type*)select->dest->content;                                  \
+    type spare;                                                               \
+    for (usize i = 0; i < n; i++) {                                           \
+      type* slot = next < limit ? to + next : &spare;                         \
+      memcpy(slot, objects + i * sizeof(type), sizeof(type));                 \
+      next += flags[i] != 0;                                                  \
+    }                                                                         \
+  } while (0)
+
+static void bulk_compact_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  BulkSelect* select = context;
+  const usize size = select->source->object_size;
+  const usize limit = select->offsets[part] + select->counts[part];
+  usize next = select->offsets[part];
+  BULK_FILTER_RUNS(select, first, last, at, objects, flags, n, {
+    switch (size) {
+    case 4:
+      BULK_COMPACT(u32);
+      break;
+    case 8:
+      BULK_COMPACT(u64);
+      break;
+    default:
+      for (usize i = 0; i < n; i++) {
+        if (flags[i] != 0) {
+          select->dest->copy_object(
+            select->dest->content + next++ * size, objects + i * size, size
+          );
+        }
+      }
+      break;
+    }
+  });
+}
+
+// Filters the source of select into a new Vector, by its mask or its
+// predicate
+static Vector* bulk_filter(BulkSelect* select) {
+  const Vector* source = select->source;
+  const usize count = source->count;
+  const usize size = source->object_size;
+
+  // The predicate is called once per object: when the filter is split,
+  // its results are kept for the second pass
+  const usize parts = vector_bulk_parts(count * size);
+  if (select->mask == nullptr) {
+    if (parts <= 1) {
+      Vector* dest = vector_construct(size, (VectorOptions){});
+      for (usize i = 0, end; dest != nullptr && i < count; i = end) {
+        u8* objects = vector_run(source, i, &end);
+        for (usize j = 0; j < end - i; j++) {
+          void* object = objects + j * size;
+          if (select->keep(object) && !vector_push_back(dest, object)) {
+            vector_destruct(dest);
+            return nullptr;
+          }
+        }
+      }
+      return dest;
+    }
+
+    select->flags = malloc(count);
+    if (select->flags == nullptr) {
+      return nullptr;
+    }
+  }
+
+  const usize n = vector_bulk_run(count, size, parts, bulk_count_part, select);
+  usize kept = 0;
+  for (usize i = 0; i < n; i++) {
+    select->offsets[i] = kept;
+    kept += select->counts[i];
+  }
+
+  select->dest = vector_construct(size, (VectorOptions){ .capacity = kept });
+  if (select->dest != nullptr) {
+    select->dest->count = kept;
+    vector_bulk_run(count, size, parts, bulk_compact_part, select);
+  }
+  free(select->flags);
+  return select->dest;
+}
+
+Vector* vector_filter(const Vector* this, bool (*keep)(const void*)) {
+  BulkSelect select = {
+    .source = this,
+    .keep   = keep,
+  };
+  return bulk_filter(&select);
+}
+
+Vector* vector_filter_mask(const Vector* this, const Vector* mask) {
+  if (mask->object_size != 1 || mask->count != this->count) {
+    return nullptr;
+  }
+
+  BulkSelect select = {
+    .source = this,
+    .mask   = mask,
+  };
+  return bulk_filter(&select);
+}
+
+// Runs the loop over the objects [first, last) of the source of a scatter,
+// run by run: objects is the address of the object at, indexes that of its
+// index, and n the number of objects of the run
+#define BULK_SCATTER_RUNS(select, first, last, at, objects, indexes, n, loop) \
+  do {                                                                        \
+    for (usize at = first, end_, index_end_; at < last; at = end_) {          \
+      const u8* objects = vector_run((select)->source, at, &end_);            \
+      const u8* indexes = vector_run((select)->indexes, at, &index_end_);     \
+      end_ = end_ < index_end_ ? end_ : index_end_;                           \
+      end_ = end_ < last ? end_ : last;                                       \
+      const usize n = end_ - at;                                              \
+      loop                                                                    \
+    }                                                                         \
+  } while (0)
+
+static void bulk_check_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  BulkSelect* select = context;
+  const u64 count = select->dest->count;
+  bool failed = false;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* indexes = vector_run(select->indexes, i, &end);
+    end = end < last ? end : last;
+    for (usize j = 0; j < end - i; j++) {
+      u64 index;
+      memcpy(&index, indexes + j * sizeof(u64), sizeof(u64));
+      failed |= index >= count;
+    }
+  }
+  select->failed[part] = failed;
+}
+
+// Copies each object of a run to its index in dest
+#define BULK_SCATTER(type)                                                    \
+  do {                                                                        \
+    for (usize i = 0; i < n; i++) {                                           \
+      u64 index;                                                              \
+      memcpy(&index, indexes + i * sizeof(u64), sizeof(u64));                 \
+      memcpy(                                                                 \
+        content + index * sizeof(type), objects + i * sizeof(type),           \
+        sizeof(type)                                                          \
+      );                                                                      \
+    }                                                                         \
+  } while (0)
+
+static void bulk_scatter_part(
+  void*       context,
+  const usize,
+  const usize first,
+  const usize last
+) {
+  BulkSelect* select = context;
+  Vector* dest = select->dest;
+  u8* content = dest->content;
+  const usize size = dest->object_size;
+  BULK_SCATTER_RUNS(select, first, last, at, objects, indexes, n, {
+    switch (size) {
+    case 4:
+      BULK_SCATTER(u32);
+      break;
+    case 8:
+      BULK_SCATTER(u64);
+      break;
+    default:
+      for (usize i = 0; i < n; i++) {
+        u64 index;
+        memcpy(&index, indexes + i * sizeof(u64), sizeof(u64));
+        dest->copy_object(content + index * size, objects + i * size, size);
+      }
+      break;
+    }
+  });
+}
+
+bool vector_scatter(Vector* dest, const Vector* this, const Vector* indexes) {
+  if (
+    dest->object_size != this->object_size ||
+    indexes->object_size != sizeof(u64) || indexes->count != this->count ||
+    (dest->flags & VECTOR_FLAG_READONLY) || dest == this
+  ) {
+    return false;
+  }
+
+  BulkSelect select = {
+    .source  = this,
+    .dest    = dest,
+    .indexes = indexes,
+  };
+  const usize count = this->count;
+  const usize size = this->object_size;
+  const usize parts = vector_bulk_parts(count * size);
+
+  // Every index is checked before any object is written
+  const usize n = vector_bulk_run(count, size, parts, bulk_check_part, &select);
+  for (usize i = 0; i < n; i++) {
+    if (select.failed[i]) {
+      return false;
+    }
+  }
+
+  vector_settle(dest);
+  vector_dirty_mark(dest, 0, dest->count);
+  vector_bulk_run(count, size, parts, bulk_scatter_part, &select);
+  return true;
+}
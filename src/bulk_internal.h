@@ -0,0 +1,37 @@
+#pragma once
+#include "castor/bulk.h"
+#include "castor/types.h"
+
+
+// Most parts an operation is split into
+#define VECTOR_BULK_PARTS 64
+
+// Runs a part of a split operation: the items [first, last). part is the
+// index of the part, below VECTOR_BULK_PARTS.
+typedef void (*VectorBulkTask)(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+);
+
+
+// Copies bytes from src to dst, which do not overlap, as memcpy, with the
+// threads and the non-temporal stores of the bulk options.
+void vector_bulk_copy(void* dst, const void* src, const usize bytes);
+
+// Returns the number of threads an operation over the given number of bytes
+// should be split across, from the bulk options: 1 below the parallel
+// threshold.
+usize vector_bulk_parts(const usize bytes);
+
+// Splits count items of size bytes into up to parts contiguous parts and
+// runs the task on each of them, the calling thread running one of them.
+// Returns the number of parts run, which are numbered from 0.
+usize vector_bulk_run(
+  const usize          count,
+  const usize          size,
+  const usize          parts,
+  const VectorBulkTask task,
+  void*                context
+);
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "castor/cache.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "cache_internal.h"
+#include "vector_internal.h"
+#include <stdlib.h>
+#include <threads.h>
+
+
+// Order of the smallest bucket, 16 bytes, which holds the link of a buffer
+#define CACHE_MIN_ORDER 4
+
+// Number of buckets
+#define CACHE_ORDERS 64
+
+
+// A buffer or header kept, linked through its first bytes.
+typedef struct CacheEntry {
+  struct CacheEntry* next;
+} CacheEntry;
+
+// Member:
+// - options:
+//    As set by vector_cache_configure.
+// - buckets, counts:
+//    Buffers of each order, at least 2^order bytes each, and their number.
+// - headers, header_count:
+//    Vector headers kept and their number.
+// - bytes:
+//    Bytes kept.
+// - stats:
+//    Counters, buffers and bytes excepted.
+// - registered:
+//    Set once the cache is freed at the exit of the thread.
+typedef struct VectorCache {
+  VectorCacheOptions options;
+  CacheEntry*        buckets[CACHE_ORDERS];
+  usize              counts[CACHE_ORDERS];
+  CacheEntry*        headers;
+  usize              header_count;
+  usize              bytes;
+  VectorCacheStats   stats;
+  bool               registered;
+} VectorCache;
+
+
+static once_flag cache_once = ONCE_FLAG_INIT;
+
+// Frees the cache of a thread when it exits
+static tss_t cache_key;
+
+// Disabled until vector_cache_configure is called
+static thread_local VectorCache vector_cache;
+
+
+static void cache_free(VectorCache* cache) {
+  for (usize order = 0; order < CACHE_ORDERS; order++) {
+    while (cache->buckets[order] != nullptr) {
+      CacheEntry* entry = cache->buckets[order];
+      cache->buckets[order] = entry->next;
+      free(entry);
+    }
+    cache->counts[order] = 0;
+  }
+  while (cache->headers != nullptr) {
+    CacheEntry* entry = cache->headers;
+    cache->headers = entry->next;
+    free(entry);
+  }
+  cache->header_count = 0;
+  cache->bytes = 0;
+}
+
+static void cache_exit(void* data) {
+  cache_free(data);
+}
+
+static void cache_init(void) {
+  tss_create(&cache_key, cache_exit);
+}
+
+// Makes the thread free its cache when it exits, before it keeps anything
+static void cache_register(VectorCache* cache) {
+  if (cache->registered) {
+    return;
+  }
+  call_once(&cache_once, cache_init);
+  tss_set(cache_key, cache);
+  cache->registered = true;
+}
+
+static bool cache_keeps(const VectorCache* cache, const usize bytes) {
+  return cache->options.buffers > 0 && bytes > 0 &&
+    bytes <= cache->options.largest;
+}
+
+// Returns the order of the smallest bucket holding bytes
+static usize cache_order(const usize bytes) {
+  usize order = CACHE_MIN_ORDER;
+  while (order < CACHE_ORDERS - 1 && ((usize)1 << order) < bytes) {
+    order++;
+  }
+  return order;
+}
+
+usize vector_cache_size(const usize bytes) {
+  if (!cache_keeps(&vector_cache, bytes)) {
+    return bytes;
+  }
+  return (usize)1 << cache_order(bytes);
+}
+
+void* vector_cache_take(const usize bytes, usize* size) {
+  VectorCache* cache = &vector_cache;
+  if (!cache_keeps(cache, bytes)) {
+    return nullptr;
+  }
+
+  const usize order = cache_order(bytes);
+  const usize last = order + VECTOR_CACHE_SPAN < CACHE_ORDERS - 1
+    ? order + VECTOR_CACHE_SPAN
+    : CACHE_ORDERS - 1;
+  cache->stats.requests++;
+  for (usize found = order; found <= last; found++) {
+    CacheEntry* entry = cache->buckets[found];
+    if (entry == nullptr) {
+      continue;
+    }
+
+    cache->buckets[found] = entry->next;
+    cache->counts[found]--;
+    cache->bytes -= (usize)1 << found;
+    cache->stats.hits++;
+    *size = (usize)1 << found;
+    return entry;
+  }
+  return nullptr;
+}
+
+void vector_cache_give(void* buffer, const usize bytes) {
+  if (buffer == nullptr) {
+    return;
+  }
+
+  VectorCache* cache = &vector_cache;
+  if (!cache_keeps(cache, bytes) || bytes < ((usize)1 << CACHE_MIN_ORDER)) {
+    free(buffer);
+    return;
+  }
+
+  // The buffer goes to the largest bucket it fills
+  usize order = cache_order(bytes);
+  if (((usize)1 << order) > bytes) {
+    order--;
+  }
+
+  cache->stats.returns++;
+  if (
+    cache->counts[order] >= cache->options.buffers ||
+    cache->bytes + ((usize)1 << order) > cache->options.bytes
+  ) {
+    cache->stats.drops++;
+    free(buffer);
+    return;
+  }
+
+  cache_register(cache);
+  CacheEntry* entry = buffer;
+  entry->next = cache->buckets[order];
+  cache->buckets[order] = entry;
+  cache->counts[order]++;
+  cache->bytes += (usize)1 << order;
+}
+
+Vector* vector_cache_take_header(void) {
+  VectorCache* cache = &vector_cache;
+  if (cache->options.buffers == 0) {
+    return nullptr;
+  }
+
+  cache->stats.header_requests++;
+  CacheEntry* entry = cache->headers;
+  if (entry == nullptr) {
+    return nullptr;
+  }
+
+  cache->headers = entry->next;
+  cache->header_count--;
+  cache->bytes -= sizeof(Vector);
+  cache->stats.header_hits++;
+  return (Vector*)entry;
+}
+
+void vector_cache_give_header(Vector* header) {
+  VectorCache* cache = &vector_cache;
+  if (cache->options.buffers == 0) {
+    free(header);
+    return;
+  }
+
+  cache->stats.returns++;
+  if (
+    cache->header_count >= cache->options.buffers ||
+    cache->bytes + sizeof(Vector) > cache->options.bytes
+  ) {
+    cache->stats.drops++;
+    free(header);
+    return;
+  }
+
+  cache_register(cache);
+  CacheEntry* entry = (CacheEntry*)header;
+  entry->next = cache->headers;
+  cache->headers = entry;
+  cache->header_count++;
+  cache->bytes += sizeof(Vector);
+}
+
+void vector_cache_configure(const VectorCacheOptions options) {
+  cache_free(&vector_cache);
+  vector_cache.options = (VectorCacheOptions){
+    .buffers = options.buffers,
+    .largest = options.largest ? options.largest : 64 * 1024,
+    .bytes   = options.bytes ? options.bytes : 1024 * 1024,
+  };
+}
+
+void vector_cache_trim(void) {
+  cache_free(&vector_cache);
+}
+
+void vector_cache_stats(VectorCacheStats* stats) {
+  const VectorCache* cache = &vector_cache;
+  *stats = cache->stats;
+
+  usize buffers = cache->header_count;
+  for (usize order = 0; order < CACHE_ORDERS; order++) {
+    buffers += cache->counts[order];
+  }
+  stats->buffers = buffers;
+  stats->bytes = cache->bytes;
+
+  const u64 requests = stats->requests + stats->header_requests;
+  stats->hit_rate = requests > 0
+    ? (f64)(stats->hits + stats->header_hits) / (f64)requests
+    : 0.0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "castor/cache.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+
+
+// Number of buckets above the one of a size where vector_cache_take looks,
+// so that a Vector can start with the capacity a previous one grew to
+#define VECTOR_CACHE_SPAN 2
+
+
+// Returns the bytes to allocate for a content of the given bytes: the size
+// of its bucket if the cache of the thread keeps such contents, else bytes.
+usize vector_cache_size(const usize bytes);
+
+// Takes a buffer of at least the given bytes from the cache of the thread,
+// from its bucket or one up to VECTOR_CACHE_SPAN larger, and sets size to
+// the size of the bucket. Returns nullptr if they are empty or not cached.
+void* vector_cache_take(const usize bytes, usize* size);
+
+// Gives a buffer allocated with malloc, holding at least the given bytes, to
+// the cache of the thread, or frees it if the cache is full.
+void vector_cache_give(void* buffer, const usize bytes);
+
+// Takes a Vector header from the cache of the thread. Returns nullptr if it
+// holds none.
+Vector* vector_cache_take_header(void);
+
+// Gives a Vector header allocated with malloc to the cache of the thread,
+// or frees it if the cache is full.
+void vector_cache_give_header(Vector*);
@@ -0,0 +1,461 @@
+#define _GNU_SOURCE
+#include "castor/checkpoint.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include "vector_internal.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define CHECKPOINT_MANIFEST_MAGIC "CASTORMF"
+#define CHECKPOINT_DELTA_MAGIC    "CASTORDL"
+#define CHECKPOINT_VERSION        2
+
+// Number of content buffers written per writev batch
+#define CHECKPOINT_BATCH 256
+
+
+// Member:
+// - magic:
+//    CHECKPOINT_MANIFEST_MAGIC without the terminating null byte.
+// - version:
+//    Format version.
+// - header_size:
+//    sizeof(CheckpointManifest) when the file was written.
+// - object_size:
+//    Size of each object in bytes.
+// - first:
+//    Sequence number of the first delta to apply, which holds the whole
+//    content.
+// - deltas:
+//    Number of delta files to apply, from delta.<first> to
+//    delta.<first + deltas - 1>.
+typedef struct CheckpointManifest {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 object_size;
+  u64 first;
+  u64 deltas;
+} CheckpointManifest;
+
+// Member:
+// - magic:
+//    CHECKPOINT_DELTA_MAGIC without the terminating null byte.
+// - version:
+//    Format version.
+// - header_size:
+//    sizeof(CheckpointDelta) when the file was written.
+// - sequence:
+//    Sequence number of the delta.
+// - count:
+//    Number of objects in the Vector at the time of the checkpoint.
+// - ranges:
+//    Number of CheckpointRange following the header. The content of each
+//    range follows the range table, in order.
+typedef struct CheckpointDelta {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 sequence;
+  u64 count;
+  u64 ranges;
+} CheckpointDelta;
+
+// A contiguous byte range of the content of the Vector.
+typedef struct CheckpointRange {
+  u64 offset;
+  u64 length;
+} CheckpointRange;
+
+// Member:
+// - vector:
+//    The tracked Vector.
+// - directory:
+//    The directory holding the manifest and the delta files.
+// - stale:
+//    Sequence number of the first delta listed by the manifest found in the
+//    directory, whose deltas are removed once replaced.
+// - first:
+//    Sequence number of the first delta written by the Checkpoint.
+// - sequence:
+//    Sequence number of the next delta.
+struct Checkpoint {
+  Vector* vector;
+  char*   directory;
+  u64     stale;
+  u64     first;
+  u64     sequence;
+};
+
+
+// Formats the path of the delta file with the given sequence number.
+// Returns false if it does not fit.
+static bool checkpoint_delta_path(
+  char*       path,
+  const char* directory,
+  const u64   sequence
+) {
+  return snprintf(
+    path, PATH_MAX, "%s/delta.%llu",
+    directory, (unsigned long long)sequence
+  ) < PATH_MAX;
+}
+
+// Reads and checks the manifest in the directory
+static bool checkpoint_read_manifest(
+  const char*         directory,
+  CheckpointManifest* manifest
+) {
+  char path[PATH_MAX];
+  if (snprintf(path, sizeof(path), "%s/manifest", directory)
+    >= (int)sizeof(path)) {
+    return false;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool ok = io_read_all(fd, manifest, sizeof(*manifest))
+    && memcmp(
+      manifest->magic, CHECKPOINT_MANIFEST_MAGIC, sizeof(manifest->magic)
+    ) == 0
+    && manifest->version == CHECKPOINT_VERSION
+    && manifest->header_size == sizeof(CheckpointManifest)
+    && manifest->object_size > 0
+    && manifest->deltas <= UINT64_MAX - manifest->first;
+  close(fd);
+  return ok;
+}
+
+
+Checkpoint* checkpoint_construct(
+  Vector*                 vector,
+  const char*             directory,
+  const CheckpointOptions options
+) {
+  if (vector->interface != nullptr || vector->dirty != nullptr) {
+    return nullptr;
+  }
+
+  Checkpoint* this = calloc(1, sizeof(Checkpoint));
+  VectorDirty* dirty = calloc(1, sizeof(VectorDirty));
+  char* path = strdup(directory);
+  if (this == nullptr || dirty == nullptr || path == nullptr) {
+    free(this);
+    free(dirty);
+    free(path);
+    return nullptr;
+  }
+
+  // The first checkpoint writes the whole content. Its delta is numbered
+  // after those of the manifest in the directory, so that no delta the
+  // manifest lists is overwritten before the manifest is replaced.
+  dirty->chunk_size = options.chunk_size ? options.chunk_size : 4096;
+  dirty->all = true;
+
+  CheckpointManifest manifest;
+  if (checkpoint_read_manifest(directory, &manifest)) {
+    this->stale = manifest.first;
+    this->first = manifest.first + manifest.deltas;
+    this->sequence = this->first;
+  }
+
+  vector->dirty = dirty;
+  vector->flags |= VECTOR_FLAG_DIRTY;
+  this->vector = vector;
+  this->directory = path;
+
+  return this;
+}
+
+void checkpoint_destruct(Checkpoint* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  VectorDirty* dirty = this->vector->dirty;
+  this->vector->dirty = nullptr;
+  this->vector->flags &= ~VECTOR_FLAG_DIRTY;
+  free(dirty->bits);
+  free(dirty);
+  free(this->directory);
+  free(this);
+}
+
+// Collects the dirty byte ranges below end into a Vector of CheckpointRange
+static bool checkpoint_ranges(
+  const VectorDirty* dirty,
+  const usize        end,
+  Vector*            ranges
+) {
+  if (end == 0) {
+    return true;
+  }
+
+  if (dirty->all) {
+    CheckpointRange range = { .offset = 0, .length = end };
+    return vector_push_back(ranges, &range);
+  }
+
+  const usize chunks = (end + dirty->chunk_size - 1) / dirty->chunk_size;
+  const usize tracked = chunks < dirty->chunks ? chunks : dirty->chunks;
+
+  usize chunk = 0;
+  while (chunk < tracked) {
+    // Skip clean words at once
+    if (chunk % 64 == 0 && dirty->bits[chunk / 64] == 0) {
+      chunk += 64;
+      continue;
+    }
+    if (!(dirty->bits[chunk / 64] & 1ull << (chunk % 64))) {
+      chunk++;
+      continue;
+    }
+
+    // Coalesce the run of dirty chunks into one range
+    usize first = chunk;
+    while (
+      chunk < tracked && dirty->bits[chunk / 64] & 1ull << (chunk % 64)
+    ) {
+      chunk++;
+    }
+
+    usize offset = first * dirty->chunk_size;
+    usize last = chunk * dirty->chunk_size;
+    CheckpointRange range = {
+      .offset = offset,
+      .length = (last < end ? last : end) - offset,
+    };
+    if (!vector_push_back(ranges, &range)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool checkpoint_write_delta(
+  Checkpoint*      this,
+  const char*      path,
+  Vector*          ranges,
+  CheckpointStats* stats
+) {
+  const usize range_count = vector_empty(ranges) ? 0 : ranges->count;
+  CheckpointDelta header = {
+    .version     = CHECKPOINT_VERSION,
+    .header_size = sizeof(CheckpointDelta),
+    .sequence    = this->sequence,
+    .count       = this->vector->count,
+    .ranges      = range_count,
+  };
+  memcpy(header.magic, CHECKPOINT_DELTA_MAGIC, sizeof(header.magic));
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  const usize table_size = range_count * sizeof(CheckpointRange);
+  struct iovec table[] = {
+    { .iov_base = &header,         .iov_len = sizeof(header) },
+    { .iov_base = ranges->content, .iov_len = table_size },
+  };
+  bool ok = io_writev_all(fd, table, range_count > 0 ? 2 : 1);
+  stats->bytes_written += sizeof(header) + table_size;
+
+  // Write the content of the ranges in batches
+  struct iovec iov[CHECKPOINT_BATCH];
+  for (usize i = 0; ok && i < range_count; i += CHECKPOINT_BATCH) {
+    int n = 0;
+    for (usize j = i; j < range_count && n < CHECKPOINT_BATCH; j++, n++) {
+      CheckpointRange* range = vector_get(ranges, j);
+      iov[n].iov_base = this->vector->content + range->offset;
+      iov[n].iov_len = range->length;
+      stats->bytes_written += range->length;
+    }
+    ok = io_writev_all(fd, iov, n);
+  }
+
+  ok = ok && fdatasync(fd) == 0;
+  return close(fd) == 0 && ok;
+}
+
+static bool checkpoint_write_manifest(
+  Checkpoint*      this,
+  CheckpointStats* stats
+) {
+  char path[PATH_MAX];
+  char temporary[PATH_MAX];
+  if (
+    snprintf(path, sizeof(path), "%s/manifest", this->directory)
+      >= (int)sizeof(path) ||
+    snprintf(temporary, sizeof(temporary), "%s/manifest.tmp", this->directory)
+      >= (int)sizeof(temporary)
+  ) {
+    return false;
+  }
+
+  CheckpointManifest manifest = {
+    .version     = CHECKPOINT_VERSION,
+    .header_size = sizeof(CheckpointManifest),
+    .object_size = this->vector->object_size,
+    .first       = this->first,
+    .deltas      = this->sequence + 1 - this->first,
+  };
+  memcpy(manifest.magic, CHECKPOINT_MANIFEST_MAGIC, sizeof(manifest.magic));
+
+  int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  bool ok = io_write_all(fd, &manifest, sizeof(manifest))
+    && fdatasync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  stats->bytes_written += sizeof(manifest);
+
+  // Replace the manifest atomically, then persist the rename
+  if (!ok || rename(temporary, path) != 0) {
+    return false;
+  }
+
+  int dir = open(this->directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+
+  return true;
+}
+
+bool checkpoint_write(Checkpoint* this, CheckpointStats* stats) {
+  CheckpointStats local = { .sequence = this->sequence };
+  Vector* ranges = vector_construct(
+    sizeof(CheckpointRange),
+    (VectorOptions){}
+  );
+  if (ranges == nullptr) {
+    return false;
+  }
+
+  vector_settle(this->vector);
+  VectorDirty* dirty = this->vector->dirty;
+  const usize end = this->vector->count * this->vector->object_size;
+
+  char path[PATH_MAX];
+  bool ok = checkpoint_delta_path(path, this->directory, this->sequence)
+    && checkpoint_ranges(dirty, end, ranges)
+    && checkpoint_write_delta(this, path, ranges, &local)
+    && checkpoint_write_manifest(this, &local);
+
+  if (ok) {
+    local.count = this->vector->count;
+    local.ranges = vector_empty(ranges) ? 0 : ranges->count;
+    this->sequence++;
+
+    // Start tracking the next checkpoint
+    if (dirty->bits != nullptr) {
+      memset(dirty->bits, 0, (dirty->chunks + 63) / 64 * sizeof(u64));
+    }
+    dirty->all = false;
+
+    // The manifest no longer lists the deltas it was found with
+    for (; this->stale < this->first; this->stale++) {
+      if (checkpoint_delta_path(path, this->directory, this->stale)) {
+        unlink(path);
+      }
+    }
+  }
+
+  if (stats != nullptr) {
+    *stats = local;
+  }
+
+  vector_destruct(ranges);
+  return ok;
+}
+
+// Applies one delta file onto the Vector
+static bool checkpoint_apply(
+  Vector*     vector,
+  const char* path,
+  const u64   sequence
+) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  CheckpointDelta header;
+  Vector* ranges = nullptr;
+  bool ok = io_read_all(fd, &header, sizeof(header))
+    && memcmp(header.magic, CHECKPOINT_DELTA_MAGIC, sizeof(header.magic)) == 0
+    && header.version == CHECKPOINT_VERSION
+    && header.header_size == sizeof(CheckpointDelta)
+    && header.sequence == sequence;
+
+  // Make room for the objects of the checkpoint
+  if (ok && header.count > vector->capacity) {
+    ok = vector_grow(vector, header.count - vector->capacity);
+  }
+
+  if (ok && header.ranges > 0) {
+    ranges = vector_construct(
+      sizeof(CheckpointRange),
+      (VectorOptions){ .capacity = header.ranges }
+    );
+    ok = ranges != nullptr && io_read_all(
+      fd, ranges->content, header.ranges * sizeof(CheckpointRange)
+    );
+  }
+
+  const usize end = header.count * vector->object_size;
+  for (usize i = 0; ok && i < header.ranges; i++) {
+    CheckpointRange* range = (CheckpointRange*)ranges->content + i;
+    ok = range->offset <= end && range->length <= end - range->offset
+      && io_read_all(fd, vector->content + range->offset, range->length);
+  }
+
+  if (ok) {
+    vector->count = header.count;
+  }
+
+  vector_destruct(ranges);
+  close(fd);
+  return ok;
+}
+
+Vector* checkpoint_restore(const char* directory) {
+  CheckpointManifest manifest;
+  if (!checkpoint_read_manifest(directory, &manifest)) {
+    return nullptr;
+  }
+
+  Vector* vector = vector_construct(manifest.object_size, (VectorOptions){});
+  if (vector == nullptr) {
+    return nullptr;
+  }
+
+  // Replay the deltas in order
+  const u64 end = manifest.first + manifest.deltas;
+  for (u64 sequence = manifest.first; sequence < end; sequence++) {
+    char path[PATH_MAX];
+    if (
+      !checkpoint_delta_path(path, directory, sequence) ||
+      !checkpoint_apply(vector, path, sequence)
+    ) {
+      vector_destruct(vector);
+      return nullptr;
+    }
+  }
+
+  return vector;
+}
\ No newline at end of file
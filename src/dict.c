@@ -0,0 +1,547 @@
+#define _GNU_SOURCE
+#include "castor/dict.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "vector_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// Sets with up to this many codes are compared lane by lane, larger ones
+// go through a membership bitmap
+#define DICT_SIMD_SET 8
+
+
+// Member:
+// - offset:
+//    Offset of the value in the arena.
+// - length:
+//    Length of the value in bytes.
+// - hash:
+//    Hash of the value, kept to rehash the table.
+typedef struct DictEntry {
+  usize offset;
+  usize length;
+  u64   hash;
+} DictEntry;
+
+// Member:
+// - codes:
+//    Vector of u8, u16 or u32, the code of each row.
+// - entries:
+//    Vector of DictEntry, indexed by code.
+// - arena:
+//    Vector of u8, the bytes of the values.
+// - table:
+//    Vector of u32, the hash table from values to codes. A slot holds the
+//    code plus one, or 0 when empty. The size is a power of two.
+struct DictVector {
+  Vector* codes;
+  Vector* entries;
+  Vector* arena;
+  Vector* table;
+};
+
+
+// FNV-1a
+static u64 dict_hash(const void* value, const usize length) {
+  const u8* bytes = value;
+  u64 hash = 0xcbf29ce484222325ull;
+  for (usize i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static bool dict_table_resize(DictVector* this, const usize slots) {
+  Vector* table = vector_construct(
+    sizeof(u32),
+    (VectorOptions){ .capacity = slots }
+  );
+  if (table == nullptr) {
+    return false;
+  }
+
+  table->count = slots;
+  memset(table->content, 0, slots * sizeof(u32));
+
+  u32* buckets = (u32*)table->content;
+  const DictEntry* entries = (DictEntry*)this->entries->content;
+  for (usize code = 0; code < this->entries->count; code++) {
+    usize slot = entries[code].hash & (slots - 1);
+    while (buckets[slot] != 0) {
+      slot = (slot + 1) & (slots - 1);
+    }
+    buckets[slot] = (u32)code + 1;
+  }
+
+  vector_destruct(this->table);
+  this->table = table;
+  return true;
+}
+
+DictVector* dict_vector_construct(const DictVectorOptions options) {
+  DictVector* this = calloc(1, sizeof(DictVector));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->codes = vector_construct(
+    sizeof(u8),
+    (VectorOptions){ .capacity = options.capacity }
+  );
+  this->entries = vector_construct(
+    sizeof(DictEntry),
+    (VectorOptions){ .capacity = options.cardinality }
+  );
+  this->arena = vector_construct(
+    sizeof(u8),
+    (VectorOptions){ .capacity = 4096 }
+  );
+
+  // Keep the table at most half full
+  usize slots = 16;
+  while (slots < options.cardinality * 2) {
+    slots *= 2;
+  }
+
+  if (
+    this->codes == nullptr || this->entries == nullptr ||
+    this->arena == nullptr || !dict_table_resize(this, slots)
+  ) {
+    dict_vector_destruct(this);
+    return nullptr;
+  }
+
+  return this;
+}
+
+void dict_vector_destruct(DictVector* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  vector_destruct(this->codes);
+  vector_destruct(this->entries);
+  vector_destruct(this->arena);
+  vector_destruct(this->table);
+  free(this);
+}
+
+static const u8* dict_entry_value(const DictVector* this, const u32 code) {
+  const DictEntry* entry = (DictEntry*)this->entries->content + code;
+  return this->arena->content + entry->offset;
+}
+
+bool dict_vector_find(
+  const DictVector* this,
+  const void*       value,
+  const usize       length,
+  u32*              code
+) {
+  const u64 hash = dict_hash(value, length);
+  const u32* buckets = (u32*)this->table->content;
+  const usize mask = this->table->count - 1;
+  const DictEntry* entries = (DictEntry*)this->entries->content;
+
+  for (usize slot = hash & mask; buckets[slot] != 0;) {
+    const u32 candidate = buckets[slot] - 1;
+    const DictEntry* entry = &entries[candidate];
+    if (
+      entry->hash == hash && entry->length == length &&
+      memcmp(dict_entry_value(this, candidate), value, length) == 0
+    ) {
+      *code = candidate;
+      return true;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  return false;
+}
+
+// Re-encodes the rows with codes of the given size
+static bool dict_widen(DictVector* this, const usize code_size) {
+  Vector* codes = vector_construct(
+    code_size,
+    (VectorOptions){ .capacity = this->codes->capacity }
+  );
+  if (codes == nullptr) {
+    return false;
+  }
+
+  const usize count = this->codes->count;
+  const u8* content = this->codes->content;
+  if (code_size == sizeof(u16)) {
+    u16* out = (u16*)codes->content;
+    for (usize i = 0; i < count; i++) {
+      out[i] = content[i];
+    }
+  } else {
+    u32* out = (u32*)codes->content;
+    const u16* in = (const u16*)content;
+    for (usize i = 0; i < count; i++) {
+      out[i] = in[i];
+    }
+  }
+
+  codes->count = count;
+  vector_destruct(this->codes);
+  this->codes = codes;
+  return true;
+}
+
+// Returns the code of the value, adding it to the dictionary if needed
+static bool dict_intern(
+  DictVector* this,
+  const void* value,
+  const usize length,
+  u32*        code
+) {
+  if (dict_vector_find(this, value, length, code)) {
+    return true;
+  }
+
+  const usize cardinality = this->entries->count;
+  if (cardinality == (usize)UINT32_MAX) {
+    return false;
+  }
+
+  // Widen the codes when the new one does not fit
+  const usize code_size = this->codes->object_size;
+  if (
+    (code_size == sizeof(u8) && cardinality == 1u << 8 &&
+      !dict_widen(this, sizeof(u16))) ||
+    (code_size == sizeof(u16) && cardinality == 1u << 16 &&
+      !dict_widen(this, sizeof(u32)))
+  ) {
+    return false;
+  }
+
+  if ((cardinality + 1) * 2 > this->table->count) {
+    if (!dict_table_resize(this, this->table->count * 2)) {
+      return false;
+    }
+  }
+
+  // Copy the value into the arena
+  Vector* arena = this->arena;
+  while (arena->capacity - arena->count < length) {
+    if (!vector_grow(arena, arena->capacity)) {
+      return false;
+    }
+  }
+
+  DictEntry entry = {
+    .offset = arena->count,
+    .length = length,
+    .hash   = dict_hash(value, length),
+  };
+  if (!vector_push_back(this->entries, &entry)) {
+    return false;
+  }
+  if (length > 0) {
+    memcpy(arena->content + arena->count, value, length);
+  }
+  arena->count += length;
+
+  u32* buckets = (u32*)this->table->content;
+  const usize mask = this->table->count - 1;
+  usize slot = entry.hash & mask;
+  while (buckets[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  buckets[slot] = (u32)cardinality + 1;
+
+  *code = (u32)cardinality;
+  return true;
+}
+
+static void dict_store(DictVector* this, const usize index, const u32 code) {
+  u8* dest = this->codes->content + index * this->codes->object_size;
+  switch (this->codes->object_size) {
+    case sizeof(u8):
+      *dest = (u8)code;
+      break;
+    case sizeof(u16):
+      *(u16*)dest = (u16)code;
+      break;
+    default:
+      *(u32*)dest = code;
+      break;
+  }
+}
+
+bool dict_vector_push_back(
+  DictVector* this,
+  const void* value,
+  const usize length
+) {
+  u32 code;
+  if (!dict_intern(this, value, length, &code)) {
+    return false;
+  }
+
+  u32 zero = 0;
+  if (!vector_push_back(this->codes, &zero)) {
+    return false;
+  }
+
+  dict_store(this, this->codes->count - 1, code);
+  return true;
+}
+
+bool dict_vector_set(
+  DictVector* this,
+  const usize index,
+  const void* value,
+  const usize length
+) {
+  u32 code;
+  if (index >= this->codes->count) {
+    return false;
+  }
+  if (!dict_intern(this, value, length, &code)) {
+    return false;
+  }
+
+  dict_store(this, index, code);
+  return true;
+}
+
+usize dict_vector_count(const DictVector* this) {
+  return this->codes->count;
+}
+
+usize dict_vector_cardinality(const DictVector* this) {
+  return this->entries->count;
+}
+
+usize dict_vector_code_size(const DictVector* this) {
+  return this->codes->object_size;
+}
+
+// Returns the code of a row in range
+static u32 dict_code(const DictVector* this, const usize index) {
+  const u8* code = this->codes->content + index * this->codes->object_size;
+  switch (this->codes->object_size) {
+    case sizeof(u8):
+      return *code;
+    case sizeof(u16):
+      return *(const u16*)code;
+    default:
+      return *(const u32*)code;
+  }
+}
+
+u32 dict_vector_code(const DictVector* this, const usize index) {
+  if (index >= this->codes->count) {
+    return DICT_VECTOR_NO_CODE;
+  }
+  return dict_code(this, index);
+}
+
+const void* dict_vector_value(
+  const DictVector* this,
+  const u32         code,
+  usize*            length
+) {
+  if (code >= this->entries->count) {
+    return nullptr;
+  }
+
+  *length = ((DictEntry*)this->entries->content)[code].length;
+  return dict_entry_value(this, code);
+}
+
+const void* dict_vector_get(
+  const DictVector* this,
+  const usize       index,
+  usize*            length
+) {
+  if (index >= this->codes->count) {
+    return nullptr;
+  }
+  return dict_vector_value(this, dict_code(this, index), length);
+}
+
+// The codes of a predicate: either a few codes compared lane by lane, or a
+// membership bitmap over the whole dictionary
+typedef struct DictSet {
+  u32        codes[DICT_SIMD_SET];
+  usize      count;
+  const u64* members;
+} DictSet;
+
+// Returns the bits of the rows in [first, first + n) that are in the set,
+// n being at most 64
+static u64 dict_match(
+  const DictVector* this,
+  const DictSet*    set,
+  const usize       first,
+  const usize       n
+) {
+  u64 bits = 0;
+  usize i = 0;
+
+#if defined(__SSE2__)
+  if (set->members == nullptr && n == 64) {
+    const u8* content = this->codes->content;
+    const usize code_size = this->codes->object_size;
+    const __m128i* in = (const __m128i*)(content + first * code_size);
+
+    // Broadcast each code to every lane
+    __m128i targets[DICT_SIMD_SET];
+    for (usize c = 0; c < set->count; c++) {
+      const u32 code = set->codes[c];
+      targets[c] = code_size == sizeof(u8) ? _mm_set1_epi8((char)code)
+        : code_size == sizeof(u16) ? _mm_set1_epi16((short)code)
+        : _mm_set1_epi32((int)code);
+    }
+
+    // Each 128-bit load covers 16, 8 or 4 rows depending on the code size
+    const usize rows = 16 / code_size;
+    for (usize k = 0; k < 64 / rows; k++) {
+      const __m128i v = _mm_loadu_si128(in + k);
+      __m128i match = _mm_setzero_si128();
+
+      for (usize c = 0; c < set->count; c++) {
+        const __m128i equal = code_size == sizeof(u8)
+          ? _mm_cmpeq_epi8(v, targets[c])
+          : code_size == sizeof(u16)
+            ? _mm_cmpeq_epi16(v, targets[c])
+            : _mm_cmpeq_epi32(v, targets[c]);
+        match = _mm_or_si128(match, equal);
+      }
+
+      u64 mask;
+      switch (code_size) {
+        case sizeof(u8):
+          mask = (u16)_mm_movemask_epi8(match);
+          break;
+        case sizeof(u16):
+          // Narrow the 16-bit lanes to bytes to get one bit per row
+          mask = (u8)_mm_movemask_epi8(_mm_packs_epi16(match, match));
+          break;
+        default:
+          mask = (u64)_mm_movemask_ps(_mm_castsi128_ps(match));
+          break;
+      }
+      bits |= mask << (k * rows);
+    }
+
+    return bits;
+  }
+#endif
+
+  for (; i < n; i++) {
+    const u32 code = dict_code(this, first + i);
+    bool match = false;
+    if (set->members != nullptr) {
+      match = (set->members[code / 64] >> (code % 64)) & 1;
+    } else {
+      for (usize c = 0; c < set->count; c++) {
+        match |= set->codes[c] == code;
+      }
+    }
+    bits |= (u64)match << i;
+  }
+
+  return bits;
+}
+
+static usize dict_evaluate(
+  const DictVector* this,
+  const DictSet*    set,
+  Vector*           bitmap
+) {
+  const usize count = this->codes->count;
+  const usize words = (count + 63) / 64;
+
+  // A bitmap of the wrong size is left as it is
+  if (bitmap->object_size != sizeof(u64)) {
+    return (usize)-1;
+  }
+  vector_reset(bitmap);
+  if (
+    bitmap->capacity < words &&
+    !vector_grow(bitmap, words - bitmap->capacity)
+  ) {
+    return (usize)-1;
+  }
+
+  u64* out = (u64*)bitmap->content;
+  usize matches = 0;
+  for (usize w = 0; w < words; w++) {
+    const usize first = w * 64;
+    const usize n = count - first < 64 ? count - first : 64;
+    // Nothing can match an empty set
+    out[w] = set->count > 0 || set->members != nullptr
+      ? dict_match(this, set, first, n)
+      : 0;
+    matches += (usize)__builtin_popcountll(out[w]);
+  }
+
+  bitmap->count = words;
+  vector_dirty_mark(bitmap, 0, words);
+  return matches;
+}
+
+usize dict_vector_equals(
+  const DictVector* this,
+  const void*       value,
+  const usize       length,
+  Vector*           bitmap
+) {
+  DictSet set = {};
+  if (dict_vector_find(this, value, length, &set.codes[0])) {
+    set.count = 1;
+  }
+
+  return dict_evaluate(this, &set, bitmap);
+}
+
+usize dict_vector_in(
+  const DictVector* this,
+  const DictKey*    values,
+  const usize       count,
+  Vector*           bitmap
+) {
+  DictSet set = {};
+  u64* members = nullptr;
+
+  for (usize i = 0; i < count; i++) {
+    u32 code;
+    if (!dict_vector_find(this, values[i].data, values[i].length, &code)) {
+      continue;
+    }
+
+    if (members != nullptr) {
+      members[code / 64] |= 1ull << (code % 64);
+      continue;
+    }
+    if (set.count < DICT_SIMD_SET) {
+      set.codes[set.count++] = code;
+      continue;
+    }
+
+    // Too many codes to compare lane by lane
+    members = calloc((this->entries->count + 63) / 64, sizeof(u64));
+    if (members == nullptr) {
+      return (usize)-1;
+    }
+    for (usize c = 0; c < set.count; c++) {
+      members[set.codes[c] / 64] |= 1ull << (set.codes[c] % 64);
+    }
+    members[code / 64] |= 1ull << (code % 64);
+  }
+
+  set.members = members;
+  const usize matches = dict_evaluate(this, &set, bitmap);
+  free(members);
+  return matches;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#define _GNU_SOURCE
+#include "castor/dispatch.h"
+#include "castor/types.h"
+#include "dispatch_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static const char* castor_isa_names[CASTOR_ISAS] = {
+  [CASTOR_ISA_SCALAR] = "scalar",
+  [CASTOR_ISA_SSE42]  = "sse4.2",
+  [CASTOR_ISA_AVX2]   = "avx2",
+  [CASTOR_ISA_AVX512] = "avx512",
+};
+
+// The scalar kernels until the level is chosen, so that the constructors
+// of other libraries can use Vectors
+const CastorKernels* castor_kernels = &castor_kernels_isa[CASTOR_ISA_SCALAR];
+
+static CastorIsa castor_isa_chosen = CASTOR_ISA_SCALAR;
+
+
+CastorIsa castor_isa_detected(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (
+    __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+  ) {
+    return CASTOR_ISA_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return CASTOR_ISA_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return CASTOR_ISA_SSE42;
+  }
+#endif
+  return CASTOR_ISA_SCALAR;
+}
+
+CastorIsa castor_isa(void) {
+  return castor_isa_chosen;
+}
+
+const char* castor_isa_name(const CastorIsa isa) {
+  return isa < CASTOR_ISAS ? castor_isa_names[isa] : "unknown";
+}
+
+// Chooses the level before main, from the CPU and CASTOR_ISA
+[[gnu::constructor]]
+static void castor_dispatch_init(void) {
+  CastorIsa isa = castor_isa_detected();
+
+  const char* forced = getenv("CASTOR_ISA");
+  if (forced != nullptr) {
+    for (CastorIsa i = CASTOR_ISA_SCALAR; i < isa; i++) {
+      if (strcmp(forced, castor_isa_names[i]) == 0) {
+        isa = i;
+        break;
+      }
+    }
+  }
+
+  castor_isa_chosen = isa;
+  castor_kernels = &castor_kernels_isa[isa];
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "castor/dispatch.h"
+#include "castor/types.h"
+
+
+// CastorKernels holds the implementations of the kernels for a level.
+typedef struct CastorKernels CastorKernels;
+
+
+// Member:
+// - move:
+//    Moves bytes between overlapping ranges, as memmove.
+// - stream:
+//    Copies bytes between ranges that do not overlap, as memcpy, with
+//    non-temporal stores that bypass the cache.
+// - find:
+//    Returns the index of the first of the count objects of object_size
+//    bytes at content equal to object, or count if none is.
+struct CastorKernels {
+  void* (*move)(void* dst, const void* src, usize bytes);
+  void  (*stream)(void* dst, const void* src, const usize bytes);
+  usize (*find)(
+    const u8*   content,
+    const usize count,
+    const usize object_size,
+    const void* object
+  );
+};
+
+
+// The kernels of the level chosen at load time.
+extern const CastorKernels* castor_kernels;
+
+// The kernels of each level, from kernels.c. Those of a level the target
+// does not have are the scalar ones.
+extern const CastorKernels castor_kernels_isa[CASTOR_ISAS];
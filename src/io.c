@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+#include "io_internal.h"
+#include "castor/types.h"
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+
+bool io_writev_all(int fd, struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    // The kernel accepts at most IOV_MAX buffers per call
+    ssize_t written = writev(fd, iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+
+    // Skip the buffers that were completely written
+    usize remaining = (usize)written;
+    while (iovcnt > 0 && remaining >= iov->iov_len) {
+      remaining -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (u8*)iov->iov_base + remaining;
+      iov->iov_len -= remaining;
+    }
+  }
+
+  return true;
+}
+
+bool io_write_all(int fd, const void* data, const usize length) {
+  const u8* bytes = data;
+  usize done = 0;
+
+  while (done < length) {
+    ssize_t written = write(fd, bytes + done, length - done);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += (usize)written;
+  }
+
+  return true;
+}
+
+bool io_pwrite_all(
+  int         fd,
+  const void* data,
+  const usize length,
+  off_t       offset
+) {
+  const u8* bytes = data;
+  usize done = 0;
+
+  while (done < length) {
+    ssize_t written = pwrite(
+      fd, bytes + done, length - done, offset + (off_t)done
+    );
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += (usize)written;
+  }
+
+  return true;
+}
+
+bool io_read_all(int fd, void* data, const usize length) {
+  u8* bytes = data;
+  usize done = 0;
+
+  while (done < length) {
+    ssize_t read_bytes = read(fd, bytes + done, length - done);
+    if (read_bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    // Unexpected end of file
+    if (read_bytes == 0) {
+      return false;
+    }
+    done += (usize)read_bytes;
+  }
+
+  return true;
+}
+
+bool io_pread_all(int fd, void* data, const usize length, off_t offset) {
+  u8* bytes = data;
+  usize done = 0;
+
+  while (done < length) {
+    ssize_t read_bytes = pread(
+      fd, bytes + done, length - done, offset + (off_t)done
+    );
+    if (read_bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (read_bytes == 0) {
+      return false;
+    }
+    done += (usize)read_bytes;
+  }
+
+  return true;
+}
+
+usize io_varint_encode(u8* bytes, u64 value) {
+  usize length = 0;
+
+  // Seven bits per byte, the high bit tells whether more bytes follow
+  while (value >= 0x80) {
+    bytes[length++] = (u8)(value | 0x80);
+    value >>= 7;
+  }
+  bytes[length++] = (u8)value;
+
+  return length;
+}
+
+bool io_varint_decode(bool (*next)(void*, u8*), void* context, u64* value) {
+  *value = 0;
+
+  for (usize i = 0; i < IO_VARINT_MAX; i++) {
+    u8 byte;
+    if (!next(context, &byte)) {
+      return false;
+    }
+    *value |= (u64)(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+
+  // Too long to be a u64
+  return false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "castor/types.h"
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+// Helpers shared by the modules that persist vectors to files.
+// They resume after partial transfers and EINTR, and return false on any
+// other error or on an unexpected end of file.
+
+
+// Maximum size of a varint encoding a u64
+#define IO_VARINT_MAX 10
+
+
+// Writes all the buffers. The iovec array is modified.
+bool io_writev_all(int fd, struct iovec* iov, int iovcnt);
+
+// Writes length bytes from data.
+bool io_write_all(int fd, const void* data, const usize length);
+
+// Reads exactly length bytes into data.
+bool io_read_all(int fd, void* data, const usize length);
+
+// Writes length bytes from data, starting at the given file offset.
+bool io_pwrite_all(int fd, const void* data, const usize length, off_t offset);
+
+// Reads exactly length bytes into data, starting at the given file offset.
+bool io_pread_all(int fd, void* data, const usize length, off_t offset);
+
+// Encodes value as a varint into bytes, which must hold IO_VARINT_MAX
+// bytes. Returns its size.
+usize io_varint_encode(u8* bytes, u64 value);
+
+// Decodes a varint from the bytes returned one at a time by next, which
+// returns false at the end of the input. Returns false at the end of the
+// input, or if the varint is too long to be a u64.
+bool io_varint_decode(bool (*next)(void*, u8*), void* context, u64* value);
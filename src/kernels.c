@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include "castor/types.h"
+#include "dispatch_internal.h"
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+// The moves of every level are memmove: the C library already picks its
+// implementation for the CPU, and beats a loop of vector loads and stores
+// on the sizes and overlaps of the shifts of a Vector.
+
+// Objects of 2, 4 or 8 bytes are compared as lanes of a vector register.
+// Bytes are searched with memchr, and the other sizes with memcmp, at
+// every level.
+static bool find_lanes(const usize object_size) {
+  return object_size == 2 || object_size == 4 || object_size == 8;
+}
+
+// Compares the objects as words of the given type
+#define FIND_WORDS(type)                                                      \
+  do {                                                                        \
+    type needle;                                                              \
+    memcpy(&needle, object, sizeof(type));                                    \
+    for (usize i = 0; i < count; i++) {                                       \
+      type value;                                                             \
+      memcpy(&value, content + i * sizeof(type), sizeof(type));               \
+      if (value == needle) {                                                  \
+        return i;                                                             \
+      }                                                                       \
+    }                                                                         \
+    return count;                                                             \
+  } while (0)
+
+static usize find_scalar(
+  const u8*   content,
+  const usize count,
+  const usize object_size,
+  const void* object
+) {
+  switch (object_size) {
+  case 1: {
+    // memchr is already picked for the CPU by the C library
+    const u8* found = memchr(content, *(const u8*)object, count);
+    return found != nullptr ? (usize)(found - content) : count;
+  }
+  case 2:
+    FIND_WORDS(u16);
+  case 4:
+    FIND_WORDS(u32);
+  case 8:
+    FIND_WORDS(u64);
+  default:
+    break;
+  }
+
+  // Compare the first word before calling memcmp
+  if (object_size >= sizeof(u64)) {
+    u64 needle;
+    memcpy(&needle, object, sizeof(u64));
+    for (usize i = 0; i < count; i++) {
+      const u8* other = content + i * object_size;
+      u64 value;
+      memcpy(&value, other, sizeof(u64));
+      if (value == needle && memcmp(other, object, object_size) == 0) {
+        return i;
+      }
+    }
+    return count;
+  }
+
+  for (usize i = 0; i < count; i++) {
+    if (memcmp(content + i * object_size, object, object_size) == 0) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// The scalar level has no non-temporal stores
+static void stream_scalar(void* dst, const void* src, const usize bytes) {
+  memcpy(dst, src, bytes);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Copies with non-temporal stores of a vector register at a time: the head
+// up to the first aligned address of the destination and the tail are
+// copied by memcpy, and a fence orders the stores with the following ones.
+// Four registers are moved per iteration to keep the write-combining
+// buffers full.
+#define STREAM_BLOCKS(type, load, store, fence)                               \
+  do {                                                                        \
+    u8* to = dst;                                                             \
+    const u8* from = src;                                                     \
+    const usize head = (usize)(-(uintptr_t)to & (sizeof(type) - 1));          \
+    if (bytes < head + 4 * sizeof(type)) {                                    \
+      memcpy(to, from, bytes);                                                \
+      return;                                                                 \
+    }                                                                         \
+    memcpy(to, from, head);                                                   \
+    usize offset = head;                                                      \
+    for (; offset + 4 * sizeof(type) <= bytes; offset += 4 * sizeof(type)) {  \
+      const type* in = (const type*)(from + offset);                          \
+      type* out = (type*)(to + offset);                                       \
+      const type a = load(in);                                                \
+      const type b = load(in + 1);                                            \
+      const type c = load(in + 2);                                            \
+      const type d = load(in + 3);                                            \
+      store(out, a);                                                          \
+      store(out + 1, b);                                                      \
+      store(out + 2, c);                                                      \
+      store(out + 3, d);                                                      \
+    }                                                                         \
+    fence();                                                                  \
+    memcpy(to + offset, from + offset, bytes - offset);                       \
+  } while (0)
+
+[[gnu::target("sse4.2")]]
+static void stream_sse42(void* dst, const void* src, const usize bytes) {
+  STREAM_BLOCKS(__m128i, _mm_loadu_si128, _mm_stream_si128, _mm_sfence);
+}
+
+[[gnu::target("avx2")]]
+static void stream_avx2(void* dst, const void* src, const usize bytes) {
+  STREAM_BLOCKS(
+    __m256i, _mm256_loadu_si256, _mm256_stream_si256, _mm_sfence
+  );
+}
+
+[[gnu::target("avx512f,avx512bw")]]
+static void stream_avx512(void* dst, const void* src, const usize bytes) {
+  STREAM_BLOCKS(
+    __m512i, _mm512_loadu_si512, _mm512_stream_si512, _mm_sfence
+  );
+}
+
+// Scans the content a vector register at a time. The mask of the equal
+// bytes of a block is computed by EQUAL from the block and the needle, and
+// gives the index of the first equal lane. The objects after the last full
+// block are left to find_scalar.
+#define FIND_BLOCKS(type, load, equal, byte_mask)                             \
+  do {                                                                        \
+    const usize bytes = count * object_size;                                  \
+    usize offset = 0;                                                         \
+    for (; offset + sizeof(type) <= bytes; offset += sizeof(type)) {          \
+      const type block = load((const type*)(content + offset));               \
+      const u64 mask = equal(block, needle);                                  \
+      if (mask != 0) {                                                        \
+        return (offset + (byte_mask                                           \
+          ? (usize)__builtin_ctzll(mask)                                      \
+          : (usize)__builtin_ctzll(mask) * object_size)) / object_size;       \
+      }                                                                       \
+    }                                                                         \
+    return offset / object_size + find_scalar(                                \
+      content + offset, count - offset / object_size, object_size, object     \
+    );                                                                        \
+  } while (0)
+
+#define SSE_EQUAL(a, b, bits) \
+  ((u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi##bits(a, b)))
+#define SSE_EQUAL_16(a, b) SSE_EQUAL(a, b, 16)
+#define SSE_EQUAL_32(a, b) SSE_EQUAL(a, b, 32)
+#define SSE_EQUAL_64(a, b) SSE_EQUAL(a, b, 64)
+
+[[gnu::target("sse4.2")]]
+static usize find_sse42(
+  const u8*   content,
+  const usize count,
+  const usize object_size,
+  const void* object
+) {
+  u64 value = 0;
+  memcpy(&value, object, find_lanes(object_size) ? object_size : 0);
+
+  switch (object_size) {
+  case 2: {
+    const __m128i needle = _mm_set1_epi16((short)value);
+    FIND_BLOCKS(__m128i, _mm_loadu_si128, SSE_EQUAL_16, true);
+  }
+  case 4: {
+    const __m128i needle = _mm_set1_epi32((int)value);
+    FIND_BLOCKS(__m128i, _mm_loadu_si128, SSE_EQUAL_32, true);
+  }
+  case 8: {
+    const __m128i needle = _mm_set1_epi64x((long long)value);
+    FIND_BLOCKS(__m128i, _mm_loadu_si128, SSE_EQUAL_64, true);
+  }
+  default:
+    return find_scalar(content, count, object_size, object);
+  }
+}
+
+#define AVX2_EQUAL(a, b, bits) \
+  ((u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi##bits(a, b)))
+#define AVX2_EQUAL_16(a, b) AVX2_EQUAL(a, b, 16)
+#define AVX2_EQUAL_32(a, b) AVX2_EQUAL(a, b, 32)
+#define AVX2_EQUAL_64(a, b) AVX2_EQUAL(a, b, 64)
+
+[[gnu::target("avx2")]]
+static usize find_avx2(
+  const u8*   content,
+  const usize count,
+  const usize object_size,
+  const void* object
+) {
+  u64 value = 0;
+  memcpy(&value, object, find_lanes(object_size) ? object_size : 0);
+
+  switch (object_size) {
+  case 2: {
+    const __m256i needle = _mm256_set1_epi16((short)value);
+    FIND_BLOCKS(__m256i, _mm256_loadu_si256, AVX2_EQUAL_16, true);
+  }
+  case 4: {
+    const __m256i needle = _mm256_set1_epi32((int)value);
+    FIND_BLOCKS(__m256i, _mm256_loadu_si256, AVX2_EQUAL_32, true);
+  }
+  case 8: {
+    const __m256i needle = _mm256_set1_epi64x((long long)value);
+    FIND_BLOCKS(__m256i, _mm256_loadu_si256, AVX2_EQUAL_64, true);
+  }
+  default:
+    return find_scalar(content, count, object_size, object);
+  }
+}
+
+// The masks of AVX-512 have a bit per lane rather than per byte
+#define AVX512_EQUAL_16(a, b) ((u64)_mm512_cmpeq_epi16_mask(a, b))
+#define AVX512_EQUAL_32(a, b) ((u64)_mm512_cmpeq_epi32_mask(a, b))
+#define AVX512_EQUAL_64(a, b) ((u64)_mm512_cmpeq_epi64_mask(a, b))
+
+[[gnu::target("avx512f,avx512bw")]]
+static usize find_avx512(
+  const u8*   content,
+  const usize count,
+  const usize object_size,
+  const void* object
+) {
+  u64 value = 0;
+  memcpy(&value, object, find_lanes(object_size) ? object_size : 0);
+
+  switch (object_size) {
+  case 2: {
+    const __m512i needle = _mm512_set1_epi16((short)value);
+    FIND_BLOCKS(__m512i, _mm512_loadu_si512, AVX512_EQUAL_16, false);
+  }
+  case 4: {
+    const __m512i needle = _mm512_set1_epi32((int)value);
+    FIND_BLOCKS(__m512i, _mm512_loadu_si512, AVX512_EQUAL_32, false);
+  }
+  case 8: {
+    const __m512i needle = _mm512_set1_epi64((long long)value);
+    FIND_BLOCKS(__m512i, _mm512_loadu_si512, AVX512_EQUAL_64, false);
+  }
+  default:
+    return find_scalar(content, count, object_size, object);
+  }
+}
+
+const CastorKernels castor_kernels_isa[CASTOR_ISAS] = {
+  [CASTOR_ISA_SCALAR] = {
+    .move   = memmove,
+    .stream = stream_scalar,
+    .find   = find_scalar,
+  },
+  [CASTOR_ISA_SSE42] = {
+    .move   = memmove,
+    .stream = stream_sse42,
+    .find   = find_sse42,
+  },
+  [CASTOR_ISA_AVX2] = {
+    .move   = memmove,
+    .stream = stream_avx2,
+    .find   = find_avx2,
+  },
+  [CASTOR_ISA_AVX512] = {
+    .move   = memmove,
+    .stream = stream_avx512,
+    .find   = find_avx512,
+  },
+};
+
+#else
+
+const CastorKernels castor_kernels_isa[CASTOR_ISAS] = {
+  [CASTOR_ISA_SCALAR] = {
+    .move   = memmove,
+    .stream = stream_scalar,
+    .find   = find_scalar,
+  },
+  [CASTOR_ISA_SSE42] = {
+    .move   = memmove,
+    .stream = stream_scalar,
+    .find   = find_scalar,
+  },
+  [CASTOR_ISA_AVX2] = {
+    .move   = memmove,
+    .stream = stream_scalar,
+    .find   = find_scalar,
+  },
+  [CASTOR_ISA_AVX512] = {
+    .move   = memmove,
+    .stream = stream_scalar,
+    .find   = find_scalar,
+  },
+};
+
+#endif
@@ -0,0 +1,1059 @@
+#define _GNU_SOURCE
+#include "castor/numeric.h"
+#include "castor/dispatch.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "bulk_internal.h"
+#include "vector_internal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Independent accumulators of the loops. The compiler turns them into
+// vector registers, four of them for f64 at the widest level, and the
+// result does not depend on the level.
+#define NUMERIC_LANES 32
+
+// Objects summed in lanes at the leaves of a pairwise sum
+#define NUMERIC_BLOCK 256
+
+// Objects of a block of a scan, held in a vector register or several
+#define NUMERIC_SCAN_LANES 8
+
+
+// A sum or a dot product as returned by the kernels: f64 for the floating
+// point types, the bits of the unsigned sum for the integer ones, so that
+// the sums of the parts of a call can be added.
+typedef union NumericValue {
+  f64 f;
+  u64 u;
+} NumericValue;
+
+// The kernels of a type at a level, over count contiguous objects. min and
+// max return count if every object is a NaN. histogram adds to the bins.
+// scan stores the exclusive prefix sums of the objects plus a carry, and
+// returns the carry plus their sum.
+typedef struct NumericKernels {
+  bool         real;
+  usize        size;
+  NumericValue (*sum)(const void*, const usize, const VectorSummation);
+  usize        (*min)(const void*, const usize);
+  usize        (*max)(const void*, const usize);
+  bool         (*less)(const void*, const void*);
+  f64          (*total)(const void*, const usize);
+  f64          (*deviation)(const void*, const usize, const f64 mean);
+  NumericValue (*dot)(const void*, const void*, const usize);
+  void         (*axpy)(void*, const void*, const usize, const f64 a);
+  void         (*scale)(void*, const usize, const f64 a);
+  void         (*add)(void*, const void*, const usize);
+  void         (*histogram)(
+    const void*, const usize, const f64 low, const f64 width, usize* bins,
+    const usize bin_count
+  );
+  NumericValue (*scan)(void*, const void*, const usize, const NumericValue);
+  void         (*store)(void*, const NumericValue);
+} NumericKernels;
+
+
+// Returns the first index of the extreme object of x, the one before the
+// others in the order of op, starting from the bound start. Each lane keeps
+// the first index of its own extreme. The objects equal to start are only
+// looked for when no lane moved; NaNs are never before another object.
+#define NUMERIC_EXTREME(T, op, start)                                         \
+  do {                                                                        \
+    T lanes[NUMERIC_LANES];                                                   \
+    usize indexes[NUMERIC_LANES];                                             \
+    for (usize j = 0; j < NUMERIC_LANES; j++) {                               \
+      lanes[j] = start;                                                       \
+      indexes[j] = n;                                                         \
+    }                                                                         \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_LANES <= n; i += NUMERIC_LANES) {                      \
+      for (usize j = 0; j < NUMERIC_LANES; j++) {                             \
+        const bool before = x[i + j] op lanes[j];                             \
+        lanes[j] = before ? x[i + j] : lanes[j];                              \
+        indexes[j] = before ? i + j : indexes[j];                             \
+      }                                                                       \
+    }                                                                         \
+    T best = start;                                                           \
+    usize index = n;                                                          \
+    for (; i < n; i++) {                                                      \
+      if (x[i] op best) {                                                     \
+        best = x[i];                                                          \
+        index = i;                                                            \
+      }                                                                       \
+    }                                                                         \
+    for (usize j = 0; j < NUMERIC_LANES; j++) {                               \
+      if (                                                                    \
+        lanes[j] op best || (lanes[j] == best && indexes[j] < index)          \
+      ) {                                                                     \
+        best = lanes[j];                                                      \
+        index = indexes[j];                                                   \
+      }                                                                       \
+    }                                                                         \
+    if (index == n) {                                                         \
+      for (index = 0; index < n && x[index] != start; index++) {}             \
+    }                                                                         \
+    return index;                                                             \
+  } while (0)
+
+// The loops of a type T, computed in U: the type itself for the floating
+// point types, its unsigned counterpart for the integer ones so that they
+// wrap around. Each loop runs NUMERIC_LANES independent accumulators, then
+// handles the objects left and adds up the lanes. They are inlined in the
+// kernels of each level, which compile them for its instruction set.
+#define NUMERIC_LOOPS(T, U, name, highest, lowest)                            \
+  [[gnu::always_inline]]                                                      \
+  static inline U sum_plain_##name(const T* x, const usize n) {               \
+    U lanes[NUMERIC_LANES] = {};                                              \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_LANES <= n; i += NUMERIC_LANES) {                      \
+      for (usize j = 0; j < NUMERIC_LANES; j++) {                             \
+        lanes[j] += (U)x[i + j];                                              \
+      }                                                                       \
+    }                                                                         \
+    U sum = 0;                                                                \
+    for (; i < n; i++) {                                                      \
+      sum += (U)x[i];                                                         \
+    }                                                                         \
+    for (usize j = 0; j < NUMERIC_LANES; j++) {                               \
+      sum += lanes[j];                                                        \
+    }                                                                         \
+    return sum;                                                               \
+  }                                                                           \
+                                                                              \
+  /* Each lane keeps the rounding error of its sum, and the lanes are      */ \
+  /* added up the same way                                                 */ \
+  [[gnu::always_inline]]                                                      \
+  static inline U sum_kahan_##name(const T* x, const usize n) {               \
+    U lanes[NUMERIC_LANES] = {};                                              \
+    U errors[NUMERIC_LANES] = {};                                             \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_LANES <= n; i += NUMERIC_LANES) {                      \
+      for (usize j = 0; j < NUMERIC_LANES; j++) {                             \
+        const U y = (U)x[i + j] - errors[j];                                  \
+        const U t = lanes[j] + y;                                             \
+        errors[j] = (t - lanes[j]) - y;                                       \
+        lanes[j] = t;                                                         \
+      }                                                                       \
+    }                                                                         \
+    U sum = 0;                                                                \
+    U error = 0;                                                              \
+    for (usize j = 0; j < NUMERIC_LANES * 2 + n - i; j++) {                   \
+      const U value = j < NUMERIC_LANES ? lanes[j]                            \
+        : j < NUMERIC_LANES * 2 ? -errors[j - NUMERIC_LANES]                  \
+        : (U)x[i + j - NUMERIC_LANES * 2];                                    \
+      const U y = value - error;                                              \
+      const U t = sum + y;                                                    \
+      error = (t - sum) - y;                                                  \
+      sum = t;                                                                \
+    }                                                                         \
+    return sum;                                                               \
+  }                                                                           \
+                                                                              \
+  [[gnu::always_inline]]                                                      \
+  static inline usize min_##name(const T* x, const usize n) {                 \
+    NUMERIC_EXTREME(T, <, highest);                                           \
+  }                                                                           \
+                                                                              \
+  [[gnu::always_inline]]                                                      \
+  static inline usize max_##name(const T* x, const usize n) {                 \
+    NUMERIC_EXTREME(T, >, lowest);                                            \
+  }                                                                           \
+                                                                              \
+  /* Exclusive prefix sums, NUMERIC_SCAN_LANES objects at a time: their    */ \
+  /* inclusive sums are made in register by adding the block shifted by 1, */ \
+  /* 2 and 4 lanes, then shifted once more and added to the carry. x may   */ \
+  /* be y.                                                                 */ \
+  typedef U NumericBlock_##name                                              \
+    [[gnu::vector_size(NUMERIC_SCAN_LANES * sizeof(U))]];                     \
+                                                                              \
+  [[gnu::always_inline]]                                                      \
+  static inline U scan_##name(T* y, const T* x, const usize n, U carry) {     \
+    const NumericBlock_##name zero = {};                                      \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_SCAN_LANES <= n; i += NUMERIC_SCAN_LANES) {            \
+      NumericBlock_##name block;                                              \
+      memcpy(&block, x + i, sizeof(block));                                   \
+      block += __builtin_shufflevector(block, zero, 8, 0, 1, 2, 3, 4, 5, 6);  \
+      block += __builtin_shufflevector(block, zero, 8, 8, 0, 1, 2, 3, 4, 5);  \
+      block += __builtin_shufflevector(block, zero, 8, 8, 8, 8, 0, 1, 2, 3);  \
+      const NumericBlock_##name sums = carry                                  \
+        + __builtin_shufflevector(block, zero, 8, 0, 1, 2, 3, 4, 5, 6);       \
+      memcpy(y + i, &sums, sizeof(sums));                                     \
+      carry += block[NUMERIC_SCAN_LANES - 1];                                 \
+    }                                                                         \
+    for (; i < n; i++) {                                                      \
+      const U value = (U)x[i];                                                \
+      y[i] = (T)carry;                                                        \
+      carry += value;                                                         \
+    }                                                                         \
+    return carry;                                                             \
+  }                                                                           \
+                                                                              \
+  static bool less_##name(const void* a, const void* b) {                     \
+    return *(const T*)a < *(const T*)b;                                       \
+  }                                                                           \
+                                                                              \
+  /* The sum in f64, of the objects or of their squared deviations         */ \
+  [[gnu::always_inline]]                                                      \
+  static inline f64 total_##name(                                             \
+    const T*    x,                                                            \
+    const usize n,                                                            \
+    const bool  squares,                                                      \
+    const f64   mean                                                          \
+  ) {                                                                         \
+    f64 lanes[NUMERIC_LANES] = {};                                            \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_LANES <= n; i += NUMERIC_LANES) {                      \
+      for (usize j = 0; j < NUMERIC_LANES; j++) {                             \
+        const f64 d = (f64)x[i + j] - mean;                                   \
+        lanes[j] += squares ? d * d : d;                                      \
+      }                                                                       \
+    }                                                                         \
+    f64 sum = 0;                                                              \
+    for (; i < n; i++) {                                                      \
+      const f64 d = (f64)x[i] - mean;                                         \
+      sum += squares ? d * d : d;                                             \
+    }                                                                         \
+    for (usize j = 0; j < NUMERIC_LANES; j++) {                               \
+      sum += lanes[j];                                                        \
+    }                                                                         \
+    return sum;                                                               \
+  }                                                                           \
+                                                                              \
+  [[gnu::always_inline]]                                                      \
+  static inline U dot_##name(const T* x, const T* y, const usize n) {         \
+    U lanes[NUMERIC_LANES] = {};                                              \
+    usize i = 0;                                                              \
+    for (; i + NUMERIC_LANES <= n; i += NUMERIC_LANES) {                      \
+      for (usize j = 0; j < NUMERIC_LANES; j++) {                             \
+        lanes[j] += (U)x[i + j] * (U)y[i + j];                                \
+      }                                                                       \
+    }                                                                         \
+    U sum = 0;                                                                \
+    for (; i < n; i++) {                                                      \
+      sum += (U)x[i] * (U)y[i];                                               \
+    }                                                                         \
+    for (usize j = 0; j < NUMERIC_LANES; j++) {                               \
+      sum += lanes[j];                                                        \
+    }                                                                         \
+    return sum;                                                               \
+  }                                                                           \
+                                                                              \
+  /* y = a * x + y, or y = a * y when x is nullptr                         */ \
+  [[gnu::always_inline]]                                                      \
+  static inline void axpy_##name(                                             \
+    T*          y,                                                            \
+    const T*    x,                                                            \
+    const usize n,                                                            \
+    const U     a                                                             \
+  ) {                                                                         \
+    if (x == nullptr) {                                                       \
+      for (usize i = 0; i < n; i++) {                                         \
+        y[i] = (T)(a * (U)y[i]);                                              \
+      }                                                                       \
+      return;                                                                 \
+    }                                                                         \
+    for (usize i = 0; i < n; i++) {                                           \
+      y[i] = (T)(a * (U)x[i] + (U)y[i]);                                      \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  [[gnu::always_inline]]                                                      \
+  static inline void add_##name(T* y, const T* x, const usize n) {            \
+    for (usize i = 0; i < n; i++) {                                           \
+      y[i] = (T)((U)x[i] + (U)y[i]);                                          \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  /* Out of range objects are clamped to the first and the last bins       */ \
+  static void histogram_##name(                                               \
+    const void* objects,                                                      \
+    const usize n,                                                            \
+    const f64   low,                                                          \
+    const f64   width,                                                        \
+    usize*      bins,                                                         \
+    const usize bin_count                                                     \
+  ) {                                                                         \
+    const T* x = objects;                                                     \
+    const f64 last = (f64)(bin_count - 1);                                    \
+    const f64 scale = 1 / width;                                              \
+    for (usize i = 0; i < n; i++) {                                           \
+      const f64 bin = ((f64)x[i] - low) * scale;                              \
+      if (bin == bin) {                                                       \
+        bins[bin < 0 ? 0 : bin < last ? (usize)bin : bin_count - 1]++;        \
+      }                                                                       \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  static void store_##name(void* object, const NumericValue value) {          \
+    const T result = NUMERIC_VALUE_##name(value);                             \
+    memcpy(object, &result, sizeof(T));                                       \
+  }
+
+// Reads a NumericValue of each type
+#define NUMERIC_VALUE_f32(value) (f32)(value).f
+#define NUMERIC_VALUE_f64(value) (value).f
+#define NUMERIC_VALUE_i32(value) (i32)(u32)(value).u
+#define NUMERIC_VALUE_i64(value) (i64)(value).u
+
+// Makes a NumericValue of each type
+#define NUMERIC_MAKE_f32(sum) (NumericValue){ .f = (f64)(sum) }
+#define NUMERIC_MAKE_f64(sum) (NumericValue){ .f = (sum) }
+#define NUMERIC_MAKE_i32(sum) (NumericValue){ .u = (u64)(i64)(i32)(sum) }
+#define NUMERIC_MAKE_i64(sum) (NumericValue){ .u = (u64)(sum) }
+
+NUMERIC_LOOPS(f32, f32, f32, INFINITY, -INFINITY)
+NUMERIC_LOOPS(f64, f64, f64, (f64)INFINITY, -(f64)INFINITY)
+NUMERIC_LOOPS(i32, u32, i32, INT32_MAX, INT32_MIN)
+NUMERIC_LOOPS(i64, u64, i64, INT64_MAX, INT64_MIN)
+
+// The kernels of a type at a level, compiled with its target attribute
+#define NUMERIC_KERNELS(T, U, name, level, target)                            \
+  target static U sum_pairwise_##name##_##level(const T* x, const usize n) {  \
+    if (n <= NUMERIC_BLOCK) {                                                 \
+      return sum_plain_##name(x, n);                                          \
+    }                                                                         \
+    const usize half = n / 2 / NUMERIC_LANES * NUMERIC_LANES;                 \
+    return sum_pairwise_##name##_##level(x, half)                             \
+      + sum_pairwise_##name##_##level(x + half, n - half);                    \
+  }                                                                           \
+                                                                              \
+  target static NumericValue sum_##name##_##level(                            \
+    const void*           x,                                                  \
+    const usize           n,                                                  \
+    const VectorSummation method                                              \
+  ) {                                                                         \
+    switch (method) {                                                         \
+    case VECTOR_SUMMATION_PAIRWISE:                                           \
+      return NUMERIC_MAKE_##name(sum_pairwise_##name##_##level(x, n));        \
+    case VECTOR_SUMMATION_KAHAN:                                              \
+      return NUMERIC_MAKE_##name(sum_kahan_##name(x, n));                     \
+    default:                                                                  \
+      return NUMERIC_MAKE_##name(sum_plain_##name(x, n));                     \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  target static usize min_##name##_##level(const void* x, const usize n) {    \
+    return min_##name(x, n);                                                  \
+  }                                                                           \
+                                                                              \
+  target static usize max_##name##_##level(const void* x, const usize n) {    \
+    return max_##name(x, n);                                                  \
+  }                                                                           \
+                                                                              \
+  target static f64 total_##name##_##level(const void* x, const usize n) {    \
+    return total_##name(x, n, false, 0);                                      \
+  }                                                                           \
+                                                                              \
+  target static f64 deviation_##name##_##level(                               \
+    const void* x,                                                            \
+    const usize n,                                                            \
+    const f64   mean                                                          \
+  ) {                                                                         \
+    return total_##name(x, n, true, mean);                                    \
+  }                                                                           \
+                                                                              \
+  target static NumericValue dot_##name##_##level(                            \
+    const void* x,                                                            \
+    const void* y,                                                            \
+    const usize n                                                             \
+  ) {                                                                         \
+    return NUMERIC_MAKE_##name(dot_##name(x, y, n));                          \
+  }                                                                           \
+                                                                              \
+  target static void axpy_##name##_##level(                                   \
+    void*       y,                                                            \
+    const void* x,                                                            \
+    const usize n,                                                            \
+    const f64   a                                                             \
+  ) {                                                                         \
+    axpy_##name(y, x, n, (U)(T)a);                                            \
+  }                                                                           \
+                                                                              \
+  target static void scale_##name##_##level(                                  \
+    void*       x,                                                            \
+    const usize n,                                                            \
+    const f64   a                                                             \
+  ) {                                                                         \
+    axpy_##name(x, nullptr, n, (U)(T)a);                                      \
+  }                                                                           \
+                                                                              \
+  target static void add_##name##_##level(                                    \
+    void*       y,                                                            \
+    const void* x,                                                            \
+    const usize n                                                             \
+  ) {                                                                         \
+    add_##name(y, x, n);                                                      \
+  }                                                                           \
+                                                                              \
+  target static NumericValue scan_##name##_##level(                           \
+    void*              y,                                                     \
+    const void*        x,                                                     \
+    const usize        n,                                                     \
+    const NumericValue carry                                                  \
+  ) {                                                                         \
+    return NUMERIC_MAKE_##name(                                               \
+      scan_##name(y, x, n, (U)NUMERIC_VALUE_##name(carry))                    \
+    );                                                                        \
+  }
+
+// The kernels of every type at a level
+#define NUMERIC_LEVEL(level, target)                                          \
+  NUMERIC_KERNELS(f32, f32, f32, level, target)                               \
+  NUMERIC_KERNELS(f64, f64, f64, level, target)                               \
+  NUMERIC_KERNELS(i32, u32, i32, level, target)                               \
+  NUMERIC_KERNELS(i64, u64, i64, level, target)
+
+// The table entry of a type at a level
+#define NUMERIC_ENTRY(T, name, level, is_real)                                \
+  {                                                                           \
+    .real      = is_real,                                                     \
+    .size      = sizeof(T),                                                   \
+    .sum       = sum_##name##_##level,                                        \
+    .min       = min_##name##_##level,                                        \
+    .max       = max_##name##_##level,                                        \
+    .less      = less_##name,                                                 \
+    .total     = total_##name##_##level,                                      \
+    .deviation = deviation_##name##_##level,                                  \
+    .dot       = dot_##name##_##level,                                        \
+    .axpy      = axpy_##name##_##level,                                       \
+    .scale     = scale_##name##_##level,                                      \
+    .add       = add_##name##_##level,                                        \
+    .histogram = histogram_##name,                                            \
+    .scan      = scan_##name##_##level,                                       \
+    .store     = store_##name,                                                \
+  }
+
+#define NUMERIC_ENTRIES(level)                                                \
+  {                                                                           \
+    [VECTOR_NUMBER_F32] = NUMERIC_ENTRY(f32, f32, level, true),               \
+    [VECTOR_NUMBER_F64] = NUMERIC_ENTRY(f64, f64, level, true),               \
+    [VECTOR_NUMBER_I32] = NUMERIC_ENTRY(i32, i32, level, false),              \
+    [VECTOR_NUMBER_I64] = NUMERIC_ENTRY(i64, i64, level, false),              \
+  }
+
+NUMERIC_LEVEL(scalar, )
+
+#if defined(__x86_64__) || defined(__i386__)
+
+NUMERIC_LEVEL(sse42, [[gnu::target("sse4.2")]])
+NUMERIC_LEVEL(avx2, [[gnu::target("avx2")]])
+NUMERIC_LEVEL(avx512, [[gnu::target("avx512f,avx512bw")]])
+
+static const NumericKernels numeric_kernels[CASTOR_ISAS][VECTOR_NUMBERS] = {
+  [CASTOR_ISA_SCALAR] = NUMERIC_ENTRIES(scalar),
+  [CASTOR_ISA_SSE42]  = NUMERIC_ENTRIES(sse42),
+  [CASTOR_ISA_AVX2]   = NUMERIC_ENTRIES(avx2),
+  [CASTOR_ISA_AVX512] = NUMERIC_ENTRIES(avx512),
+};
+
+#else
+
+static const NumericKernels numeric_kernels[CASTOR_ISAS][VECTOR_NUMBERS] = {
+  [CASTOR_ISA_SCALAR] = NUMERIC_ENTRIES(scalar),
+  [CASTOR_ISA_SSE42]  = NUMERIC_ENTRIES(scalar),
+  [CASTOR_ISA_AVX2]   = NUMERIC_ENTRIES(scalar),
+  [CASTOR_ISA_AVX512] = NUMERIC_ENTRIES(scalar),
+};
+
+#endif
+
+
+// A call split across threads.
+// Member:
+// - kernels:
+//    Those of the type at the chosen level.
+// - x, y:
+//    The Vectors read, y nullptr if there is one; y is written by axpy and
+//    add, and x by scale.
+// - method, a, mean, low, width, bin_count:
+//    The arguments of the call.
+// - add:
+//    Adds x to y rather than a times x.
+// - bins:
+//    The bins of each part, bin_count each.
+// - values, indexes, totals:
+//    The result of each part, or its carry for a scan.
+typedef struct NumericCall {
+  const NumericKernels* kernels;
+  const Vector*         x;
+  const Vector*         y;
+  VectorSummation       method;
+  f64                   a;
+  f64                   mean;
+  f64                   low;
+  f64                   width;
+  usize                 bin_count;
+  bool                  add;
+  usize*                bins;
+  NumericValue          values[VECTOR_BULK_PARTS];
+  usize                 indexes[VECTOR_BULK_PARTS];
+  f64                   totals[VECTOR_BULK_PARTS];
+} NumericCall;
+
+
+usize vector_number_size(const VectorNumber type) {
+  return type < VECTOR_NUMBERS
+    ? numeric_kernels[CASTOR_ISA_SCALAR][type].size
+    : 0;
+}
+
+// Returns the kernels of the type for the Vector, nullptr if its objects
+// are not of the type
+static const NumericKernels* numeric_kernels_for(
+  const Vector*      this,
+  const VectorNumber type
+) {
+  if (type >= VECTOR_NUMBERS) {
+    return nullptr;
+  }
+  const NumericKernels* kernels = &numeric_kernels[castor_isa()][type];
+  return this->object_size == kernels->size ? kernels : nullptr;
+}
+
+// Splits the call across the threads when the Vector is large enough
+static usize numeric_split(
+  NumericCall*         call,
+  const VectorBulkTask task
+) {
+  const usize count = call->x->count;
+  const usize size = call->x->object_size;
+  return vector_bulk_run(
+    count, size, vector_bulk_parts(count * size), task, call
+  );
+}
+
+static NumericValue numeric_add(
+  const NumericKernels* kernels,
+  const NumericValue    a,
+  const NumericValue    b
+) {
+  return kernels->real
+    ? (NumericValue){ .f = a.f + b.f }
+    : (NumericValue){ .u = a.u + b.u };
+}
+
+static void numeric_sum_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  NumericValue sum = {};
+  for (usize i = first, end; i < last; i = end) {
+    const u8* run = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    sum = numeric_add(
+      call->kernels, sum, call->kernels->sum(run, end - i, call->method)
+    );
+  }
+  call->values[part] = sum;
+}
+
+bool vector_sum(
+  const Vector*         this,
+  const VectorNumber    type,
+  const VectorSummation method,
+  void*                 sum
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+    .method  = method,
+  };
+  if (call.kernels == nullptr) {
+    return false;
+  }
+
+  const usize parts = numeric_split(&call, numeric_sum_part);
+  NumericValue total = {};
+  for (usize i = 0; i < parts; i++) {
+    total = numeric_add(call.kernels, total, call.values[i]);
+  }
+  call.kernels->store(sum, total);
+  return true;
+}
+
+// The first index of the extreme object in [first, last), last if every
+// object is a NaN
+static usize numeric_extreme(
+  const NumericCall* call,
+  const usize        first,
+  const usize        last,
+  const bool         largest
+) {
+  const NumericKernels* kernels = call->kernels;
+  usize best = last;
+  const u8* best_object = nullptr;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* run = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    const usize n = end - i;
+    const usize index = largest ? kernels->max(run, n) : kernels->min(run, n);
+    if (index == n) {
+      continue;
+    }
+
+    const u8* object = run + index * kernels->size;
+    if (
+      best_object == nullptr || (largest
+        ? kernels->less(best_object, object)
+        : kernels->less(object, best_object))
+    ) {
+      best = i + index;
+      best_object = object;
+    }
+  }
+  return best;
+}
+
+static void numeric_min_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  call->indexes[part] = numeric_extreme(call, first, last, false);
+}
+
+static void numeric_max_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  call->indexes[part] = numeric_extreme(call, first, last, true);
+}
+
+static bool numeric_extreme_of(
+  const Vector*      this,
+  const VectorNumber type,
+  void*              result,
+  usize*             index,
+  const bool         largest
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+  };
+  if (call.kernels == nullptr || this->count == 0) {
+    return false;
+  }
+
+  const usize parts = numeric_split(
+    &call, largest ? numeric_max_part : numeric_min_part
+  );
+
+  // The parts are in order, so the first of equal objects stays
+  const NumericKernels* kernels = call.kernels;
+  usize best = this->count;
+  const u8* best_object = nullptr;
+  for (usize i = 0; i < parts; i++) {
+    if (call.indexes[i] == this->count) {
+      continue;
+    }
+    usize end;
+    const u8* object = vector_run(this, call.indexes[i], &end);
+    if (
+      best_object == nullptr || (largest
+        ? kernels->less(best_object, object)
+        : kernels->less(object, best_object))
+    ) {
+      best = call.indexes[i];
+      best_object = object;
+    }
+  }
+
+  // Every object is a NaN
+  if (best_object == nullptr) {
+    usize end;
+    best = 0;
+    best_object = vector_run(this, 0, &end);
+  }
+
+  memcpy(result, best_object, kernels->size);
+  if (index != nullptr) {
+    *index = best;
+  }
+  return true;
+}
+
+bool vector_min(
+  const Vector*      this,
+  const VectorNumber type,
+  void*              min,
+  usize*             index
+) {
+  return numeric_extreme_of(this, type, min, index, false);
+}
+
+bool vector_max(
+  const Vector*      this,
+  const VectorNumber type,
+  void*              max,
+  usize*             index
+) {
+  return numeric_extreme_of(this, type, max, index, true);
+}
+
+static void numeric_total_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  f64 total = 0;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* run = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    total += call->kernels->total(run, end - i);
+  }
+  call->totals[part] = total;
+}
+
+static void numeric_deviation_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  f64 total = 0;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* run = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    total += call->kernels->deviation(run, end - i, call->mean);
+  }
+  call->totals[part] = total;
+}
+
+// Sums the totals of the parts of the call over the count
+static f64 numeric_average(NumericCall* call, const VectorBulkTask task) {
+  const usize parts = numeric_split(call, task);
+  f64 total = 0;
+  for (usize i = 0; i < parts; i++) {
+    total += call->totals[i];
+  }
+  return total / (f64)call->x->count;
+}
+
+bool vector_mean(const Vector* this, const VectorNumber type, f64* mean) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+  };
+  if (call.kernels == nullptr || this->count == 0) {
+    return false;
+  }
+
+  *mean = numeric_average(&call, numeric_total_part);
+  return true;
+}
+
+bool vector_variance(
+  const Vector*      this,
+  const VectorNumber type,
+  f64*               mean,
+  f64*               variance
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+  };
+  if (call.kernels == nullptr || this->count == 0) {
+    return false;
+  }
+
+  call.mean = numeric_average(&call, numeric_total_part);
+  *variance = numeric_average(&call, numeric_deviation_part);
+  if (mean != nullptr) {
+    *mean = call.mean;
+  }
+  return true;
+}
+
+static void numeric_dot_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  NumericValue dot = {};
+  for (usize i = first, x_end, y_end; i < last; ) {
+    const u8* x = vector_run(call->x, i, &x_end);
+    const u8* y = vector_run(call->y, i, &y_end);
+    const usize end = x_end < y_end
+      ? (x_end < last ? x_end : last)
+      : (y_end < last ? y_end : last);
+    dot = numeric_add(call->kernels, dot, call->kernels->dot(x, y, end - i));
+    i = end;
+  }
+  call->values[part] = dot;
+}
+
+bool vector_dot(
+  const Vector*      x,
+  const Vector*      y,
+  const VectorNumber type,
+  void*              dot
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(x, type),
+    .x       = x,
+    .y       = y,
+  };
+  if (
+    call.kernels == nullptr || y->object_size != x->object_size ||
+    y->count != x->count
+  ) {
+    return false;
+  }
+
+  const usize parts = numeric_split(&call, numeric_dot_part);
+  NumericValue total = {};
+  for (usize i = 0; i < parts; i++) {
+    total = numeric_add(call.kernels, total, call.values[i]);
+  }
+  call.kernels->store(dot, total);
+  return true;
+}
+
+// Prepares a Vector written in place: its objects all in its content, and
+// marked as modified
+static bool numeric_writable(Vector* this) {
+  if (this->flags & VECTOR_FLAG_READONLY) {
+    return false;
+  }
+  vector_settle(this);
+  vector_dirty_mark(this, 0, this->count);
+  return true;
+}
+
+// Runs axpy or add on the objects of y, x being read in its runs
+static void numeric_update_part(
+  void*       context,
+  const usize,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  const usize size = call->kernels->size;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* x = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    u8* y = call->y->content + i * size;
+    if (call->add) {
+      call->kernels->add(y, x, end - i);
+    } else {
+      call->kernels->axpy(y, x, end - i, call->a);
+    }
+  }
+}
+
+static bool numeric_update(
+  Vector*            y,
+  const Vector*      x,
+  const VectorNumber type,
+  const f64          a,
+  const bool         add
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(y, type),
+    .x       = x,
+    .y       = y,
+    .a       = a,
+    .add     = add,
+  };
+  if (
+    call.kernels == nullptr || x->object_size != y->object_size ||
+    x->count != y->count || !numeric_writable(y)
+  ) {
+    return false;
+  }
+
+  numeric_split(&call, numeric_update_part);
+  return true;
+}
+
+bool vector_axpy(
+  Vector*            y,
+  const Vector*      x,
+  const VectorNumber type,
+  const f64          a
+) {
+  return numeric_update(y, x, type, a, false);
+}
+
+bool vector_add(Vector* y, const Vector* x, const VectorNumber type) {
+  return numeric_update(y, x, type, 0, true);
+}
+
+static void numeric_scale_part(
+  void*       context,
+  const usize,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  const usize size = call->kernels->size;
+  call->kernels->scale(
+    call->x->content + first * size, last - first, call->a
+  );
+}
+
+bool vector_scale(Vector* this, const VectorNumber type, const f64 a) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+    .a       = a,
+  };
+  if (call.kernels == nullptr || !numeric_writable(this)) {
+    return false;
+  }
+
+  numeric_split(&call, numeric_scale_part);
+  return true;
+}
+
+static void numeric_scan_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  const usize size = call->kernels->size;
+  NumericValue carry = call->values[part];
+  for (usize i = first, end; i < last; i = end) {
+    const u8* x = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    carry = call->kernels->scan(
+      call->y->content + i * size, x, end - i, carry
+    );
+  }
+  call->values[part] = carry;
+}
+
+bool vector_scan(
+  Vector*            dest,
+  const Vector*      this,
+  const VectorNumber type,
+  void*              total
+) {
+  NumericCall call = {
+    .kernels = numeric_kernels_for(this, type),
+    .x       = this,
+    .y       = dest,
+    .method  = VECTOR_SUMMATION_PLAIN,
+  };
+  const usize count = this->count;
+  if (
+    call.kernels == nullptr || dest->object_size != this->object_size ||
+    (dest->flags & VECTOR_FLAG_READONLY)
+  ) {
+    return false;
+  }
+  if (dest != this) {
+    if (dest->capacity < count && !vector_grow(dest, count - dest->capacity)) {
+      return false;
+    }
+    vector_settle(dest);
+    dest->count = count;
+  }
+  numeric_writable(dest);
+
+  // The parts sum their objects, then each scans from the sum of the parts
+  // before it
+  const usize size = this->object_size;
+  const usize parts = vector_bulk_parts(count * size);
+  if (parts > 1) {
+    const usize n = vector_bulk_run(
+      count, size, parts, numeric_sum_part, &call
+    );
+    NumericValue carry = {};
+    for (usize i = 0; i < n; i++) {
+      const NumericValue sum = call.values[i];
+      call.values[i] = carry;
+      carry = numeric_add(call.kernels, carry, sum);
+    }
+  }
+
+  const usize n = vector_bulk_run(
+    count, size, parts, numeric_scan_part, &call
+  );
+  if (total != nullptr) {
+    call.kernels->store(total, call.values[n - 1]);
+  }
+  return true;
+}
+
+static void numeric_histogram_part(
+  void*       context,
+  const usize part,
+  const usize first,
+  const usize last
+) {
+  NumericCall* call = context;
+  usize* bins = call->bins + part * call->bin_count;
+  for (usize i = first, end; i < last; i = end) {
+    const u8* run = vector_run(call->x, i, &end);
+    end = end < last ? end : last;
+    call->kernels->histogram(
+      run, end - i, call->low, call->width, bins, call->bin_count
+    );
+  }
+}
+
+bool vector_histogram(
+  const Vector*      this,
+  const VectorNumber type,
+  const f64          low,
+  const f64          high,
+  usize*             bins,
+  const usize        bin_count
+) {
+  NumericCall call = {
+    .kernels   = numeric_kernels_for(this, type),
+    .x         = this,
+    .low       = low,
+    .width     = (high - low) / (f64)bin_count,
+    .bin_count = bin_count,
+    .bins      = bins,
+  };
+  if (call.kernels == nullptr || bin_count == 0 || !(high > low)) {
+    return false;
+  }
+  memset(bins, 0, bin_count * sizeof(usize));
+
+  // Each part counts in bins of its own, added up at the end
+  const usize size = this->object_size;
+  usize parts = vector_bulk_parts(this->count * size);
+  if (parts > 1) {
+    call.bins = calloc(parts * bin_count, sizeof(usize));
+    if (call.bins == nullptr) {
+      call.bins = bins;
+      parts = 1;
+    }
+  }
+
+  parts = vector_bulk_run(
+    this->count, size, parts, numeric_histogram_part, &call
+  );
+  if (call.bins != bins) {
+    for (usize i = 0; i < parts; i++) {
+      for (usize j = 0; j < bin_count; j++) {
+        bins[j] += call.bins[i * bin_count + j];
+      }
+    }
+    free(call.bins);
+  }
+  return true;
+}
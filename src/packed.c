@@ -0,0 +1,511 @@
+#define _GNU_SOURCE
+#include "castor/packed.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "vector_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// Widest bit-packed difference, wider ones are split into exceptions
+#define PACKED_MAX_BITS 32
+
+// Sentinel for an empty block cache
+#define PACKED_NO_BLOCK ((usize)-1)
+
+
+// Member:
+// - first:
+//    The first value of the block.
+// - offset:
+//    Offset of the encoded block in the data.
+typedef struct PackedBlock {
+  u64   first;
+  usize offset;
+} PackedBlock;
+
+// Member:
+// - data:
+//    Vector of u8, the encoded blocks. Each block is a byte holding the bit
+//    width, a byte holding the number of exceptions, the packed differences
+//    and the exceptions, each a position byte and a varint holding the high
+//    bits of the difference.
+// - index:
+//    Vector of PackedBlock, the skip index.
+// - count:
+//    Number of values.
+// - last:
+//    The last value.
+// - exceptions:
+//    Number of exceptions in the encoded blocks.
+// - tail:
+//    The values of the incomplete block.
+// - tail_count:
+//    Number of values in the incomplete block.
+// - cache:
+//    The values of the last decoded block.
+// - cached_block:
+//    Index of the block in the cache, PACKED_NO_BLOCK if none.
+// - decoded_bytes, decode_seconds:
+//    Figures of packed_sequence_decode.
+struct PackedSequence {
+  Vector* data;
+  Vector* index;
+  usize   count;
+  u64     last;
+  usize   exceptions;
+  u64     tail[PACKED_BLOCK_SIZE];
+  usize   tail_count;
+  u64     cache[PACKED_BLOCK_SIZE];
+  usize   cached_block;
+  u64     decoded_bytes;
+  f64     decode_seconds;
+};
+
+
+PackedSequence* packed_sequence_construct(void) {
+  PackedSequence* this = calloc(1, sizeof(PackedSequence));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->data = vector_construct(sizeof(u8), (VectorOptions){});
+  this->index = vector_construct(sizeof(PackedBlock), (VectorOptions){});
+  this->cached_block = PACKED_NO_BLOCK;
+  if (this->data == nullptr || this->index == nullptr) {
+    packed_sequence_destruct(this);
+    return nullptr;
+  }
+
+  return this;
+}
+
+void packed_sequence_destruct(PackedSequence* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  vector_destruct(this->data);
+  vector_destruct(this->index);
+  free(this);
+}
+
+usize packed_sequence_count(const PackedSequence* this) {
+  return this->count;
+}
+
+static u32 packed_width(const u64 value) {
+  return value ? 64 - (u32)__builtin_clzll(value) : 0;
+}
+
+static u32 packed_mask(const u32 bits) {
+  return bits >= 32 ? ~0u : (1u << bits) - 1;
+}
+
+// Packs 128 values of `bits` bits into `bits` 128-bit words. Value i goes to
+// lane i % 4, so four values are unpacked at once with 32-bit lanes.
+static void packed_pack(const u32* in, const u32 bits, u8* out) {
+  const u32 mask = packed_mask(bits);
+
+  for (usize lane = 0; lane < 4; lane++) {
+    u32 word = 0;
+    u32 shift = 0;
+    usize w = 0;
+
+    for (usize k = 0; k < PACKED_BLOCK_SIZE / 4; k++) {
+      const u32 value = in[k * 4 + lane] & mask;
+      word |= value << shift;
+      shift += bits;
+
+      if (shift >= 32) {
+        memcpy(out + (w * 4 + lane) * sizeof(u32), &word, sizeof(u32));
+        w++;
+        shift -= 32;
+        // Carry the bits that did not fit into the next word
+        word = shift > 0 ? value >> (bits - shift) : 0;
+      }
+    }
+  }
+}
+
+// Unpacks the 128 values packed by packed_pack
+static void packed_unpack(const u8* in, const u32 bits, u32* out) {
+  if (bits == 0) {
+    memset(out, 0, PACKED_BLOCK_SIZE * sizeof(u32));
+    return;
+  }
+
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi32((int)packed_mask(bits));
+  const __m128i* words = (const __m128i*)in;
+  __m128i word = _mm_loadu_si128(words++);
+  u32 shift = 0;
+
+  for (usize k = 0; k < PACKED_BLOCK_SIZE / 4; k++) {
+    __m128i v = _mm_srl_epi32(word, _mm_cvtsi32_si128((int)shift));
+    shift += bits;
+
+    // The last group always ends on a word boundary
+    if (shift >= 32 && k + 1 < PACKED_BLOCK_SIZE / 4) {
+      shift -= 32;
+      word = _mm_loadu_si128(words++);
+      if (shift > 0) {
+        __m128i high = _mm_sll_epi32(
+          word, _mm_cvtsi32_si128((int)(bits - shift))
+        );
+        v = _mm_or_si128(v, high);
+      }
+    }
+
+    _mm_storeu_si128((__m128i*)(out + k * 4), _mm_and_si128(v, mask));
+  }
+#else
+  const u32 mask = packed_mask(bits);
+
+  for (usize lane = 0; lane < 4; lane++) {
+    usize w = 0;
+    u32 word;
+    memcpy(&word, in + lane * sizeof(u32), sizeof(u32));
+    u32 shift = 0;
+
+    for (usize k = 0; k < PACKED_BLOCK_SIZE / 4; k++) {
+      u32 v = shift < 32 ? word >> shift : 0;
+      shift += bits;
+
+      if (shift >= 32 && k + 1 < PACKED_BLOCK_SIZE / 4) {
+        shift -= 32;
+        w++;
+        memcpy(&word, in + (w * 4 + lane) * sizeof(u32), sizeof(u32));
+        if (shift > 0) {
+          v |= word << (bits - shift);
+        }
+      }
+
+      out[k * 4 + lane] = v & mask;
+    }
+  }
+#endif
+}
+
+// Number of bytes of the varint holding value
+static usize packed_varint_size(const u64 value) {
+  return value ? (packed_width(value) + 6) / 7 : 1;
+}
+
+// Picks the bit width that minimizes the size of the block
+static u32 packed_choose_bits(const u64* deltas, usize* exceptions) {
+  usize histogram[65] = {};
+  for (usize i = 0; i < PACKED_BLOCK_SIZE; i++) {
+    histogram[packed_width(deltas[i])]++;
+  }
+
+  u32 best = 0;
+  usize best_size = (usize)-1;
+
+  for (u32 bits = 0; bits <= PACKED_MAX_BITS; bits++) {
+    usize size = PACKED_BLOCK_SIZE / 8 * bits;
+    usize count = 0;
+    for (u32 width = bits + 1; width <= 64; width++) {
+      if (histogram[width] > 0) {
+        // Position byte and varint of the high bits, at worst
+        size += histogram[width] * (1 + (width - bits + 6) / 7);
+        count += histogram[width];
+      }
+    }
+    if (size < best_size) {
+      best = bits;
+      best_size = size;
+      *exceptions = count;
+    }
+  }
+
+  return best;
+}
+
+// Appends n uninitialized bytes to the data and returns them
+static u8* packed_reserve(PackedSequence* this, const usize n) {
+  Vector* data = this->data;
+  while (data->capacity - data->count < n) {
+    if (!vector_grow(data, data->capacity ? data->capacity : 256)) {
+      return nullptr;
+    }
+  }
+
+  u8* bytes = data->content + data->count;
+  data->count += n;
+  return bytes;
+}
+
+// Encodes the tail as a new block
+static bool packed_flush(PackedSequence* this) {
+  const u64 first = this->tail[0];
+  u64 deltas[PACKED_BLOCK_SIZE];
+  u32 low[PACKED_BLOCK_SIZE];
+
+  deltas[0] = 0;
+  for (usize i = 1; i < PACKED_BLOCK_SIZE; i++) {
+    deltas[i] = this->tail[i] - this->tail[i - 1];
+  }
+
+  usize exceptions = 0;
+  const u32 bits = packed_choose_bits(deltas, &exceptions);
+  const u32 mask = packed_mask(bits);
+
+  usize exception_size = 0;
+  for (usize i = 0; i < PACKED_BLOCK_SIZE; i++) {
+    low[i] = (u32)deltas[i] & mask;
+    if (deltas[i] >> bits) {
+      exception_size += 1 + packed_varint_size(deltas[i] >> bits);
+    }
+  }
+
+  PackedBlock block = { .first = first, .offset = this->data->count };
+  const usize packed_size = PACKED_BLOCK_SIZE / 8 * bits;
+  u8* out = packed_reserve(this, 2 + packed_size + exception_size);
+  if (out == nullptr) {
+    return false;
+  }
+  if (!vector_push_back(this->index, &block)) {
+    this->data->count = block.offset;
+    return false;
+  }
+
+  out[0] = (u8)bits;
+  out[1] = (u8)exceptions;
+  packed_pack(low, bits, out + 2);
+  out += 2 + packed_size;
+
+  for (usize i = 0; i < PACKED_BLOCK_SIZE; i++) {
+    u64 high = deltas[i] >> bits;
+    if (high == 0) {
+      continue;
+    }
+    *out++ = (u8)i;
+    while (high >= 0x80) {
+      *out++ = (u8)(high | 0x80);
+      high >>= 7;
+    }
+    *out++ = (u8)high;
+  }
+
+  this->exceptions += exceptions;
+  this->tail_count = 0;
+  return true;
+}
+
+bool packed_sequence_push_back(PackedSequence* this, const u64 value) {
+  if (this->count > 0 && value < this->last) {
+    return false;
+  }
+
+  this->tail[this->tail_count++] = value;
+
+  if (this->tail_count == PACKED_BLOCK_SIZE && !packed_flush(this)) {
+    this->tail_count--;
+    return false;
+  }
+
+  this->count++;
+  this->last = value;
+  return true;
+}
+
+// Decodes the block into out
+static void packed_decode_block(
+  const PackedSequence* this,
+  const usize           block,
+  u64*                  out
+) {
+  const PackedBlock* entry = (PackedBlock*)this->index->content + block;
+  const u8* in = this->data->content + entry->offset;
+  const u32 bits = in[0];
+  const usize exceptions = in[1];
+  u32 low[PACKED_BLOCK_SIZE];
+
+  packed_unpack(in + 2, bits, low);
+  for (usize i = 0; i < PACKED_BLOCK_SIZE; i++) {
+    out[i] = low[i];
+  }
+
+  // Patch the high bits of the exceptions
+  in += 2 + PACKED_BLOCK_SIZE / 8 * bits;
+  for (usize e = 0; e < exceptions; e++) {
+    const usize position = *in++;
+    u64 high = 0;
+    for (u32 shift = 0;; shift += 7) {
+      const u8 byte = *in++;
+      high |= (u64)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        break;
+      }
+    }
+    out[position] |= high << bits;
+  }
+
+  // Turn the differences back into values
+  u64 value = entry->first;
+  for (usize i = 0; i < PACKED_BLOCK_SIZE; i++) {
+    value += out[i];
+    out[i] = value;
+  }
+}
+
+// Returns the values of the block, decoding it if it is not cached
+static const u64* packed_block(PackedSequence* this, const usize block) {
+  if (block == this->index->count) {
+    return this->tail;
+  }
+  if (this->cached_block != block) {
+    packed_decode_block(this, block, this->cache);
+    this->cached_block = block;
+  }
+  return this->cache;
+}
+
+bool packed_sequence_get(PackedSequence* this, const usize index, u64* dest) {
+  if (index >= this->count) {
+    return false;
+  }
+
+  const usize block = index / PACKED_BLOCK_SIZE;
+  *dest = packed_block(this, block)[index % PACKED_BLOCK_SIZE];
+  return true;
+}
+
+// Returns the position of the first of the values not lower than value
+static usize packed_search(
+  const u64*  values,
+  const usize size,
+  const u64   value
+) {
+  usize first = 0;
+  usize last = size;
+  while (first < last) {
+    const usize middle = first + (last - first) / 2;
+    if (values[middle] < value) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return first;
+}
+
+usize packed_sequence_lower_bound(PackedSequence* this, const u64 value) {
+  const PackedBlock* blocks = (PackedBlock*)this->index->content;
+  const usize count = this->index->count;
+
+  // Find the first block that starts at or after the value
+  usize low = 0;
+  usize high = count;
+  while (low < high) {
+    const usize middle = low + (high - low) / 2;
+    if (blocks[middle].first < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  // The answer is in the block before it, or is its first value
+  if (low < count) {
+    if (low == 0) {
+      return 0;
+    }
+    const u64* values = packed_block(this, low - 1);
+    return (low - 1) * PACKED_BLOCK_SIZE
+      + packed_search(values, PACKED_BLOCK_SIZE, value);
+  }
+
+  // Every block starts before the value, try the last one then the tail
+  if (count > 0) {
+    const u64* values = packed_block(this, count - 1);
+    const usize position = packed_search(values, PACKED_BLOCK_SIZE, value);
+    if (position < PACKED_BLOCK_SIZE) {
+      return (count - 1) * PACKED_BLOCK_SIZE + position;
+    }
+  }
+
+  return count * PACKED_BLOCK_SIZE
+    + packed_search(this->tail, this->tail_count, value);
+}
+
+static f64 packed_seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (f64)now.tv_sec + (f64)now.tv_nsec / 1e9;
+}
+
+bool packed_sequence_decode(
+  PackedSequence* this,
+  const usize     first,
+  const usize     count,
+  Vector*         dest
+) {
+  if (
+    first > this->count || count > this->count - first ||
+    dest->object_size != sizeof(u64) || (dest->flags & VECTOR_FLAG_READONLY)
+  ) {
+    return false;
+  }
+
+  const usize available = dest->capacity - dest->count;
+  if (available < count && !vector_grow(dest, count - available)) {
+    return false;
+  }
+
+  const f64 start = packed_seconds();
+  u64* out = (u64*)dest->content + dest->count;
+  usize index = first;
+  const usize end = first + count;
+
+  while (index < end) {
+    const usize block = index / PACKED_BLOCK_SIZE;
+    const usize offset = index % PACKED_BLOCK_SIZE;
+    usize n = PACKED_BLOCK_SIZE - offset;
+    if (n > end - index) {
+      n = end - index;
+    }
+
+    // Whole blocks are decoded straight into the Vector
+    if (n == PACKED_BLOCK_SIZE && block < this->index->count) {
+      packed_decode_block(this, block, out);
+    } else {
+      memcpy(out, packed_block(this, block) + offset, n * sizeof(u64));
+    }
+
+    out += n;
+    index += n;
+  }
+
+  dest->count += count;
+  vector_dirty_mark(dest, dest->count - count, dest->count);
+
+  this->decoded_bytes += count * sizeof(u64);
+  this->decode_seconds += packed_seconds() - start;
+  return true;
+}
+
+void packed_sequence_stats(
+  const PackedSequence* this,
+  PackedSequenceStats*  stats
+) {
+  const usize bytes = this->data->count
+    + this->index->count * sizeof(PackedBlock)
+    + this->tail_count * sizeof(u64);
+
+  *stats = (PackedSequenceStats){
+    .count            = this->count,
+    .blocks           = this->index->count,
+    .exceptions       = this->exceptions,
+    .bytes            = bytes,
+    .bits_per_integer = this->count ? (f64)bytes * 8 / (f64)this->count : 0,
+    .decoded_bytes    = this->decoded_bytes,
+    .decode_seconds   = this->decode_seconds,
+  };
+}
\ No newline at end of file
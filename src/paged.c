@@ -0,0 +1,452 @@
+#define _GNU_SOURCE
+#include "castor/paged.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define PAGED_MAGIC   "CASTORPG"
+#define PAGED_VERSION 1
+
+// Marks a page that is not in memory in the page table
+#define PAGED_NOT_CACHED 0
+
+
+// Member:
+// - magic:
+//    PAGED_MAGIC without the terminating null byte.
+// - version:
+//    Format version.
+// - header_size:
+//    sizeof(PagedHeader) when the file was written.
+// - object_size:
+//    Size of each object in bytes.
+// - page_size:
+//    Size of a page in bytes. The first page of the file holds the header.
+// - count:
+//    Number of objects as of the last flush.
+typedef struct PagedHeader {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 object_size;
+  u64 page_size;
+  u64 count;
+} PagedHeader;
+
+// Member:
+// - data:
+//    The content of the page.
+// - page:
+//    Index of the page held by the frame, only meaningful if used.
+// - pins:
+//    Number of pins on the page. Pinned pages are never evicted.
+// - used:
+//    Whether the frame holds a page.
+// - referenced:
+//    CLOCK reference bit, set on every access.
+// - dirty:
+//    Whether the page must be written back before eviction.
+typedef struct PagedFrame {
+  u8*   data;
+  usize page;
+  u32   pins;
+  bool  used;
+  bool  referenced;
+  bool  dirty;
+} PagedFrame;
+
+// Member:
+// - fd:
+//    The backing file.
+// - object_size:
+//    The size of each object in bytes.
+// - page_size:
+//    The size of each page in bytes.
+// - per_page:
+//    Number of objects per page.
+// - count:
+//    The current number of objects.
+// - frames:
+//    The in-memory page frames.
+// - frame_count:
+//    Number of frames.
+// - hand:
+//    Position of the CLOCK hand in frames.
+// - table:
+//    Vector of u32, the frame index + 1 holding each page, or
+//    PAGED_NOT_CACHED.
+// - last_page:
+//    The last page that missed, to detect sequential scans.
+// - prefetch_pages:
+//    Number of pages to read ahead on sequential scans.
+// - prefetched_until:
+//    The first page that has not been prefetched yet.
+// - stats:
+//    The counters of the page cache.
+struct PagedVector {
+  int              fd;
+  usize            object_size;
+  usize            page_size;
+  usize            per_page;
+  usize            count;
+  PagedFrame*      frames;
+  usize            frame_count;
+  usize            hand;
+  Vector*          table;
+  usize            last_page;
+  usize            prefetch_pages;
+  usize            prefetched_until;
+  PagedVectorStats stats;
+};
+
+
+static off_t paged_offset(const PagedVector* this, const usize page) {
+  // Skip the header page
+  return (off_t)((page + 1) * this->page_size);
+}
+
+static bool paged_write_header(PagedVector* this) {
+  PagedHeader header = {
+    .version     = PAGED_VERSION,
+    .header_size = sizeof(PagedHeader),
+    .object_size = this->object_size,
+    .page_size   = this->page_size,
+    .count       = this->count,
+  };
+  memcpy(header.magic, PAGED_MAGIC, sizeof(header.magic));
+
+  return io_pwrite_all(this->fd, &header, sizeof(header), 0);
+}
+
+// Restores the count of an existing file, returns false if it can not be
+// read or was written with another layout
+static bool paged_read_header(PagedVector* this) {
+  PagedHeader header;
+  if (!io_pread_all(this->fd, &header, sizeof(header), 0)) {
+    return false;
+  }
+
+  if (
+    memcmp(header.magic, PAGED_MAGIC, sizeof(header.magic)) != 0 ||
+    header.version != PAGED_VERSION ||
+    header.header_size != sizeof(PagedHeader) ||
+    header.object_size != this->object_size ||
+    header.page_size != this->page_size
+  ) {
+    return false;
+  }
+
+  this->count = header.count;
+  return true;
+}
+
+static bool paged_write_back(PagedVector* this, PagedFrame* frame) {
+  if (!frame->dirty) {
+    return true;
+  }
+
+  if (
+    !io_pwrite_all(
+      this->fd, frame->data, this->page_size, paged_offset(this, frame->page)
+    )
+  ) {
+    return false;
+  }
+
+  frame->dirty = false;
+  this->stats.writebacks++;
+
+  return true;
+}
+
+static bool paged_read(PagedVector* this, PagedFrame* frame) {
+  // Pages past the objects have not been written yet, and are zero-filled.
+  // The others are written whole, on eviction or flush.
+  if (frame->page * this->per_page >= this->count) {
+    memset(frame->data, 0, this->page_size);
+    return true;
+  }
+
+  return io_pread_all(
+    this->fd, frame->data, this->page_size, paged_offset(this, frame->page)
+  );
+}
+
+// Finds a frame for a new page with the CLOCK algorithm
+static PagedFrame* paged_evict(PagedVector* this) {
+  // Two rounds clear every reference bit, so any unpinned frame is found
+  for (usize i = 0; i < 2 * this->frame_count; i++) {
+    PagedFrame* frame = &this->frames[this->hand];
+    this->hand = (this->hand + 1) % this->frame_count;
+
+    if (!frame->used) {
+      return frame;
+    }
+    if (frame->pins > 0) {
+      continue;
+    }
+    if (frame->referenced) {
+      frame->referenced = false;
+      continue;
+    }
+
+    if (!paged_write_back(this, frame)) {
+      return nullptr;
+    }
+
+    u32* slot = vector_get(this->table, frame->page);
+    *slot = PAGED_NOT_CACHED;
+    frame->used = false;
+    this->stats.evictions++;
+
+    return frame;
+  }
+
+  return nullptr;
+}
+
+// Hints the kernel to read the following pages of a sequential scan
+static void paged_prefetch(PagedVector* this, const usize page) {
+  if (this->prefetch_pages == 0 || page + 1 < this->prefetched_until) {
+    return;
+  }
+
+  posix_fadvise(
+    this->fd,
+    paged_offset(this, page + 1),
+    (off_t)(this->prefetch_pages * this->page_size),
+    POSIX_FADV_WILLNEED
+  );
+  this->prefetched_until = page + 1 + this->prefetch_pages;
+  this->stats.prefetches += this->prefetch_pages;
+}
+
+// Returns the frame holding the page, reading it on a miss
+static PagedFrame* paged_lookup(PagedVector* this, const usize page) {
+  // Extend the page table up to the page
+  const u32 empty = PAGED_NOT_CACHED;
+  while (vector_get(this->table, page) == nullptr) {
+    if (!vector_push_back(this->table, (void*)&empty)) {
+      return nullptr;
+    }
+  }
+
+  u32* slot = vector_get(this->table, page);
+  if (*slot != PAGED_NOT_CACHED) {
+    PagedFrame* frame = &this->frames[*slot - 1];
+    frame->referenced = true;
+    this->stats.hits++;
+    return frame;
+  }
+
+  PagedFrame* frame = paged_evict(this);
+  if (frame == nullptr) {
+    return nullptr;
+  }
+
+  frame->page = page;
+  if (!paged_read(this, frame)) {
+    return nullptr;
+  }
+
+  frame->used = true;
+  frame->referenced = true;
+  frame->pins = 0;
+  *slot = (u32)(frame - this->frames) + 1;
+  this->stats.misses++;
+
+  if (page == this->last_page + 1) {
+    paged_prefetch(this, page);
+  }
+  this->last_page = page;
+
+  return frame;
+}
+
+PagedVector* paged_vector_construct(
+  const char*              path,
+  const usize              object_size,
+  const PagedVectorOptions options
+) {
+  const usize page_size = options.page_size ? options.page_size : 64 * 1024;
+  const usize frame_count = options.cache_pages ? options.cache_pages : 256;
+  if (object_size == 0 || object_size > page_size) {
+    return nullptr;
+  }
+
+  PagedVector* this = calloc(1, sizeof(PagedVector));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->object_size = object_size;
+  this->page_size = page_size;
+  this->per_page = page_size / object_size;
+  this->frame_count = frame_count;
+  this->prefetch_pages = options.prefetch_pages;
+  this->last_page = (usize)-1;
+
+  this->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  this->frames = calloc(frame_count, sizeof(PagedFrame));
+  this->table = vector_construct(sizeof(u32), (VectorOptions){});
+  u8* data = malloc(frame_count * page_size);
+  if (
+    this->fd < 0 || this->frames == nullptr ||
+    this->table == nullptr || data == nullptr
+  ) {
+    free(data);
+    goto fail;
+  }
+
+  for (usize i = 0; i < frame_count; i++) {
+    this->frames[i].data = data + i * page_size;
+  }
+
+  // Only an empty file is initialized: one written with another layout,
+  // or whose header can not be read, is left untouched
+  struct stat status;
+  if (fstat(this->fd, &status) != 0) {
+    goto fail;
+  }
+  if (
+    status.st_size == 0
+      ? !paged_write_header(this)
+      : !paged_read_header(this)
+  ) {
+    goto fail;
+  }
+
+  return this;
+
+fail:
+  if (this->fd >= 0) {
+    close(this->fd);
+  }
+  if (this->frames != nullptr) {
+    free(this->frames[0].data);
+  }
+  free(this->frames);
+  vector_destruct(this->table);
+  free(this);
+  return nullptr;
+}
+
+void paged_vector_destruct(PagedVector* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  paged_vector_flush(this);
+  close(this->fd);
+  free(this->frames[0].data);
+  free(this->frames);
+  vector_destruct(this->table);
+  free(this);
+}
+
+usize paged_vector_count(const PagedVector* this) {
+  return this->count;
+}
+
+void* paged_vector_get(PagedVector* this, const usize index) {
+  if (index >= this->count) {
+    return nullptr;
+  }
+
+  PagedFrame* frame = paged_lookup(this, index / this->per_page);
+  if (frame == nullptr) {
+    return nullptr;
+  }
+  return frame->data + (index % this->per_page) * this->object_size;
+}
+
+bool paged_vector_set(PagedVector* this, const usize index, void* object) {
+  if (index >= this->count) {
+    return false;
+  }
+
+  PagedFrame* frame = paged_lookup(this, index / this->per_page);
+  if (frame == nullptr) {
+    return false;
+  }
+
+  void* dest = frame->data + (index % this->per_page) * this->object_size;
+  memcpy(dest, object, this->object_size);
+  frame->dirty = true;
+
+  return true;
+}
+
+bool paged_vector_push_back(PagedVector* this, void* object) {
+  const usize index = this->count;
+
+  PagedFrame* frame = paged_lookup(this, index / this->per_page);
+  if (frame == nullptr) {
+    return false;
+  }
+
+  void* dest = frame->data + (index % this->per_page) * this->object_size;
+  memcpy(dest, object, this->object_size);
+  frame->dirty = true;
+  this->count++;
+
+  return true;
+}
+
+void* paged_vector_pin(PagedVector* this, const usize index, usize* count) {
+  if (index >= this->count) {
+    return nullptr;
+  }
+
+  PagedFrame* frame = paged_lookup(this, index / this->per_page);
+  if (frame == nullptr) {
+    return nullptr;
+  }
+
+  frame->pins++;
+
+  // Objects up to the end of the page or of the vector
+  const usize offset = index % this->per_page;
+  const usize page_end = index - offset + this->per_page;
+  *count = (page_end < this->count ? page_end : this->count) - index;
+
+  return frame->data + offset * this->object_size;
+}
+
+void paged_vector_unpin(
+  PagedVector* this,
+  const usize  index,
+  const bool   dirty
+) {
+  u32* slot = vector_get(this->table, index / this->per_page);
+  if (slot == nullptr || *slot == PAGED_NOT_CACHED) {
+    return;
+  }
+
+  PagedFrame* frame = &this->frames[*slot - 1];
+  if (frame->pins > 0) {
+    frame->pins--;
+  }
+  frame->dirty |= dirty;
+}
+
+bool paged_vector_flush(PagedVector* this) {
+  bool ok = true;
+  for (usize i = 0; i < this->frame_count; i++) {
+    if (this->frames[i].used && !paged_write_back(this, &this->frames[i])) {
+      ok = false;
+    }
+  }
+
+  return ok && paged_write_header(this) && fdatasync(this->fd) == 0;
+}
+
+PagedVectorStats paged_vector_stats(const PagedVector* this) {
+  return this->stats;
+}
\ No newline at end of file
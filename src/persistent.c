@@ -0,0 +1,219 @@
+#define _GNU_SOURCE
+#include "castor/persistent.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "vector_internal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Offset of the payload inside the file
+#define PERSISTENT_PAYLOAD_OFFSET 4096
+
+
+// Member:
+// - fd:
+//    The backing file, kept open to grow it.
+// - base:
+//    Start of the mapping (the persistent header).
+// - length:
+//    Length of the mapping in bytes.
+typedef struct PersistentFile {
+  int   fd;
+  u8*   base;
+  usize length;
+} PersistentFile;
+
+
+static bool persistent_resize(Vector* this, const usize new_capacity) {
+  PersistentFile* file = this->storage_context;
+  if (new_capacity < this->count) {
+    return false;
+  }
+
+  const usize length = PERSISTENT_PAYLOAD_OFFSET
+    + new_capacity * this->object_size;
+  if (ftruncate(file->fd, (off_t)length) != 0) {
+    return false;
+  }
+
+  void* base = mremap(file->base, file->length, length, MREMAP_MAYMOVE);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  file->base = base;
+  file->length = length;
+  ((PersistentHeader*)base)->capacity = new_capacity;
+
+  this->content = file->base + PERSISTENT_PAYLOAD_OFFSET;
+  this->capacity = new_capacity;
+
+  return true;
+}
+
+// Flushes the objects, then records the count in the header
+static bool persistent_flush(Vector* this) {
+  PersistentFile* file = this->storage_context;
+  PersistentHeader* header = (PersistentHeader*)file->base;
+
+  const usize used = PERSISTENT_PAYLOAD_OFFSET
+    + this->count * this->object_size;
+  if (msync(file->base, used, MS_SYNC) != 0) {
+    return false;
+  }
+
+  header->count = this->count;
+  return msync(file->base, sizeof(PersistentHeader), MS_SYNC) == 0;
+}
+
+static void persistent_release(Vector* this) {
+  PersistentFile* file = this->storage_context;
+
+  persistent_flush(this);
+  munmap(file->base, file->length);
+  close(file->fd);
+  free(file);
+}
+
+static const VectorStorage PERSISTENT_STORAGE = {
+  .resize  = persistent_resize,
+  .release = persistent_release,
+};
+
+bool persistent_sync(Vector* this) {
+  if (this->storage != &PERSISTENT_STORAGE) {
+    return false;
+  }
+  return persistent_flush(this);
+}
+
+// Initializes the header of a new file, returns its capacity or 0 on failure
+static usize persistent_create(
+  int         fd,
+  const usize object_size,
+  const usize capacity
+) {
+  PersistentHeader header = {
+    .version        = PERSISTENT_VERSION,
+    .header_size    = sizeof(PersistentHeader),
+    .object_size    = object_size,
+    .count          = 0,
+    .capacity       = capacity,
+    .payload_offset = PERSISTENT_PAYLOAD_OFFSET,
+  };
+  memcpy(header.magic, PERSISTENT_MAGIC, sizeof(header.magic));
+
+  const usize length = PERSISTENT_PAYLOAD_OFFSET + capacity * object_size;
+  if (
+    ftruncate(fd, (off_t)length) != 0 ||
+    pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+    fdatasync(fd) != 0
+  ) {
+    return 0;
+  }
+
+  return capacity;
+}
+
+// Validates the header of an existing file. The count and capacity are
+// clamped to the objects the file actually holds.
+static bool persistent_validate(
+  PersistentHeader* header,
+  const usize       object_size,
+  const usize       size
+) {
+  if (
+    memcmp(header->magic, PERSISTENT_MAGIC, sizeof(header->magic)) != 0 ||
+    header->version != PERSISTENT_VERSION ||
+    header->header_size != sizeof(PersistentHeader) ||
+    header->object_size != object_size ||
+    header->payload_offset != PERSISTENT_PAYLOAD_OFFSET ||
+    size < PERSISTENT_PAYLOAD_OFFSET
+  ) {
+    return false;
+  }
+
+  const usize available = (size - PERSISTENT_PAYLOAD_OFFSET) / object_size;
+  if (header->capacity > available) {
+    header->capacity = available;
+  }
+  if (header->count > header->capacity) {
+    header->count = header->capacity;
+  }
+
+  return true;
+}
+
+Vector* persistent_open(
+  const char*         path,
+  const usize         object_size,
+  const VectorOptions options
+) {
+  if (object_size == 0 || options.interface != nullptr) {
+    return nullptr;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  PersistentHeader header;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  if (st.st_size == 0) {
+    // Default to 16 if the capacity is 0, as vector_grow does
+    usize capacity = options.capacity ? options.capacity : 16;
+    if (persistent_create(fd, object_size, capacity) == 0) {
+      close(fd);
+      return nullptr;
+    }
+    header = (PersistentHeader){ .count = 0, .capacity = capacity };
+  } else if (
+    pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+    !persistent_validate(&header, object_size, (usize)st.st_size)
+  ) {
+    close(fd);
+    return nullptr;
+  }
+
+  const usize length = PERSISTENT_PAYLOAD_OFFSET
+    + header.capacity * object_size;
+  void* base = mmap(
+    nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
+  );
+
+  Vector* this = vector_construct(object_size, (VectorOptions){});
+  PersistentFile* file = malloc(sizeof(PersistentFile));
+  if (base == MAP_FAILED || this == nullptr || file == nullptr) {
+    if (base != MAP_FAILED) {
+      munmap(base, length);
+    }
+    vector_destruct(this);
+    free(file);
+    close(fd);
+    return nullptr;
+  }
+
+  // Store the clamped values back so the header matches the mapping
+  ((PersistentHeader*)base)->count = header.count;
+  ((PersistentHeader*)base)->capacity = header.capacity;
+
+  *file = (PersistentFile){ .fd = fd, .base = base, .length = length };
+  this->content = file->base + PERSISTENT_PAYLOAD_OFFSET;
+  this->capacity = header.capacity;
+  this->count = header.count;
+  this->storage = &PERSISTENT_STORAGE;
+  this->storage_context = file;
+
+  return this;
+}
\ No newline at end of file
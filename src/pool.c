@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include "castor/pool.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "pool_internal.h"
+#include "vector_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// Order of the smallest block, 64 bytes
+#define POOL_MIN_ORDER 6
+
+// Number of orders of blocks
+#define POOL_ORDERS 64
+
+// Marks the order of a free block in the order map
+#define POOL_FREE 0x80
+
+// Marks a unit that does not start a block in the order map
+#define POOL_INSIDE 0x7f
+
+// No block, in the free lists
+#define POOL_NONE ((usize)-1)
+
+
+// The links of a free block, stored at its start.
+// Member:
+// - previous, next:
+//    Offsets of the neighbours in the free list of the order, POOL_NONE at
+//    the ends.
+typedef struct PoolLinks {
+  usize previous;
+  usize next;
+} PoolLinks;
+
+// Member:
+// - base:
+//    Start of the blocks.
+// - size:
+//    Bytes of the blocks, a multiple of the smallest block.
+// - length:
+//    Length of the mapping, the blocks followed by the order map.
+// - orders:
+//    One byte per smallest block: the order of the block starting there,
+//    with POOL_FREE if it is free, or POOL_INSIDE.
+// - free:
+//    Offset of the first free block of each order, POOL_NONE if none.
+// - used, allocations, failures:
+//    As in PoolHeadroom.
+struct Pool {
+  u8*   base;
+  usize size;
+  usize length;
+  u8*   orders;
+  usize free[POOL_ORDERS];
+  usize used;
+  usize allocations;
+  u64   failures;
+};
+
+
+static PoolLinks* pool_links(const Pool* this, const usize offset) {
+  return (PoolLinks*)(this->base + offset);
+}
+
+static void pool_push(Pool* this, const usize offset, const usize order) {
+  PoolLinks* links = pool_links(this, offset);
+  links->previous = POOL_NONE;
+  links->next = this->free[order];
+  if (this->free[order] != POOL_NONE) {
+    pool_links(this, this->free[order])->previous = offset;
+  }
+  this->free[order] = offset;
+  this->orders[offset >> POOL_MIN_ORDER] = (u8)order | POOL_FREE;
+}
+
+static void pool_unlink(Pool* this, const usize offset, const usize order) {
+  const PoolLinks* links = pool_links(this, offset);
+  if (links->previous != POOL_NONE) {
+    pool_links(this, links->previous)->next = links->next;
+  } else {
+    this->free[order] = links->next;
+  }
+  if (links->next != POOL_NONE) {
+    pool_links(this, links->next)->previous = links->previous;
+  }
+}
+
+// Returns the order of the smallest block holding the given bytes
+static usize pool_order(const usize bytes) {
+  usize order = POOL_MIN_ORDER;
+  while (order < POOL_ORDERS - 1 && ((usize)1 << order) < bytes) {
+    order++;
+  }
+  return order;
+}
+
+void* pool_allocate(Pool* this, const usize bytes) {
+  const usize order = pool_order(bytes);
+
+  usize found = order;
+  while (found < POOL_ORDERS && this->free[found] == POOL_NONE) {
+    found++;
+  }
+  if (found == POOL_ORDERS || ((usize)1 << order) < bytes) {
+    this->failures++;
+    return nullptr;
+  }
+
+  const usize offset = this->free[found];
+  pool_unlink(this, offset, found);
+
+  // Split the block, keeping the lower half, down to the order wanted
+  while (found > order) {
+    found--;
+    pool_push(this, offset + ((usize)1 << found), found);
+  }
+
+  this->orders[offset >> POOL_MIN_ORDER] = (u8)order;
+  this->used += (usize)1 << order;
+  this->allocations++;
+  return this->base + offset;
+}
+
+void pool_free(Pool* this, void* block) {
+  if (block == nullptr) {
+    return;
+  }
+
+  usize offset = (usize)((u8*)block - this->base);
+  usize order = this->orders[offset >> POOL_MIN_ORDER];
+  this->used -= (usize)1 << order;
+  this->allocations--;
+
+  // Merge the block with its buddy as long as the buddy is free and whole
+  while (order < POOL_ORDERS - 1) {
+    const usize buddy = offset ^ ((usize)1 << order);
+    if (
+      buddy + ((usize)1 << order) > this->size ||
+      this->orders[buddy >> POOL_MIN_ORDER] != ((u8)order | POOL_FREE)
+    ) {
+      break;
+    }
+    pool_unlink(this, buddy, order);
+    this->orders[(offset > buddy ? offset : buddy) >> POOL_MIN_ORDER] =
+      POOL_INSIDE;
+    offset = offset < buddy ? offset : buddy;
+    order++;
+  }
+
+  pool_push(this, offset, order);
+}
+
+Pool* pool_construct(const PoolOptions options) {
+  const usize unit = (usize)1 << POOL_MIN_ORDER;
+  const usize size = options.size / unit * unit;
+  if (size == 0) {
+    return nullptr;
+  }
+
+  Pool* this = malloc(sizeof(Pool));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  // The order map follows the blocks in the same mapping, so that it is
+  // locked and prefaulted with them
+  const usize page = (usize)sysconf(_SC_PAGESIZE);
+  const usize length = (size + size / unit + page - 1) / page * page;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS
+    | (options.prefault || options.lock ? MAP_POPULATE : 0);
+  u8* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (base == MAP_FAILED) {
+    free(this);
+    return nullptr;
+  }
+  if (options.lock && mlock(base, length) != 0) {
+    munmap(base, length);
+    free(this);
+    return nullptr;
+  }
+
+  *this = (Pool){
+    .base   = base,
+    .size   = size,
+    .length = length,
+    .orders = base + size,
+  };
+  memset(this->orders, POOL_INSIDE, size / unit);
+  for (usize order = 0; order < POOL_ORDERS; order++) {
+    this->free[order] = POOL_NONE;
+  }
+
+  // Cut the memory in the largest blocks that fit, from the largest down.
+  // None of them has a buddy, so they are never merged
+  usize offset = 0;
+  for (usize order = POOL_ORDERS - 1; order >= POOL_MIN_ORDER; order--) {
+    if (size - offset >= (usize)1 << order) {
+      pool_push(this, offset, order);
+      offset += (usize)1 << order;
+    }
+  }
+
+  return this;
+}
+
+void pool_destruct(Pool* this) {
+  if (this == nullptr) {
+    return;
+  }
+  munmap(this->base, this->length);
+  free(this);
+}
+
+void pool_headroom(const Pool* this, PoolHeadroom* headroom) {
+  usize largest = 0;
+  for (usize order = POOL_ORDERS; order-- > POOL_MIN_ORDER;) {
+    if (this->free[order] != POOL_NONE) {
+      largest = (usize)1 << order;
+      break;
+    }
+  }
+
+  *headroom = (PoolHeadroom){
+    .size        = this->size,
+    .used        = this->used,
+    .available   = this->size - this->used,
+    .largest     = largest,
+    .allocations = this->allocations,
+    .failures    = this->failures,
+  };
+}
+
+
+// The content of a Vector of a pool is a block, whose whole room is used as
+// capacity
+static bool pool_vector_resize(Vector* this, const usize new_capacity) {
+  Pool* pool = this->storage_context;
+  if (new_capacity < this->count) {
+    return false;
+  }
+
+  u8* content = pool_allocate(pool, new_capacity * this->object_size);
+  if (content == nullptr) {
+    return false;
+  }
+  if (this->content != nullptr) {
+    memcpy(content, this->content, this->count * this->object_size);
+    pool_free(pool, this->content);
+  }
+
+  const usize order = pool->orders[(content - pool->base) >> POOL_MIN_ORDER];
+  this->content = content;
+  this->capacity = this->object_size > 0
+    ? ((usize)1 << order) / this->object_size
+    : new_capacity;
+  return true;
+}
+
+static void pool_vector_release(Vector* this) {
+  pool_free(this->storage_context, this->content);
+}
+
+static void pool_vector_destruct(Vector* this) {
+  pool_free(this->storage_context, this);
+}
+
+static const VectorStorage POOL_STORAGE = {
+  .resize   = pool_vector_resize,
+  .release  = pool_vector_release,
+  .destruct = pool_vector_destruct,
+};
+
+Vector* pool_vector_construct(
+  Pool*               pool,
+  const usize         object_size,
+  const VectorOptions options
+) {
+  void* memory = pool_allocate(pool, sizeof(Vector));
+  if (memory == nullptr) {
+    return nullptr;
+  }
+
+  Vector* this = vector_construct_in(
+    memory, object_size, options, &POOL_STORAGE, pool
+  );
+  if (this == nullptr) {
+    pool_free(pool, memory);
+  }
+  return this;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "castor/pool.h"
+#include "castor/types.h"
+
+
+// Allocates a block of at least the given number of bytes from the pool.
+// Returns nullptr if the pool has no block large enough.
+void* pool_allocate(Pool*, const usize bytes);
+
+// Returns a block to the pool.
+void pool_free(Pool*, void* block);
@@ -0,0 +1,455 @@
+#define _GNU_SOURCE
+#include "castor/serial.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include "vector_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// Member:
+// - magic:
+//    SERIAL_MAGIC without the terminating null byte.
+// - version:
+//    Format version, SERIAL_VERSION when written by this library.
+// - header_size:
+//    sizeof(SerialHeader) when the stream was written.
+// - object_size:
+//    Size of each object in bytes.
+typedef struct SerialHeader {
+  u8  magic[8];
+  u32 version;
+  u32 header_size;
+  u64 object_size;
+} SerialHeader;
+
+// Member:
+// - fd:
+//    The descriptor the stream is written to.
+// - object_size:
+//    Size of each object in bytes.
+// - interface:
+//    Encodes the objects, may be nullptr.
+// - buffer:
+//    Bytes waiting to be written.
+// - buffer_size:
+//    Size of the buffer in bytes.
+// - used:
+//    Number of bytes in the buffer.
+// - scratch:
+//    Vector of u8, the encoded form of the current object.
+// - count:
+//    Number of objects encoded.
+// - failed:
+//    Whether a write or an encoding failed.
+struct VectorEncoder {
+  int                    fd;
+  usize                  object_size;
+  const VectorInterface* interface;
+  u8*                    buffer;
+  usize                  buffer_size;
+  usize                  used;
+  Vector*                scratch;
+  usize                  count;
+  bool                   failed;
+};
+
+// Member:
+// - fd:
+//    The descriptor the stream is read from.
+// - object_size:
+//    Size of each object in bytes.
+// - interface:
+//    Decodes the objects, may be nullptr.
+// - buffer:
+//    Bytes read ahead.
+// - buffer_size:
+//    Size of the buffer in bytes.
+// - used:
+//    Number of bytes in the buffer.
+// - position:
+//    Offset of the next unread byte in the buffer.
+// - scratch:
+//    Vector of u8, the payload of the current object when it does not fit
+//    in the buffer.
+// - count:
+//    Number of objects decoded.
+// - ended:
+//    Whether the end of the stream was reached and is valid.
+// - failed:
+//    Whether a read or a decoding failed.
+struct VectorDecoder {
+  int                    fd;
+  usize                  object_size;
+  const VectorInterface* interface;
+  u8*                    buffer;
+  usize                  buffer_size;
+  usize                  used;
+  usize                  position;
+  Vector*                scratch;
+  usize                  count;
+  bool                   ended;
+  bool                   failed;
+};
+
+
+static bool serial_flush(VectorEncoder* this) {
+  if (this->used > 0 && !io_write_all(this->fd, this->buffer, this->used)) {
+    this->failed = true;
+  }
+  this->used = 0;
+  return !this->failed;
+}
+
+static bool serial_write(
+  VectorEncoder* this,
+  const void*    data,
+  const usize    length
+) {
+  if (this->used + length > this->buffer_size && !serial_flush(this)) {
+    return false;
+  }
+
+  // Large payloads are written in place rather than copied
+  if (length >= this->buffer_size) {
+    this->failed = !io_write_all(this->fd, data, length);
+    return !this->failed;
+  }
+
+  memcpy(this->buffer + this->used, data, length);
+  this->used += length;
+  return true;
+}
+
+static bool serial_write_varint(VectorEncoder* this, const u64 value) {
+  u8 bytes[IO_VARINT_MAX];
+  return serial_write(this, bytes, io_varint_encode(bytes, value));
+}
+
+VectorEncoder* vector_encoder_construct(
+  int                    fd,
+  const usize            object_size,
+  const VectorInterface* interface,
+  const SerialOptions    options
+) {
+  if (object_size == 0) {
+    return nullptr;
+  }
+
+  VectorEncoder* this = calloc(1, sizeof(VectorEncoder));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->fd = fd;
+  this->object_size = object_size;
+  this->interface = interface;
+  this->buffer_size = options.buffer_size ? options.buffer_size : 64 * 1024;
+  this->buffer = malloc(this->buffer_size);
+  this->scratch = vector_construct(sizeof(u8), (VectorOptions){});
+  if (this->buffer == nullptr || this->scratch == nullptr) {
+    vector_encoder_destruct(this);
+    return nullptr;
+  }
+
+  SerialHeader header = {
+    .version     = SERIAL_VERSION,
+    .header_size = sizeof(SerialHeader),
+    .object_size = object_size,
+  };
+  memcpy(header.magic, SERIAL_MAGIC, sizeof(header.magic));
+
+  if (!serial_write(this, &header, sizeof(header))) {
+    vector_encoder_destruct(this);
+    return nullptr;
+  }
+
+  return this;
+}
+
+void vector_encoder_destruct(VectorEncoder* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  vector_destruct(this->scratch);
+  free(this->buffer);
+  free(this);
+}
+
+bool vector_encoder_push(VectorEncoder* this, const void* object) {
+  if (this->failed) {
+    return false;
+  }
+
+  const void* payload = object;
+  usize length = this->object_size;
+
+  if (this->interface != nullptr && this->interface->serialize != nullptr) {
+    vector_reset(this->scratch);
+    if (!this->interface->serialize(this->scratch, object)) {
+      this->failed = true;
+      return false;
+    }
+    payload = this->scratch->content;
+    length = this->scratch->count;
+  }
+
+  // The length is biased by one, zero marks the end of the stream
+  if (
+    !serial_write_varint(this, (u64)length + 1) ||
+    !serial_write(this, payload, length)
+  ) {
+    return false;
+  }
+
+  this->count++;
+  return true;
+}
+
+bool vector_encoder_finish(VectorEncoder* this) {
+  if (this->failed) {
+    return false;
+  }
+
+  const u64 count = this->count;
+  return serial_write_varint(this, 0) &&
+    serial_write(this, &count, sizeof(count)) &&
+    serial_flush(this);
+}
+
+static bool serial_fill(VectorDecoder* this) {
+  for (;;) {
+    ssize_t n = read(this->fd, this->buffer, this->buffer_size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      this->failed = true;
+      return false;
+    }
+    this->used = (usize)n;
+    this->position = 0;
+    return true;
+  }
+}
+
+static bool serial_read(VectorDecoder* this, void* data, const usize length) {
+  u8* bytes = data;
+  usize done = 0;
+
+  while (done < length) {
+    if (this->position == this->used) {
+      // Large payloads are read in place rather than through the buffer
+      if (length - done >= this->buffer_size) {
+        this->failed = !io_read_all(this->fd, bytes + done, length - done);
+        return !this->failed;
+      }
+      if (!serial_fill(this)) {
+        return false;
+      }
+    }
+
+    usize n = this->used - this->position;
+    if (n > length - done) {
+      n = length - done;
+    }
+    memcpy(bytes + done, this->buffer + this->position, n);
+    this->position += n;
+    done += n;
+  }
+
+  return true;
+}
+
+static bool serial_next_byte(void* context, u8* byte) {
+  return serial_read(context, byte, 1);
+}
+
+static bool serial_read_varint(VectorDecoder* this, u64* value) {
+  if (!io_varint_decode(serial_next_byte, this, value)) {
+    this->failed = true;
+    return false;
+  }
+  return true;
+}
+
+VectorDecoder* vector_decoder_construct(
+  int                    fd,
+  const VectorInterface* interface,
+  const SerialOptions    options
+) {
+  VectorDecoder* this = calloc(1, sizeof(VectorDecoder));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->fd = fd;
+  this->interface = interface;
+  this->buffer_size = options.buffer_size ? options.buffer_size : 64 * 1024;
+  this->buffer = malloc(this->buffer_size);
+  this->scratch = vector_construct(sizeof(u8), (VectorOptions){});
+  if (this->buffer == nullptr || this->scratch == nullptr) {
+    vector_decoder_destruct(this);
+    return nullptr;
+  }
+
+  SerialHeader header;
+  if (
+    !serial_read(this, &header, sizeof(header)) ||
+    memcmp(header.magic, SERIAL_MAGIC, sizeof(header.magic)) != 0 ||
+    header.version != SERIAL_VERSION ||
+    header.header_size != sizeof(SerialHeader) ||
+    header.object_size == 0
+  ) {
+    vector_decoder_destruct(this);
+    return nullptr;
+  }
+
+  this->object_size = header.object_size;
+  return this;
+}
+
+void vector_decoder_destruct(VectorDecoder* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  vector_destruct(this->scratch);
+  free(this->buffer);
+  free(this);
+}
+
+usize vector_decoder_object_size(const VectorDecoder* this) {
+  return this->object_size;
+}
+
+bool vector_decoder_next(VectorDecoder* this, void* dest) {
+  if (this->failed || this->ended) {
+    return false;
+  }
+
+  u64 length;
+  if (!serial_read_varint(this, &length)) {
+    return false;
+  }
+
+  // End of the stream, check that no object was lost
+  if (length == 0) {
+    u64 count;
+    if (!serial_read(this, &count, sizeof(count)) || count != this->count) {
+      this->failed = true;
+      return false;
+    }
+    this->ended = true;
+    return false;
+  }
+  length--;
+
+  const bool raw = this->interface == nullptr ||
+    this->interface->deserialize == nullptr;
+  if (raw) {
+    if (length != this->object_size) {
+      this->failed = true;
+      return false;
+    }
+    if (!serial_read(this, dest, length)) {
+      return false;
+    }
+    this->count++;
+    return true;
+  }
+
+  // Decode straight from the buffer when the payload is already there
+  const void* payload;
+  if (this->used - this->position >= length) {
+    payload = this->buffer + this->position;
+    this->position += length;
+  } else {
+    const usize capacity = this->scratch->capacity;
+    if (capacity < length && !vector_grow(this->scratch, length - capacity)) {
+      this->failed = true;
+      return false;
+    }
+    if (!serial_read(this, this->scratch->content, length)) {
+      return false;
+    }
+    payload = this->scratch->content;
+  }
+
+  if (!this->interface->deserialize(dest, payload, length)) {
+    this->failed = true;
+    return false;
+  }
+
+  this->count++;
+  return true;
+}
+
+bool vector_decoder_ok(const VectorDecoder* this) {
+  return this->ended;
+}
+
+bool vector_serialize(Vector* this, int fd, const SerialOptions options) {
+  VectorEncoder* encoder = vector_encoder_construct(
+    fd, this->object_size, this->interface, options
+  );
+  if (encoder == nullptr) {
+    return false;
+  }
+
+  vector_settle(this);
+  bool ok = true;
+  for (usize i = 0; ok && i < this->count; i++) {
+    ok = vector_encoder_push(encoder, this->content + i * this->object_size);
+  }
+  ok = ok && vector_encoder_finish(encoder);
+
+  vector_encoder_destruct(encoder);
+  return ok;
+}
+
+Vector* vector_deserialize(
+  int                 fd,
+  VectorInterface*    interface,
+  const SerialOptions options
+) {
+  VectorDecoder* decoder = vector_decoder_construct(fd, interface, options);
+  if (decoder == nullptr) {
+    return nullptr;
+  }
+
+  Vector* this = vector_construct(
+    decoder->object_size,
+    (VectorOptions){ .interface = interface }
+  );
+  if (this == nullptr) {
+    vector_decoder_destruct(decoder);
+    return nullptr;
+  }
+
+  // Objects are decoded in place at the end of the Vector
+  for (;;) {
+    if (this->count == this->capacity && !vector_grow(this, this->capacity)) {
+      break;
+    }
+    void* dest = this->content + this->count * this->object_size;
+    if (!vector_decoder_next(decoder, dest)) {
+      break;
+    }
+    this->count++;
+  }
+
+  const bool ok = vector_decoder_ok(decoder);
+  vector_decoder_destruct(decoder);
+
+  if (!ok) {
+    vector_destruct(this);
+    return nullptr;
+  }
+
+  return this;
+}
\ No newline at end of file
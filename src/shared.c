@@ -0,0 +1,428 @@
+#define _GNU_SOURCE
+#include "castor/shared.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define SHARED_MAGIC   "CASTORSH"
+#define SHARED_VERSION 1
+
+// Offset of the first object in the segment
+#define SHARED_DATA_OFFSET 4096
+
+
+// Member:
+// - magic:
+//    SHARED_MAGIC without the terminating null byte.
+// - version:
+//    Layout version.
+// - header_size:
+//    sizeof(SharedHeader) when the segment was created.
+// - object_size:
+//    Size of each object in bytes.
+// - data_offset:
+//    Offset of the first object from the start of the segment.
+// - sequence:
+//    The sequence lock, odd while the writer modifies the segment.
+// - capacity:
+//    Number of objects the segment has room for.
+// - count:
+//    The current number of objects.
+typedef struct SharedHeader {
+  u8            magic[8];
+  u32           version;
+  u32           header_size;
+  u64           object_size;
+  u64           data_offset;
+  _Atomic u64   sequence;
+  _Atomic usize capacity;
+  _Atomic usize count;
+} SharedHeader;
+
+// Member:
+// - fd:
+//    The shared memory object.
+// - base:
+//    Start of the local mapping of the segment.
+// - length:
+//    Length of the local mapping in bytes.
+// - object_size:
+//    Size of each object in bytes.
+// - writer:
+//    Whether this handle is the writer.
+// - depth:
+//    Nesting depth of the writer's publication sections.
+struct SharedVector {
+  int   fd;
+  u8*   base;
+  usize length;
+  usize object_size;
+  bool  writer;
+  usize depth;
+};
+
+
+static SharedHeader* shared_header(const SharedVector* this) {
+  return (SharedHeader*)this->base;
+}
+
+static u8* shared_object(const SharedVector* this, const usize index) {
+  return this->base + SHARED_DATA_OFFSET + index * this->object_size;
+}
+
+SharedVector* shared_vector_create(
+  const char*         name,
+  const usize         object_size,
+  const VectorOptions options
+) {
+  if (object_size == 0 || options.interface != nullptr) {
+    return nullptr;
+  }
+
+  SharedVector* this = calloc(1, sizeof(SharedVector));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->fd = name != nullptr
+    ? shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)
+    : memfd_create("castor", MFD_CLOEXEC);
+  if (this->fd < 0) {
+    free(this);
+    return nullptr;
+  }
+
+  // Default to 16 if the capacity is 0, as vector_grow does
+  const usize capacity = options.capacity ? options.capacity : 16;
+  this->length = SHARED_DATA_OFFSET + capacity * object_size;
+  this->object_size = object_size;
+  this->writer = true;
+
+  if (ftruncate(this->fd, (off_t)this->length) != 0) {
+    goto fail;
+  }
+
+  this->base = mmap(
+    nullptr, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0
+  );
+  if (this->base == MAP_FAILED) {
+    goto fail;
+  }
+
+  SharedHeader* header = shared_header(this);
+  memcpy(header->magic, SHARED_MAGIC, sizeof(header->magic));
+  header->version = SHARED_VERSION;
+  header->header_size = sizeof(SharedHeader);
+  header->object_size = object_size;
+  header->data_offset = SHARED_DATA_OFFSET;
+  atomic_store_explicit(&header->capacity, capacity, memory_order_relaxed);
+  atomic_store_explicit(&header->count, 0, memory_order_relaxed);
+  atomic_store_explicit(&header->sequence, 0, memory_order_release);
+
+  return this;
+
+fail:
+  close(this->fd);
+  if (name != nullptr) {
+    shm_unlink(name);
+  }
+  free(this);
+  return nullptr;
+}
+
+// Maps the header and the objects of an existing segment as a reader
+static SharedVector* shared_vector_map(int fd) {
+  SharedVector* this = calloc(1, sizeof(SharedVector));
+  struct stat st;
+  if (
+    this == nullptr || fstat(fd, &st) != 0 ||
+    (usize)st.st_size < SHARED_DATA_OFFSET
+  ) {
+    free(this);
+    close(fd);
+    return nullptr;
+  }
+
+  this->fd = fd;
+  this->length = (usize)st.st_size;
+  this->base = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+  if (this->base == MAP_FAILED) {
+    free(this);
+    close(fd);
+    return nullptr;
+  }
+
+  const SharedHeader* header = shared_header(this);
+  if (
+    memcmp(header->magic, SHARED_MAGIC, sizeof(header->magic)) != 0 ||
+    header->version != SHARED_VERSION ||
+    header->header_size != sizeof(SharedHeader) ||
+    header->data_offset != SHARED_DATA_OFFSET ||
+    header->object_size == 0
+  ) {
+    shared_vector_destruct(this);
+    return nullptr;
+  }
+
+  this->object_size = header->object_size;
+  return this;
+}
+
+SharedVector* shared_vector_open(const char* name) {
+  int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return shared_vector_map(fd);
+}
+
+SharedVector* shared_vector_adopt(int fd) {
+  int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (copy < 0) {
+    return nullptr;
+  }
+  return shared_vector_map(copy);
+}
+
+void shared_vector_destruct(SharedVector* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  munmap(this->base, this->length);
+  close(this->fd);
+  free(this);
+}
+
+bool shared_vector_unlink(const char* name) {
+  return shm_unlink(name) == 0;
+}
+
+int shared_vector_fd(const SharedVector* this) {
+  return this->fd;
+}
+
+bool shared_vector_begin(SharedVector* this) {
+  if (!this->writer) {
+    return false;
+  }
+
+  // Only the outermost section makes the sequence odd
+  if (this->depth++ == 0) {
+    SharedHeader* header = shared_header(this);
+    u64 sequence = atomic_load_explicit(
+      &header->sequence, memory_order_relaxed
+    );
+    atomic_store_explicit(
+      &header->sequence, sequence + 1, memory_order_relaxed
+    );
+    // Readers must not see the modifications before the odd sequence
+    atomic_thread_fence(memory_order_release);
+  }
+
+  return true;
+}
+
+bool shared_vector_end(SharedVector* this) {
+  if (!this->writer || this->depth == 0) {
+    return false;
+  }
+
+  if (--this->depth == 0) {
+    SharedHeader* header = shared_header(this);
+    u64 sequence = atomic_load_explicit(
+      &header->sequence, memory_order_relaxed
+    );
+    atomic_store_explicit(
+      &header->sequence, sequence + 1, memory_order_release
+    );
+  }
+
+  return true;
+}
+
+// Doubles the segment. Called by the writer inside a publication section.
+static bool shared_vector_grow(SharedVector* this) {
+  SharedHeader* header = shared_header(this);
+  const usize capacity = atomic_load_explicit(
+    &header->capacity, memory_order_relaxed
+  );
+  const usize new_capacity = capacity * 2;
+  const usize length = SHARED_DATA_OFFSET + new_capacity * this->object_size;
+
+  // The segment only grows, so the readers' smaller mappings stay valid
+  if (ftruncate(this->fd, (off_t)length) != 0) {
+    return false;
+  }
+
+  void* base = mremap(this->base, this->length, length, MREMAP_MAYMOVE);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  this->base = base;
+  this->length = length;
+  atomic_store_explicit(
+    &shared_header(this)->capacity, new_capacity, memory_order_relaxed
+  );
+
+  return true;
+}
+
+bool shared_vector_push_back(SharedVector* this, void* object) {
+  if (!shared_vector_begin(this)) {
+    return false;
+  }
+
+  SharedHeader* header = shared_header(this);
+  const usize count = atomic_load_explicit(
+    &header->count, memory_order_relaxed
+  );
+  const usize capacity = atomic_load_explicit(
+    &header->capacity, memory_order_relaxed
+  );
+  bool ok = count < capacity || shared_vector_grow(this);
+
+  if (ok) {
+    memcpy(shared_object(this, count), object, this->object_size);
+    atomic_store_explicit(
+      &shared_header(this)->count, count + 1, memory_order_relaxed
+    );
+  }
+
+  shared_vector_end(this);
+  return ok;
+}
+
+bool shared_vector_set(SharedVector* this, const usize index, void* object) {
+  if (!this->writer) {
+    return false;
+  }
+
+  SharedHeader* header = shared_header(this);
+  if (index >= atomic_load_explicit(&header->count, memory_order_relaxed)) {
+    return false;
+  }
+
+  shared_vector_begin(this);
+  memcpy(shared_object(this, index), object, this->object_size);
+  shared_vector_end(this);
+
+  return true;
+}
+
+bool shared_vector_discard_back(SharedVector* this) {
+  if (!this->writer) {
+    return false;
+  }
+
+  SharedHeader* header = shared_header(this);
+  const usize count = atomic_load_explicit(
+    &header->count, memory_order_relaxed
+  );
+  if (count == 0) {
+    return false;
+  }
+
+  shared_vector_begin(this);
+  atomic_store_explicit(&header->count, count - 1, memory_order_relaxed);
+  shared_vector_end(this);
+
+  return true;
+}
+
+bool shared_vector_reset(SharedVector* this) {
+  if (!shared_vector_begin(this)) {
+    return false;
+  }
+
+  atomic_store_explicit(&shared_header(this)->count, 0, memory_order_relaxed);
+  shared_vector_end(this);
+
+  return true;
+}
+
+u64 shared_vector_read_begin(SharedVector* this, usize* count) {
+  SharedHeader* header = shared_header(this);
+
+  for (;;) {
+    u64 sequence = atomic_load_explicit(
+      &header->sequence, memory_order_acquire
+    );
+    // The writer is modifying the segment. The writer itself reads its own
+    // modifications.
+    if ((sequence & 1) && !this->writer) {
+      sched_yield();
+      continue;
+    }
+
+    const usize capacity = atomic_load_explicit(
+      &header->capacity, memory_order_relaxed
+    );
+    *count = atomic_load_explicit(&header->count, memory_order_relaxed);
+
+    // Follow the growth of the segment
+    const usize length = SHARED_DATA_OFFSET + capacity * this->object_size;
+    if (length > this->length && !this->writer) {
+      void* base = mremap(this->base, this->length, length, MREMAP_MAYMOVE);
+      if (base == MAP_FAILED) {
+        // Only the objects of the current mapping can be read
+        *count = (this->length - SHARED_DATA_OFFSET) / this->object_size;
+        return sequence;
+      }
+      this->base = base;
+      this->length = length;
+      header = shared_header(this);
+    }
+
+    return sequence;
+  }
+}
+
+const void* shared_vector_data(const SharedVector* this) {
+  return shared_object(this, 0);
+}
+
+bool shared_vector_read_retry(const SharedVector* this, const u64 sequence) {
+  // The reads of the objects must complete before the sequence is checked
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(
+    &shared_header(this)->sequence, memory_order_relaxed
+  ) != sequence;
+}
+
+bool shared_vector_read(SharedVector* this, const usize index, void* dest) {
+  for (;;) {
+    usize count;
+    u64 sequence = shared_vector_read_begin(this, &count);
+    if (index >= count) {
+      if (!shared_vector_read_retry(this, sequence)) {
+        return false;
+      }
+      continue;
+    }
+
+    memcpy(dest, shared_object(this, index), this->object_size);
+    if (!shared_vector_read_retry(this, sequence)) {
+      return true;
+    }
+  }
+}
+
+usize shared_vector_count(SharedVector* this) {
+  for (;;) {
+    usize count;
+    u64 sequence = shared_vector_read_begin(this, &count);
+    if (!shared_vector_read_retry(this, sequence)) {
+      return count;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include "castor/site.h"
+#include "castor/types.h"
+#include "site_internal.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+
+// Buckets of the histogram of a site: bucket b holds the counts of b bits
+#define SITE_BUCKETS 63
+
+// Share of the Vectors the learned capacity holds
+#define SITE_PERCENTILE 0.9f
+
+// Each record scales the histogram by 1 - SITE_DECAY, so that the estimate
+// is made of the last 1 / SITE_DECAY records or so
+#define SITE_DECAY (1.0f / 32.0f)
+
+
+// Member:
+// - tag:
+//    Copy of the tag, nullptr while the entry is free. Set once, after the
+//    other members, so that it can be read without the lock.
+// - hash:
+//    Hash of the tag.
+// - lock:
+//    Protects weights and samples.
+// - weights:
+//    Decayed number of the final counts in each bucket.
+// - samples:
+//    Number of Vectors recorded or imported.
+// - capacity:
+//    Capacity learned, read without the lock by the constructs.
+struct VectorSiteState {
+  _Atomic(const char*) tag;
+  u64                  hash;
+  mtx_t                lock;
+  f32                  weights[SITE_BUCKETS];
+  u64                  samples;
+  _Atomic usize        capacity;
+};
+
+
+static once_flag site_once = ONCE_FLAG_INIT;
+
+// Protects the insertion of the sites
+static mtx_t site_lock;
+
+// Open addressing table of the sites
+static VectorSiteState vector_sites[VECTOR_SITES];
+
+
+static void site_init(void) {
+  mtx_init(&site_lock, mtx_plain);
+}
+
+// FNV-1a
+static u64 site_hash(const char* tag) {
+  u64 hash = 0xcbf29ce484222325;
+  for (const u8* c = (const u8*)tag; *c != '\0'; c++) {
+    hash = (hash ^ *c) * 0x100000001b3;
+  }
+  return hash;
+}
+
+// Returns the site of the tag, or the free entry where it belongs if
+// insert is true, or nullptr
+static VectorSiteState* site_probe(
+  const char* tag,
+  const u64   hash,
+  const bool  insert
+) {
+  for (usize i = 0; i < VECTOR_SITES; i++) {
+    VectorSiteState* site = &vector_sites[(hash + i) % VECTOR_SITES];
+    const char* other = atomic_load_explicit(&site->tag, memory_order_acquire);
+    if (other == nullptr) {
+      return insert ? site : nullptr;
+    }
+    if (site->hash == hash && strcmp(other, tag) == 0) {
+      return site;
+    }
+  }
+  return nullptr;
+}
+
+VectorSiteState* vector_site_find(const char* tag) {
+  const u64 hash = site_hash(tag);
+  VectorSiteState* site = site_probe(tag, hash, false);
+  if (site != nullptr) {
+    return site;
+  }
+
+  // Insert under the lock, unless another thread just did
+  call_once(&site_once, site_init);
+  mtx_lock(&site_lock);
+  site = site_probe(tag, hash, true);
+  if (
+    site != nullptr &&
+    atomic_load_explicit(&site->tag, memory_order_relaxed) == nullptr
+  ) {
+    char* copy = strdup(tag);
+    if (copy == nullptr) {
+      site = nullptr;
+    } else {
+      site->hash = hash;
+      mtx_init(&site->lock, mtx_plain);
+      atomic_store_explicit(&site->tag, copy, memory_order_release);
+    }
+  }
+  mtx_unlock(&site_lock);
+  return site;
+}
+
+usize vector_site_capacity(const VectorSiteState* this) {
+  return atomic_load_explicit(&this->capacity, memory_order_relaxed);
+}
+
+// Returns the bucket of the count, its number of bits
+static usize site_bucket(const usize count) {
+  const usize bits = count > 0 ? 64 - (usize)__builtin_clzll(count) : 0;
+  return bits < SITE_BUCKETS ? bits : SITE_BUCKETS - 1;
+}
+
+// Returns the capacity holding every count of the bucket. It is the power of
+// two above them, the capacity a growing Vector reaches and the size class
+// of the cache, so that the Vector uses exactly the capacity learned.
+static usize site_bucket_capacity(const usize bucket) {
+  return bucket > 0 ? (usize)1 << bucket : 0;
+}
+
+void vector_site_record(VectorSiteState* this, const usize count) {
+  mtx_lock(&this->lock);
+  f32 total = 0.0f;
+  for (usize b = 0; b < SITE_BUCKETS; b++) {
+    this->weights[b] *= 1.0f - SITE_DECAY;
+    total += this->weights[b];
+  }
+  this->weights[site_bucket(count)] += 1.0f;
+  total += 1.0f;
+  this->samples++;
+
+  // The smallest bucket up to which the percentile of the weight is
+  f32 sum = 0.0f;
+  usize bucket = 0;
+  while (bucket < SITE_BUCKETS - 1) {
+    sum += this->weights[bucket];
+    if (sum >= SITE_PERCENTILE * total) {
+      break;
+    }
+    bucket++;
+  }
+  atomic_store_explicit(
+    &this->capacity, site_bucket_capacity(bucket), memory_order_relaxed
+  );
+  mtx_unlock(&this->lock);
+}
+
+bool vector_site_read(const char* tag, VectorSite* site) {
+  VectorSiteState* state = site_probe(tag, site_hash(tag), false);
+  if (state == nullptr) {
+    return false;
+  }
+
+  mtx_lock(&state->lock);
+  *site = (VectorSite){
+    .tag      = atomic_load_explicit(&state->tag, memory_order_relaxed),
+    .capacity = vector_site_capacity(state),
+    .samples  = state->samples,
+  };
+  mtx_unlock(&state->lock);
+  return true;
+}
+
+bool vector_sites_export(FILE* out) {
+  for (usize i = 0; i < VECTOR_SITES; i++) {
+    VectorSiteState* state = &vector_sites[i];
+    const char* tag = atomic_load_explicit(&state->tag, memory_order_acquire);
+    if (tag == nullptr) {
+      continue;
+    }
+
+    VectorSite site;
+    vector_site_read(tag, &site);
+    if (fprintf(
+      out, "capacity=%zu samples=%llu site=%s\n",
+      (size_t)site.capacity, (unsigned long long)site.samples, site.tag
+    ) < 0) {
+      return false;
+    }
+  }
+  return fflush(out) == 0;
+}
+
+bool vector_sites_import(FILE* in) {
+  char line[512];
+  while (fgets(line, sizeof(line), in) != nullptr) {
+    const usize length = strcspn(line, "\n");
+    if (line[length] != '\n' && !feof(in)) {
+      return false;
+    }
+    line[length] = '\0';
+
+    size_t capacity;
+    unsigned long long samples;
+    int tag = 0;
+    if (
+      sscanf(line, "capacity=%zu samples=%llu site=%n", &capacity, &samples,
+        &tag) != 2 ||
+      tag == 0 || line[tag] == '\0'
+    ) {
+      return false;
+    }
+
+    VectorSiteState* state = vector_site_find(line + tag);
+    if (state == nullptr) {
+      continue;
+    }
+
+    // Weigh the imported capacity as the records would, up to their limit
+    mtx_lock(&state->lock);
+    memset(state->weights, 0, sizeof(state->weights));
+    state->weights[site_bucket(capacity > 0 ? capacity - 1 : 0)] =
+      samples < 1.0f / SITE_DECAY ? (f32)samples : 1.0f / SITE_DECAY;
+    state->samples = samples;
+    atomic_store_explicit(&state->capacity, capacity, memory_order_relaxed);
+    mtx_unlock(&state->lock);
+  }
+  return !ferror(in);
+}
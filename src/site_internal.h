@@ -0,0 +1,18 @@
+#pragma once
+#include "castor/site.h"
+#include "castor/types.h"
+
+
+// The state of a call site, see site.c.
+typedef struct VectorSiteState VectorSiteState;
+
+
+// Returns the state of the site with the given tag, tracking it if it is
+// new. Returns nullptr if every site is taken.
+VectorSiteState* vector_site_find(const char* tag);
+
+// Returns the initial capacity learned for the site, 0 if none.
+usize vector_site_capacity(const VectorSiteState*);
+
+// Records the final count of a Vector of the site.
+void vector_site_record(VectorSiteState*, const usize count);
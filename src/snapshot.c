@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+#include "castor/snapshot.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include "snapshot_internal.h"
+#include "vector_internal.h"
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+// Member:
+// - base:
+//    Start of the mapping (the snapshot header).
+// - length:
+//    Length of the mapping in bytes.
+typedef struct SnapshotMapping {
+  void* base;
+  usize length;
+} SnapshotMapping;
+
+
+u64 snapshot_checksum_begin(const usize length) {
+  return length * 0x9E3779B97F4A7C15ull;
+}
+
+u64 snapshot_checksum_update(u64 hash, const void* data, const usize length) {
+  const u64 prime = 0x9E3779B97F4A7C15ull;
+  const u8* bytes = data;
+  usize i = 0;
+
+  // Mix the payload 8 bytes at a time
+  for (; i + sizeof(u64) <= length; i += sizeof(u64)) {
+    u64 word;
+    memcpy(&word, bytes + i, sizeof(u64));
+    hash ^= word * prime;
+    hash = (hash << 31 | hash >> 33) * 0xC2B2AE3D27D4EB4Full;
+  }
+
+  // Mix the remaining bytes
+  for (; i < length; i++) {
+    hash ^= bytes[i] * prime;
+    hash = (hash << 31 | hash >> 33) * 0xC2B2AE3D27D4EB4Full;
+  }
+
+  return hash;
+}
+
+u64 snapshot_checksum_end(u64 hash) {
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+u64 snapshot_checksum(const void* data, const usize length) {
+  u64 hash = snapshot_checksum_begin(length);
+  hash = snapshot_checksum_update(hash, data, length);
+  return snapshot_checksum_end(hash);
+}
+
+bool snapshot_save(const Vector* this, const char* path) {
+  if (this->interface != nullptr) {
+    return false;
+  }
+  // The payload is written from the content, and settling does not change
+  // the objects
+  vector_settle((Vector*)this);
+
+  static const u8 padding[SNAPSHOT_ALIGNMENT - sizeof(SnapshotHeader)];
+  const usize payload_size = this->count * this->object_size;
+
+  SnapshotHeader header = {
+    .version        = SNAPSHOT_VERSION,
+    .header_size    = sizeof(SnapshotHeader),
+    .object_size    = this->object_size,
+    .count          = this->count,
+    .alignment      = SNAPSHOT_ALIGNMENT,
+    .payload_offset = SNAPSHOT_ALIGNMENT,
+    .checksum       = snapshot_checksum(this->content, payload_size),
+  };
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+
+  // The file is written beside the target and renamed over it: a mapping
+  // of the previous snapshot keeps its content, and a crash leaves either
+  // the previous snapshot or the new one
+  char temporary[PATH_MAX];
+  char directory[PATH_MAX];
+  if (
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path)
+      >= (int)sizeof(temporary) ||
+    snprintf(directory, sizeof(directory), "%s", path)
+      >= (int)sizeof(directory)
+  ) {
+    return false;
+  }
+
+  int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct iovec iov[] = {
+    { .iov_base = &header,          .iov_len = sizeof(header) },
+    { .iov_base = (void*)padding,   .iov_len = sizeof(padding) },
+    { .iov_base = this->content,    .iov_len = payload_size },
+  };
+  bool ok = io_writev_all(fd, iov, payload_size > 0 ? 3 : 2)
+    && fdatasync(fd) == 0;
+  // A failed close may report a deferred write error
+  ok = close(fd) == 0 && ok;
+
+  // Replace the target atomically, then persist the rename
+  if (!ok || rename(temporary, path) != 0) {
+    unlink(temporary);
+    return false;
+  }
+
+  int dir = open(dirname(directory), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+
+  return true;
+}
+
+static bool snapshot_readonly_resize(Vector*, const usize) {
+  return false;
+}
+
+static void snapshot_release(Vector* this) {
+  SnapshotMapping* mapping = this->storage_context;
+  munmap(mapping->base, mapping->length);
+  free(mapping);
+}
+
+// Moves the content to the heap on the first growth, as a mapping of the
+// file can not grow
+static bool snapshot_copy_on_write_resize(
+  Vector*     this,
+  const usize new_capacity
+) {
+  if (new_capacity < this->count) {
+    return false;
+  }
+
+  u8* content = (u8*)malloc(new_capacity * this->object_size);
+  if (content == nullptr) {
+    return false;
+  }
+  memcpy(content, this->content, this->count * this->object_size);
+
+  snapshot_release(this);
+  this->content = content;
+  this->capacity = new_capacity;
+  this->storage = nullptr;
+  this->storage_context = nullptr;
+
+  return true;
+}
+
+static const VectorStorage SNAPSHOT_READONLY_STORAGE = {
+  .resize  = snapshot_readonly_resize,
+  .release = snapshot_release,
+};
+
+static const VectorStorage SNAPSHOT_COPY_ON_WRITE_STORAGE = {
+  .resize  = snapshot_copy_on_write_resize,
+  .release = snapshot_release,
+};
+
+bool snapshot_valid(const SnapshotHeader* header, const usize size) {
+  if (
+    memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+    header->version != SNAPSHOT_VERSION ||
+    header->header_size != sizeof(SnapshotHeader) ||
+    header->object_size == 0 ||
+    header->payload_offset < sizeof(SnapshotHeader) ||
+    header->payload_offset % SNAPSHOT_ALIGNMENT != 0 ||
+    header->payload_offset > size
+  ) {
+    return false;
+  }
+
+  // The payload must fit in the file without overflowing
+  usize available = size - header->payload_offset;
+  return header->count <= available / header->object_size;
+}
+
+Vector* snapshot_load(const char* path, const SnapshotOptions options) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (usize)st.st_size < sizeof(SnapshotHeader)) {
+    close(fd);
+    return nullptr;
+  }
+
+  const bool readonly = options.mode == SNAPSHOT_READONLY;
+  const usize length = (usize)st.st_size;
+  void* base = mmap(
+    nullptr,
+    length,
+    readonly ? PROT_READ : PROT_READ | PROT_WRITE,
+    readonly ? MAP_SHARED : MAP_PRIVATE,
+    fd,
+    0
+  );
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const SnapshotHeader* header = base;
+  u8* payload = (u8*)base + header->payload_offset;
+  if (
+    !snapshot_valid(header, length) ||
+    (options.verify && snapshot_checksum(
+      payload, header->count * header->object_size
+    ) != header->checksum)
+  ) {
+    munmap(base, length);
+    return nullptr;
+  }
+
+  Vector* this = vector_construct(header->object_size, (VectorOptions){});
+  SnapshotMapping* mapping = malloc(sizeof(SnapshotMapping));
+  if (this == nullptr || mapping == nullptr) {
+    vector_destruct(this);
+    free(mapping);
+    munmap(base, length);
+    return nullptr;
+  }
+
+  if (readonly) {
+    this->flags |= VECTOR_FLAG_READONLY;
+  }
+
+  // Nothing to map, keep an unallocated vector
+  if (header->count == 0) {
+    free(mapping);
+    munmap(base, length);
+    return this;
+  }
+
+  *mapping = (SnapshotMapping){ .base = base, .length = length };
+  this->content = payload;
+  this->capacity = header->count;
+  this->count = header->count;
+  this->storage = readonly
+    ? &SNAPSHOT_READONLY_STORAGE
+    : &SNAPSHOT_COPY_ON_WRITE_STORAGE;
+  this->storage_context = mapping;
+
+  return this;
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include "castor/snapshot.h"
+#include "castor/types.h"
+
+
+// Alignment of the payload inside a snapshot file
+#define SNAPSHOT_ALIGNMENT 4096
+
+
+// Incremental form of snapshot_checksum, for payloads that are not in memory
+// all at once. Every call to snapshot_checksum_update but the last must
+// cover a multiple of 8 bytes.
+u64 snapshot_checksum_begin(const usize length);
+u64 snapshot_checksum_update(u64 hash, const void* data, const usize length);
+u64 snapshot_checksum_end(u64 hash);
+
+// Checks the header of a snapshot file of size bytes: its format, and that
+// its payload fits in the file without overflowing.
+bool snapshot_valid(const SnapshotHeader*, const usize size);
@@ -1,11 +1,20 @@
 #include "castor/stack.h"
+#include "castor/pool.h"
+#include "castor/stats.h"
 #include "castor/vector.h"
 #include "castor/types.h"
+#include "pool_internal.h"
 #include <stdlib.h>
 
 
+// Member:
+// - vector:
+//    Holds the objects.
+// - pool:
+//    Pool the Stack and its Vector are in, nullptr for the heap.
 struct Stack {
   Vector* vector;
+  Pool*   pool;
 };
 
 
@@ -30,7 +39,31 @@ void stack_destruct(Stack* this) {
   }
 
   vector_destruct(this->vector);
-  free(this);
+  if (this->pool != nullptr) {
+    pool_free(this->pool, this);
+  } else {
+    free(this);
+  }
+}
+
+Stack* pool_stack_construct(
+  Pool*               pool,
+  const usize         object_size,
+  const VectorOptions options
+) {
+  Stack* stack = pool_allocate(pool, sizeof(Stack));
+  if (stack == nullptr) {
+    return nullptr;
+  }
+
+  stack->pool = pool;
+  stack->vector = pool_vector_construct(pool, object_size, options);
+  if (stack->vector == nullptr) {
+    pool_free(pool, stack);
+    return nullptr;
+  }
+
+  return stack;
 }
 
 bool stack_push(Stack* this, void* object) {
@@ -62,4 +95,8 @@ Stack* stack_copy(const Stack* this, const bool shrink_to_fit) {
   }
 
   return clone;
+}
+
+bool stack_stats(const Stack* this, VectorStats* stats) {
+  return vector_stats(this->vector, stats);
 }
\ No newline at end of file
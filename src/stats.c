@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+#include "castor/stats.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "vector_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+
+static const char* vector_operation_names[VECTOR_OPERATIONS] = {
+  [VECTOR_OPERATION_GROW]          = "grow",
+  [VECTOR_OPERATION_PUSH_BACK]     = "push_back",
+  [VECTOR_OPERATION_PUSH_FRONT]    = "push_front",
+  [VECTOR_OPERATION_DISCARD_BACK]  = "discard_back",
+  [VECTOR_OPERATION_DISCARD_FRONT] = "discard_front",
+  [VECTOR_OPERATION_DISCARD]       = "discard",
+  [VECTOR_OPERATION_POP_BACK]      = "pop_back",
+  [VECTOR_OPERATION_POP_FRONT]     = "pop_front",
+  [VECTOR_OPERATION_POP]           = "pop",
+  [VECTOR_OPERATION_SET]           = "set",
+  [VECTOR_OPERATION_INSERT]        = "insert",
+  [VECTOR_OPERATION_COPY]          = "copy",
+  [VECTOR_OPERATION_RESET]         = "reset",
+  [VECTOR_OPERATION_RELEASE]       = "release",
+  [VECTOR_OPERATION_APPEND]        = "append",
+};
+
+const char* vector_operation_name(const VectorOperation operation) {
+  return operation < VECTOR_OPERATIONS
+    ? vector_operation_names[operation]
+    : "unknown";
+}
+
+
+#ifdef CASTOR_STATS
+
+// The counters of a Vector are updated without synchronization, as the
+// Vector itself, so reading those of a Vector used by another thread at
+// the same time gives approximate values.
+
+// A Vector listed by vector_stats_dump
+typedef struct VectorStatsEntry {
+  const Vector* vector;
+  usize         object_size;
+  VectorStats   stats;
+} VectorStatsEntry;
+
+
+static once_flag vector_stats_once = ONCE_FLAG_INIT;
+
+// Protects the list and the counters of the destructed Vectors
+static mtx_t vector_stats_lock;
+
+// First Vector of the list of the Vectors alive
+static Vector* vector_stats_alive;
+
+// Sum of the counters of the destructed Vectors
+static VectorStats vector_stats_retired;
+
+
+static void vector_stats_init(void) {
+  mtx_init(&vector_stats_lock, mtx_plain);
+}
+
+static void vector_stats_lock_acquire(void) {
+  call_once(&vector_stats_once, vector_stats_init);
+  mtx_lock(&vector_stats_lock);
+}
+
+void vector_stats_register(Vector* this) {
+  vector_stats_lock_acquire();
+  this->stats.previous = nullptr;
+  this->stats.next = vector_stats_alive;
+  if (vector_stats_alive != nullptr) {
+    vector_stats_alive->stats.previous = this;
+  }
+  vector_stats_alive = this;
+  mtx_unlock(&vector_stats_lock);
+}
+
+// Reads the counters of a Vector into stats
+static void vector_stats_read(const Vector* this, VectorStats* stats) {
+  *stats = (VectorStats){
+    .reallocs    = this->stats.reallocs,
+    .bytes_moved = this->stats.bytes_moved,
+    .vectors     = 1,
+    .count       = this->count * this->object_size,
+    .capacity    = this->capacity * this->object_size,
+  };
+  memcpy(
+    stats->operations, this->stats.operations, sizeof(stats->operations)
+  );
+
+  // A storage may set the capacity without a resize, as a loaded snapshot
+  const usize peak = this->stats.peak_capacity > this->capacity
+    ? this->stats.peak_capacity
+    : this->capacity;
+  stats->peak_capacity = peak * this->object_size;
+  stats->wasted_capacity = stats->capacity - stats->count;
+}
+
+// Adds the counters of stats to total. The capacities are only added if
+// alive is true.
+static void vector_stats_add(
+  VectorStats*       total,
+  const VectorStats* stats,
+  const bool         alive
+) {
+  for (usize i = 0; i < VECTOR_OPERATIONS; i++) {
+    total->operations[i] += stats->operations[i];
+  }
+  total->reallocs += stats->reallocs;
+  total->bytes_moved += stats->bytes_moved;
+  if (stats->peak_capacity > total->peak_capacity) {
+    total->peak_capacity = stats->peak_capacity;
+  }
+
+  if (alive) {
+    total->vectors += stats->vectors;
+    total->count += stats->count;
+    total->capacity += stats->capacity;
+    total->wasted_capacity += stats->wasted_capacity;
+  }
+}
+
+void vector_stats_unregister(Vector* this) {
+  VectorStats stats;
+  vector_stats_read(this, &stats);
+
+  vector_stats_lock_acquire();
+  if (this->stats.previous != nullptr) {
+    this->stats.previous->stats.next = this->stats.next;
+  } else {
+    vector_stats_alive = this->stats.next;
+  }
+  if (this->stats.next != nullptr) {
+    this->stats.next->stats.previous = this->stats.previous;
+  }
+  vector_stats_add(&vector_stats_retired, &stats, false);
+  mtx_unlock(&vector_stats_lock);
+}
+
+bool vector_stats(const Vector* this, VectorStats* stats) {
+  vector_stats_read(this, stats);
+  return true;
+}
+
+bool vector_stats_global(VectorStats* stats) {
+  vector_stats_lock_acquire();
+  *stats = vector_stats_retired;
+  for (Vector* v = vector_stats_alive; v != nullptr; v = v->stats.next) {
+    VectorStats alive;
+    vector_stats_read(v, &alive);
+    vector_stats_add(stats, &alive, true);
+  }
+  mtx_unlock(&vector_stats_lock);
+  return true;
+}
+
+void vector_stats_reset(Vector* this) {
+  memset(this->stats.operations, 0, sizeof(this->stats.operations));
+  this->stats.reallocs = 0;
+  this->stats.bytes_moved = 0;
+  this->stats.peak_capacity = this->capacity;
+}
+
+// Writes the operations that were called at least once
+static bool vector_stats_dump_operations(FILE* out, const VectorStats* stats) {
+  for (usize i = 0; i < VECTOR_OPERATIONS; i++) {
+    if (stats->operations[i] == 0) {
+      continue;
+    }
+    if (fprintf(
+      out, " %s=%llu", vector_operation_names[i],
+      (unsigned long long)stats->operations[i]
+    ) < 0) {
+      return false;
+    }
+  }
+  return fputc('\n', out) != EOF;
+}
+
+// Sorts the entries by decreasing wasted capacity
+static int vector_stats_compare(const void* a, const void* b) {
+  const usize x = ((const VectorStatsEntry*)a)->stats.wasted_capacity;
+  const usize y = ((const VectorStatsEntry*)b)->stats.wasted_capacity;
+  return (x < y) - (x > y);
+}
+
+bool vector_stats_dump(FILE* out, const usize limit) {
+  // Copy the statistics under the lock, and write them without it
+  vector_stats_lock_acquire();
+  usize alive = 0;
+  for (Vector* v = vector_stats_alive; v != nullptr; v = v->stats.next) {
+    alive++;
+  }
+
+  VectorStats total = vector_stats_retired;
+  VectorStatsEntry* entries = malloc(
+    (alive ? alive : 1) * sizeof(VectorStatsEntry)
+  );
+  usize n = 0;
+  for (Vector* v = vector_stats_alive; v != nullptr; v = v->stats.next) {
+    VectorStats stats;
+    vector_stats_read(v, &stats);
+    vector_stats_add(&total, &stats, true);
+    if (entries != nullptr) {
+      entries[n++] = (VectorStatsEntry){ v, v->object_size, stats };
+    }
+  }
+  mtx_unlock(&vector_stats_lock);
+
+  qsort(entries, n, sizeof(VectorStatsEntry), vector_stats_compare);
+
+  bool ok = fprintf(
+    out,
+    "vectors=%zu count=%zu capacity=%zu peak_capacity=%zu "
+    "wasted_capacity=%zu reallocs=%llu bytes_moved=%llu",
+    (size_t)total.vectors, (size_t)total.count, (size_t)total.capacity,
+    (size_t)total.peak_capacity, (size_t)total.wasted_capacity,
+    (unsigned long long)total.reallocs,
+    (unsigned long long)total.bytes_moved
+  ) >= 0 && vector_stats_dump_operations(out, &total);
+
+  const usize listed = limit > 0 && limit < n ? limit : n;
+  for (usize i = 0; ok && i < listed; i++) {
+    const VectorStats* stats = &entries[i].stats;
+    ok = fprintf(
+      out,
+      "  %p object_size=%zu count=%zu capacity=%zu peak_capacity=%zu "
+      "wasted_capacity=%zu reallocs=%llu bytes_moved=%llu",
+      (const void*)entries[i].vector, (size_t)entries[i].object_size,
+      (size_t)stats->count, (size_t)stats->capacity,
+      (size_t)stats->peak_capacity, (size_t)stats->wasted_capacity,
+      (unsigned long long)stats->reallocs,
+      (unsigned long long)stats->bytes_moved
+    ) >= 0 && vector_stats_dump_operations(out, stats);
+  }
+
+  free(entries);
+  return ok && fflush(out) == 0;
+}
+
+#else
+
+bool vector_stats(const Vector*, VectorStats*) {
+  return false;
+}
+
+bool vector_stats_global(VectorStats*) {
+  return false;
+}
+
+void vector_stats_reset(Vector*) {}
+
+bool vector_stats_dump(FILE*, const usize) {
+  return false;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+#include "castor/stats.h"
+#include "castor/types.h"
+
+
+// The counting hooks of the Vector functions. Without CASTOR_STATS they
+// expand to nothing, and Vector has no counters.
+#ifdef CASTOR_STATS
+
+// Member:
+// - operations, reallocs, bytes_moved:
+//    As in VectorStats.
+// - peak_capacity:
+//    Largest capacity reached, in objects.
+// - previous, next:
+//    Links of the list of the Vectors alive.
+typedef struct VectorCounters {
+  u64            operations[VECTOR_OPERATIONS];
+  u64            reallocs;
+  u64            bytes_moved;
+  usize          peak_capacity;
+  struct Vector* previous;
+  struct Vector* next;
+} VectorCounters;
+
+// Adds a constructed Vector to the list of the Vectors alive.
+void vector_stats_register(Vector*);
+
+// Removes a Vector from the list before it is destructed, and adds its
+// counters to those of the destructed Vectors.
+void vector_stats_unregister(Vector*);
+
+#define VECTOR_STATS_OPERATION(vector, operation) \
+  ((vector)->stats.operations[VECTOR_OPERATION_##operation]++)
+
+#define VECTOR_STATS_MOVE(vector, bytes) \
+  ((vector)->stats.bytes_moved += (bytes))
+
+// After an allocation or reallocation of the content
+#define VECTOR_STATS_RESIZE(vector)                                           \
+  do {                                                                        \
+    (vector)->stats.reallocs++;                                               \
+    if ((vector)->capacity > (vector)->stats.peak_capacity) {                 \
+      (vector)->stats.peak_capacity = (vector)->capacity;                     \
+    }                                                                         \
+  } while (0)
+
+#define VECTOR_STATS_REGISTER(vector)   vector_stats_register(vector)
+#define VECTOR_STATS_UNREGISTER(vector) vector_stats_unregister(vector)
+
+#else
+
+#define VECTOR_STATS_OPERATION(vector, operation) ((void)0)
+#define VECTOR_STATS_MOVE(vector, bytes)          ((void)0)
+#define VECTOR_STATS_RESIZE(vector)               ((void)0)
+#define VECTOR_STATS_REGISTER(vector)             ((void)0)
+#define VECTOR_STATS_UNREGISTER(vector)           ((void)0)
+
+#endif
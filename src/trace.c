@@ -0,0 +1,445 @@
+#define _GNU_SOURCE
+#include "castor/trace.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include "vector_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+
+// Maximum size of a record: the event byte and up to four varints
+#define TRACE_RECORD_MAX (1 + 4 * IO_VARINT_MAX)
+
+// Size of the buffer of each thread
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+
+static const char* vector_trace_event_names[VECTOR_TRACE_EVENTS] = {
+  [VECTOR_TRACE_CONSTRUCT]     = "construct",
+  [VECTOR_TRACE_ATTACH]        = "attach",
+  [VECTOR_TRACE_DESTRUCT]      = "destruct",
+  [VECTOR_TRACE_GROW]          = "grow",
+  [VECTOR_TRACE_PUSH_BACK]     = "push_back",
+  [VECTOR_TRACE_PUSH_FRONT]    = "push_front",
+  [VECTOR_TRACE_DISCARD_BACK]  = "discard_back",
+  [VECTOR_TRACE_DISCARD_FRONT] = "discard_front",
+  [VECTOR_TRACE_DISCARD]       = "discard",
+  [VECTOR_TRACE_POP_BACK]      = "pop_back",
+  [VECTOR_TRACE_POP_FRONT]     = "pop_front",
+  [VECTOR_TRACE_POP]           = "pop",
+  [VECTOR_TRACE_SET]           = "set",
+  [VECTOR_TRACE_INSERT]        = "insert",
+  [VECTOR_TRACE_COPY]          = "copy",
+  [VECTOR_TRACE_RESET]         = "reset",
+  [VECTOR_TRACE_RELEASE]       = "release",
+  [VECTOR_TRACE_GET]           = "get",
+  [VECTOR_TRACE_GET_BACK]      = "get_back",
+  [VECTOR_TRACE_GET_FRONT]     = "get_front",
+  [VECTOR_TRACE_WALK]          = "walk",
+  [VECTOR_TRACE_APPEND]        = "append",
+};
+
+const char* vector_trace_event_name(const VectorTraceEvent event) {
+  return event < VECTOR_TRACE_EVENTS
+    ? vector_trace_event_names[event]
+    : "unknown";
+}
+
+// Whether the event has an index argument
+static bool trace_indexed(const VectorTraceEvent event) {
+  switch (event) {
+    case VECTOR_TRACE_GROW:
+    case VECTOR_TRACE_DISCARD:
+    case VECTOR_TRACE_POP:
+    case VECTOR_TRACE_SET:
+    case VECTOR_TRACE_INSERT:
+    case VECTOR_TRACE_COPY:
+    case VECTOR_TRACE_GET:
+    case VECTOR_TRACE_APPEND:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool trace_next_byte(void* context, u8* byte) {
+  const int next = getc(context);
+  *byte = (u8)next;
+  return next != EOF;
+}
+
+static bool trace_read_varint(FILE* in, u64* value) {
+  return io_varint_decode(trace_next_byte, in, value);
+}
+
+bool vector_trace_read_header(FILE* in) {
+  u8 magic[8];
+  u32 version;
+  return
+    fread(magic, sizeof(magic), 1, in) == 1 &&
+    memcmp(magic, VECTOR_TRACE_MAGIC, sizeof(magic)) == 0 &&
+    fread(&version, sizeof(version), 1, in) == 1 &&
+    version == VECTOR_TRACE_VERSION;
+}
+
+bool vector_trace_read(FILE* in, VectorTraceRecord* record) {
+  const int event = getc(in);
+  if (event == EOF || event >= VECTOR_TRACE_EVENTS) {
+    return false;
+  }
+
+  *record = (VectorTraceRecord){ .event = (VectorTraceEvent)event };
+  if (!trace_read_varint(in, &record->vector)) {
+    return false;
+  }
+
+  switch (record->event) {
+    case VECTOR_TRACE_ATTACH:
+      return
+        trace_read_varint(in, &record->object_size) &&
+        trace_read_varint(in, &record->capacity) &&
+        trace_read_varint(in, &record->count);
+    case VECTOR_TRACE_CONSTRUCT:
+      return
+        trace_read_varint(in, &record->object_size) &&
+        trace_read_varint(in, &record->capacity);
+    case VECTOR_TRACE_COPY:
+      return
+        trace_read_varint(in, &record->index) &&
+        trace_read_varint(in, &record->copy);
+    default:
+      return
+        !trace_indexed(record->event) ||
+        trace_read_varint(in, &record->index);
+  }
+}
+
+
+#ifdef CASTOR_TRACE
+
+// The buffer of a thread. The thread appends to it under its lock, which
+// vector_trace_stop also takes to write the records of the other threads.
+// Member:
+// - lock:
+//    Held while the records are appended or written.
+// - generation:
+//    The trace of the records held.
+// - length:
+//    Number of bytes held.
+// - previous, next:
+//    Links of the list of the buffers.
+typedef struct TraceBuffer {
+  mtx_t               lock;
+  u32                 generation;
+  usize               length;
+  struct TraceBuffer* previous;
+  struct TraceBuffer* next;
+  u8                  bytes[TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+
+_Atomic u32 vector_trace_generation;
+
+static once_flag trace_once = ONCE_FLAG_INIT;
+
+// Protects the file, the lists of the buffers and of the Vectors, and the
+// generations. Taken before the lock of a buffer.
+static mtx_t trace_lock;
+
+// Frees the buffer of a thread when it exits
+static tss_t trace_key;
+
+// First buffer of the list of the buffers of the threads alive
+static TraceBuffer* trace_buffers;
+
+// First Vector of the list of the Vectors alive
+static Vector* trace_vectors;
+
+// The file of the running trace
+static FILE* trace_file;
+
+// Set when a write to the file failed
+static _Atomic bool trace_failed;
+
+// Generation of the last trace started, kept while none runs
+static u32 trace_last_generation;
+
+// Number of the last Vector numbered by the running trace
+static u64 trace_last_id;
+
+static thread_local TraceBuffer* trace_buffer;
+
+
+// Writes the records of the buffer if they belong to the running trace, and
+// empties it. Must be called with the lock and the lock of the buffer held.
+static void trace_flush(TraceBuffer* buffer) {
+  if (
+    buffer->length > 0 && trace_file != nullptr &&
+    buffer->generation == vector_trace_generation &&
+    fwrite(buffer->bytes, 1, buffer->length, trace_file) != buffer->length
+  ) {
+    trace_failed = true;
+  }
+  buffer->length = 0;
+}
+
+static void trace_exit(void* data) {
+  TraceBuffer* buffer = data;
+  mtx_lock(&trace_lock);
+  mtx_lock(&buffer->lock);
+  trace_flush(buffer);
+  mtx_unlock(&buffer->lock);
+  if (buffer->previous != nullptr) {
+    buffer->previous->next = buffer->next;
+  } else {
+    trace_buffers = buffer->next;
+  }
+  if (buffer->next != nullptr) {
+    buffer->next->previous = buffer->previous;
+  }
+  mtx_unlock(&trace_lock);
+  mtx_destroy(&buffer->lock);
+  free(buffer);
+}
+
+static void trace_init(void) {
+  mtx_init(&trace_lock, mtx_plain);
+  tss_create(&trace_key, trace_exit);
+}
+
+// Returns the buffer of the thread, or nullptr if allocation fails
+static TraceBuffer* trace_thread_buffer(void) {
+  if (trace_buffer != nullptr) {
+    return trace_buffer;
+  }
+
+  TraceBuffer* buffer = malloc(sizeof(TraceBuffer));
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  if (mtx_init(&buffer->lock, mtx_plain) != thrd_success) {
+    free(buffer);
+    return nullptr;
+  }
+  buffer->length = 0;
+
+  mtx_lock(&trace_lock);
+  buffer->generation = vector_trace_generation;
+  buffer->previous = nullptr;
+  buffer->next = trace_buffers;
+  if (trace_buffers != nullptr) {
+    trace_buffers->previous = buffer;
+  }
+  trace_buffers = buffer;
+  mtx_unlock(&trace_lock);
+
+  tss_set(trace_key, buffer);
+  trace_buffer = buffer;
+  return buffer;
+}
+
+// Encodes a record into bytes, of at least TRACE_RECORD_MAX bytes. Returns
+// its size.
+static usize trace_encode(
+  u8*                    bytes,
+  const VectorTraceEvent event,
+  const u64              vector,
+  const u64*             arguments,
+  const usize            count
+) {
+  usize length = 0;
+  bytes[length++] = (u8)event;
+  length += io_varint_encode(bytes + length, vector);
+  for (usize i = 0; i < count; i++) {
+    length += io_varint_encode(bytes + length, arguments[i]);
+  }
+  return length;
+}
+
+// Appends a record to the buffer of the thread
+static void trace_append(
+  const u32              generation,
+  const VectorTraceEvent event,
+  const u64              vector,
+  const u64*             arguments,
+  const usize            count
+) {
+  TraceBuffer* buffer = trace_thread_buffer();
+  if (buffer == nullptr) {
+    trace_failed = true;
+    return;
+  }
+
+  // Records of a previous trace are dropped, and a full buffer is written.
+  // The lock of the file is taken first, then the one of the buffer again.
+  mtx_lock(&buffer->lock);
+  if (buffer->generation != generation || buffer->length > (
+    TRACE_BUFFER_SIZE - TRACE_RECORD_MAX
+  )) {
+    mtx_unlock(&buffer->lock);
+    mtx_lock(&trace_lock);
+    mtx_lock(&buffer->lock);
+    trace_flush(buffer);
+    buffer->generation = generation;
+    mtx_unlock(&trace_lock);
+  }
+
+  buffer->length += trace_encode(
+    buffer->bytes + buffer->length, event, vector, arguments, count
+  );
+  mtx_unlock(&buffer->lock);
+}
+
+void vector_trace_register(Vector* this) {
+  call_once(&trace_once, trace_init);
+  mtx_lock(&trace_lock);
+  this->trace.previous = nullptr;
+  this->trace.next = trace_vectors;
+  if (trace_vectors != nullptr) {
+    trace_vectors->trace.previous = this;
+  }
+  trace_vectors = this;
+
+  // A Vector constructed while a trace runs is numbered at once
+  const u32 generation = vector_trace_generation;
+  if (generation != 0) {
+    this->trace.generation = generation;
+    this->trace.id = ++trace_last_id;
+  }
+  const u64 id = this->trace.id;
+  mtx_unlock(&trace_lock);
+
+  if (generation != 0) {
+    const u64 arguments[] = { this->object_size, this->capacity };
+    trace_append(generation, VECTOR_TRACE_CONSTRUCT, id, arguments, 2);
+  }
+}
+
+void vector_trace_unregister(Vector* this) {
+  mtx_lock(&trace_lock);
+  if (this->trace.previous != nullptr) {
+    this->trace.previous->trace.next = this->trace.next;
+  } else {
+    trace_vectors = this->trace.next;
+  }
+  if (this->trace.next != nullptr) {
+    this->trace.next->trace.previous = this->trace.previous;
+  }
+  const u32 generation = vector_trace_generation;
+  mtx_unlock(&trace_lock);
+
+  // Unlinked, the Vector is no longer numbered by a trace starting
+  if (generation != 0 && this->trace.generation == generation) {
+    trace_append(
+      generation, VECTOR_TRACE_DESTRUCT, this->trace.id, nullptr, 0
+    );
+  }
+}
+
+void vector_trace_record(
+  const Vector*          this,
+  const VectorTraceEvent event,
+  const u64              index,
+  const u64              copy
+) {
+  // Every Vector alive is numbered by the running trace, unless the trace
+  // started or stopped during the call
+  const u32 generation = vector_trace_generation;
+  if (generation == 0 || this->trace.generation != generation) {
+    return;
+  }
+
+  if (event == VECTOR_TRACE_COPY) {
+    const u64 arguments[] = { index, copy };
+    trace_append(generation, event, this->trace.id, arguments, 2);
+  } else {
+    trace_append(
+      generation, event, this->trace.id, &index, trace_indexed(event)
+    );
+  }
+}
+
+bool vector_trace_start(FILE* out) {
+  call_once(&trace_once, trace_init);
+  mtx_lock(&trace_lock);
+  if (vector_trace_generation != 0) {
+    mtx_unlock(&trace_lock);
+    return false;
+  }
+
+  const u32 version = VECTOR_TRACE_VERSION;
+  if (
+    fwrite(VECTOR_TRACE_MAGIC, 8, 1, out) != 1 ||
+    fwrite(&version, sizeof(version), 1, out) != 1
+  ) {
+    mtx_unlock(&trace_lock);
+    return false;
+  }
+
+  trace_file = out;
+  trace_failed = false;
+  trace_last_id = 0;
+  // Skip 0, which means that no trace runs
+  trace_last_generation = trace_last_generation + 1
+    ? trace_last_generation + 1
+    : 1;
+  const u32 generation = trace_last_generation;
+
+  // Number the Vectors alive and introduce them, before any call of the
+  // trace is recorded
+  for (Vector* vector = trace_vectors; vector; vector = vector->trace.next) {
+    vector->trace.generation = generation;
+    vector->trace.id = ++trace_last_id;
+
+    u8 bytes[TRACE_RECORD_MAX];
+    const u64 arguments[] = {
+      vector->object_size, vector->capacity, vector->count
+    };
+    const usize length = trace_encode(
+      bytes, VECTOR_TRACE_ATTACH, vector->trace.id, arguments, 3
+    );
+    if (fwrite(bytes, 1, length, out) != length) {
+      trace_failed = true;
+    }
+  }
+
+  vector_trace_generation = generation;
+  mtx_unlock(&trace_lock);
+  return true;
+}
+
+bool vector_trace_stop(void) {
+  call_once(&trace_once, trace_init);
+  mtx_lock(&trace_lock);
+  if (vector_trace_generation == 0) {
+    mtx_unlock(&trace_lock);
+    return false;
+  }
+
+  for (TraceBuffer* buffer = trace_buffers; buffer; buffer = buffer->next) {
+    mtx_lock(&buffer->lock);
+    trace_flush(buffer);
+    mtx_unlock(&buffer->lock);
+  }
+  const bool ok = !trace_failed && fflush(trace_file) == 0;
+
+  vector_trace_generation = 0;
+  trace_file = nullptr;
+  mtx_unlock(&trace_lock);
+  return ok;
+}
+
+#else
+
+bool vector_trace_start(FILE*) {
+  return false;
+}
+
+bool vector_trace_stop(void) {
+  return false;
+}
+
+#endif
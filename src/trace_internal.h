@@ -0,0 +1,71 @@
+#pragma once
+#include "castor/trace.h"
+#include "castor/types.h"
+
+
+// The tracing hooks of the Vector functions. Without CASTOR_TRACE they
+// expand to nothing, and Vector has no trace state.
+#ifdef CASTOR_TRACE
+
+// Member:
+// - generation:
+//    The trace that numbered the Vector, 0 for none.
+// - id:
+//    Number of the Vector in that trace.
+// - previous, next:
+//    Links of the list of the Vectors alive.
+typedef struct VectorTraceState {
+  u32     generation;
+  u64     id;
+  Vector* previous;
+  Vector* next;
+} VectorTraceState;
+
+// The running trace, 0 when none is
+extern _Atomic u32 vector_trace_generation;
+
+// Adds a Vector to the list of the Vectors alive. While a trace runs, the
+// Vector is numbered and its construction recorded.
+void vector_trace_register(Vector*);
+
+// Removes a Vector from the list of the Vectors alive, and records its
+// destruction if the running trace numbered it.
+void vector_trace_unregister(Vector*);
+
+// Records a call on the Vector. The Vectors are only numbered when they
+// are constructed or when a trace starts, so that a call that only reads
+// the Vector does not write to it either.
+void vector_trace_record(
+  const Vector*          vector,
+  const VectorTraceEvent event,
+  const u64              index,
+  const u64              copy
+);
+
+#define VECTOR_TRACE_CALL(vector, event, index, copy)                         \
+  do {                                                                        \
+    if (vector_trace_generation != 0) {                                       \
+      vector_trace_record(                                                    \
+        (vector), VECTOR_TRACE_##event, (index), (copy)                       \
+      );                                                                      \
+    }                                                                         \
+  } while (0)
+
+#define VECTOR_TRACE_REGISTER(vector)   vector_trace_register(vector)
+#define VECTOR_TRACE_UNREGISTER(vector) vector_trace_unregister(vector)
+#define VECTOR_TRACE(vector, event) \
+  VECTOR_TRACE_CALL(vector, event, 0, 0)
+#define VECTOR_TRACE_INDEX(vector, event, index) \
+  VECTOR_TRACE_CALL(vector, event, index, 0)
+#define VECTOR_TRACE_COPY(vector, shrink, copy) \
+  VECTOR_TRACE_CALL(vector, COPY, shrink, (copy)->trace.id)
+
+#else
+
+#define VECTOR_TRACE_REGISTER(vector)            ((void)0)
+#define VECTOR_TRACE_UNREGISTER(vector)          ((void)0)
+#define VECTOR_TRACE(vector, event)              ((void)0)
+#define VECTOR_TRACE_INDEX(vector, event, index) ((void)0)
+#define VECTOR_TRACE_COPY(vector, shrink, copy)  ((void)0)
+
+#endif
@@ -1,70 +1,205 @@
 #include "castor/vector.h"
 #include "castor/types.h"
+#include "bulk_internal.h"
+#include "cache_internal.h"
+#include "dispatch_internal.h"
+#include "vector_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
 
-// Check if the method is available in the vector's interface
-#define VECTOR_INTERFACE_OK(vector, method) \
-  (vector->interface != nullptr && vector->interface->method != nullptr)
+static Vector* vector_init(Vector* this, const usize capacity) {
+  if (this->storage != nullptr) {
+    if (!this->storage->resize(this, capacity)) {
+      return nullptr;
+    }
+    VECTOR_STATS_RESIZE(this);
+    return this;
+  }
 
+  // Take a buffer from the cache, and use all of it
+  usize bytes = vector_cache_size(capacity * this->object_size);
+  this->content = vector_cache_take(bytes, &bytes);
+  if (this->content == nullptr) {
+    this->content = (u8*)malloc(bytes);
+  }
+  if (this->content == nullptr) {
+    return nullptr;
+  }
+  this->capacity = this->object_size > 0
+    ? bytes / this->object_size
+    : capacity;
+  VECTOR_STATS_RESIZE(this);
+  return this;
+}
 
-// Member:
-// - content: 
-//    Pointer to the content of the vector (dynamic array of objects).
-// - object_size: 
-//    The size of each individual object stored in the vector (in bytes).
-// - capacity: 
-//    The total capacity of the vector (maximum number of objects it can hold).
-// - count: 
-//    The current number of objects in the vector.
-// - interface: 
-//    Interface for custom operations (e.g., release).
-struct Vector {
-  u8*              content;
-  usize            object_size;
-  usize            capacity;
-  usize            count;
-  VectorInterface* interface;
-};
+// The copies of single objects of the sizes that fit in registers, whose
+// memcpy compiles to a few moves rather than a call
+#define VECTOR_COPY_FIXED(bytes)                                              \
+  static void* vector_copy_##bytes(void* dst, const void* src, usize) {      \
+    return memcpy(dst, src, bytes);                                           \
+  }
+
+VECTOR_COPY_FIXED(1)
+VECTOR_COPY_FIXED(2)
+VECTOR_COPY_FIXED(4)
+VECTOR_COPY_FIXED(8)
+VECTOR_COPY_FIXED(16)
+VECTOR_COPY_FIXED(32)
+VECTOR_COPY_FIXED(64)
+
+static VectorCopyObject vector_copy_select(const usize object_size) {
+  switch (object_size) {
+  case 1:  return vector_copy_1;
+  case 2:  return vector_copy_2;
+  case 4:  return vector_copy_4;
+  case 8:  return vector_copy_8;
+  case 16: return vector_copy_16;
+  case 32: return vector_copy_32;
+  case 64: return vector_copy_64;
+  // The other sizes are left to memcpy itself, whose SIMD loops the C
+  // library picks for the CPU
+  default: return memcpy;
+  }
+}
 
+Vector* vector_construct_in(
+  void*                memory,
+  const usize          object_size,
+  const VectorOptions  options,
+  const VectorStorage* storage,
+  void*                storage_context
+) {
+  Vector* this = memset(memory, 0, sizeof(Vector));
+  this->interface = options.interface;
+  this->object_size = object_size;
+  this->copy_object = vector_copy_select(object_size);
+  this->storage = storage;
+  this->storage_context = storage_context;
+  if (options.incremental) {
+    this->flags |= VECTOR_FLAG_INCREMENTAL;
+  }
+
+  // Start with the capacity learned for the call site if none is given
+  usize capacity = options.capacity;
+  if (options.site != nullptr) {
+    this->site = vector_site_find(options.site);
+    if (capacity == 0 && this->site != nullptr) {
+      capacity = vector_site_capacity(this->site);
+    }
+  }
 
-static Vector* vector_init(Vector* this, const usize capacity) {
-  this->content = (u8*)malloc(capacity * this->object_size);
-  if (this->content == nullptr) {
+  if (capacity > 0 && !vector_init(this, capacity)) {
     return nullptr;
   }
-  this->capacity = capacity;
+
+  VECTOR_STATS_REGISTER(this);
+  VECTOR_TRACE_REGISTER(this);
   return this;
 }
 
 Vector* vector_construct(const usize object_size, const VectorOptions options) {
-  Vector* this = calloc(1, sizeof(Vector));
+  Vector* this = vector_cache_take_header();
+  if (this == nullptr) {
+    this = malloc(sizeof(Vector));
+  }
   if (this == nullptr) {
     return nullptr;
   }
 
-  this->interface = options.interface;
-  this->object_size = object_size;
-
   // Free the allocated vector if initialization fails
-  if (options.capacity > 0 && !vector_init(this, options.capacity)) {
-    free(this);
+  if (!vector_construct_in(this, object_size, options, nullptr, nullptr)) {
+    vector_cache_give_header(this);
     return nullptr;
   }
-
   return this;
 }
 
 static void* vector_get_unsafe(const Vector* this, const usize index) {
+  // During an incremental resize, the objects not moved yet are in the old
+  // content
+  if (
+    this->old_content != nullptr &&
+    index >= this->migrated && index < this->old_count
+  ) {
+    return this->old_content + index * this->object_size;
+  }
   return this->content + index * this->object_size;
 }
 
 void* vector_get(Vector* this, const usize index) {
+  VECTOR_TRACE_INDEX(this, GET, index);
   if (index >= this->count) {
     return nullptr;
   }
-  return this->content + index * this->object_size;
+  return vector_get_unsafe(this, index);
+}
+
+// Moves up to count objects of an incremental resize to the content, and
+// frees the old content once they are all moved
+static void vector_migrate(Vector* this, const usize count) {
+  if (this->old_content == nullptr) {
+    return;
+  }
+
+  const usize left = this->old_count - this->migrated;
+  const usize n = count < left ? count : left;
+  const usize offset = this->migrated * this->object_size;
+  memcpy(
+    this->content + offset, this->old_content + offset, n * this->object_size
+  );
+  VECTOR_STATS_MOVE(this, n * this->object_size);
+  this->migrated += n;
+
+  if (this->migrated == this->old_count) {
+    free(this->old_content);
+    this->old_content = nullptr;
+    this->flags &= ~VECTOR_FLAG_MIGRATING;
+  }
+}
+
+// Moves the share of an operation of an incremental resize: a bounded
+// number of bytes, and at least one object so that the move completes
+// before the Vector is full again
+static void vector_migrate_step(Vector* this) {
+  if (this->old_content == nullptr) {
+    return;
+  }
+
+  usize step = 1;
+  if (this->object_size > 0 && this->object_size < VECTOR_MIGRATE_BYTES) {
+    step = VECTOR_MIGRATE_BYTES / this->object_size;
+  }
+  vector_migrate(this, step);
+}
+
+// Drops the objects removed from the back that were not moved yet
+static void vector_migrate_trim(Vector* this) {
+  if (this->old_content != nullptr && this->old_count > this->count) {
+    this->old_count = this->count > this->migrated
+      ? this->count
+      : this->migrated;
+    vector_migrate(this, 0);
+  }
+}
+
+void vector_settle(Vector* this) {
+  if (this->old_content != nullptr) {
+    vector_migrate(this, this->old_count - this->migrated);
+  }
+}
+
+u8* vector_run(const Vector* this, const usize index, usize* end) {
+  if (this->old_content == nullptr || index >= this->old_count) {
+    *end = this->count;
+    return this->content + index * this->object_size;
+  }
+  if (index < this->migrated) {
+    *end = this->migrated;
+    return this->content + index * this->object_size;
+  }
+  *end = this->old_count;
+  return this->old_content + index * this->object_size;
 }
 
 bool vector_empty(const Vector* this) { 
@@ -75,7 +210,68 @@ static bool vector_unallocated(const Vector* this) {
   return this->content == nullptr;
 }
 
-void vector_walk(const Vector* this, void (*callback)(void*)) {
+static bool vector_readonly(const Vector* this) {
+  return this->flags & VECTOR_FLAG_READONLY;
+}
+
+// Extends the dirty bitmap to cover at least the given number of chunks
+static bool vector_dirty_extend(VectorDirty* dirty, const usize chunks) {
+  usize words = (chunks + 63) / 64;
+  // Double the bitmap to amortize the extension
+  words = words > (dirty->chunks + 63) / 64 * 2
+    ? words
+    : (dirty->chunks + 63) / 64 * 2;
+
+  u64* bits = realloc(dirty->bits, words * sizeof(u64));
+  if (bits == nullptr) {
+    return false;
+  }
+
+  const usize old_words = (dirty->chunks + 63) / 64;
+  memset(bits + old_words, 0, (words - old_words) * sizeof(u64));
+  dirty->bits = bits;
+  dirty->chunks = words * 64;
+
+  return true;
+}
+
+// Marks the chunks of the objects in [first, last), out of line as only
+// the Vectors under a Checkpoint get there
+[[gnu::cold, gnu::noinline]]
+static void vector_dirty_record(
+  Vector*     this,
+  const usize first,
+  const usize last
+) {
+  VectorDirty* dirty = this->dirty;
+  if (dirty->all || first >= last) {
+    return;
+  }
+
+  const usize from = first * this->object_size / dirty->chunk_size;
+  const usize to = (last * this->object_size - 1) / dirty->chunk_size;
+  if (to >= dirty->chunks && !vector_dirty_extend(dirty, to + 1)) {
+    dirty->all = true;
+    return;
+  }
+
+  for (usize chunk = from; chunk <= to; chunk++) {
+    dirty->bits[chunk / 64] |= 1ull << (chunk % 64);
+  }
+}
+
+void vector_dirty_mark(
+  Vector*     this,
+  const usize first,
+  const usize last
+) {
+  if (this->dirty != nullptr) {
+    vector_dirty_record(this, first, last);
+  }
+}
+
+// Applies the callback to each object, without recording a walk
+static void vector_apply(const Vector* this, void (*callback)(void*)) {
   if (vector_empty(this)) {
     return;
   }
@@ -86,31 +282,58 @@ void vector_walk(const Vector* this, void (*callback)(void*)) {
   }
 }
 
+void vector_walk(const Vector* this, void (*callback)(void*)) {
+  VECTOR_TRACE(this, WALK);
+  vector_apply(this, callback);
+}
+
 void vector_reset(Vector* this) {
+  VECTOR_STATS_OPERATION(this, RESET);
+  VECTOR_TRACE(this, RESET);
   if (vector_empty(this)) {
     return;
   }
 
   // If the interface has a release method, call it for each object
   if (VECTOR_INTERFACE_OK(this, release)) {
-    vector_walk(this, this->interface->release);
+    vector_apply(this, this->interface->release);
   }
 
   this->count = 0;
+  vector_migrate_trim(this);
 }
 
 void vector_release(Vector* this) {
+  VECTOR_STATS_OPERATION(this, RELEASE);
+  VECTOR_TRACE(this, RELEASE);
   if (vector_unallocated(this)) {
     return;
   }
 
-  // Reset the vector to free any associated resources
-  vector_reset(this);
+  // Release the objects before the content. The count is only cleared
+  // afterwards, as a storage may persist it on release
+  if (VECTOR_INTERFACE_OK(this, release)) {
+    vector_apply(this, this->interface->release);
+  }
   // Free the allocated memory for vector content
-  free(this->content);
+  if (this->storage != nullptr) {
+    this->storage->release(this);
+    // A storage holding the Vector stays for its next content
+    if (this->storage->destruct == nullptr) {
+      this->storage = nullptr;
+      this->storage_context = nullptr;
+    }
+    this->flags &= ~VECTOR_FLAG_READONLY;
+  } else {
+    vector_cache_give(this->content, this->capacity * this->object_size);
+    free(this->old_content);
+    this->old_content = nullptr;
+    this->flags &= ~VECTOR_FLAG_MIGRATING;
+  }
 
   this->content  = nullptr;
   this->capacity = 0;
+  this->count    = 0;
 }
 
 void vector_destruct(Vector* this) {
@@ -118,28 +341,86 @@ void vector_destruct(Vector* this) {
     return;
   }
 
+  // Record the final count for the call site before it is released
+  if (this->site != nullptr) {
+    vector_site_record(this->site, this->count);
+  }
   // Release resources
   vector_release(this);
+  VECTOR_STATS_UNREGISTER(this);
+  VECTOR_TRACE_UNREGISTER(this);
+  // Stop dirty tracking
+  if (this->dirty != nullptr) {
+    free(this->dirty->bits);
+    free(this->dirty);
+  }
   // Free the vector object itself
-  free(this);
+  if (this->storage != nullptr && this->storage->destruct != nullptr) {
+    this->storage->destruct(this);
+  } else {
+    vector_cache_give_header(this);
+  }
 }
 
 static bool vector_resize(Vector* this, const usize new_capacity) {
-  u8* new_content = (u8*)realloc(
-    this->content, 
-    new_capacity * this->object_size
-  );
+  if (this->storage != nullptr) {
+    if (!this->storage->resize(this, new_capacity)) {
+      return false;
+    }
+    VECTOR_STATS_RESIZE(this);
+    return true;
+  }
+
+  // Grow to the size class of the cache, so that the content fits a bucket
+  // once released. The cache is not used here: realloc often extends the
+  // content in place, which beats moving it to a recycled buffer
+  const usize bytes = vector_cache_size(new_capacity * this->object_size);
+  u8* new_content = (u8*)realloc(this->content, bytes);
   if (new_content == nullptr) {
     return false;
   }
 
+  this->content = new_content;
+  this->capacity = this->object_size > 0
+    ? bytes / this->object_size
+    : new_capacity;
+  VECTOR_STATS_RESIZE(this);
+
+  return true;
+}
+
+// Starts an incremental resize: the current content becomes the old one,
+// and its objects are moved by the following operations
+static bool vector_resize_incremental(Vector* this, const usize new_capacity) {
+  // Complete the resize still running, which is rare: the objects are moved
+  // faster than the Vector fills up
+  vector_settle(this);
+
+  u8* new_content = (u8*)malloc(new_capacity * this->object_size);
+  if (new_content == nullptr) {
+    return false;
+  }
+
+  this->old_content = this->content;
+  this->flags |= VECTOR_FLAG_MIGRATING;
+  this->old_count = this->count;
+  this->migrated = 0;
   this->content = new_content;
   this->capacity = new_capacity;
+  VECTOR_STATS_RESIZE(this);
 
+  // Free the old content at once if it holds no object
+  vector_migrate(this, 0);
   return true;
 }
 
-bool vector_grow(Vector* this, const usize n) {
+// Grows the Vector as vector_grow, for the operations that make room
+static bool vector_expand(Vector* this, const usize n) {
+  VECTOR_STATS_OPERATION(this, GROW);
+  if (vector_readonly(this)) {
+    return false;
+  }
+
   usize new_capacity = this->capacity + n;
   // Default to 16 if new capacity is 0
   new_capacity = new_capacity ? new_capacity : 16;
@@ -148,52 +429,173 @@ bool vector_grow(Vector* this, const usize n) {
   if (vector_unallocated(this)) {
     return vector_init(this, new_capacity);
   }
-  
+
+  if (this->flags & VECTOR_FLAG_INCREMENTAL && this->storage == nullptr) {
+    return vector_resize_incremental(this, new_capacity);
+  }
   return vector_resize(this, new_capacity);
 }
 
+bool vector_grow(Vector* this, const usize n) {
+  VECTOR_TRACE_INDEX(this, GROW, n);
+  return vector_expand(this, n);
+}
+
 static bool vector_full(const Vector* this) {
   return this->count == this->capacity;
 }
 
-bool vector_push_back(Vector* this, void* object) {
+// Pushes an object when the Vector is full, read-only, tracked or in an
+// incremental resize
+[[gnu::noinline]]
+static bool vector_push_back_slow(Vector* this, void* object) {
+  if (vector_readonly(this)) {
+    return false;
+  }
+  vector_migrate_step(this);
+
   if (vector_full(this)) {
-    if (!vector_grow(this, this->capacity)) {
+    if (!vector_expand(this, this->capacity)) {
       return false;
     }
   }
 
   void* dest = vector_get_unsafe(this, this->count);
-  memcpy(dest, object, this->object_size);
+  this->copy_object(dest, object, this->object_size);
   this->count++;
+  vector_dirty_mark(this, this->count - 1, this->count);
+
+  return true;
+}
+
+bool vector_push_back(Vector* this, void* object) {
+  VECTOR_STATS_OPERATION(this, PUSH_BACK);
+  VECTOR_TRACE(this, PUSH_BACK);
+  // A single test of the flags keeps the common push as cheap as a store
+  if ((this->flags & VECTOR_FLAGS_SLOW) || vector_full(this)) {
+    return vector_push_back_slow(this, object);
+  }
+
+  this->copy_object(
+    this->content + this->count * this->object_size, object, this->object_size
+  );
+  this->count++;
+
+  return true;
+}
+
+// Returns whether address lies in the objects of the content from first to
+// end, and sets offset to its offset in the content
+static bool vector_holds(
+  const u8*   content,
+  const usize first,
+  const usize end,
+  const usize object_size,
+  const void* address,
+  usize*      offset
+) {
+  if (content == nullptr) {
+    return false;
+  }
+  const uintptr_t begin = (uintptr_t)content + first * object_size;
+  const uintptr_t at = (uintptr_t)address;
+  if (at < begin || at >= (uintptr_t)content + end * object_size) {
+    return false;
+  }
+  *offset = at - (uintptr_t)content;
+  return true;
+}
+
+bool vector_append(Vector* this, const void* objects, const usize count) {
+  VECTOR_STATS_OPERATION(this, APPEND);
+  VECTOR_TRACE_INDEX(this, APPEND, count);
+  if (vector_readonly(this)) {
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+  if (
+    this->object_size > 0 &&
+    count > UINT64_MAX / this->object_size - this->count
+  ) {
+    return false;
+  }
+
+  // Grow once, at least doubling as a push_back would
+  if (this->count + count > this->capacity) {
+    // The objects may be those of the Vector, which growing moves: their
+    // offset is taken first, and found in the content once it is settled
+    usize offset;
+    const bool own = vector_holds(
+      this->content, 0, this->count, this->object_size, objects, &offset
+    ) || vector_holds(
+      this->old_content, this->migrated, this->old_count, this->object_size,
+      objects, &offset
+    );
+
+    const usize needed = this->count + count - this->capacity;
+    if (!vector_expand(
+      this, needed > this->capacity ? needed : this->capacity
+    )) {
+      return false;
+    }
+
+    if (own) {
+      vector_settle(this);
+      objects = this->content + offset;
+    }
+  }
+
+  // The objects past the count are never in the old content of an
+  // incremental resize, so it need not be settled
+  const usize first = this->count;
+  vector_bulk_copy(
+    vector_get_unsafe(this, first), objects, count * this->object_size
+  );
+  this->count += count;
+  vector_dirty_mark(this, first, this->count);
 
   return true;
 }
 
 bool vector_push_front(Vector* this, void* object) {
+  VECTOR_STATS_OPERATION(this, PUSH_FRONT);
+  VECTOR_TRACE(this, PUSH_FRONT);
+  if (vector_readonly(this)) {
+    return false;
+  }
+
   if (vector_full(this)) {
-    if (!vector_grow(this, this->capacity)) {
+    if (!vector_expand(this, this->capacity)) {
       return false;
     }
   }
+  // The shift needs every object in the content
+  vector_settle(this);
 
   void* dest = vector_get_unsafe(this, 1);
   void* src = this->content;
 
   // Move all object one position back to make space at the front
-  memmove(dest, src, this->count * this->object_size);
+  castor_kernels->move(dest, src, this->count * this->object_size);
+  VECTOR_STATS_MOVE(this, this->count * this->object_size);
 
   // Copy the new object to the front
-  memcpy(src, object, this->object_size);
+  this->copy_object(src, object, this->object_size);
   this->count++;
+  vector_dirty_mark(this, 0, this->count);
 
   return true;
 }
 
 bool vector_discard_back(Vector* this) {
-  if (vector_empty(this)) {
+  VECTOR_STATS_OPERATION(this, DISCARD_BACK);
+  VECTOR_TRACE(this, DISCARD_BACK);
+  if (vector_readonly(this) || vector_empty(this)) {
     return false;
   }
+  vector_migrate_step(this);
 
   this->count--;
 
@@ -203,14 +605,18 @@ bool vector_discard_back(Vector* this) {
     void* object = vector_get_unsafe(this, this->count);
     this->interface->release(object);
   }
+  vector_migrate_trim(this);
 
   return true;
 }
 
 bool vector_discard_front(Vector* this) {
-  if (vector_empty(this)) {
+  VECTOR_STATS_OPERATION(this, DISCARD_FRONT);
+  VECTOR_TRACE(this, DISCARD_FRONT);
+  if (vector_readonly(this) || vector_empty(this)) {
     return false;
   }
+  vector_settle(this);
 
   // If a release function is provided, call it for the front element
   if (VECTOR_INTERFACE_OK(this, release)) {
@@ -221,17 +627,24 @@ bool vector_discard_front(Vector* this) {
   void* dest = this->content;
   void* src = this->content + this->object_size;
 
-  // Move all elements one position back to fill the gap
-  memmove(dest, src, this->count * this->object_size);
+  // Move the elements after the first one position back to fill the gap
+  castor_kernels->move(dest, src, (this->count - 1) * this->object_size);
+  VECTOR_STATS_MOVE(this, (this->count - 1) * this->object_size);
   this->count--;
+  vector_dirty_mark(this, 0, this->count);
 
   return true;
 }
 
 bool vector_discard(Vector* this, const usize index) {
-  if (vector_empty(this) || index >= this->count) {
+  VECTOR_STATS_OPERATION(this, DISCARD);
+  VECTOR_TRACE_INDEX(this, DISCARD, index);
+  if (
+    vector_readonly(this) || vector_empty(this) || index >= this->count
+  ) {
     return false;
   }
+  vector_settle(this);
 
   // If a release function is provided, call it for the element at the specified index
   if (VECTOR_INTERFACE_OK(this, release)) {
@@ -243,118 +656,169 @@ bool vector_discard(Vector* this, const usize index) {
   void* src = dest + this->object_size;
 
   // Shift all elements after the removed one to fill the gap
-  memmove(dest, src, (this->count - index - 1) * this->object_size);
+  castor_kernels->move(
+    dest, src, (this->count - index - 1) * this->object_size
+  );
+  VECTOR_STATS_MOVE(this, (this->count - index - 1) * this->object_size);
   this->count--;
+  vector_dirty_mark(this, index, this->count);
 
   return true;
 }
 
 bool vector_pop_back(Vector* this, void* object) {
-  if (vector_empty(this)) {
+  VECTOR_STATS_OPERATION(this, POP_BACK);
+  VECTOR_TRACE(this, POP_BACK);
+  if (vector_readonly(this) || vector_empty(this)) {
     return false;
   }
+  vector_migrate_step(this);
 
   void* src = vector_get_unsafe(this, this->count - 1);
   // Copy it to the provided object buffer
-  memcpy(object, src, this->object_size);
+  this->copy_object(object, src, this->object_size);
   this->count--;
+  vector_migrate_trim(this);
 
   return true;
 }
 
 bool vector_pop_front(Vector* this, void* object) {
-  if (vector_empty(this)) {
+  VECTOR_STATS_OPERATION(this, POP_FRONT);
+  VECTOR_TRACE(this, POP_FRONT);
+  if (vector_readonly(this) || vector_empty(this)) {
     return false;
   }
+  vector_settle(this);
 
   void* src = vector_get_unsafe(this, 0);
   // Copy it to the provided object buffer
-  memcpy(object, src, this->object_size);
+  this->copy_object(object, src, this->object_size);
 
-  // Shift elements forward to fill the gap
-  memmove(src, src + this->object_size, this->count * this->object_size);
+  // Shift the remaining elements forward to fill the gap
+  castor_kernels->move(
+    src, src + this->object_size, (this->count - 1) * this->object_size
+  );
+  VECTOR_STATS_MOVE(this, (this->count - 1) * this->object_size);
   this->count--;
+  vector_dirty_mark(this, 0, this->count);
 
   return true;
 }
 
 bool vector_pop(Vector* this, void* object, const usize index) {
-  if (vector_empty(this) || index >= this->count) {
+  VECTOR_STATS_OPERATION(this, POP);
+  VECTOR_TRACE_INDEX(this, POP, index);
+  if (
+    vector_readonly(this) || vector_empty(this) || index >= this->count
+  ) {
     return false;
   }
+  vector_settle(this);
 
   void* src = vector_get_unsafe(this, index);
   // Copy it to the provided object buffer
-  memcpy(object, src, this->object_size);
+  this->copy_object(object, src, this->object_size);
 
   void* dest = vector_get_unsafe(this, index);
   void* next = src + this->object_size;
 
   // Shift elements after the removed one
-  memmove(dest, next, (this->count - index - 1) * this->object_size);
+  castor_kernels->move(
+    dest, next, (this->count - index - 1) * this->object_size
+  );
+  VECTOR_STATS_MOVE(this, (this->count - index - 1) * this->object_size);
   this->count--;
+  vector_dirty_mark(this, index, this->count);
 
   return true;
 }
 
 bool vector_set(Vector* this, const usize index, void* object) {
-  if (vector_empty(this) || index >= this->count) {
+  VECTOR_STATS_OPERATION(this, SET);
+  VECTOR_TRACE_INDEX(this, SET, index);
+  if (
+    vector_readonly(this) || vector_empty(this) || index >= this->count
+  ) {
     return false;
   }
+  vector_migrate_step(this);
 
   void* dest = vector_get_unsafe(this, index); 
-  memcpy(dest, object, this->object_size);
+  this->copy_object(dest, object, this->object_size);
+  vector_dirty_mark(this, index, index + 1);
 
   return true;
 }
 
 bool vector_insert(Vector* this, const usize index, void* object) {
-  if (vector_empty(this) || index >= this->count) {
+  VECTOR_STATS_OPERATION(this, INSERT);
+  VECTOR_TRACE_INDEX(this, INSERT, index);
+  if (
+    vector_readonly(this) || vector_empty(this) || index >= this->count
+  ) {
     return false;
   }
 
   if (vector_full(this)) {
-    if (!vector_grow(this, this->capacity)) {
+    if (!vector_expand(this, this->capacity)) {
       return false;
     }
   }
+  // The shift needs every object in the content
+  vector_settle(this);
 
   void* dest = vector_get_unsafe(this, index);
   void* src = dest + this->object_size;
 
   // Shift all elements after the insertion point to the right
-  memmove(src, dest, (this->count - index) * this->object_size);
+  castor_kernels->move(
+    src, dest, (this->count - index) * this->object_size
+  );
+  VECTOR_STATS_MOVE(this, (this->count - index) * this->object_size);
 
   // Insert the new object
-  memcpy(dest, object, this->object_size);
+  this->copy_object(dest, object, this->object_size);
   this->count++;
+  vector_dirty_mark(this, index, this->count);
 
   return true;
 }
 
 Vector* vector_copy(Vector* this, const bool shrink_to_fit) {
+  VECTOR_STATS_OPERATION(this, COPY);
   VectorOptions options = {
     // Set the capacity to count if shrinking, else keep the current capacity.
-    .capacity  = shrink_to_fit ? this->count : this->capacity,
-    .interface = this->interface,
+    .capacity    = shrink_to_fit ? this->count : this->capacity,
+    .interface   = this->interface,
+    .incremental = this->flags & VECTOR_FLAG_INCREMENTAL,
   };
 
   // If the vector is empty, just return a new empty vector
   if (shrink_to_fit && vector_empty(this)) {
     options.capacity = 0;
-    return vector_construct(this->object_size, options);
+    Vector* v = vector_construct(this->object_size, options);
+    if (v != nullptr) {
+      VECTOR_TRACE_COPY(this, shrink_to_fit, v);
+    }
+    return v;
   }
 
   Vector* v = vector_construct(this->object_size, options);
   if (v == nullptr) {
     return nullptr;
   }
+  VECTOR_TRACE_COPY(this, shrink_to_fit, v);
+  vector_settle(this);
 
   v->count = this->count;
+  VECTOR_STATS_MOVE(this, this->count * this->object_size);
 
   // If the interface doesn't support copying, just copy the raw memory
   if (!VECTOR_INTERFACE_OK(v, copy)) {
-    memcpy(v->content, this->content, this->count * this->object_size);
+    vector_bulk_copy(
+      v->content, this->content, this->count * this->object_size
+    );
     return v;
   }
 
@@ -373,6 +837,7 @@ Vector* vector_copy(Vector* this, const bool shrink_to_fit) {
 }
 
 void* vector_get_back(const Vector* this) {
+  VECTOR_TRACE(this, GET_BACK);
   if (vector_empty(this)) {
     return nullptr;
   }
@@ -380,8 +845,49 @@ void* vector_get_back(const Vector* this) {
 }
 
 void* vector_get_front(const Vector* this) {
+  VECTOR_TRACE(this, GET_FRONT);
   if (vector_empty(this)) {
     return nullptr;
   }
   return vector_get_unsafe(this, 0);
-}
\ No newline at end of file
+}
+
+// Searches the objects of [begin, end) of the given content
+static bool vector_find_range(
+  const Vector* this,
+  const u8*     content,
+  const usize   begin,
+  const usize   end,
+  const void*   object,
+  usize*        index
+) {
+  if (begin >= end) {
+    return false;
+  }
+  const usize found = castor_kernels->find(
+    content + begin * this->object_size, end - begin, this->object_size, object
+  );
+  if (found == end - begin) {
+    return false;
+  }
+  *index = begin + found;
+  return true;
+}
+
+bool vector_find(const Vector* this, const void* object, usize* index) {
+  if (this->old_content == nullptr) {
+    return vector_find_range(
+      this, this->content, 0, this->count, object, index
+    );
+  }
+
+  // During an incremental resize, search the objects where they are
+  return
+    vector_find_range(this, this->content, 0, this->migrated, object, index) ||
+    vector_find_range(
+      this, this->old_content, this->migrated, this->old_count, object, index
+    ) ||
+    vector_find_range(
+      this, this->content, this->old_count, this->count, object, index
+    );
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "castor/types.h"
+#include "castor/vector.h"
+#include "site_internal.h"
+#include "stats_internal.h"
+#include "trace_internal.h"
+
+
+// Check if the method is available in the vector's interface
+#define VECTOR_INTERFACE_OK(vector, method) \
+  (vector->interface != nullptr && vector->interface->method != nullptr)
+
+// The content of the vector must not be modified.
+#define VECTOR_FLAG_READONLY (1u << 0)
+
+// The vector grows incrementally (see VectorOptions).
+#define VECTOR_FLAG_INCREMENTAL (1u << 1)
+
+// The modifications are tracked in dirty.
+#define VECTOR_FLAG_DIRTY (1u << 2)
+
+// An incremental resize is running: old_content holds objects.
+#define VECTOR_FLAG_MIGRATING (1u << 3)
+
+// The flags that take a modification off its fast path, tested at once
+#define VECTOR_FLAGS_SLOW \
+  (VECTOR_FLAG_READONLY | VECTOR_FLAG_DIRTY | VECTOR_FLAG_MIGRATING)
+
+// Bytes moved by each operation during an incremental resize
+#define VECTOR_MIGRATE_BYTES 4096
+
+
+// VectorStorage describes how the content of a Vector is allocated, resized
+// and released when it does not live in a plain malloc'd buffer (e.g. a
+// mapped file).
+// A Vector without storage uses malloc/realloc/free.
+typedef struct VectorStorage VectorStorage;
+
+// Member:
+// - resize:
+//    Resizes the content to hold new_capacity objects. Called with a nullptr
+//    content for the first allocation. Must update content and capacity on
+//    success.
+// - release:
+//    Releases the content and any state stored in `storage_context`.
+// - destruct:
+//    Frees the Vector itself, for a storage that also holds it (see
+//    vector_construct_in); nullptr if it comes from malloc. Such a storage
+//    stays attached after vector_release, which only releases the content.
+struct VectorStorage {
+  bool (*resize)(Vector*, const usize new_capacity);
+  void (*release)(Vector*);
+  void (*destruct)(Vector*);
+};
+
+// VectorDirty tracks which chunks of the content were modified since the
+// last checkpoint, one bit per chunk of chunk_size bytes.
+typedef struct VectorDirty VectorDirty;
+
+// Member:
+// - bits:
+//    The dirty bitmap.
+// - chunks:
+//    Number of chunks covered by the bitmap. The bitmap is extended when a
+//    chunk past its end is marked.
+// - chunk_size:
+//    Size of a chunk in bytes.
+// - all:
+//    Set when the bitmap could not be extended. Every chunk is dirty.
+struct VectorDirty {
+  u64*  bits;
+  usize chunks;
+  usize chunk_size;
+  bool  all;
+};
+
+// Copies one object of size bytes from src to dst, which do not overlap, as
+// memcpy. The routine of a Vector is chosen for its object size at
+// construction.
+typedef void* (*VectorCopyObject)(void* dst, const void* src, usize size);
+
+// Member:
+// - content:
+//    Pointer to the content of the vector (dynamic array of objects).
+// - object_size:
+//    The size of each individual object stored in the vector (in bytes).
+// - capacity:
+//    The total capacity of the vector (maximum number of objects it can hold).
+// - count:
+//    The current number of objects in the vector.
+// - interface:
+//    Interface for custom operations (e.g., release).
+// - flags:
+//    Combination of VECTOR_FLAG_* values.
+// - storage:
+//    Custom storage for the content, nullptr for the heap.
+// - storage_context:
+//    State owned by the custom storage.
+// - dirty:
+//    Dirty tracking for incremental checkpoints, nullptr when disabled.
+// - old_content:
+//    During an incremental resize, the content before it, still holding
+//    the objects in [migrated, old_count). nullptr otherwise.
+// - old_count:
+//    End of the objects left in old_content.
+// - migrated:
+//    Number of objects moved to the content.
+// - copy_object:
+//    Copies a single object, with a fixed width for the common sizes.
+// - site:
+//    The call site the count is recorded for, nullptr if none.
+// - stats:
+//    The counters, with CASTOR_STATS only.
+// - trace:
+//    The number of the Vector in the trace, with CASTOR_TRACE only.
+struct Vector {
+  u8*                  content;
+  usize                object_size;
+  usize                capacity;
+  usize                count;
+  VectorInterface*     interface;
+  u32                  flags;
+  const VectorStorage* storage;
+  void*                storage_context;
+  VectorDirty*         dirty;
+  u8*                  old_content;
+  usize                old_count;
+  usize                migrated;
+  VectorCopyObject     copy_object;
+  VectorSiteState*     site;
+#ifdef CASTOR_STATS
+  VectorCounters       stats;
+#endif
+#ifdef CASTOR_TRACE
+  VectorTraceState     trace;
+#endif
+};
+
+// Constructs a Vector in the given memory of sizeof(Vector) bytes, with the
+// given storage (nullptr for the heap) and its context. Returns nullptr if
+// the initial capacity cannot be allocated, leaving the memory to the
+// caller.
+Vector* vector_construct_in(
+  void*                memory,
+  const usize          object_size,
+  const VectorOptions  options,
+  const VectorStorage* storage,
+  void*                storage_context
+);
+
+// Completes an incremental resize, so that every object is in the content.
+// Modules that read or write the content of a Vector directly must call it.
+// The objects do not change, only the buffer holding them.
+void vector_settle(Vector*);
+
+// Returns the address of the object at index and sets end to the end of
+// the objects stored after it in the same buffer: the count, or the end of
+// a range of an incremental resize. Modules that read the content of a
+// const Vector directly loop over these runs.
+u8* vector_run(const Vector*, const usize index, usize* end);
+
+// Marks the objects in [first, last) as modified. Modules that write into
+// the content of a Vector directly must call it. The Vectors without dirty
+// tracking only pay the test of their dirty member.
+void vector_dirty_mark(Vector*, const usize first, const usize last);
@@ -0,0 +1,701 @@
+#define _GNU_SOURCE
+#include "castor/wal.h"
+#include "castor/snapshot.h"
+#include "castor/vector.h"
+#include "castor/types.h"
+#include "io_internal.h"
+#include "vector_internal.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// Operations recorded in the log
+enum {
+  WAL_PUSH_BACK = 1,
+  WAL_PUSH_FRONT,
+  WAL_SET,
+  WAL_INSERT,
+  WAL_DISCARD_BACK,
+  WAL_DISCARD_FRONT,
+  WAL_DISCARD,
+};
+
+
+// Member:
+// - op:
+//    The recorded operation, one of the WAL_* values.
+// - checksum:
+//    Low 32 bits of snapshot_checksum over the record (header with a zero
+//    checksum, then the object).
+// - index:
+//    Index argument of the operation, 0 if it takes none.
+// Details:
+// - The object follows the header for the operations that take one.
+typedef struct WalRecord {
+  u8  op;
+  u8  reserved[3];
+  u32 checksum;
+  u64 index;
+} WalRecord;
+
+// Member:
+// - directory:
+//    The directory holding the snapshots and the logs.
+// - vector:
+//    The logged Vector.
+// - window:
+//    Group commit window in microseconds.
+// - generation:
+//    Generation of the log being appended to.
+// - fd:
+//    The log being appended to.
+// - lock:
+//    Protects every member below and the Vector.
+// - flushed:
+//    Signaled when a flush completes.
+// - pending:
+//    Vector of bytes, the records waiting for the next flush.
+// - writing:
+//    Vector of bytes, the records being written by the current flush.
+// - appended:
+//    Number of records appended.
+// - durable:
+//    Number of records known to be durable.
+// - flushing:
+//    Whether a thread is currently flushing.
+// - failed:
+//    Set when writing the log fails. Every further mutation fails.
+// - compacting:
+//    Whether a compaction is running.
+// - joinable:
+//    Whether the compactor thread must be joined.
+// - compactor:
+//    The compaction thread.
+// - compact_generation:
+//    Generation of the snapshot written by the compaction.
+// - snapshot_found:
+//    Whether the directory holds a snapshot.
+// - snapshot_generation:
+//    Generation of the latest snapshot, 0 without any.
+// - stats:
+//    The counters of the Wal.
+struct Wal {
+  char*    directory;
+  Vector*  vector;
+  usize    window;
+  u64      generation;
+  int      fd;
+  mtx_t    lock;
+  cnd_t    flushed;
+  Vector*  pending;
+  Vector*  writing;
+  u64      appended;
+  u64      durable;
+  bool     flushing;
+  bool     failed;
+  bool     compacting;
+  bool     joinable;
+  thrd_t   compactor;
+  u64      compact_generation;
+  bool     snapshot_found;
+  u64      snapshot_generation;
+  WalStats stats;
+};
+
+
+static void wal_path(
+  char*       path,
+  const char* directory,
+  const char* name,
+  const u64   generation
+) {
+  snprintf(
+    path, PATH_MAX, "%s/%s.%llu",
+    directory, name, (unsigned long long)generation
+  );
+}
+
+// Parses "<name>.<generation>", returns false for any other file name
+static bool wal_parse(const char* file, const char* name, u64* generation) {
+  const usize length = strlen(name);
+  if (strncmp(file, name, length) != 0 || file[length] != '.') {
+    return false;
+  }
+
+  const char* digits = file + length + 1;
+  char* end;
+  if (*digits < '0' || *digits > '9') {
+    return false;
+  }
+  *generation = strtoull(digits, &end, 10);
+  return *end == '\0';
+}
+
+static bool wal_has_object(const u8 op) {
+  return op == WAL_PUSH_BACK || op == WAL_PUSH_FRONT
+    || op == WAL_SET || op == WAL_INSERT;
+}
+
+static bool wal_execute(
+  Vector*     vector,
+  const u8    op,
+  const usize index,
+  void*       object
+) {
+  switch (op) {
+    case WAL_PUSH_BACK:     return vector_push_back(vector, object);
+    case WAL_PUSH_FRONT:    return vector_push_front(vector, object);
+    case WAL_SET:           return vector_set(vector, index, object);
+    case WAL_INSERT:        return vector_insert(vector, index, object);
+    case WAL_DISCARD_BACK:  return vector_discard_back(vector);
+    case WAL_DISCARD_FRONT: return vector_discard_front(vector);
+    case WAL_DISCARD:       return vector_discard(vector, index);
+    default:                return false;
+  }
+}
+
+// Encodes a record at the end of the pending buffer
+static bool wal_append(
+  Wal*        this,
+  const u8    op,
+  const usize index,
+  void*       object
+) {
+  Vector* pending = this->pending;
+  const usize object_size = wal_has_object(op) ? this->vector->object_size : 0;
+  const usize size = sizeof(WalRecord) + object_size;
+
+  if (pending->capacity - pending->count < size) {
+    const usize n = pending->capacity > size ? pending->capacity : size;
+    if (!vector_grow(pending, n)) {
+      return false;
+    }
+  }
+
+  u8* record = pending->content + pending->count;
+  WalRecord header = { .op = op, .index = index };
+  memcpy(record, &header, sizeof(header));
+  if (object_size > 0) {
+    memcpy(record + sizeof(header), object, object_size);
+  }
+
+  const u32 checksum = (u32)snapshot_checksum(record, size);
+  memcpy(record + offsetof(WalRecord, checksum), &checksum, sizeof(checksum));
+
+  pending->count += size;
+  this->appended++;
+  this->stats.records++;
+
+  return true;
+}
+
+// Writes and syncs the pending records. Called with the lock held, by the
+// thread leading the group commit.
+static void wal_flush(Wal* this) {
+  this->flushing = true;
+
+  // Give the other writers a chance to join the group
+  if (this->window > 0) {
+    mtx_unlock(&this->lock);
+    thrd_sleep(&(struct timespec){
+      .tv_sec  = (time_t)(this->window / 1000000),
+      .tv_nsec = (long)(this->window % 1000000 * 1000),
+    }, nullptr);
+    mtx_lock(&this->lock);
+  }
+
+  Vector* writing = this->pending;
+  this->pending = this->writing;
+  this->writing = writing;
+
+  const u64 target = this->appended;
+  const int fd = this->fd;
+  const usize length = writing->count;
+
+  // Writers keep appending to the other buffer during the sync
+  mtx_unlock(&this->lock);
+  bool ok = io_write_all(fd, writing->content, length)
+    && fdatasync(fd) == 0;
+  mtx_lock(&this->lock);
+
+  writing->count = 0;
+  this->stats.commits++;
+  this->stats.bytes_written += length;
+  if (ok) {
+    this->durable = target;
+  } else {
+    this->failed = true;
+  }
+
+  this->flushing = false;
+  cnd_broadcast(&this->flushed);
+}
+
+// Waits until the given number of records is durable, leading a flush when
+// none is running
+static bool wal_wait(Wal* this, const u64 lsn) {
+  while (this->durable < lsn && !this->failed) {
+    if (this->flushing) {
+      cnd_wait(&this->flushed, &this->lock);
+    } else {
+      wal_flush(this);
+    }
+  }
+
+  return this->durable >= lsn;
+}
+
+static bool wal_apply(
+  Wal*        this,
+  const u8    op,
+  const usize index,
+  void*       object
+) {
+  mtx_lock(&this->lock);
+
+  bool ok = !this->failed && wal_execute(this->vector, op, index, object);
+  if (ok) {
+    // The operation is applied, a record that can not be logged is a failure
+    // of the log
+    if (!wal_append(this, op, index, object)) {
+      this->failed = true;
+      ok = false;
+    } else {
+      ok = wal_wait(this, this->appended);
+    }
+  }
+
+  mtx_unlock(&this->lock);
+  return ok;
+}
+
+bool wal_push_back(Wal* this, void* object) {
+  return wal_apply(this, WAL_PUSH_BACK, 0, object);
+}
+
+bool wal_push_front(Wal* this, void* object) {
+  return wal_apply(this, WAL_PUSH_FRONT, 0, object);
+}
+
+bool wal_set(Wal* this, const usize index, void* object) {
+  return wal_apply(this, WAL_SET, index, object);
+}
+
+bool wal_insert(Wal* this, const usize index, void* object) {
+  return wal_apply(this, WAL_INSERT, index, object);
+}
+
+bool wal_discard_back(Wal* this) {
+  return wal_apply(this, WAL_DISCARD_BACK, 0, nullptr);
+}
+
+bool wal_discard_front(Wal* this) {
+  return wal_apply(this, WAL_DISCARD_FRONT, 0, nullptr);
+}
+
+bool wal_discard(Wal* this, const usize index) {
+  return wal_apply(this, WAL_DISCARD, index, nullptr);
+}
+
+// Replays the records of the log open as fd onto the Vector, until a torn
+// or corrupted record. Sets end to the length of the records replayed and
+// length to the one of the log.
+// Returns false if the log can not be read.
+static bool wal_replay_log(
+  Vector*   vector,
+  const int fd,
+  u8*       scratch,
+  usize*    end,
+  usize*    length,
+  u64*      replayed
+) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+
+  *length = (usize)st.st_size;
+  u8* log = *length > 0
+    ? mmap(nullptr, *length, PROT_READ, MAP_PRIVATE, fd, 0)
+    : nullptr;
+  if (log == MAP_FAILED) {
+    return false;
+  }
+
+  usize offset = 0;
+  while (*length - offset >= sizeof(WalRecord)) {
+    WalRecord header;
+    memcpy(&header, log + offset, sizeof(header));
+
+    const usize object_size = wal_has_object(header.op)
+      ? vector->object_size
+      : 0;
+    const usize size = sizeof(WalRecord) + object_size;
+    if (*length - offset < size) {
+      break;
+    }
+
+    // Verify the checksum on a copy with a zero checksum field
+    const u32 checksum = header.checksum;
+    header.checksum = 0;
+    memcpy(scratch, &header, sizeof(header));
+    memcpy(
+      scratch + sizeof(header), log + offset + sizeof(header), object_size
+    );
+    if ((u32)snapshot_checksum(scratch, size) != checksum) {
+      break;
+    }
+
+    void* object = scratch + sizeof(header);
+    if (!wal_execute(vector, header.op, header.index, object)) {
+      break;
+    }
+
+    offset += size;
+    (*replayed)++;
+  }
+
+  if (log != nullptr) {
+    munmap(log, *length);
+  }
+
+  *end = offset;
+  return true;
+}
+
+// Replays the records of one log. A torn or corrupted record ends the log,
+// and the file is truncated before it.
+// Returns false if the log ended early.
+static bool wal_replay(Wal* this, const char* path, u8* scratch) {
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  usize end;
+  usize length;
+  if (!wal_replay_log(
+    this->vector, fd, scratch, &end, &length, &this->stats.replayed
+  )) {
+    close(fd);
+    return false;
+  }
+
+  // Drop the torn tail so new records directly follow the last valid one
+  const bool complete = end == length;
+  if (!complete && ftruncate(fd, (off_t)end) != 0) {
+    this->failed = true;
+  }
+  close(fd);
+
+  return complete;
+}
+
+// Loads the latest snapshot and replays the logs written after it
+static bool wal_recover(Wal* this, const usize object_size) {
+  DIR* dir = opendir(this->directory);
+  if (dir == nullptr) {
+    return false;
+  }
+
+  bool found = false;
+  u64 latest = 0;
+  for (struct dirent* entry; (entry = readdir(dir)) != nullptr;) {
+    u64 generation;
+    if (
+      wal_parse(entry->d_name, "snapshot", &generation) &&
+      (!found || generation > latest)
+    ) {
+      found = true;
+      latest = generation;
+    }
+  }
+  closedir(dir);
+
+  char path[PATH_MAX];
+  if (found) {
+    wal_path(path, this->directory, "snapshot", latest);
+    this->vector = snapshot_load(path, (SnapshotOptions){
+      .mode   = SNAPSHOT_COPY_ON_WRITE,
+      .verify = true,
+    });
+  } else {
+    this->vector = vector_construct(object_size, (VectorOptions){});
+  }
+
+  if (this->vector == nullptr || this->vector->object_size != object_size) {
+    return false;
+  }
+
+  u8* scratch = malloc(sizeof(WalRecord) + object_size);
+  if (scratch == nullptr) {
+    return false;
+  }
+
+  // Replay every following generation until a log is missing or torn
+  this->snapshot_found = found;
+  this->snapshot_generation = latest;
+  this->generation = latest;
+  for (u64 generation = latest;; generation++) {
+    wal_path(path, this->directory, "wal", generation);
+    if (access(path, F_OK) != 0) {
+      break;
+    }
+
+    this->generation = generation;
+    if (!wal_replay(this, path, scratch)) {
+      // The records of the following generations depend on the lost ones
+      for (u64 next = generation + 1;; next++) {
+        wal_path(path, this->directory, "wal", next);
+        if (unlink(path) != 0) {
+          break;
+        }
+      }
+      break;
+    }
+  }
+
+  free(scratch);
+
+  wal_path(path, this->directory, "wal", this->generation);
+  this->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  return this->fd >= 0;
+}
+
+Wal* wal_open(
+  const char*      directory,
+  const usize      object_size,
+  const WalOptions options
+) {
+  Wal* this = calloc(1, sizeof(Wal));
+  if (this == nullptr) {
+    return nullptr;
+  }
+
+  this->fd = -1;
+  this->window = options.commit_window;
+  this->directory = strdup(directory);
+  this->pending = vector_construct(1, (VectorOptions){ .capacity = 4096 });
+  this->writing = vector_construct(1, (VectorOptions){ .capacity = 4096 });
+
+  if (
+    this->directory == nullptr ||
+    this->pending == nullptr ||
+    this->writing == nullptr ||
+    mtx_init(&this->lock, mtx_plain) != thrd_success
+  ) {
+    goto fail;
+  }
+
+  if (cnd_init(&this->flushed) != thrd_success) {
+    mtx_destroy(&this->lock);
+    goto fail;
+  }
+
+  if (!wal_recover(this, object_size)) {
+    cnd_destroy(&this->flushed);
+    mtx_destroy(&this->lock);
+    goto fail;
+  }
+
+  return this;
+
+fail:
+  if (this->fd >= 0) {
+    close(this->fd);
+  }
+  vector_destruct(this->vector);
+  vector_destruct(this->pending);
+  vector_destruct(this->writing);
+  free(this->directory);
+  free(this);
+  return nullptr;
+}
+
+void wal_close(Wal* this) {
+  if (this == nullptr) {
+    return;
+  }
+
+  if (this->joinable) {
+    thrd_join(this->compactor, nullptr);
+  }
+
+  close(this->fd);
+  cnd_destroy(&this->flushed);
+  mtx_destroy(&this->lock);
+  vector_destruct(this->vector);
+  vector_destruct(this->pending);
+  vector_destruct(this->writing);
+  free(this->directory);
+  free(this);
+}
+
+Vector* wal_vector(Wal* this) {
+  return this->vector;
+}
+
+// Removes the snapshots and logs older than the given generation
+static void wal_remove_before(Wal* this, const u64 generation) {
+  DIR* dir = opendir(this->directory);
+  if (dir == nullptr) {
+    return;
+  }
+
+  char path[PATH_MAX];
+  for (struct dirent* entry; (entry = readdir(dir)) != nullptr;) {
+    u64 found;
+    if (
+      (wal_parse(entry->d_name, "snapshot", &found) ||
+       wal_parse(entry->d_name, "wal", &found)) &&
+      found < generation
+    ) {
+      snprintf(path, sizeof(path), "%s/%s", this->directory, entry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dir);
+}
+
+// Rebuilds the Vector as of the start of the given generation from the
+// latest snapshot and the logs written since, which are complete: the
+// writers append to the given generation. Only the compaction thread
+// changes the snapshot members, so they are read without the lock.
+static Vector* wal_rebuild(Wal* this, const u64 generation) {
+  char path[PATH_MAX];
+  Vector* vector;
+  if (this->snapshot_found) {
+    wal_path(path, this->directory, "snapshot", this->snapshot_generation);
+    vector = snapshot_load(path, (SnapshotOptions){
+      .mode   = SNAPSHOT_COPY_ON_WRITE,
+      .verify = true,
+    });
+  } else {
+    vector = vector_construct(this->vector->object_size, (VectorOptions){});
+  }
+
+  u8* scratch = malloc(sizeof(WalRecord) + this->vector->object_size);
+  bool ok = vector != nullptr && scratch != nullptr;
+  for (u64 next = this->snapshot_generation; ok && next < generation; next++) {
+    wal_path(path, this->directory, "wal", next);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    usize end;
+    usize length;
+    u64 replayed = 0;
+    ok = fd >= 0
+      && wal_replay_log(vector, fd, scratch, &end, &length, &replayed)
+      && end == length;
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  free(scratch);
+
+  if (!ok) {
+    vector_destruct(vector);
+    return nullptr;
+  }
+  return vector;
+}
+
+static int wal_compact_run(void* argument) {
+  Wal* this = argument;
+  const u64 generation = this->compact_generation;
+
+  char path[PATH_MAX];
+  wal_path(path, this->directory, "snapshot", generation);
+
+  // snapshot_save makes the snapshot durable before it returns, so the
+  // previous generation can be removed after it
+  Vector* copy = wal_rebuild(this, generation);
+  const bool ok = copy != nullptr && snapshot_save(copy, path);
+  vector_destruct(copy);
+  if (ok) {
+    wal_remove_before(this, generation);
+  }
+
+  mtx_lock(&this->lock);
+  this->compacting = false;
+  if (ok) {
+    this->snapshot_found = true;
+    this->snapshot_generation = generation;
+    this->stats.compactions++;
+  }
+  mtx_unlock(&this->lock);
+
+  return 0;
+}
+
+bool wal_compact(Wal* this) {
+  mtx_lock(&this->lock);
+  if (this->compacting || this->failed) {
+    mtx_unlock(&this->lock);
+    return false;
+  }
+
+  // Reap the previous compaction
+  if (this->joinable) {
+    thrd_join(this->compactor, nullptr);
+    this->joinable = false;
+  }
+
+  // Drain the log, so that the current generation is complete on disk once
+  // the writers move to the next one
+  while (this->flushing || this->pending->count > 0) {
+    if (this->flushing) {
+      cnd_wait(&this->flushed, &this->lock);
+    } else {
+      wal_flush(this);
+    }
+  }
+
+  char path[PATH_MAX];
+  wal_path(path, this->directory, "wal", this->generation + 1);
+  int fd = open(
+    path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644
+  );
+  if (fd < 0 || this->failed) {
+    if (fd >= 0) {
+      close(fd);
+      unlink(path);
+    }
+    mtx_unlock(&this->lock);
+    return false;
+  }
+
+  // Start the new generation. The snapshot is rebuilt from the files by
+  // the compaction thread, so the writers do not wait for a copy.
+  close(this->fd);
+  this->fd = fd;
+  this->generation++;
+  this->compact_generation = this->generation;
+  this->compacting = true;
+
+  if (thrd_create(&this->compactor, wal_compact_run, this) != thrd_success) {
+    // The new log is valid on its own, only the snapshot is missing
+    this->compacting = false;
+    mtx_unlock(&this->lock);
+    return false;
+  }
+
+  this->joinable = true;
+  mtx_unlock(&this->lock);
+  return true;
+}
+
+WalStats wal_stats(Wal* this) {
+  mtx_lock(&this->lock);
+  WalStats stats = this->stats;
+  mtx_unlock(&this->lock);
+  return stats;
+}
\ No newline at end of file
@@ -6,6 +6,28 @@ add_rules("mode.release", "mode.debug")
 
 add_includedirs("include")
 
+option("stats")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Count the operations and allocations of each Vector")
+  add_defines("CASTOR_STATS")
+
+option("trace")
+  set_default(false)
+  set_showmenu(true)
+  set_description("Record the Vector calls to a trace for offline replay")
+  add_defines("CASTOR_TRACE")
+
 target("castor")
   set_kind("static")
-  add_files("src/*.c")
\ No newline at end of file
+  add_files("src/*.c")
+  add_options("stats", "trace")
+  add_syslinks("pthread", {public = true})
+
+target("castor_bench")
+  set_kind("binary")
+  set_default(false)
+  set_languages("c23", "cxx20")
+  add_deps("castor")
+  add_files("bench/*.c", "bench/*.cpp")
+  add_syslinks("m")